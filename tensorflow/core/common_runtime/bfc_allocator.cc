@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <atomic>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/allocator_retry.h"
 #include "tensorflow/core/lib/core/bits.h"
@@ -37,6 +39,323 @@ namespace tensorflow {
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
 constexpr uint64 BFCAllocator::kMemDebugHistorySize;
 
+namespace {
+
+// Sets `*max` to `value` if `value` is larger.
+void UpdateMax(std::atomic<int64>* max, int64 value) {
+  int64 prev = max->load(std::memory_order_relaxed);
+  while (value > prev &&
+         !max->compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+// A cache of small blocks in front of the bins of a BFCAllocator. See
+// BFCAllocator::EnableThreadLocalCache().
+class BFCAllocator::ThreadLocalCache {
+ public:
+  explicit ThreadLocalCache(BFCAllocator* allocator)
+      : allocator_(allocator),
+        id_(next_id_.fetch_add(1)),
+        shared_(std::make_shared<SharedFreeLists>()),
+        max_slabs_(std::min<size_t>(
+            kMaxSlabs, allocator->memory_limit_ / (4 * kSlabBytes))),
+        slab_table_(new SlabTableEntry[kSlabTableSize]()) {}
+
+  // Returns true if the cache can serve an allocation of `num_bytes`.
+  static bool IsCacheable(size_t num_bytes) {
+    return num_bytes > 0 && num_bytes <= kMaxBlockBytes;
+  }
+
+  // Returns a block of at least `num_bytes`, or nullptr if no slab could be
+  // allocated. REQUIRES: IsCacheable(num_bytes).
+  void* Allocate(size_t num_bytes) {
+    const int size_class = SizeClass(num_bytes);
+    PerThreadCache* cache = GetPerThreadCache();
+    std::vector<Block>* blocks = &cache->blocks[size_class];
+    if (blocks->empty() && !Refill(size_class, blocks)) return nullptr;
+    const Block block = blocks->back();
+    blocks->pop_back();
+
+    Slab* slab = block.slab;
+    const size_t index =
+        (static_cast<char*>(block.ptr) - slab->base) / slab->block_size;
+    if (cache->next_allocation_id == cache->end_allocation_id) {
+      cache->next_allocation_id = allocator_->next_allocation_id_.fetch_add(
+          kAllocationIdBatch, std::memory_order_relaxed);
+      cache->end_allocation_id = cache->next_allocation_id + kAllocationIdBatch;
+    }
+    slab->requested_sizes[index].store(num_bytes, std::memory_order_relaxed);
+    slab->allocation_ids[index].store(cache->next_allocation_id++,
+                                      std::memory_order_relaxed);
+    allocator_->RecordCachedAllocation(slab->block_size);
+    return block.ptr;
+  }
+
+  // Returns `ptr` to the cache if it was allocated by the cache, in which case
+  // it returns true. Otherwise returns false.
+  bool Deallocate(void* ptr) {
+    Slab* slab = FindSlab(ptr);
+    if (slab == nullptr) return false;
+    const size_t index =
+        (static_cast<char*>(ptr) - slab->base) / slab->block_size;
+    slab->allocation_ids[index].store(-1, std::memory_order_relaxed);
+    allocator_->RecordCachedDeallocation(slab->block_size);
+
+    std::vector<Block>* blocks =
+        &GetPerThreadCache()->blocks[slab->size_class];
+    blocks->push_back({ptr, slab});
+    if (blocks->size() >= 2 * kBatchSize) {
+      shared_->Push(slab->size_class, blocks, kBatchSize);
+    }
+    return true;
+  }
+
+  // If `ptr` was allocated by the cache, stores its requested size, block
+  // size and allocation id and returns true.
+  bool Lookup(const void* ptr, size_t* requested_size, size_t* allocated_size,
+              int64* allocation_id) const {
+    const Slab* slab = FindSlab(ptr);
+    if (slab == nullptr) return false;
+    const size_t index =
+        (static_cast<const char*>(ptr) - slab->base) / slab->block_size;
+    *requested_size =
+        slab->requested_sizes[index].load(std::memory_order_relaxed);
+    *allocated_size = slab->block_size;
+    *allocation_id = slab->allocation_ids[index].load(std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  // Size classes are the powers of two from kMinBlockBytes to kMaxBlockBytes.
+  static constexpr size_t kMinBlockBytes = 256;
+  static constexpr int kNumSizeClasses = 7;
+  static constexpr size_t kMaxBlockBytes = kMinBlockBytes
+                                           << (kNumSizeClasses - 1);
+  static constexpr int kSlabShift = 18;
+  static constexpr size_t kSlabBytes = size_t{1} << kSlabShift;
+  static constexpr size_t kMaxSlabs = 1024;
+  // Power of two, and large enough to keep the load factor of the table at
+  // most 1/2, since a slab is registered under at most two windows.
+  static constexpr size_t kSlabTableSize = 4 * kMaxSlabs;
+  // Number of blocks moved between a per-thread and the shared free list at
+  // a time.
+  static constexpr size_t kBatchSize = 32;
+  // Number of allocation ids reserved by a thread at a time.
+  static constexpr int64 kAllocationIdBatch = 1024;
+
+  struct Slab {
+    char* base;
+    size_t block_size;
+    int size_class;
+    std::unique_ptr<std::atomic<size_t>[]> requested_sizes;
+    std::unique_ptr<std::atomic<int64>[]> allocation_ids;
+  };
+
+  struct Block {
+    void* ptr;
+    Slab* slab;
+  };
+
+  // Free lists shared by all threads. Reference counted because the
+  // per-thread caches return their blocks here when their thread exits,
+  // which may happen after the allocator has been destroyed.
+  struct SharedFreeLists {
+    struct FreeList {
+      mutex mu;
+      std::vector<Block> blocks TF_GUARDED_BY(mu);
+    };
+    FreeList lists[kNumSizeClasses];
+
+    // Moves the last `n` blocks of `*blocks` to the free list of
+    // `size_class`.
+    void Push(int size_class, std::vector<Block>* blocks, size_t n) {
+      n = std::min(n, blocks->size());
+      FreeList& list = lists[size_class];
+      mutex_lock l(list.mu);
+      list.blocks.insert(list.blocks.end(), blocks->end() - n, blocks->end());
+      blocks->resize(blocks->size() - n);
+    }
+
+    // Moves up to `n` blocks of the free list of `size_class` to `*blocks`.
+    // Returns false if the free list is empty.
+    bool Pop(int size_class, std::vector<Block>* blocks, size_t n) {
+      FreeList& list = lists[size_class];
+      mutex_lock l(list.mu);
+      n = std::min(n, list.blocks.size());
+      blocks->insert(blocks->end(), list.blocks.end() - n, list.blocks.end());
+      list.blocks.resize(list.blocks.size() - n);
+      return n > 0;
+    }
+  };
+
+  struct PerThreadCache {
+    explicit PerThreadCache(std::shared_ptr<SharedFreeLists> shared)
+        : shared(std::move(shared)) {}
+    ~PerThreadCache() {
+      for (int i = 0; i < kNumSizeClasses; ++i) {
+        shared->Push(i, &blocks[i], blocks[i].size());
+      }
+    }
+
+    std::shared_ptr<SharedFreeLists> shared;
+    std::vector<Block> blocks[kNumSizeClasses];
+    int64 next_allocation_id = 0;
+    int64 end_allocation_id = 0;
+  };
+
+  // The per-thread caches of the current thread, keyed by ThreadLocalCache
+  // id. Ids are never reused, so entries of destroyed allocators are never
+  // looked up again.
+  struct PerThreadCaches {
+    uint64 last_id = 0;
+    PerThreadCache* last = nullptr;
+    absl::flat_hash_map<uint64, std::unique_ptr<PerThreadCache>> caches;
+  };
+
+  // An entry of the lock-free table that maps kSlabBytes-aligned address
+  // windows to the (at most two) slabs that overlap them.
+  struct SlabTableEntry {
+    // `window + 1`, or 0 if the entry is empty.
+    std::atomic<uintptr_t> key;
+    std::atomic<Slab*> slabs[2];
+  };
+
+  static int SizeClass(size_t num_bytes) {
+    if (num_bytes <= kMinBlockBytes) return 0;
+    return Log2Ceiling64(num_bytes) - Log2Floor64(kMinBlockBytes);
+  }
+
+  static size_t SlabTableIndex(uintptr_t key) {
+    return (key * 0x9E3779B97F4A7C15ull) >>
+           (64 - Log2Floor64(kSlabTableSize));
+  }
+
+  PerThreadCache* GetPerThreadCache() {
+    static thread_local PerThreadCaches per_thread_caches;
+    PerThreadCaches& caches = per_thread_caches;
+    if (TF_PREDICT_TRUE(caches.last_id == id_)) return caches.last;
+    std::unique_ptr<PerThreadCache>& cache = caches.caches[id_];
+    if (cache == nullptr) cache.reset(new PerThreadCache(shared_));
+    caches.last_id = id_;
+    caches.last = cache.get();
+    return cache.get();
+  }
+
+  // Adds blocks of `size_class` to the empty per-thread free list `*blocks`,
+  // taking them from the shared free list or from a new slab.
+  bool Refill(int size_class, std::vector<Block>* blocks) {
+    if (shared_->Pop(size_class, blocks, kBatchSize)) return true;
+    Slab* slab = NewSlab(size_class);
+    if (slab == nullptr) return false;
+    const size_t num_blocks = kSlabBytes / slab->block_size;
+    blocks->reserve(std::max(num_blocks, 2 * kBatchSize));
+    for (size_t i = num_blocks; i > 0; --i) {
+      blocks->push_back({slab->base + (i - 1) * slab->block_size, slab});
+    }
+    if (blocks->size() > kBatchSize) {
+      shared_->Push(size_class, blocks, blocks->size() - kBatchSize);
+    }
+    return true;
+  }
+
+  Slab* NewSlab(int size_class) {
+    mutex_lock l(slabs_mu_);
+    if (slabs_.size() >= max_slabs_) return nullptr;
+    void* base = allocator_->AllocateCacheSlab(kSlabBytes);
+    if (base == nullptr) return nullptr;
+
+    auto slab = absl::make_unique<Slab>();
+    slab->base = static_cast<char*>(base);
+    slab->block_size = kMinBlockBytes << size_class;
+    slab->size_class = size_class;
+    const size_t num_blocks = kSlabBytes / slab->block_size;
+    slab->requested_sizes.reset(new std::atomic<size_t>[num_blocks]());
+    slab->allocation_ids.reset(new std::atomic<int64>[num_blocks]());
+
+    const uintptr_t first_window = reinterpret_cast<uintptr_t>(base) >>
+                                   kSlabShift;
+    const uintptr_t last_window =
+        (reinterpret_cast<uintptr_t>(base) + kSlabBytes - 1) >> kSlabShift;
+    for (uintptr_t window = first_window; window <= last_window; ++window) {
+      InsertSlabLocked(window, slab.get());
+    }
+    slabs_.push_back(std::move(slab));
+    return slabs_.back().get();
+  }
+
+  void InsertSlabLocked(uintptr_t window, Slab* slab)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(slabs_mu_) {
+    const uintptr_t key = window + 1;
+    for (size_t i = SlabTableIndex(key);; i = (i + 1) % kSlabTableSize) {
+      SlabTableEntry& entry = slab_table_[i];
+      const uintptr_t entry_key = entry.key.load(std::memory_order_relaxed);
+      if (entry_key == key) {
+        // A window overlaps at most two slabs, since slabs do not overlap
+        // and are as large as a window.
+        const int slot =
+            entry.slabs[0].load(std::memory_order_relaxed) == nullptr ? 0 : 1;
+        DCHECK(entry.slabs[slot].load(std::memory_order_relaxed) == nullptr);
+        entry.slabs[slot].store(slab, std::memory_order_release);
+        return;
+      }
+      if (entry_key == 0) {
+        entry.slabs[0].store(slab, std::memory_order_relaxed);
+        entry.key.store(key, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+  // Returns the slab that contains `ptr`, or nullptr if `ptr` was not
+  // allocated by the cache. Lock-free: slabs are only ever added to the table,
+  // and a pointer can only be looked up after its slab has been inserted.
+  Slab* FindSlab(const void* ptr) const {
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    const uintptr_t key = (addr >> kSlabShift) + 1;
+    for (size_t i = SlabTableIndex(key), n = 0; n < kSlabTableSize;
+         i = (i + 1) % kSlabTableSize, ++n) {
+      const SlabTableEntry& entry = slab_table_[i];
+      const uintptr_t entry_key = entry.key.load(std::memory_order_acquire);
+      if (entry_key == 0) return nullptr;
+      if (entry_key != key) continue;
+      for (const auto& slot : entry.slabs) {
+        Slab* slab = slot.load(std::memory_order_acquire);
+        if (slab != nullptr && addr >= reinterpret_cast<uintptr_t>(slab->base) &&
+            addr < reinterpret_cast<uintptr_t>(slab->base) + kSlabBytes) {
+          return slab;
+        }
+      }
+      return nullptr;
+    }
+    return nullptr;
+  }
+
+  static std::atomic<uint64> next_id_;
+
+  BFCAllocator* const allocator_;  // Not owned.
+  const uint64 id_;
+  const std::shared_ptr<SharedFreeLists> shared_;
+  const size_t max_slabs_;
+
+  mutex slabs_mu_;
+  std::vector<std::unique_ptr<Slab>> slabs_ TF_GUARDED_BY(slabs_mu_);
+  std::unique_ptr<SlabTableEntry[]> slab_table_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ThreadLocalCache);
+};
+
+std::atomic<uint64> BFCAllocator::ThreadLocalCache::next_id_{1};
+constexpr size_t BFCAllocator::ThreadLocalCache::kMinBlockBytes;
+constexpr int BFCAllocator::ThreadLocalCache::kNumSizeClasses;
+constexpr size_t BFCAllocator::ThreadLocalCache::kMaxBlockBytes;
+constexpr size_t BFCAllocator::ThreadLocalCache::kSlabBytes;
+constexpr size_t BFCAllocator::ThreadLocalCache::kMaxSlabs;
+constexpr size_t BFCAllocator::ThreadLocalCache::kSlabTableSize;
+constexpr size_t BFCAllocator::ThreadLocalCache::kBatchSize;
+constexpr int64 BFCAllocator::ThreadLocalCache::kAllocationIdBatch;
+
 BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                            bool allow_growth, const string& name,
                            bool garbage_collection)
@@ -254,6 +573,13 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(1) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (thread_local_cache_ != nullptr &&
+      ThreadLocalCache::IsCacheable(num_bytes) &&
+      allocation_attr.freed_by_func == nullptr && timing_counter_ == nullptr) {
+    void* ptr = thread_local_cache_->Allocate(num_bytes);
+    if (ptr != nullptr) return ptr;
+    // Fall back to the bins, e.g. to retry on failure.
+  }
   if (!allocation_attr.retry_on_failure) {
     // Return immediately upon the first failure if this is for allocating an
     // optional scratch space.
@@ -286,6 +612,42 @@ void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
   }
 }
 
+void BFCAllocator::EnableThreadLocalCache() {
+  thread_local_cache_.reset(new ThreadLocalCache(this));
+}
+
+void* BFCAllocator::AllocateCacheSlab(size_t num_bytes) {
+  const size_t rounded_bytes = RoundedBytes(num_bytes);
+  const BinNum bin_num = BinNumForSize(rounded_bytes);
+  mutex_lock l(lock_);
+  const AllocatorStats saved_stats = stats_;
+  void* ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, 0);
+  if (ptr == nullptr && Extend(kAllocatorAlignment, rounded_bytes)) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, 0);
+  }
+  // The slab is not a user allocation, so undo the stats updates of
+  // FindChunkPtr().
+  stats_.num_allocs = saved_stats.num_allocs;
+  stats_.bytes_in_use = saved_stats.bytes_in_use;
+  stats_.peak_bytes_in_use = saved_stats.peak_bytes_in_use;
+  stats_.largest_alloc_size = saved_stats.largest_alloc_size;
+  uncached_bytes_in_use_.store(stats_.bytes_in_use, std::memory_order_relaxed);
+  return ptr;
+}
+
+void BFCAllocator::RecordCachedAllocation(int64 num_bytes) {
+  cached_num_allocs_.fetch_add(1, std::memory_order_relaxed);
+  const int64 bytes_in_use =
+      cached_bytes_in_use_.fetch_add(num_bytes, std::memory_order_relaxed) +
+      num_bytes + uncached_bytes_in_use_.load(std::memory_order_relaxed);
+  UpdateMax(&cached_peak_bytes_in_use_, bytes_in_use);
+  UpdateMax(&cached_largest_alloc_size_, num_bytes);
+}
+
+void BFCAllocator::RecordCachedDeallocation(int64 num_bytes) {
+  cached_bytes_in_use_.fetch_sub(num_bytes, std::memory_order_relaxed);
+}
+
 // static
 size_t BFCAllocator::RoundedBytes(size_t bytes) {
   size_t rounded_bytes =
@@ -560,13 +922,18 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         chunk->requested_size = num_bytes;
         // Assign a unique id and increment the id counter, marking the
         // chunk as being in use.
-        chunk->allocation_id = next_allocation_id_++;
+        chunk->allocation_id =
+            next_allocation_id_.fetch_add(1, std::memory_order_relaxed);
 
         // Update stats.
         ++stats_.num_allocs;
         stats_.bytes_in_use += chunk->size;
-        stats_.peak_bytes_in_use =
-            std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+        uncached_bytes_in_use_.store(stats_.bytes_in_use,
+                                     std::memory_order_relaxed);
+        stats_.peak_bytes_in_use = std::max(
+            stats_.peak_bytes_in_use,
+            stats_.bytes_in_use +
+                cached_bytes_in_use_.load(std::memory_order_relaxed));
         stats_.largest_alloc_size =
             std::max<std::size_t>(stats_.largest_alloc_size, chunk->size);
         if (ShouldRecordOpName()) {
@@ -639,6 +1006,10 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(1) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
+  if (thread_local_cache_ != nullptr && ptr != nullptr &&
+      thread_local_cache_->Deallocate(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -761,6 +1132,7 @@ void BFCAllocator::MarkFree(BFCAllocator::ChunkHandle h) {
 
   // Updates the stats.
   stats_.bytes_in_use -= c->size;
+  uncached_bytes_in_use_.store(stats_.bytes_in_use, std::memory_order_relaxed);
 
   if (ShouldRecordOpName()) {
     c->action_count = ++action_counter_;
@@ -890,6 +1262,13 @@ bool BFCAllocator::TracksAllocationSizes() const { return true; }
 
 size_t BFCAllocator::RequestedSize(const void* ptr) const {
   CHECK(ptr);
+  size_t requested_size, allocated_size;
+  int64 allocation_id;
+  if (thread_local_cache_ != nullptr &&
+      thread_local_cache_->Lookup(ptr, &requested_size, &allocated_size,
+                                  &allocation_id)) {
+    return requested_size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -899,6 +1278,13 @@ size_t BFCAllocator::RequestedSize(const void* ptr) const {
 }
 
 size_t BFCAllocator::AllocatedSize(const void* ptr) const {
+  size_t requested_size, allocated_size;
+  int64 allocation_id;
+  if (thread_local_cache_ != nullptr &&
+      thread_local_cache_->Lookup(ptr, &requested_size, &allocated_size,
+                                  &allocation_id)) {
+    return allocated_size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -908,6 +1294,13 @@ size_t BFCAllocator::AllocatedSize(const void* ptr) const {
 }
 
 int64 BFCAllocator::AllocationId(const void* ptr) const {
+  size_t requested_size, allocated_size;
+  int64 allocation_id;
+  if (thread_local_cache_ != nullptr &&
+      thread_local_cache_->Lookup(ptr, &requested_size, &allocated_size,
+                                  &allocation_id)) {
+    return allocation_id;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -1155,14 +1548,31 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  if (thread_local_cache_ != nullptr) {
+    stats.num_allocs += cached_num_allocs_.load(std::memory_order_relaxed);
+    stats.bytes_in_use += cached_bytes_in_use_.load(std::memory_order_relaxed);
+    stats.peak_bytes_in_use =
+        std::max(stats.peak_bytes_in_use,
+                 cached_peak_bytes_in_use_.load(std::memory_order_relaxed));
+    stats.largest_alloc_size =
+        std::max(stats.largest_alloc_size,
+                 cached_largest_alloc_size_.load(std::memory_order_relaxed));
+  }
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
   mutex_lock l(lock_);
+  const int64 cached_bytes_in_use =
+      cached_bytes_in_use_.load(std::memory_order_relaxed);
   stats_.num_allocs = 0;
-  stats_.peak_bytes_in_use = stats_.bytes_in_use;
+  stats_.peak_bytes_in_use = stats_.bytes_in_use + cached_bytes_in_use;
   stats_.largest_alloc_size = 0;
+  cached_num_allocs_.store(0, std::memory_order_relaxed);
+  cached_peak_bytes_in_use_.store(stats_.peak_bytes_in_use,
+                                  std::memory_order_relaxed);
+  cached_largest_alloc_size_.store(0, std::memory_order_relaxed);
   return true;
 }
 
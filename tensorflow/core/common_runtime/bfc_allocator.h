@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_BFC_ALLOCATOR_H_
 
 #include <array>
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <string>
@@ -79,6 +80,22 @@ class BFCAllocator : public Allocator {
 
   void SetTimingCounter(SharedCounter* sc) { timing_counter_ = sc; }
 
+  // Enables a per-thread cache of small blocks in front of the bins.
+  //
+  // Allocations of up to 16KiB are rounded up to a power-of-two size class
+  // and served from fixed-size blocks carved out of 256KiB slabs, which are
+  // themselves allocated from the bins. Each thread keeps a free list of
+  // blocks per size class, so most small AllocateRaw() and DeallocateRaw()
+  // calls do not take `lock_`. Blocks move between the per-thread free lists
+  // and a shared per-size-class free list in batches. The memory of a slab is
+  // never returned to the bins, so the total slab memory is capped at a
+  // quarter of the memory limit.
+  //
+  // The cache does not read or write the memory it hands out, but it is
+  // bypassed for allocations that use `freed_by_func` or when a timing counter
+  // is set. Must be called before the first allocation.
+  void EnableThreadLocalCache();
+
   void SetSafeFrontier(uint64 count) override;
 
   bool ShouldRecordOpName() const { return true; }
@@ -96,6 +113,16 @@ class BFCAllocator : public Allocator {
       size_t alignment, size_t num_bytes,
       const AllocationAttributes& allocation_attr);
 
+  class ThreadLocalCache;
+
+  // Allocates a slab for `thread_local_cache_` from the bins. Slabs are not
+  // counted in `stats_`: the blocks carved out of them are counted when they
+  // are handed out, by RecordCachedAllocation() and
+  // RecordCachedDeallocation(). Returns nullptr if no memory is available.
+  void* AllocateCacheSlab(size_t num_bytes);
+  void RecordCachedAllocation(int64 num_bytes);
+  void RecordCachedDeallocation(int64 num_bytes);
+
   void DeallocateRawInternal(void* ptr);
 
   // Chunks whose freed_at_count is later than the safe frontier value are kept
@@ -598,13 +625,26 @@ class BFCAllocator : public Allocator {
   ChunkHandle free_chunks_list_ TF_GUARDED_BY(lock_);
 
   // Counter containing the next unique identifier to assign to a
-  // newly-created chunk.
-  int64 next_allocation_id_ TF_GUARDED_BY(lock_);
+  // newly-created chunk. Atomic because `thread_local_cache_` reserves
+  // ranges of identifiers without holding `lock_`.
+  std::atomic<int64> next_allocation_id_;
 
   // Stats.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
   uint64 action_counter_ TF_GUARDED_BY(lock_);
 
+  // Non-null iff EnableThreadLocalCache() has been called.
+  std::unique_ptr<ThreadLocalCache> thread_local_cache_;
+
+  // Stats of the allocations served by `thread_local_cache_`, which are
+  // merged with `stats_` by GetStats(). `uncached_bytes_in_use_` mirrors
+  // `stats_.bytes_in_use` so that the peak can be updated without `lock_`.
+  std::atomic<int64> cached_num_allocs_{0};
+  std::atomic<int64> cached_bytes_in_use_{0};
+  std::atomic<int64> cached_peak_bytes_in_use_{0};
+  std::atomic<int64> cached_largest_alloc_size_{0};
+  std::atomic<int64> uncached_bytes_in_use_{0};
+
   // The circular buffer used to track memory operation history.
   static constexpr uint64 kMemDebugHistorySize = 4096;
   int64 size_history_[kMemDebugHistorySize];
@@ -17,7 +17,11 @@ limitations under the License.
 #include <algorithm>
 #include <random>
 
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -26,7 +30,9 @@ namespace tensorflow {
 // A fake SubAllocator to test the performance of BFCAllocator.
 class FakeSubAllocator : public SubAllocator {
  public:
-  FakeSubAllocator() : SubAllocator({}, {}), alloc_counter_(0) {}
+  // Starts at a non-null address, so that the first chunk is not nullptr.
+  FakeSubAllocator()
+      : SubAllocator({}, {}), alloc_counter_(Allocator::kAllocatorAlignment) {}
   ~FakeSubAllocator() override {}
 
   // Alloc and Free functions are implemented as very cheap operations, so that
@@ -84,4 +90,129 @@ BENCHMARK(BM_Allocator)
     ->ArgPair(1000, 256)
     ->ArgPair(10000, 256);
 
+TEST(BFCAllocatorTest, ThreadLocalCacheTracksSizesAndStats) {
+  BFCAllocator bfc_allocator(new FakeSubAllocator, 1 << 30, false, "bfc");
+  bfc_allocator.EnableThreadLocalCache();
+
+  std::vector<void*> ptrs;
+  absl::flat_hash_set<int64> allocation_ids;
+  int64 expected_bytes_in_use = 0;
+  for (int i = 0; i < 1000; ++i) {
+    const size_t num_bytes = 1 + (i * 37) % (16 << 10);
+    void* ptr = bfc_allocator.AllocateRaw(1, num_bytes);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(bfc_allocator.RequestedSize(ptr), num_bytes);
+    EXPECT_GE(bfc_allocator.AllocatedSize(ptr), num_bytes);
+    EXPECT_TRUE(allocation_ids.insert(bfc_allocator.AllocationId(ptr)).second);
+    expected_bytes_in_use += bfc_allocator.AllocatedSize(ptr);
+    ptrs.push_back(ptr);
+  }
+  // Allocations that are too large for the cache are served from the bins.
+  void* large_ptr = bfc_allocator.AllocateRaw(1, 1 << 20);
+  ASSERT_NE(large_ptr, nullptr);
+  EXPECT_EQ(bfc_allocator.RequestedSize(large_ptr), 1 << 20);
+  EXPECT_TRUE(
+      allocation_ids.insert(bfc_allocator.AllocationId(large_ptr)).second);
+  expected_bytes_in_use += bfc_allocator.AllocatedSize(large_ptr);
+
+  AllocatorStats stats = *bfc_allocator.GetStats();
+  EXPECT_EQ(stats.num_allocs, 1001);
+  EXPECT_EQ(stats.bytes_in_use, expected_bytes_in_use);
+  EXPECT_EQ(stats.peak_bytes_in_use, expected_bytes_in_use);
+  EXPECT_EQ(stats.largest_alloc_size, 1 << 20);
+
+  for (void* ptr : ptrs) bfc_allocator.DeallocateRaw(ptr);
+  bfc_allocator.DeallocateRaw(large_ptr);
+  stats = *bfc_allocator.GetStats();
+  EXPECT_EQ(stats.bytes_in_use, 0);
+  EXPECT_EQ(stats.peak_bytes_in_use, expected_bytes_in_use);
+
+  EXPECT_TRUE(bfc_allocator.ClearStats());
+  stats = *bfc_allocator.GetStats();
+  EXPECT_EQ(stats.num_allocs, 0);
+  EXPECT_EQ(stats.peak_bytes_in_use, 0);
+}
+
+TEST(BFCAllocatorTest, ThreadLocalCacheMultiThreaded) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocsPerThread = 10000;
+  BFCAllocator bfc_allocator(new FakeSubAllocator, 1 << 30, false, "bfc");
+  bfc_allocator.EnableThreadLocalCache();
+
+  // Each thread frees half of its allocations and hands the other half to its
+  // neighbor, so that blocks move between per-thread caches.
+  std::vector<std::vector<void*>> handed_off(kNumThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+    BlockingCounter counter(kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&, t]() {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < kNumAllocsPerThread; ++i) {
+          ptrs.push_back(bfc_allocator.AllocateRaw(1, 64 << (i % 8)));
+        }
+        for (int i = 0; i < kNumAllocsPerThread; i += 2) {
+          bfc_allocator.DeallocateRaw(ptrs[i]);
+          handed_off[(t + 1) % kNumThreads].push_back(ptrs[i + 1]);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    BlockingCounter free_counter(kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&, t]() {
+        for (void* ptr : handed_off[t]) bfc_allocator.DeallocateRaw(ptr);
+        free_counter.DecrementCount();
+      });
+    }
+    free_counter.Wait();
+  }
+
+  const AllocatorStats stats = *bfc_allocator.GetStats();
+  EXPECT_EQ(stats.num_allocs, kNumThreads * kNumAllocsPerThread);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+}
+
+// Allocates and deallocates small blocks from `state.range(0)` threads
+// concurrently. `state.range(1)` selects whether the thread-local cache is
+// enabled.
+void BM_AllocatorMultiThreaded(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const bool use_thread_local_cache = state.range(1);
+  constexpr int kAllocsPerThread = 1024;
+  constexpr int kLiveObjects = 16;
+
+  BFCAllocator bfc_allocator(new FakeSubAllocator, 1 << 30, false, "bfc");
+  if (use_thread_local_cache) bfc_allocator.EnableThreadLocalCache();
+  thread::ThreadPool pool(Env::Default(), "bench", num_threads);
+
+  for (auto _ : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&bfc_allocator, &counter]() {
+        void* live[kLiveObjects] = {};
+        for (int i = 0; i < kAllocsPerThread; ++i) {
+          void*& slot = live[i % kLiveObjects];
+          if (slot != nullptr) bfc_allocator.DeallocateRaw(slot);
+          slot = bfc_allocator.AllocateRaw(1, 256 << (i % 5));
+        }
+        for (void* ptr : live) bfc_allocator.DeallocateRaw(ptr);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()) *
+                          num_threads * kAllocsPerThread);
+}
+BENCHMARK(BM_AllocatorMultiThreaded)
+    ->UseRealTime()
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 1);
+
 }  // namespace tensorflow
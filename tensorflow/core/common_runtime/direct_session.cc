@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
 #include "tensorflow/core/common_runtime/collective_param_resolver_local.h"
 #include "tensorflow/core/common_runtime/constant_folding.h"
@@ -38,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -153,6 +155,39 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Records the static shapes of fed placeholders in `full_graph` as the
+// `_output_shapes` of the corresponding `_Arg` nodes in `graph`, so that the
+// static memory planner can infer the shapes of their consumers.
+void AnnotateFeedShapes(const Graph& full_graph,
+                        const CallableOptions& callable_options, Graph* graph) {
+  std::unordered_map<StringPiece, const Node*, StringPieceHasher> feed_nodes;
+  for (const string& feed : callable_options.feed()) {
+    feed_nodes.emplace(ParseTensorName(feed).node(), nullptr);
+  }
+  for (const Node* n : full_graph.op_nodes()) {
+    auto it = feed_nodes.find(n->name());
+    if (it != feed_nodes.end()) it->second = n;
+  }
+  for (Node* n : graph->op_nodes()) {
+    if (!n->IsArg()) continue;
+    int64 index;
+    if (!GetNodeAttr(n->attrs(), "index", &index).ok() || index < 0 ||
+        index >= callable_options.feed_size()) {
+      continue;
+    }
+    const TensorId feed = ParseTensorName(callable_options.feed(index));
+    const Node* placeholder = feed_nodes[feed.node()];
+    PartialTensorShape shape;
+    if (placeholder != nullptr && feed.index() == 0 &&
+        (placeholder->type_string() == "Placeholder" ||
+         placeholder->type_string() == "PlaceholderV2") &&
+        GetNodeAttr(placeholder->attrs(), "shape", &shape).ok() &&
+        shape.IsFullyDefined()) {
+      n->AddAttr("_output_shapes", std::vector<PartialTensorShape>{shape});
+    }
+  }
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -373,6 +408,31 @@ DirectSession::DirectSession(const SessionOptions& options,
     }
     ++devices_added;
   }
+  if (options_.config.experimental().use_numa_affinity()) {
+    // When there is one CPU device per NUMA node (and no accelerators), place
+    // unconstrained ops of this session on a single node so that a step's
+    // tensors are produced and consumed by threads on the node whose memory
+    // backs them. Sessions are spread round-robin over the nodes.
+    std::vector<Device*> numa_devices;
+    bool cpu_only = true;
+    for (Device* d : devices_) {
+      if (d->device_type() != DEVICE_CPU) {
+        cpu_only = false;
+        break;
+      }
+      if (d->attributes().locality().numa_node() ==
+          static_cast<int>(numa_devices.size())) {
+        numa_devices.push_back(d);
+      }
+    }
+    if (cpu_only && numa_devices.size() > 1) {
+      static std::atomic<int64> next_numa_device(0);
+      default_local_device_ =
+          numa_devices[next_numa_device.fetch_add(1) % numa_devices.size()];
+      VLOG(1) << "Session " << session_handle_ << " prefers NUMA-local device "
+              << default_local_device_->name();
+    }
+  }
 }
 
 DirectSession::~DirectSession() {
@@ -439,6 +499,7 @@ Status DirectSession::ExtendLocked(GraphDef graph) {
     options.device_set = &device_set_;
     options.session_options = &options_;
     options.session_handle = session_handle_;
+    options.default_local_device = default_local_device_;
     TF_RETURN_IF_ERROR(GraphExecutionState::MakeForBaseGraph(
         std::move(graph), options, &execution_state_));
     graph_created_ = true;
@@ -496,7 +557,8 @@ Status DirectSession::RunInternal(
     int64 step_id, const RunOptions& run_options,
     CallFrameInterface* call_frame, ExecutorsAndKeys* executors_and_keys,
     RunMetadata* run_metadata,
-    const thread::ThreadPoolOptions& threadpool_options) {
+    const thread::ThreadPoolOptions& threadpool_options,
+    std::unique_ptr<PrivateIntraProcessRendezvous>* reusable_rendezvous) {
   const uint64 start_time_usecs = options_.env->NowMicros();
   const int64 executor_step_count = executors_and_keys->step_count.fetch_add(1);
   RunState run_state(step_id, &devices_);
@@ -715,8 +777,17 @@ Status DirectSession::RunInternal(
       };
 
   if (can_execute_synchronously) {
-    PrivateIntraProcessRendezvous rendezvous(device_mgr_.get());
-    args.rendezvous = &rendezvous;
+    absl::optional<PrivateIntraProcessRendezvous> step_rendezvous;
+    if (reusable_rendezvous != nullptr) {
+      if (*reusable_rendezvous == nullptr) {
+        reusable_rendezvous->reset(
+            new PrivateIntraProcessRendezvous(device_mgr_.get()));
+      }
+      args.rendezvous = reusable_rendezvous->get();
+    } else {
+      step_rendezvous.emplace(device_mgr_.get());
+      args.rendezvous = &*step_rendezvous;
+    }
 
     const auto& item = executors_and_keys->items[0];
     set_threadpool_args_for_item(item, &args);
@@ -754,6 +825,11 @@ Status DirectSession::RunInternal(
   if (step_cancellation_manager.IsCancelled()) {
     run_status.Update(errors::Cancelled("Run call was cancelled"));
   }
+  if (!run_status.ok() && reusable_rendezvous != nullptr) {
+    // The rendezvous may have been aborted, or hold values that were never
+    // received.
+    reusable_rendezvous->reset();
+  }
 
   if (profiler_session) {
     TF_RETURN_IF_ERROR(profiler_session->CollectData(run_metadata));
@@ -1412,6 +1488,15 @@ Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    if (options_.config.experimental().use_static_memory_planning() &&
+        device->device_type() == DEVICE_CPU) {
+      std::unique_ptr<StaticMemoryPlan> plan;
+      TF_RETURN_IF_ERROR(PlanStaticMemory(
+          *partition_graph, device->GetAllocator(AllocatorAttributes()),
+          &plan));
+      params.static_memory_plan = std::move(plan);
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -1599,6 +1684,7 @@ Status DirectSession::CreateGraphs(
     prune_options.session_options = &options_;
     prune_options.stateful_placements = stateful_placements_;
     prune_options.session_handle = session_handle_;
+    prune_options.default_local_device = default_local_device_;
     TF_RETURN_IF_ERROR(GraphExecutionState::MakeForPrunedGraph(
         *execution_state_, prune_options, subgraph_options,
         &temp_exec_state_holder, &client_graph));
@@ -1627,6 +1713,13 @@ Status DirectSession::CreateGraphs(
         client_graph->fetch_types.size());
   }
 
+  if (options_.config.experimental().use_static_memory_planning() &&
+      !run_state_args->is_partial_run) {
+    AnnotateFeedShapes(*execution_state->full_graph(),
+                       subgraph_options.callable_options,
+                       &client_graph->graph);
+  }
+
   auto current_stateful_placements = execution_state->GetStatefulPlacements();
   // Update our current state based on the execution_state's
   // placements.  If there are any mismatches for a node,
@@ -1916,8 +2009,6 @@ class DirectSession::RunCallableCallFrame : public CallFrameInterface {
 
   // Check if we already have an executor for these arguments.
   std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
-  const int64 step_id = step_id_counter_.fetch_add(1);
-
   {
     tf_shared_lock l(callables_lock_);
     if (handle >= next_callable_handle_) {
@@ -1931,10 +2022,18 @@ class DirectSession::RunCallableCallFrame : public CallFrameInterface {
         "Attempted to run callable after handle was released: ", handle);
   }
 
-  // NOTE(mrry): Debug options are not currently supported in the
-  // callable interface.
-  DebugOptions debug_options;
-  RunStateArgs run_state_args(debug_options);
+  return RunCallableInternal(executors_and_keys.get(), feed_tensors,
+                             fetch_tensors, run_metadata, threadpool_options,
+                             /*reusable_rendezvous=*/nullptr);
+}
+
+Status DirectSession::RunCallableInternal(
+    ExecutorsAndKeys* executors_and_keys,
+    const std::vector<Tensor>& feed_tensors,
+    std::vector<Tensor>* fetch_tensors, RunMetadata* run_metadata,
+    const thread::ThreadPoolOptions& threadpool_options,
+    std::unique_ptr<PrivateIntraProcessRendezvous>* reusable_rendezvous) {
+  const int64 step_id = step_id_counter_.fetch_add(1);
 
   // Configure a call frame for the step, which we use to feed and
   // fetch values to and from the executors.
@@ -1981,16 +2080,19 @@ class DirectSession::RunCallableCallFrame : public CallFrameInterface {
 
   // A specialized CallFrame implementation that takes advantage of the
   // optimized RunCallable interface.
-  RunCallableCallFrame call_frame(this, executors_and_keys.get(),
+  RunCallableCallFrame call_frame(this, executors_and_keys,
                                   actual_feed_tensors, fetch_tensors);
 
   if (LogMemory::IsEnabled()) {
-    LogMemory::RecordStep(step_id, run_state_args.handle);
+    // NOTE(mrry): Debug options are not currently supported in the
+    // callable interface, so the step has no run handle.
+    LogMemory::RecordStep(step_id, "");
   }
 
   TF_RETURN_IF_ERROR(RunInternal(
       step_id, executors_and_keys->callable_options.run_options(), &call_frame,
-      executors_and_keys.get(), run_metadata, threadpool_options));
+      executors_and_keys, run_metadata, threadpool_options,
+      reusable_rendezvous));
 
   if (fetch_tensors != nullptr) {
     size_t output_size = 0;
@@ -2012,6 +2114,75 @@ class DirectSession::RunCallableCallFrame : public CallFrameInterface {
   return Status::OK();
 }
 
+Status DirectSession::PrepareRun(const CallableOptions& callable_options,
+                                 std::unique_ptr<PreparedRun>* out) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  TF_RETURN_IF_ERROR(CheckGraphCreated("PrepareRun()"));
+
+  std::unique_ptr<ExecutorsAndKeys> ek;
+  std::unique_ptr<FunctionInfo> func_info;
+  RunStateArgs run_state_args(callable_options.run_options().debug_options());
+  TF_RETURN_IF_ERROR(
+      CreateExecutors(callable_options, &ek, &func_info, &run_state_args));
+
+  // A rendezvous can only be reused if no step leaves values in it, which is
+  // guaranteed if it is not used for any transfers.
+  bool reuse_rendezvous = ek->items.size() == 1;
+  if (reuse_rendezvous) {
+    for (const Node* n : ek->items[0].graph->op_nodes()) {
+      if (n->IsSend() || n->IsRecv()) {
+        reuse_rendezvous = false;
+        break;
+      }
+    }
+  }
+
+  Callable callable;
+  callable.executors_and_keys = std::move(ek);
+  callable.function_info = std::move(func_info);
+  out->reset(new PreparedRun(this, std::move(callable), reuse_rendezvous));
+  return Status::OK();
+}
+
+DirectSession::PreparedRun::PreparedRun(DirectSession* session,
+                                        Callable callable,
+                                        bool reuse_rendezvous)
+    : session_(session),
+      callable_(std::move(callable)),
+      reuse_rendezvous_(reuse_rendezvous) {}
+
+DirectSession::PreparedRun::~PreparedRun() {}
+
+Status DirectSession::PreparedRun::Run(const std::vector<Tensor>& feed_tensors,
+                                       std::vector<Tensor>* fetch_tensors,
+                                       RunMetadata* run_metadata) {
+  TF_RETURN_IF_ERROR(session_->CheckNotClosed());
+  direct_session_runs->GetCell()->IncrementBy(1);
+  if (!reuse_rendezvous_) {
+    return session_->RunCallableInternal(
+        callable_.executors_and_keys.get(), feed_tensors, fetch_tensors,
+        run_metadata, thread::ThreadPoolOptions(),
+        /*reusable_rendezvous=*/nullptr);
+  }
+
+  std::unique_ptr<PrivateIntraProcessRendezvous> rendezvous;
+  {
+    mutex_lock l(mu_);
+    if (!free_rendezvous_.empty()) {
+      rendezvous = std::move(free_rendezvous_.back());
+      free_rendezvous_.pop_back();
+    }
+  }
+  const Status s = session_->RunCallableInternal(
+      callable_.executors_and_keys.get(), feed_tensors, fetch_tensors,
+      run_metadata, thread::ThreadPoolOptions(), &rendezvous);
+  if (rendezvous != nullptr) {
+    mutex_lock l(mu_);
+    free_rendezvous_.push_back(std::move(rendezvous));
+  }
+  return s;
+}
+
 Status DirectSession::Finalize() {
   mutex_lock l(graph_state_lock_);
   if (finalized_) {
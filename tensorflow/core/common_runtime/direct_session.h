@@ -133,6 +133,13 @@ class DirectSession : public Session {
 
   ::tensorflow::Status ReleaseCallable(CallableHandle handle) override;
 
+  class PreparedRun;
+
+  // Creates a PreparedRun that executes the subgraph defined by
+  // `callable_options`.
+  ::tensorflow::Status PrepareRun(const CallableOptions& callable_options,
+                                  std::unique_ptr<PreparedRun>* out);
+
   ::tensorflow::Status Finalize() override;
 
   const SessionOptions& options() const { return options_; }
@@ -263,11 +270,25 @@ class DirectSession : public Session {
       RunStateArgs* run_state_args, DataTypeVector* input_types,
       DataTypeVector* output_types, int64* collective_graph_key);
 
+  // If `reusable_rendezvous` is non-null and the step runs synchronously, the
+  // step uses `*reusable_rendezvous` (creating it if it is null) instead of a
+  // fresh rendezvous, and resets it if the step fails.
   ::tensorflow::Status RunInternal(
       int64 step_id, const RunOptions& run_options,
       CallFrameInterface* call_frame, ExecutorsAndKeys* executors_and_keys,
       RunMetadata* run_metadata,
-      const thread::ThreadPoolOptions& threadpool_options);
+      const thread::ThreadPoolOptions& threadpool_options,
+      std::unique_ptr<PrivateIntraProcessRendezvous>* reusable_rendezvous =
+          nullptr);
+
+  // Runs one step of `executors_and_keys` with the positional feeds and
+  // fetches of a callable.
+  ::tensorflow::Status RunCallableInternal(
+      ExecutorsAndKeys* executors_and_keys,
+      const std::vector<Tensor>& feed_tensors,
+      std::vector<Tensor>* fetch_tensors, RunMetadata* run_metadata,
+      const thread::ThreadPoolOptions& threadpool_options,
+      std::unique_ptr<PrivateIntraProcessRendezvous>* reusable_rendezvous);
 
   // Returns whether inter-op execution uses a global pool or the input
   // `run_options` requests being run on inter_op_thread_pool = 0 in case
@@ -339,6 +360,9 @@ class DirectSession : public Session {
   const std::unique_ptr<const DeviceMgr> device_mgr_;
   std::vector<Device*> devices_;  // not owned
   DeviceSet device_set_;
+  // If non-null, the NUMA-local CPU device preferred by the placer for ops
+  // without a requested device. Set only when `use_numa_affinity` is on.
+  Device* default_local_device_ = nullptr;  // not owned
 
   // Unique session identifier.
   string session_handle_;
@@ -443,6 +467,44 @@ class DirectSession : public Session {
   friend class DebugGateway;
 };
 
+// A PreparedRun is a lower overhead alternative to MakeCallable() and
+// RunCallable() for callers that run the same feeds and fetches many times.
+// Like a callable, its feeds and fetches are bound to positions when it is
+// created. In addition, it holds its executors directly, so that a step does
+// not look up a handle or build any string-keyed state, and it reuses the
+// rendezvous of earlier steps when the subgraph is a single partition without
+// _Send or _Recv nodes.
+//
+// Run() is thread safe. A PreparedRun must be destroyed before its session.
+class DirectSession::PreparedRun {
+ public:
+  ~PreparedRun();
+
+  // Runs one step. `feed_tensors` and `fetch_tensors` are in the order of
+  // `CallableOptions::feed` and `CallableOptions::fetch`, as for
+  // DirectSession::RunCallable().
+  ::tensorflow::Status Run(const std::vector<Tensor>& feed_tensors,
+                           std::vector<Tensor>* fetch_tensors,
+                           RunMetadata* run_metadata);
+
+ private:
+  friend class DirectSession;
+
+  PreparedRun(DirectSession* session, Callable callable,
+              bool reuse_rendezvous);
+
+  DirectSession* const session_;  // Not owned.
+  Callable callable_;
+  const bool reuse_rendezvous_;
+
+  mutex mu_;
+  // Rendezvous that are not in use by a step, if `reuse_rendezvous_`.
+  std::vector<std::unique_ptr<PrivateIntraProcessRendezvous>> free_rendezvous_
+      TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PreparedRun);
+};
+
 }  // end namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_COMMON_RUNTIME_DIRECT_SESSION_H_
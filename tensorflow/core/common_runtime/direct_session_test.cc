@@ -44,6 +44,8 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/stacktrace.h"
 #include "tensorflow/core/platform/test.h"
@@ -198,6 +200,30 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_Callable) {
   }
 }
 
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_PreparedRun) {
+  Initialize({3, 2, -1, 0});
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  DirectSession* direct_session = static_cast<DirectSession*>(session.get());
+
+  // The subgraph spans two devices, so steps do not share a rendezvous.
+  std::unique_ptr<DirectSession::PreparedRun> prepared_run;
+  TF_ASSERT_OK(direct_session->PrepareRun(
+      MakeCallableOptions({}, {y_ + ":0"}, {y_neg_}), &prepared_run));
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(prepared_run->Run({}, &outputs, nullptr));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(5.0, outputs[0].matrix<float>()(0, 0));
+  }
+
+  Status s = prepared_run->Run({}, nullptr, nullptr);
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.error_message(),
+                                "`fetch_tensors` must be provided"));
+}
+
 TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_OptimizeForStaticGraph) {
   Initialize({3, 2, -1, 0});
   SessionOptions options(DefaultSessionOptions());
@@ -2585,6 +2611,124 @@ TEST(DirectSessionTest,
   TestFeedAndFetchTensorsInDeviceMemoryForAllDataTypes(opts);
 }
 
+// Runs a chain of matmuls on a statically shaped placeholder `num_runs`
+// times, and returns the result of the last run. If `last_run_num_allocs` is
+// not null, it is set to the number of CPU allocator calls of the last run,
+// which requires CPU allocator stats to be enabled.
+Tensor RunMatMulChain(bool use_static_memory_planning, int num_runs,
+                      int64* last_run_num_allocs = nullptr) {
+  Graph graph(OpRegistry::Global());
+  Node* x;
+  TF_CHECK_OK(NodeBuilder("x", "Placeholder")
+                  .Attr("shape", TensorShape({2, 2}))
+                  .Attr("dtype", DT_FLOAT)
+                  .Finalize(&graph, &x));
+  Node* a = test::graph::Constant(
+      &graph, test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2})));
+  Node* y = x;
+  for (int i = 0; i < 4; ++i) {
+    y = test::graph::Matmul(&graph, a, y, false, false);
+  }
+  GraphDef def;
+  graph.ToGraphDef(&def);
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_static_memory_planning(
+      use_static_memory_planning);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_CHECK_OK(session->Create(def));
+  std::vector<Tensor> outputs;
+  for (int i = 0; i < num_runs; ++i) {
+    outputs.clear();
+    const Tensor x_value =
+        test::AsTensor<float>({1, 0, 0, static_cast<float>(i)}, {2, 2});
+    const int64 num_allocs = cpu_allocator_base()->GetStats()->num_allocs;
+    TF_CHECK_OK(session->Run({{"x:0", x_value}}, {y->name() + ":0"}, {},
+                             &outputs));
+    if (last_run_num_allocs != nullptr) {
+      *last_run_num_allocs =
+          cpu_allocator_base()->GetStats()->num_allocs - num_allocs;
+    }
+  }
+  return outputs[0];
+}
+
+// Builds `add = x + y` on "/cpu:0" for float scalar placeholders `x` and `y`.
+GraphDef MakeAddGraph() {
+  Graph graph(OpRegistry::Global());
+  Node* x;
+  TF_CHECK_OK(NodeBuilder("x", "Placeholder")
+                  .Attr("shape", TensorShape())
+                  .Attr("dtype", DT_FLOAT)
+                  .Device("/cpu:0")
+                  .Finalize(&graph, &x));
+  Node* y;
+  TF_CHECK_OK(NodeBuilder("y", "Placeholder")
+                  .Attr("shape", TensorShape())
+                  .Attr("dtype", DT_FLOAT)
+                  .Device("/cpu:0")
+                  .Finalize(&graph, &y));
+  Node* add;
+  TF_CHECK_OK(NodeBuilder("add", "Add")
+                  .Input(x)
+                  .Input(y)
+                  .Attr("T", DT_FLOAT)
+                  .Device("/cpu:0")
+                  .Finalize(&graph, &add));
+  GraphDef def;
+  graph.ToGraphDef(&def);
+  return def;
+}
+
+TEST(DirectSessionTest, PreparedRunReusesRendezvousAcrossSteps) {
+  std::unique_ptr<Session> session(NewSession(SessionOptions()));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(MakeAddGraph()));
+  DirectSession* direct_session = static_cast<DirectSession*>(session.get());
+
+  CallableOptions callable_options =
+      MakeCallableOptions({"x:0", "y:0"}, {"add:0"}, {});
+  callable_options.mutable_run_options()->set_inter_op_thread_pool(-1);
+  std::unique_ptr<DirectSession::PreparedRun> prepared_run;
+  TF_ASSERT_OK(direct_session->PrepareRun(callable_options, &prepared_run));
+
+  std::vector<Tensor> outputs;
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(prepared_run->Run(
+        {test::AsScalar<float>(i), test::AsScalar<float>(10.0f)}, &outputs,
+        nullptr));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(outputs[0],
+                                   test::AsScalar<float>(i + 10.0f));
+  }
+
+  // A failed step does not affect later steps.
+  Status s = prepared_run->Run({test::AsScalar<float>(1.0f)}, &outputs,
+                               nullptr);
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  s = prepared_run->Run({test::AsScalar<int32>(1), test::AsScalar<float>(1.0f)},
+                        &outputs, nullptr);
+  EXPECT_FALSE(s.ok());
+  TF_ASSERT_OK(prepared_run->Run(
+      {test::AsScalar<float>(1.0f), test::AsScalar<float>(2.0f)}, &outputs,
+      nullptr));
+  test::ExpectTensorEqual<float>(outputs[0], test::AsScalar<float>(3.0f));
+}
+
+TEST(DirectSessionTest, StaticMemoryPlanningMatchesDynamicAllocation) {
+  EnableCPUAllocatorStats();
+  int64 dynamic_num_allocs = 0;
+  int64 static_num_allocs = 0;
+  test::ExpectTensorEqual<float>(
+      RunMatMulChain(false, 3, &dynamic_num_allocs),
+      RunMatMulChain(true, 3, &static_num_allocs));
+  DisableCPUAllocatorStats();
+  // The outputs of the first three MatMuls are planned, so a warm step makes
+  // no allocator calls for them. The output of the last one is fetched and
+  // keeps the dynamic path.
+  EXPECT_GE(dynamic_num_allocs - static_num_allocs, 3);
+}
+
 // A simple benchmark for the overhead of `DirectSession::Run()` calls
 // with varying numbers of feeds/fetches.
 void FeedFetchBenchmarkHelper(::testing::benchmark::State& state, int num_feeds,
@@ -2704,6 +2848,112 @@ BENCHMARK(BM_FeedFetchCallableSingleThreadExecutor)
     ->Arg(5)
     ->Arg(10);
 
+// Measures the per-call overhead of running `x + y` on scalars inline in the
+// caller thread, using Run() (mode 0), RunCallable() (mode 1) or a
+// PreparedRun (mode 2).
+void BM_TrivialAddOverhead(::testing::benchmark::State& state) {
+  const int mode = state.range(0);
+  std::unique_ptr<Session> session(NewSession(SessionOptions()));
+  TF_CHECK_OK(session->Create(MakeAddGraph()));
+  DirectSession* direct_session = static_cast<DirectSession*>(session.get());
+
+  const std::vector<Tensor> feeds = {test::AsScalar<float>(1.0f),
+                                     test::AsScalar<float>(2.0f)};
+  CallableOptions callable_options =
+      MakeCallableOptions({"x:0", "y:0"}, {"add:0"}, {});
+  callable_options.mutable_run_options()->set_inter_op_thread_pool(-1);
+  std::vector<Tensor> outputs;
+  if (mode == 0) {
+    RunOptions run_options;
+    run_options.set_inter_op_thread_pool(-1);
+    const std::vector<std::pair<string, Tensor>> inputs = {{"x:0", feeds[0]},
+                                                           {"y:0", feeds[1]}};
+    // Ignore the first run, which creates the executors.
+    TF_CHECK_OK(session->Run(run_options, inputs, {"add:0"}, {}, &outputs,
+                             nullptr));
+    for (auto s : state) {
+      TF_CHECK_OK(session->Run(run_options, inputs, {"add:0"}, {}, &outputs,
+                               nullptr));
+    }
+  } else if (mode == 1) {
+    Session::CallableHandle handle;
+    TF_CHECK_OK(session->MakeCallable(callable_options, &handle));
+    for (auto s : state) {
+      TF_CHECK_OK(session->RunCallable(handle, feeds, &outputs, nullptr));
+    }
+    TF_CHECK_OK(session->ReleaseCallable(handle));
+  } else {
+    std::unique_ptr<DirectSession::PreparedRun> prepared_run;
+    TF_CHECK_OK(direct_session->PrepareRun(callable_options, &prepared_run));
+    for (auto s : state) {
+      TF_CHECK_OK(prepared_run->Run(feeds, &outputs, nullptr));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrivialAddOverhead)->Arg(0)->Arg(1)->Arg(2);
+
+// Runs `num_sessions` sessions concurrently, each evaluating a chain of
+// `kChainLength` dependent matmuls, with and without NUMA affinity. With
+// affinity, each session is kept on one NUMA-local CPU device.
+void BM_ConcurrentMatMulChain(::testing::benchmark::State& state) {
+  const bool use_numa_affinity = state.range(0) != 0;
+  const int num_sessions = state.range(1);
+  constexpr int kDim = 512;
+  constexpr int kChainLength = 8;
+
+  Graph graph(OpRegistry::Global());
+  Tensor a_tensor(DT_FLOAT, TensorShape({kDim, kDim}));
+  a_tensor.flat<float>().setRandom();
+  Node* a = test::graph::Constant(&graph, a_tensor);
+  Tensor x_tensor(DT_FLOAT, TensorShape({kDim, kDim}));
+  x_tensor.flat<float>().setRandom();
+  Node* y = test::graph::Constant(&graph, x_tensor);
+  for (int i = 0; i < kChainLength; ++i) {
+    y = test::graph::Matmul(&graph, a, y, false, false);
+  }
+  GraphDef def;
+  graph.ToGraphDef(&def);
+  const string output_name = strings::StrCat(y->name(), ":0");
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_numa_affinity(
+      use_numa_affinity);
+  if (use_numa_affinity) {
+    (*options.config.mutable_device_count())["CPU"] = port::NUMANumNodes();
+  }
+  std::vector<std::unique_ptr<Session>> sessions;
+  for (int i = 0; i < num_sessions; ++i) {
+    sessions.emplace_back(NewSession(options));
+    TF_CHECK_OK(sessions.back()->Create(def));
+    // Ignore the first run, which pays for graph pruning and placement.
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(sessions.back()->Run({}, {output_name}, {}, &outputs));
+  }
+
+  thread::ThreadPool pool(Env::Default(), "matmul_chain", num_sessions);
+  for (auto s : state) {
+    BlockingCounter counter(num_sessions);
+    for (int i = 0; i < num_sessions; ++i) {
+      pool.Schedule([&sessions, &counter, &output_name, i]() {
+        std::vector<Tensor> outputs;
+        TF_CHECK_OK(sessions[i]->Run({}, {output_name}, {}, &outputs));
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_sessions * kChainLength *
+                          2LL * kDim * kDim * kDim);
+}
+
+BENCHMARK(BM_ConcurrentMatMulChain)
+    ->UseRealTime()
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1)
+    ->ArgPair(0, 4)
+    ->ArgPair(1, 4);
+
 }  // namespace
 
 class DirectSessionCollectiveTest : public ::testing::Test {
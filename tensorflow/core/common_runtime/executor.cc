@@ -15,20 +15,25 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/executor_step_arena.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -56,6 +61,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -134,9 +140,140 @@ struct KernelTimer {
 typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
 typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
+// Identifies the work-stealing worker (if any) that is running on the current
+// thread. `queues` is an opaque pointer to the `WorkStealingReadyQueues` that
+// the worker belongs to, so that nodes made ready by a different step (e.g. a
+// nested function call executed inline) are not pushed onto the wrong deque.
+struct WorkStealingWorkerId {
+  const void* queues = nullptr;
+  int id = -1;
+};
+thread_local WorkStealingWorkerId current_work_stealing_worker;
+
+// The per-step ready queues used by the work-stealing executor.
+//
+// Each worker closure scheduled on the step's runner owns one deque. A worker
+// pushes the nodes that it makes ready onto the back of its own deque and pops
+// from the back (LIFO), so that successors preferentially run on the thread
+// (and therefore the core) that produced their inputs. When its own deque is
+// empty, a worker steals from the front of the other deques (FIFO), taking the
+// oldest ready node. Nodes made ready by threads that are not workers (e.g.
+// the caller of `RunAsync()` or an async kernel's completion callback) are
+// distributed round-robin across the deques.
+template <class TaggedNode>
+class WorkStealingReadyQueues {
+ public:
+  struct Item {
+    TaggedNode node;
+    int64 scheduled_nsec;
+  };
+
+  explicit WorkStealingReadyQueues(int num_workers)
+      : num_workers_(num_workers),
+        deques_(new Deque[num_workers]),
+        num_pending_(0),
+        next_external_(0) {}
+
+  int num_workers() const { return num_workers_; }
+
+  // Returns the id of the worker running on the current thread, or -1 if the
+  // current thread is not a worker of this step.
+  int CurrentWorker() const {
+    const WorkStealingWorkerId& w = current_work_stealing_worker;
+    return w.queues == this ? w.id : -1;
+  }
+
+  // Adds `node` to the deque of `worker_id`, or to a round-robin deque if
+  // `worker_id` is -1.
+  void Push(int worker_id, const TaggedNode& node, int64 scheduled_nsec) {
+    if (worker_id < 0) {
+      worker_id = next_external_.fetch_add(1, std::memory_order_relaxed) %
+                  num_workers_;
+    }
+    Deque& d = deques_[worker_id];
+    {
+      mutex_lock l(d.mu);
+      d.items.push_back({node, scheduled_nsec});
+    }
+    // N.B. This must be sequentially consistent with the load in
+    // `HasPending()` and the `owned` flag updates; see `ReleaseWorker()`.
+    num_pending_.fetch_add(1);
+  }
+
+  // Pops the most recently pushed item of `worker_id`'s own deque, or failing
+  // that steals the oldest item of another worker's deque. Returns
+  // `absl::nullopt` if all deques are empty.
+  absl::optional<Item> Pop(int worker_id) {
+    absl::optional<Item> item;
+    if (num_pending_.load(std::memory_order_relaxed) == 0) return item;
+    {
+      Deque& d = deques_[worker_id];
+      mutex_lock l(d.mu);
+      if (!d.items.empty()) {
+        item.emplace(d.items.back());
+        d.items.pop_back();
+        num_pending_.fetch_sub(1, std::memory_order_relaxed);
+        return item;
+      }
+    }
+    for (int i = 1; i < num_workers_; ++i) {
+      Deque& d = deques_[(worker_id + i) % num_workers_];
+      mutex_lock l(d.mu);
+      if (!d.items.empty()) {
+        item.emplace(d.items.front());
+        d.items.pop_front();
+        num_pending_.fetch_sub(1, std::memory_order_relaxed);
+        return item;
+      }
+    }
+    return item;
+  }
+
+  bool HasPending() const { return num_pending_.load() > 0; }
+
+  // Claims an idle worker slot, storing its id in `*worker_id`. Returns false
+  // if every worker is already running.
+  bool AcquireWorker(int* worker_id) {
+    for (int i = 0; i < num_workers_; ++i) {
+      bool expected = false;
+      if (!deques_[i].owned.load(std::memory_order_relaxed) &&
+          deques_[i].owned.compare_exchange_strong(expected, true)) {
+        *worker_id = i;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Releases the slot of `worker_id`. A producer that pushed concurrently may
+  // have observed this worker as running and not spawned a new one, so the
+  // caller must check `HasPending()` after releasing: the sequentially
+  // consistent store here and the `fetch_add()` in `Push()` guarantee that
+  // at least one of the two sides observes the other.
+  void ReleaseWorker(int worker_id) { deques_[worker_id].owned.store(false); }
+
+ private:
+  struct Deque {
+    mutex mu;
+    std::deque<Item> items TF_GUARDED_BY(mu);
+    std::atomic<bool> owned{false};
+  };
+
+  const int num_workers_;
+  std::unique_ptr<Deque[]> deques_;
+  std::atomic<int64> num_pending_;
+  std::atomic<uint32> next_external_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(WorkStealingReadyQueues);
+};
+
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        bool use_work_stealing = false)
+      : immutable_state_(p),
+        use_work_stealing_(use_work_stealing),
+        step_arena_pool_(p.step_arena_allocator) {}
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
@@ -163,7 +300,9 @@ class ExecutorImpl : public Executor {
         if (gview.node(i)) {
           is_expensive_[i] =
               gview.node(i)->kernel && gview.node(i)->kernel->IsExpensive();
-          cost_estimates_[i] = kInitialCostEstimateCycles;
+          cost_estimates_[i] = is_expensive_[i]
+                                   ? kInitialCostEstimateCycles
+                                   : kInitialInexpensiveCostEstimateCycles;
         }
       }
     }
@@ -172,9 +311,12 @@ class ExecutorImpl : public Executor {
     // executor uses this flag to optimize graph execution, for example
     // by "inlining" inexpensive kernels.
     bool IsExpensive(const NodeItem& node) const {
-      return is_expensive_[node.node_id] &&
-             (cost_estimates_[node.node_id].load(std::memory_order_relaxed) >
-              kOpIsExpensiveThresholdCycles);
+      return CostEstimate(node) > kOpIsExpensiveThresholdCycles;
+    }
+
+    // Returns the current cost estimate (in CPU cycles) of the given node.
+    uint64 CostEstimate(const NodeItem& node) const {
+      return cost_estimates_[node.node_id].load(std::memory_order_relaxed);
     }
 
     // Returns the value of kernel->IsExpensive().
@@ -182,10 +324,18 @@ class ExecutorImpl : public Executor {
       return is_expensive_[node.node_id];
     }
 
+    // Returns true if the cost of an inexpensive kernel (one without the
+    // IsExpensive() marker) should be measured. Such kernels are sampled on
+    // every 16th invocation on each thread, so that the common case costs a
+    // thread-local increment rather than two cycle counter reads.
+    static bool ShouldSampleInexpensiveKernel() {
+      static thread_local uint32 num_invocations = 0;
+      return (++num_invocations & 15) == 0;
+    }
+
     // Updates the dynamic cost estimate, which is used to determine whether the
     // given node is expensive. The new cost estimate is a weighted average of
-    // the old cost estimate and the latest cost. We only update cost estimates
-    // for kernels for which IsExpensive() return true.
+    // the old cost estimate and the latest cost.
     void UpdateCostEstimate(const NodeItem& node, uint64 elapsed_cycles) {
       // N.B. Updates to `cost_estimate` are atomic but unlocked.  Simultaneous
       // updates may result in one or more updates being ignored.  This does not
@@ -199,11 +349,18 @@ class ExecutorImpl : public Executor {
       cost_estimate.store(new_estimate, std::memory_order_relaxed);
     }
 
+    // Maximum estimated cost (in CPU cycles) of the inexpensive nodes that a
+    // thread runs inline, or that are batched into one closure, when several
+    // nodes become ready at once.
+    static constexpr uint64 kInlineBudgetCycles = 128 * 1000;
+
    private:
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
-    // Operations start out "expensive".
+    // Operations with the IsExpensive() marker start out "expensive", and
+    // other operations start out cheap.
     static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
+    static constexpr uint64 kInitialInexpensiveCostEstimateCycles = 1000;
     static constexpr uint64 kOpIsExpensiveThresholdCycles = 8000;
     static constexpr uint64 kCostDecay = 10;
 
@@ -215,6 +372,13 @@ class ExecutorImpl : public Executor {
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
 
+  // If true, each step dispatches ready nodes through per-worker deques with
+  // work stealing instead of scheduling one closure per node on the runner.
+  const bool use_work_stealing_;
+
+  // Arenas for the bookkeeping of in-flight steps, reused across steps.
+  ExecutorStepArenaPool step_arena_pool_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
 
@@ -270,9 +434,13 @@ class ExecutorImpl : public Executor {
 template <class PropagatorStateType>
 class ExecutorState {
  public:
+  // The state of a step lives in `step_arena`, which it returns to
+  // `step_arena_pool` when it is deleted.
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                bool use_work_stealing, ExecutorStepArenaPool* step_arena_pool,
+                ExecutorStepArena* step_arena);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -284,6 +452,8 @@ class ExecutorState {
       typename PropagatorStateType::TaggedNodeReadyQueue TaggedNodeReadyQueue;
   typedef typename PropagatorStateType::TaggedNodeSeq TaggedNodeSeq;
 
+  typedef WorkStealingReadyQueues<TaggedNode> ReadyQueues;
+
   struct AsyncState;
 
   // Process a ready node in current thread.
@@ -316,8 +486,10 @@ class ExecutorState {
                 NodeExecStatsInterface* stats,
                 TaggedNodeReadyQueue* inline_ready);
 
-  // Schedule all the expensive nodes in '*ready', and put all the inexpensive
-  // nodes in 'ready' into 'inline_ready'.
+  // Schedule all the expensive nodes in '*ready', and put the inexpensive
+  // nodes in 'ready' into 'inline_ready' until their estimated cost exceeds
+  // `KernelStats::kInlineBudgetCycles`. The remaining inexpensive nodes are
+  // scheduled in batches of about that cost.
   //
   // This method will clear `*ready` before returning.
   //
@@ -330,10 +502,31 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c);
 
+  // Dispatches `tagged_node` to another thread. In work-stealing mode the node
+  // is pushed onto the current worker's deque (and an idle worker is woken to
+  // steal it); otherwise a closure is scheduled on `runner_`.
+  void Dispatch(const TaggedNode& tagged_node, int64 scheduled_nsec);
+
+  // Runs the loop of work-stealing worker `worker_id` until all deques are
+  // empty. This is static because the last node that it processes may delete
+  // `state`, so the loop must only dereference `state` after a successful pop
+  // (which implies that the step has not yet completed).
+  static void RunWorker(ExecutorState* state,
+                        std::shared_ptr<ReadyQueues> queues, int worker_id);
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
 
+  // Destroys this object and returns its arena to the pool.
+  void Delete();
+
+  // AsyncStates are allocated from the step arena, and recycled through
+  // `free_async_states_` since nodes in loops may run many times per step.
+  template <typename... Args>
+  AsyncState* NewAsyncState(Args&&... args);
+  void DeleteAsyncState(AsyncState* state);
+
   // Contains the device context assigned by the device at the beginning of a
   // step.
   DeviceContext* device_context_ = nullptr;
@@ -357,8 +550,10 @@ class ExecutorState {
   const tracing::EventCollector* const event_collector_;
   Context context_;
 
-  // QUESTION: Make it a checkpoint::TensorSliceReaderCacheWrapper
-  // instead of a pointer?  (avoids having to delete).
+  ExecutorStepArenaPool* const step_arena_pool_;
+  ExecutorStepArena* const step_arena_;
+
+  // Allocated from `step_arena_`.
   checkpoint::TensorSliceReaderCacheWrapper* slice_reader_cache_;
   CallFrameInterface* call_frame_;
   const ImmutableExecutorState& immutable_state_;
@@ -372,6 +567,14 @@ class ExecutorState {
 
   PropagatorStateType propagator_;
 
+  // Non-null iff this step uses work-stealing dispatch. Shared with the worker
+  // closures, which may outlive this object.
+  std::shared_ptr<ReadyQueues> ready_queues_;
+
+  // Non-null iff this step serves planned outputs from a static memory arena.
+  // Returned to the plan's pool when the step finishes.
+  StaticMemoryArena* static_memory_arena_ = nullptr;
+
   // Invoked when the execution finishes.
   Executor::DoneCallback done_cb_;
 
@@ -385,12 +588,23 @@ class ExecutorState {
 
   mutex mu_;
   Status status_ TF_GUARDED_BY(mu_);
+
+  // Number of nodes that ScheduleReady() left to run on the current thread,
+  // and that it handed to the runner. Recorded in the executor metrics when
+  // the step finishes.
+  std::atomic<int64> num_inline_dispatches_{0};
+  std::atomic<int64> num_scheduled_dispatches_{0};
+
+  // Each free AsyncState holds a pointer to the next one at its start.
+  mutex async_states_mu_;
+  void* free_async_states_ TF_GUARDED_BY(async_states_mu_) = nullptr;
 };
 
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats, bool use_work_stealing,
+    ExecutorStepArenaPool* step_arena_pool, ExecutorStepArena* step_arena)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -405,7 +619,10 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       event_collector_(
           tracing::GetEventCollector(tracing::EventCategory::kCompute)),
       context_(ContextKind::kThread),
-      slice_reader_cache_(new checkpoint::TensorSliceReaderCacheWrapper),
+      step_arena_pool_(step_arena_pool),
+      step_arena_(step_arena),
+      slice_reader_cache_(
+          step_arena->New<checkpoint::TensorSliceReaderCacheWrapper>()),
       call_frame_(args.call_frame),
       immutable_state_(immutable_state),
       kernel_stats_(kernel_stats),
@@ -420,6 +637,15 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (use_work_stealing && !run_all_kernels_inline_) {
+    ready_queues_ = std::make_shared<ReadyQueues>(std::max(
+        1, std::min(port::MaxParallelism(),
+                    immutable_state_.graph_view().num_nodes())));
+  }
+  StaticMemoryPlan* plan = immutable_state_.params().static_memory_plan.get();
+  if (plan != nullptr) {
+    static_memory_arena_ = plan->AcquireArena();
+  }
 }
 
 template <class PropagatorStateType>
@@ -427,7 +653,22 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
   if (device_context_) {
     device_context_->Unref();
   }
-  delete slice_reader_cache_;
+  slice_reader_cache_->~TensorSliceReaderCacheWrapper();
+  if (static_memory_arena_ != nullptr) {
+    immutable_state_.params().static_memory_plan->ReleaseArena(
+        static_memory_arena_);
+  }
+  metrics::RecordExecutorDispatches(
+      num_inline_dispatches_.load(std::memory_order_relaxed),
+      num_scheduled_dispatches_.load(std::memory_order_relaxed));
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::Delete() {
+  ExecutorStepArenaPool* pool = step_arena_pool_;
+  ExecutorStepArena* arena = step_arena_;
+  this->~ExecutorState();
+  pool->Release(arena);
 }
 
 template <class PropagatorStateType>
@@ -454,6 +695,44 @@ void ExecutorState<PropagatorStateType>::RunTask(Closure&& c) {
   });
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::Dispatch(const TaggedNode& tagged_node,
+                                                  int64 scheduled_nsec) {
+  if (!ready_queues_) {
+    RunTask([=]() { Process(tagged_node, scheduled_nsec); });
+    return;
+  }
+  ready_queues_->Push(ready_queues_->CurrentWorker(), tagged_node,
+                      scheduled_nsec);
+  int worker_id;
+  if (ready_queues_->AcquireWorker(&worker_id)) {
+    RunTask([this, queues = ready_queues_, worker_id]() {
+      RunWorker(this, queues, worker_id);
+    });
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RunWorker(
+    ExecutorState* state, std::shared_ptr<ReadyQueues> queues, int worker_id) {
+  // Save the enclosing worker id, in case this worker is running inline
+  // inside a node of another step (or of the same step, for inline runners).
+  const WorkStealingWorkerId saved_worker = current_work_stealing_worker;
+  while (true) {
+    current_work_stealing_worker = {queues.get(), worker_id};
+    while (absl::optional<typename ReadyQueues::Item> item =
+               queues->Pop(worker_id)) {
+      state->Process(item->node, item->scheduled_nsec);
+      current_work_stealing_worker = {queues.get(), worker_id};
+    }
+    queues->ReleaseWorker(worker_id);
+    // Recheck for nodes pushed by a producer that observed this worker as
+    // running; see `WorkStealingReadyQueues::ReleaseWorker()`.
+    if (!queues->HasPending() || !queues->AcquireWorker(&worker_id)) break;
+  }
+  current_work_stealing_worker = saved_worker;
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   TaggedNodeSeq ready;
@@ -463,7 +742,7 @@ void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   const Status get_context_status =
       device->TryGetDeviceContext(&device_context_);
   if (!get_context_status.ok()) {
-    delete this;
+    Delete();
     done(get_context_status);
     return;
   }
@@ -473,7 +752,7 @@ void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   propagator_.ActivateRoots(immutable_state_.root_nodes(), &ready);
   num_outstanding_ops_ = ready.size();
   if (ready.empty()) {
-    delete this;
+    Delete();
     done(Status::OK());
   } else {
     done_cb_ = std::move(done);
@@ -525,6 +804,32 @@ struct ExecutorState<PropagatorStateType>::AsyncState {
   }
 };
 
+template <class PropagatorStateType>
+template <typename... Args>
+typename ExecutorState<PropagatorStateType>::AsyncState*
+ExecutorState<PropagatorStateType>::NewAsyncState(Args&&... args) {
+  void* storage = nullptr;
+  {
+    mutex_lock l(async_states_mu_);
+    if (free_async_states_ != nullptr) {
+      storage = free_async_states_;
+      free_async_states_ = *static_cast<void**>(storage);
+    }
+  }
+  if (storage == nullptr) {
+    storage = step_arena_->Allocate(sizeof(AsyncState), alignof(AsyncState));
+  }
+  return new (storage) AsyncState(std::forward<Args>(args)...);
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::DeleteAsyncState(AsyncState* state) {
+  state->~AsyncState();
+  mutex_lock l(async_states_mu_);
+  *reinterpret_cast<void**>(state) = free_async_states_;
+  free_async_states_ = state;
+}
+
 // Returns true if `item` might be traced by the given trace and event
 // collectors. Returns false only if `item` definitely will not be traced.
 bool MightTrace(const tracing::EventCollector* event_collector,
@@ -578,6 +883,13 @@ Status ExecutorState<PropagatorStateType>::ProcessSync(
         timer.start_cycles % kKernelExecutionTrackingInvocationSkipCount == 0) {
       kernel_stats_->UpdateCostEstimate(item, timer.ElapsedCycles());
     }
+  } else if (is_expensive ||
+             ExecutorImpl::KernelStats::ShouldSampleInexpensiveKernel()) {
+    // A kernel without the marker that turned out to be expensive keeps being
+    // measured on every invocation, like marked kernels.
+    KernelTimer timer;
+    device->Compute(op_kernel, &ctx);
+    kernel_stats_->UpdateCostEstimate(item, timer.ElapsedCycles());
   } else {
     device->Compute(op_kernel, &ctx);
   }
@@ -596,7 +908,7 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
   AsyncOpKernel* async_kernel = item.kernel->AsAsync();
   DCHECK(async_kernel != nullptr);
   AsyncState* state =
-      new AsyncState(params, tagged_node, &item, first_input, stats);
+      NewAsyncState(params, tagged_node, &item, first_input, stats);
 
   auto done = [this, state]() {
     Device* device = immutable_state_.params().device;
@@ -626,7 +938,7 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
     }
     outputs.clear();
     const bool completed = NodeDone(s, &ready, stats, nullptr);
-    delete state;
+    DeleteAsyncState(state);
     if (completed) ScheduleFinish();
   };
   nodestats::SetOpStart(stats);
@@ -801,6 +1113,10 @@ void ExecutorState<PropagatorStateType>::Process(TaggedNode tagged_node,
       params.frame_iter = propagator_.GetFrameAndIter(tagged_node);
       params.is_input_dead = is_input_dead;
       params.output_attr_array = item.output_attrs();
+      params.output_allocator_array =
+          static_memory_arena_ != nullptr
+              ? static_memory_arena_->output_allocators(id)
+              : nullptr;
       params.forward_from_array = item.forward_from();
       params.outputs_required_array = item.outputs_required.get();
 
@@ -1148,7 +1464,10 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     scheduled_nsec = nodestats::NowInNsec();
   }
 
+  int64 num_inline = 0;
+  int64 num_scheduled = 0;
   if (run_all_kernels_inline_) {
+    num_inline = ready->size();
     if (inline_ready == nullptr) {
       // Schedule all ready kernels from a single closure. This ensure that,
       // regardless of the `runner_` implementation, all kernels will run
@@ -1165,40 +1484,107 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
   } else {
+    // Inexpensive nodes that are not run inline are batched into closures,
+    // so that many cheap nodes cost one thread wakeup rather than one each.
+    // Work-stealing deques already amortize wakeups, so in that mode every
+    // node is dispatched on its own and can be stolen independently.
+    TaggedNodeSeq batch;
+    uint64 batch_cost = 0;
+    auto dispatch_batch = [this, &batch, &batch_cost, &num_scheduled,
+                           scheduled_nsec]() {
+      if (batch.empty()) return;
+      num_scheduled += batch.size();
+      if (batch.size() == 1) {
+        Dispatch(*batch.begin(), scheduled_nsec);
+      } else {
+        RunTask([this, batch = std::move(batch), scheduled_nsec]() {
+          for (auto& tagged_node : batch) {
+            Process(tagged_node, scheduled_nsec);
+          }
+        });
+      }
+      batch.clear();
+      batch_cost = 0;
+    };
+    auto schedule_inexpensive = [this, &batch, &batch_cost, &num_scheduled,
+                                 &dispatch_batch, scheduled_nsec](
+                                    const TaggedNode& tagged_node,
+                                    uint64 cost) {
+      if (ready_queues_) {
+        ++num_scheduled;
+        Dispatch(tagged_node, scheduled_nsec);
+        return;
+      }
+      batch.push_back(tagged_node);
+      batch_cost += cost;
+      if (batch_cost >= ExecutorImpl::KernelStats::kInlineBudgetCycles) {
+        dispatch_batch();
+      }
+    };
+    auto cost_estimate = [this](const TaggedNode& tagged_node) -> uint64 {
+      return tagged_node.get_is_dead()
+                 ? 0
+                 : kernel_stats_->CostEstimate(*tagged_node.node_item);
+    };
+
     const TaggedNode* curr_expensive_node = nullptr;
     if (inline_ready == nullptr) {
       // Schedule to run all the ready ops in thread pool.
       for (auto& tagged_node : *ready) {
-        RunTask([=]() { Process(tagged_node, scheduled_nsec); });
+        const NodeItem& item = *tagged_node.node_item;
+        if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
+          schedule_inexpensive(tagged_node, cost_estimate(tagged_node));
+        } else {
+          ++num_scheduled;
+          Dispatch(tagged_node, scheduled_nsec);
+        }
       }
     } else {
+      uint64 inline_cost = 0;
       for (auto& tagged_node : *ready) {
         const NodeItem& item = *tagged_node.node_item;
         if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
-          // Inline this inexpensive node.
-          inline_ready->push_back(tagged_node);
+          const uint64 cost = cost_estimate(tagged_node);
+          if (inline_cost < ExecutorImpl::KernelStats::kInlineBudgetCycles) {
+            // Inline this inexpensive node.
+            inline_cost += cost;
+            ++num_inline;
+            inline_ready->push_back(tagged_node);
+          } else {
+            // This thread already has enough inexpensive work.
+            schedule_inexpensive(tagged_node, cost);
+          }
         } else {
           if (curr_expensive_node) {
             // Dispatch to another thread since there is plenty of work to
             // do for this thread.
-            RunTask(std::bind(&ExecutorState::Process, this,
-                              *curr_expensive_node, scheduled_nsec));
+            ++num_scheduled;
+            Dispatch(*curr_expensive_node, scheduled_nsec);
           }
           curr_expensive_node = &tagged_node;
         }
       }
     }
+    dispatch_batch();
     if (curr_expensive_node) {
       if (inline_ready->empty()) {
+        ++num_inline;
         inline_ready->push_back(*curr_expensive_node);
       } else {
         // There are inline nodes to run already. We dispatch this expensive
         // node to other thread.
-        RunTask(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                          scheduled_nsec));
+        ++num_scheduled;
+        Dispatch(*curr_expensive_node, scheduled_nsec);
       }
     }
   }
+  if (num_inline > 0) {
+    num_inline_dispatches_.fetch_add(num_inline, std::memory_order_relaxed);
+  }
+  if (num_scheduled > 0) {
+    num_scheduled_dispatches_.fetch_add(num_scheduled,
+                                        std::memory_order_relaxed);
+  }
   ready->clear();
 }
 
@@ -1283,7 +1669,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
         collective_executor_->StartAbort(status);
       }
     }
-    delete this;
+    Delete();
     runner([step_id, status, done_cb = std::move(done_cb)]() {
       profiler::TraceMeConsumer activity(
           // From TraceMeProducer in KernelAndDeviceFunc::RunAsync,
@@ -1306,7 +1692,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
     // the user until the step (and its side-effects) has actually completed.
     device->Sync([this, step_id, runner = std::move(runner),
                   done_cb = std::move(done_cb)](const Status& status) mutable {
-      delete this;
+      Delete();
       runner([step_id, status, done_cb = std::move(done_cb)]() {
         profiler::TraceMeConsumer activity(
             // From TraceMeProducer in KernelAndDeviceFunc::RunAsync,
@@ -1321,7 +1707,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
       });
     });
   } else {
-    delete this;
+    Delete();
     runner([step_id, status, done_cb = std::move(done_cb)]() {
       profiler::TraceMeConsumer activity(
           // From TraceMeProducer in KernelAndDeviceFunc::RunAsync,
@@ -1338,12 +1724,19 @@ void ExecutorState<PropagatorStateType>::Finish() {
 }
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  ExecutorStepArena* arena = step_arena_pool_.Acquire();
   if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    arena
+        ->New<ExecutorState<PropagatorState>>(args, immutable_state_,
+                                              &kernel_stats_,
+                                              use_work_stealing_,
+                                              &step_arena_pool_, arena)
         ->RunAsync(std::move(done));
   } else {
-    (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+    arena
+        ->New<ExecutorState<SimplePropagatorState>>(
+            args, immutable_state_, &kernel_stats_, use_work_stealing_,
+            &step_arena_pool_, arena)
         ->RunAsync(std::move(done));
   }
 }
@@ -1397,6 +1790,28 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers an executor that dispatches ready nodes through per-worker deques
+// with work stealing. Select it with `executor_type = "WORK_STEALING"`.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl = absl::make_unique<ExecutorImpl>(params,
+                                                  /*use_work_stealing=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return Status::OK();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
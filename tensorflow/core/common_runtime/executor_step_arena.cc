@@ -0,0 +1,120 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/executor_step_arena.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr size_t kMinBlockSize = 4096;
+
+size_t RoundUp(size_t bytes, size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+ExecutorStepArena::ExecutorStepArena(Allocator* block_allocator)
+    : block_allocator_(block_allocator) {}
+
+ExecutorStepArena::~ExecutorStepArena() {
+  mutex_lock l(mu_);
+  for (const Block& block : blocks_) {
+    FreeBlock(block);
+  }
+}
+
+char* ExecutorStepArena::AllocateBlock(size_t size) {
+  void* ptr =
+      block_allocator_ != nullptr
+          ? block_allocator_->AllocateRaw(Allocator::kAllocatorAlignment, size)
+          : port::AlignedMalloc(size, Allocator::kAllocatorAlignment);
+  CHECK(ptr != nullptr) << "Failed to allocate " << size
+                        << " bytes for executor step state.";
+  return static_cast<char*>(ptr);
+}
+
+void ExecutorStepArena::FreeBlock(const Block& block) {
+  if (block_allocator_ != nullptr) {
+    block_allocator_->DeallocateRaw(block.base);
+  } else {
+    port::AlignedFree(block.base);
+  }
+}
+
+void* ExecutorStepArena::Allocate(size_t bytes, size_t alignment) {
+  DCHECK_LE(alignment, Allocator::kAllocatorAlignment);
+  mutex_lock l(mu_);
+  if (!blocks_.empty()) {
+    const size_t offset = RoundUp(used_, alignment);
+    if (offset + bytes <= blocks_.back().size) {
+      used_ = offset + bytes;
+      return blocks_.back().base + offset;
+    }
+    filled_ += blocks_.back().size;
+  }
+  // Blocks start at the maximum alignment, so `bytes` fit in a new block of
+  // that size.
+  const size_t size = std::max(
+      {kMinBlockSize, RoundUp(bytes, Allocator::kAllocatorAlignment), filled_});
+  blocks_.push_back({AllocateBlock(size), size});
+  used_ = bytes;
+  return blocks_.back().base;
+}
+
+void ExecutorStepArena::Reset() {
+  mutex_lock l(mu_);
+  if (blocks_.size() > 1) {
+    const size_t total = filled_ + blocks_.back().size;
+    for (const Block& block : blocks_) {
+      FreeBlock(block);
+    }
+    blocks_.clear();
+    blocks_.push_back({AllocateBlock(total), total});
+  }
+  used_ = 0;
+  filled_ = 0;
+}
+
+ExecutorStepArenaPool::~ExecutorStepArenaPool() {
+  mutex_lock l(mu_);
+  for (ExecutorStepArena* arena : free_arenas_) {
+    delete arena;
+  }
+}
+
+ExecutorStepArena* ExecutorStepArenaPool::Acquire() {
+  {
+    mutex_lock l(mu_);
+    if (!free_arenas_.empty()) {
+      ExecutorStepArena* arena = free_arenas_.back();
+      free_arenas_.pop_back();
+      return arena;
+    }
+  }
+  return new ExecutorStepArena(block_allocator_);
+}
+
+void ExecutorStepArenaPool::Release(ExecutorStepArena* arena) {
+  arena->Reset();
+  mutex_lock l(mu_);
+  free_arenas_.push_back(arena);
+}
+
+}  // namespace tensorflow
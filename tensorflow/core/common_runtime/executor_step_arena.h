@@ -0,0 +1,104 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EXECUTOR_STEP_ARENA_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_EXECUTOR_STEP_ARENA_H_
+
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A bump-pointer arena for part of the bookkeeping of one executor step: the
+// step state itself, its slice reader cache and the state of its running
+// asynchronous kernels. Unlike core::Arena, allocation is thread-safe, because
+// nodes of a step run on many threads.
+//
+// Memory is only reclaimed by Reset(). If a step needed more than one block,
+// Reset() replaces the blocks with a single block large enough for all of
+// them, so that once an arena has run a step of a given graph, later steps of
+// that graph reuse its blocks instead of allocating new ones. This does not
+// make steps free of heap allocations: frames, iterations, their input and
+// pending-count arrays, ready queues and runner closures still use the heap.
+class ExecutorStepArena {
+ public:
+  // Blocks are allocated from `block_allocator` if it is non-null, and from
+  // the heap otherwise.
+  explicit ExecutorStepArena(Allocator* block_allocator);
+  ~ExecutorStepArena();
+
+  // Returns `bytes` bytes of memory aligned to `alignment`, which must be at
+  // most Allocator::kAllocatorAlignment.
+  void* Allocate(size_t bytes, size_t alignment);
+
+  // Constructs a T in the arena. The caller must call the destructor of the
+  // result, if needed, before the arena is reset.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Releases everything allocated from the arena.
+  void Reset();
+
+ private:
+  struct Block {
+    char* base;
+    size_t size;
+  };
+
+  char* AllocateBlock(size_t size);
+  void FreeBlock(const Block& block);
+
+  Allocator* const block_allocator_;  // Not owned.
+
+  mutex mu_;
+  std::vector<Block> blocks_ TF_GUARDED_BY(mu_);
+  // The number of bytes used in the last block of `blocks_`.
+  size_t used_ TF_GUARDED_BY(mu_) = 0;
+  // The total size of the blocks that were filled before the last one.
+  size_t filled_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ExecutorStepArena);
+};
+
+// A pool of ExecutorStepArenas, so that concurrent steps of one executor each
+// use their own arena, and sequential steps reuse the same arenas.
+class ExecutorStepArenaPool {
+ public:
+  explicit ExecutorStepArenaPool(Allocator* block_allocator)
+      : block_allocator_(block_allocator) {}
+  ~ExecutorStepArenaPool();
+
+  ExecutorStepArena* Acquire();
+  // Resets `arena` and returns it to the pool.
+  void Release(ExecutorStepArena* arena);
+
+ private:
+  Allocator* const block_allocator_;  // Not owned.
+  mutex mu_;
+  std::vector<ExecutorStepArena*> free_arenas_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ExecutorStepArenaPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_EXECUTOR_STEP_ARENA_H_
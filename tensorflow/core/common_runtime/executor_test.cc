@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include "tensorflow/cc/framework/ops.h"
 #include "tensorflow/cc/ops/array_ops.h"
@@ -25,12 +26,14 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
@@ -67,7 +70,8 @@ class ExecutorTest : public ::testing::Test {
   }
 
   // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  void Create(std::unique_ptr<const Graph> graph,
+              const string& executor_type = "") {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
@@ -80,9 +84,12 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
+    params.step_arena_allocator = step_arena_allocator_;
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    std::unique_ptr<Executor> exec;
+    TF_CHECK_OK(NewExecutor(executor_type, params, *graph, &exec));
+    exec_ = exec.release();
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
@@ -101,6 +108,7 @@ class ExecutorTest : public ::testing::Test {
   StepStats step_stats_;
   Executor::Args::Runner runner_;
   Rendezvous* rendez_ = nullptr;
+  Allocator* step_arena_allocator_ = nullptr;
 };
 
 // A float val -> Tensor<float>
@@ -255,6 +263,21 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "WORK_STEALING");
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -430,10 +453,115 @@ TEST_F(ExecutorTest, NoInputTensors) {
   TF_ASSERT_OK(Run(rendez_));
 }
 
+TEST_F(ExecutorTest, BatchesInexpensiveNodes) {
+  // A root with a fan-out of many inexpensive nodes.
+  constexpr int kWidth = 1024;
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  Node* root = test::graph::NoOp(g.get(), {});
+  for (int i = 0; i < kWidth; ++i) {
+    test::graph::NoOp(g.get(), {root});
+  }
+  FixupSourceAndSinkEdges(g.get());
+  const int num_nodes = g->num_nodes();
+  Create(std::move(g));
+
+  std::atomic<int> num_closures(0);
+  runner_ = [this, &num_closures](std::function<void()> fn) {
+    num_closures.fetch_add(1);
+    thread_pool_->Schedule(fn);
+  };
+  monitoring::CounterCell* inline_counter =
+      metrics::GetExecutorDispatchesCounter("inline");
+  monitoring::CounterCell* scheduled_counter =
+      metrics::GetExecutorDispatchesCounter("scheduled");
+  const int64 inline_before = inline_counter->value();
+  const int64 scheduled_before = scheduled_counter->value();
+
+  TF_ASSERT_OK(Run(rendez_));
+
+  // Every node is dispatched exactly once. The fan-out does not all run
+  // on one thread, but it is scheduled in a few batches rather than one
+  // closure per node.
+  const int64 num_inline = inline_counter->value() - inline_before;
+  const int64 num_scheduled = scheduled_counter->value() - scheduled_before;
+  EXPECT_EQ(num_nodes, num_inline + num_scheduled);
+  EXPECT_GT(num_inline, 0);
+  EXPECT_GT(num_scheduled, 0);
+  EXPECT_LT(num_closures.load(), kWidth / 16);
+}
+
+// Counts the blocks that executor step arenas allocate.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    num_allocations_.fetch_add(1);
+    num_live_.fetch_add(1);
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    num_live_.fetch_sub(1);
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() const { return num_allocations_.load(); }
+  int num_live() const { return num_live_.load(); }
+
+ private:
+  std::atomic<int> num_allocations_{0};
+  std::atomic<int> num_live_{0};
+};
+
+// Counts only the blocks of the step arenas, which hold the ExecutorState,
+// the slice reader cache and the AsyncStates of a step. Runner closures,
+// ready queues and the propagator state are still allocated on the heap.
+TEST_F(ExecutorTest, StepArenaIsReusedInSteadyState) {
+  CountingAllocator allocator;
+  step_arena_allocator_ = &allocator;
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  Node* one = test::graph::Constant(g.get(), V(1.0));
+  Node* sum = test::graph::Add(g.get(), one, one);
+  for (int i = 0; i < 64; ++i) {
+    sum = test::graph::Add(g.get(), sum, one);
+  }
+  test::graph::Send(g.get(), sum, "c", BOB, 1, ALICE);
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g));
+
+  auto run_step = [this]() {
+    Rendezvous* rendez = NewLocalRendezvous();
+    Rendezvous::Args args;
+    TF_ASSERT_OK(Run(rendez));
+    Tensor out;
+    bool is_dead = false;
+    TF_ASSERT_OK(
+        rendez->Recv(Key(BOB, 1, ALICE, "c"), args, &out, &is_dead));
+    EXPECT_EQ(66.0, V(out));
+    rendez->Unref();
+  };
+
+  // The first step sizes the arena for the graph.
+  run_step();
+  const int warm_allocations = allocator.num_allocations();
+  EXPECT_GT(warm_allocations, 0);
+  for (int i = 0; i < 10; ++i) {
+    run_step();
+  }
+  EXPECT_EQ(warm_allocations, allocator.num_allocations());
+
+  // The executor owns the arena and frees it on destruction.
+  delete exec_;
+  exec_ = nullptr;
+  EXPECT_EQ(0, allocator.num_live());
+}
+
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
-static void BM_executor(::testing::benchmark::State& state) {
+static void BM_executor_helper(::testing::benchmark::State& state,
+                               const char* executor_type) {
   const int width = state.range(0);
   const int depth = state.range(1);
 
@@ -467,12 +595,19 @@ static void BM_executor(::testing::benchmark::State& state) {
   }
 
   FixupSourceAndSinkEdges(g);
-  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr, executor_type,
+                  /*old_benchmark_api=*/false)
+      .Run(state);
 
   state.SetLabel(strings::StrCat("Nodes = ", cur));
   state.SetItemsProcessed(cur * static_cast<int64>(state.iterations()));
 }
 
+static void BM_executor(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "");
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(32, 8192);
@@ -484,6 +619,17 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+static void BM_executor_work_stealing(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "WORK_STEALING");
+}
+
+// The same graphs as `BM_executor`, run with the work-stealing executor.
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(16, 1024);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(32, 8192);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(1024, 16);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(8192, 32);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(1024, 1024);
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
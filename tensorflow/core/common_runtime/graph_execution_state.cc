@@ -78,6 +78,7 @@ GraphExecutionState::GraphExecutionState(
       original_graph_def_(std::move(graph_def)),
       device_set_(options.device_set),
       session_options_(options.session_options),
+      default_local_device_(options.default_local_device),
       session_handle_(options.session_handle),
       flib_def_(std::move(flib_def)),
       graph_(nullptr) {}
@@ -262,6 +263,7 @@ Status GraphExecutionState::Extend(
   combined_options.session_options = session_options_;
   combined_options.session_handle = session_handle_;
   combined_options.stateful_placements = stateful_placements_;
+  combined_options.default_local_device = default_local_device_;
 
   TF_RETURN_IF_ERROR(AddDefaultAttrsToGraphDef(&gdef, *flib_def_, 0));
   auto flib_def = absl::make_unique<FunctionLibraryDefinition>(
@@ -621,7 +623,7 @@ Status GraphExecutionState::InitBaseGraph(std::unique_ptr<Graph>&& new_graph) {
       OptimizationPassRegistry::PRE_PLACEMENT, optimization_options));
 
   Placer placer(new_graph.get(), "", flib_def_.get(), device_set_,
-                /* default_local_device= */ nullptr,
+                default_local_device_,
                 session_options_ == nullptr ||
                     session_options_->config.allow_soft_placement(),
                 session_options_ != nullptr &&
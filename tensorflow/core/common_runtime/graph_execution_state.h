@@ -47,6 +47,9 @@ struct GraphExecutionStateOptions {
   // A map from node name to device name, representing the unchangeable
   // placement of stateful nodes.
   std::unordered_map<string, string> stateful_placements;
+  // If non-null, the placer prefers this device for nodes that do not have a
+  // requested device. Must be an element of `device_set`.
+  const Device* default_local_device = nullptr;
 };
 
 // A ClientGraph is simply a sub-graph of the full graph as induced by
@@ -199,6 +202,7 @@ class GraphExecutionState {
 
   const DeviceSet* device_set_;            // Not owned
   const SessionOptions* session_options_;  // Not owned
+  const Device* default_local_device_;     // Not owned
   // Unique session identifier. Can be empty.
   string session_handle_;
 
@@ -21,12 +21,14 @@ limitations under the License.
 
 namespace tensorflow {
 
+class Allocator;
 class Device;
 class StepStatsCollector;
 class SessionMetadata;
 class FunctionLibraryRuntime;
 class NodeProperties;
 class OpKernel;
+class StaticMemoryPlan;
 class Status;
 
 // LocalExecutorParams provides arguments that will be shared by all invocations
@@ -47,6 +49,17 @@ struct LocalExecutorParams {
                        OpKernel**)>
       create_kernel;
   std::function<void(OpKernel*)> delete_kernel;
+
+  // If non-null, each step serves the planned node outputs from an arena laid
+  // out by this plan instead of allocating them individually.
+  std::shared_ptr<StaticMemoryPlan> static_memory_plan;
+
+  // Part of the bookkeeping of each step (the step state, its slice reader
+  // cache and the state of running asynchronous kernels) is allocated from
+  // arenas that the executor reuses across steps. If non-null, the arena
+  // blocks are allocated from this allocator instead of the heap. Steps still
+  // make other heap allocations, e.g. for frames, iterations and closures.
+  Allocator* step_arena_allocator = nullptr;
 };
 
 }  // end namespace tensorflow
@@ -20,11 +20,19 @@ limitations under the License.
 #include <strings.h>
 #include <sys/mman.h>  // for munmap
 #endif
+#if defined(__linux__)
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
 
 #include <map>
 #include <utility>
 
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -50,6 +58,37 @@ PoolAllocator::PoolAllocator(size_t pool_size_limit, bool auto_resize,
 
 PoolAllocator::~PoolAllocator() { Clear(); }
 
+Status PoolAllocator::EnableSpilling(const SpillOptions& options) {
+#if defined(__linux__)
+  DCHECK_EQ(0, allocated_count_ + get_from_pool_count_)
+      << "EnableSpilling must be called before the first allocation.";
+  spill_options_ = options;
+  if (spill_options_.scratch_dir.empty()) {
+    const char* tmpdir = getenv("TMPDIR");
+    spill_options_.scratch_dir =
+        (tmpdir != nullptr && tmpdir[0] != '\0') ? tmpdir : "/tmp";
+  }
+  string path = io::JoinPath(spill_options_.scratch_dir, "tf_pool_XXXXXX");
+  const int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    return errors::InvalidArgument("Cannot create a scratch file in ",
+                                   spill_options_.scratch_dir, ": ",
+                                   strerror(errno));
+  }
+  unlink(path.c_str());
+  close(fd);
+  spill_enabled_ = true;
+  VLOG(1) << name_ << ": spilling buffers of at least "
+          << spill_options_.min_spill_bytes << " bytes to "
+          << spill_options_.scratch_dir << " beyond a RAM budget of "
+          << spill_options_.ram_budget_bytes << " bytes.";
+  return Status::OK();
+#else
+  return errors::Unimplemented(
+      "PoolAllocator spilling is not supported on this platform.");
+#endif
+}
+
 namespace {
 // Pools contain Chunks allocated from the underlying Allocator.
 // Chunk alignment is always on kPoolAlignment boundaries.  Each Chunk
@@ -125,10 +164,19 @@ void* PoolAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
   if (pr != nullptr) {
     void* r = pr->ptr;
     delete pr;
+    if (spill_enabled_ && IsSpilled(r)) PageIn(r, num_bytes);
     return PrepareChunk(r, alignment, num_bytes);
   } else {
+    if (spill_enabled_ && num_bytes >= spill_options_.min_spill_bytes &&
+        !FitsRamBudget(num_bytes)) {
+      void* chunk = AllocateSpilled(num_bytes);
+      if (chunk != nullptr) return PrepareChunk(chunk, alignment, num_bytes);
+    }
     size_t bytes_received;
     void* ptr = allocator_->Alloc(kPoolAlignment, num_bytes, &bytes_received);
+    if (spill_enabled_ && ptr != nullptr) {
+      ram_bytes_.fetch_add(bytes_received, std::memory_order_relaxed);
+    }
     return PrepareChunk(ptr, alignment, bytes_received);
   }
 }
@@ -138,7 +186,7 @@ void PoolAllocator::DeallocateRaw(void* ptr) {
   ChunkPrefix* cp = FindPrefix(ptr);
   CHECK_LE((void*)cp, (void*)ptr);
   if (!has_size_limit_ && !auto_resize_) {
-    allocator_->Free(cp, cp->num_bytes);
+    FreeChunk(cp, cp->num_bytes);
   } else {
     mutex_lock lock(mutex_);
     ++put_count_;
@@ -158,7 +206,7 @@ void PoolAllocator::Clear() {
     mutex_lock lock(mutex_);
     for (auto iter : pool_) {
       PtrRecord* pr = iter.second;
-      allocator_->Free(pr->ptr, pr->num_bytes);
+      FreeChunk(pr->ptr, pr->num_bytes);
       delete pr;
     }
     pool_.clear();
@@ -212,7 +260,7 @@ void PoolAllocator::EvictOne() {
     DCHECK(iter != pool_.end());
   }
   pool_.erase(iter);
-  allocator_->Free(prec->ptr, prec->num_bytes);
+  FreeChunk(prec->ptr, prec->num_bytes);
   delete prec;
   ++evicted_count_;
   // Auto-resizing, and warning messages.
@@ -257,6 +305,104 @@ void PoolAllocator::EvictOne() {
   }
 }
 
+void PoolAllocator::FreeChunk(void* chunk, size_t num_bytes) {
+  if (spill_enabled_) {
+    if (IsSpilled(chunk)) {
+      {
+        mutex_lock lock(spill_mu_);
+        spilled_chunks_.erase(chunk);
+      }
+#if defined(__linux__)
+      munmap(chunk, num_bytes);
+#endif
+      spilled_bytes_.fetch_sub(num_bytes, std::memory_order_relaxed);
+      return;
+    }
+    ram_bytes_.fetch_sub(num_bytes, std::memory_order_relaxed);
+  }
+  allocator_->Free(chunk, num_bytes);
+}
+
+bool PoolAllocator::FitsRamBudget(size_t num_bytes) {
+  const int64 budget = spill_options_.ram_budget_bytes;
+  auto fits = [this, budget, num_bytes]() {
+    return ram_bytes_.load(std::memory_order_relaxed) +
+               static_cast<int64>(num_bytes) <=
+           budget;
+  };
+  if (fits()) return true;
+  if (has_size_limit_) {
+    // Buffers in the pool are not in use, so they are the coldest memory
+    // and are released before anything is spilled.
+    mutex_lock lock(mutex_);
+    while (lru_tail_ != nullptr && !fits()) {
+      EvictOne();
+    }
+  }
+  return fits();
+}
+
+void* PoolAllocator::AllocateSpilled(size_t num_bytes) {
+#if defined(__linux__)
+  // Each buffer gets its own unlinked file, so that its disk space is
+  // released as soon as it is unmapped.
+  string path = io::JoinPath(spill_options_.scratch_dir, "tf_pool_XXXXXX");
+  const int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    LOG_EVERY_N_SEC(WARNING, 60)
+        << name_ << ": failed to create a scratch file in "
+        << spill_options_.scratch_dir << ": " << strerror(errno);
+    return nullptr;
+  }
+  unlink(path.c_str());
+  // Reserve the disk space now, so that running out of it fails here rather
+  // than with a SIGBUS when the buffer is written.
+  if (posix_fallocate(fd, 0, num_bytes) != 0) {
+    close(fd);
+    LOG_EVERY_N_SEC(WARNING, 60)
+        << name_ << ": failed to reserve " << num_bytes << " bytes in "
+        << spill_options_.scratch_dir << "; allocating in RAM instead.";
+    return nullptr;
+  }
+  void* chunk = mmap(nullptr, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+  close(fd);
+  if (chunk == MAP_FAILED) return nullptr;
+  {
+    mutex_lock lock(spill_mu_);
+    spilled_chunks_.insert(chunk);
+  }
+  spilled_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+  total_spilled_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+  VLOG(2) << name_ << ": spilled a buffer of " << num_bytes << " bytes.";
+  return chunk;
+#else
+  return nullptr;
+#endif
+}
+
+bool PoolAllocator::IsSpilled(void* chunk) {
+  mutex_lock lock(spill_mu_);
+  return spilled_chunks_.count(chunk) > 0;
+}
+
+void PoolAllocator::PageIn(void* chunk, size_t num_bytes) {
+#if defined(__linux__)
+  // Fault the pages of a reused buffer in here, rather than one at a time
+  // in the kernel that writes it.
+  const uint64 start = Env::Default()->NowMicros();
+  madvise(chunk, num_bytes, MADV_WILLNEED);
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  volatile const char* p = static_cast<const char*>(chunk);
+  for (size_t offset = 0; offset < num_bytes; offset += page_size) {
+    (void)p[offset];
+  }
+  page_in_count_.fetch_add(1, std::memory_order_relaxed);
+  page_in_micros_.fetch_add(Env::Default()->NowMicros() - start,
+                            std::memory_order_relaxed);
+#endif
+}
+
 void* BasicCPUAllocator::Alloc(size_t alignment, size_t num_bytes,
                                size_t* bytes_received) {
   void* ptr = nullptr;
@@ -21,10 +21,12 @@ limitations under the License.
 #include <atomic>
 #include <map>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -43,6 +45,21 @@ class RoundUpInterface {
 // instance.  Pool eviction policy is LRU.
 class PoolAllocator : public Allocator {
  public:
+  // Options for the optional out-of-core tier. Once the buffers obtained
+  // from the SubAllocator (including those held in the pool) exceed
+  // "ram_budget_bytes", pooled buffers are released, and if that is not
+  // enough, new large buffers are served from memory-mapped scratch files
+  // instead. The kernel can then write their cold pages back to disk under
+  // memory pressure, and faults them back in when they are accessed.
+  struct SpillOptions {
+    // A soft limit on the bytes obtained from the SubAllocator.
+    size_t ram_budget_bytes = 0;
+    // Buffers smaller than this are never spilled.
+    size_t min_spill_bytes = 1 << 20;
+    // Directory for the scratch files. Defaults to $TMPDIR, or /tmp.
+    string scratch_dir;
+  };
+
   // "pool_size_limit" is the maximum number of returned, re-usable
   // memory buffers to keep in the pool.  If pool_size_limit == 0, the
   // pool is effectively a thin wrapper around the allocator.
@@ -58,6 +75,11 @@ class PoolAllocator : public Allocator {
                 string name);
   ~PoolAllocator() override;
 
+  // Enables the out-of-core tier. Must be called before the first
+  // allocation. Returns an error if the platform does not support it or a
+  // scratch file cannot be created in "options.scratch_dir".
+  Status EnableSpilling(const SpillOptions& options);
+
   string Name() override { return name_; }
 
   void* AllocateRaw(size_t alignment, size_t num_bytes) override;
@@ -100,6 +122,29 @@ class PoolAllocator : public Allocator {
     return pool_size_limit_;
   }
 
+  // The following accessors monitor the out-of-core tier.
+
+  // Bytes currently obtained from the SubAllocator.
+  int64 ram_bytes() const {
+    return ram_bytes_.load(std::memory_order_relaxed);
+  }
+  // Bytes currently served from scratch files.
+  int64 spilled_bytes() const {
+    return spilled_bytes_.load(std::memory_order_relaxed);
+  }
+  // Total bytes ever served from scratch files.
+  int64 total_spilled_bytes() const {
+    return total_spilled_bytes_.load(std::memory_order_relaxed);
+  }
+  // Number of pooled spilled buffers that were paged back in to be reused,
+  // and the total time spent doing so.
+  int64 page_in_count() const {
+    return page_in_count_.load(std::memory_order_relaxed);
+  }
+  int64 page_in_micros() const {
+    return page_in_micros_.load(std::memory_order_relaxed);
+  }
+
  private:
   struct PtrRecord {
     void* ptr;
@@ -117,6 +162,19 @@ class PoolAllocator : public Allocator {
   // Delete the least recently used record.
   void EvictOne() TF_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Return a chunk to the SubAllocator or the out-of-core tier.
+  void FreeChunk(void* chunk, size_t num_bytes);
+
+  // Returns true if a chunk of "num_bytes" fits in the RAM budget, after
+  // evicting pooled buffers if needed.
+  bool FitsRamBudget(size_t num_bytes) TF_LOCKS_EXCLUDED(mutex_);
+
+  // Out-of-core tier. AllocateSpilled returns nullptr on failure, in which
+  // case the caller falls back to the SubAllocator.
+  void* AllocateSpilled(size_t num_bytes);
+  bool IsSpilled(void* chunk) TF_LOCKS_EXCLUDED(spill_mu_);
+  void PageIn(void* chunk, size_t num_bytes);
+
   const string name_;
   const bool has_size_limit_;
   const bool auto_resize_;
@@ -131,6 +189,16 @@ class PoolAllocator : public Allocator {
   int64 put_count_ TF_GUARDED_BY(mutex_) = 0;
   int64 allocated_count_ TF_GUARDED_BY(mutex_) = 0;
   int64 evicted_count_ TF_GUARDED_BY(mutex_) = 0;
+
+  bool spill_enabled_ = false;
+  SpillOptions spill_options_;
+  mutex spill_mu_;
+  std::unordered_set<void*> spilled_chunks_ TF_GUARDED_BY(spill_mu_);
+  std::atomic<int64> ram_bytes_{0};
+  std::atomic<int64> spilled_bytes_{0};
+  std::atomic<int64> total_spilled_bytes_{0};
+  std::atomic<int64> page_in_count_{0};
+  std::atomic<int64> page_in_micros_{0};
 };
 
 // Do-nothing rounder. Passes through sizes unchanged.
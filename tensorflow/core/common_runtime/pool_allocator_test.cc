@@ -0,0 +1,169 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+
+#include <cstring>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+#if defined(__linux__)
+
+constexpr size_t kMB = 1 << 20;
+
+PoolAllocator* NewSpillingPool(size_t pool_size_limit, size_t ram_budget) {
+  PoolAllocator* pool = new PoolAllocator(
+      pool_size_limit, /*auto_resize=*/false,
+      new BasicCPUAllocator(port::kNUMANoAffinity, {}, {}), new NoopRounder,
+      "spilling_pool");
+  PoolAllocator::SpillOptions options;
+  options.ram_budget_bytes = ram_budget;
+  options.min_spill_bytes = 256 * 1024;
+  options.scratch_dir = testing::TmpDir();
+  TF_CHECK_OK(pool->EnableSpilling(options));
+  return pool;
+}
+
+TEST(PoolAllocatorTest, SpillsBeyondRamBudget) {
+  std::unique_ptr<PoolAllocator> pool(NewSpillingPool(2, 2 * kMB));
+  std::vector<void*> buffers;
+  for (int i = 0; i < 4; ++i) {
+    void* p = pool->AllocateRaw(64, kMB);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % 64);
+    memset(p, i, kMB);
+    buffers.push_back(p);
+  }
+  // Only the first buffer fits in the budget.
+  EXPECT_LE(pool->ram_bytes(), 2 * kMB);
+  EXPECT_GE(pool->spilled_bytes(), 3 * kMB);
+  EXPECT_EQ(pool->spilled_bytes(), pool->total_spilled_bytes());
+  for (int i = 0; i < 4; ++i) {
+    const char* p = static_cast<const char*>(buffers[i]);
+    EXPECT_EQ(i, p[0]);
+    EXPECT_EQ(i, p[kMB - 1]);
+  }
+
+  // Small buffers are never spilled.
+  const int64 spilled = pool->spilled_bytes();
+  void* small = pool->AllocateRaw(64, 1024);
+  EXPECT_EQ(spilled, pool->spilled_bytes());
+  pool->DeallocateRaw(small);
+
+  // A spilled buffer returned to the pool is paged back in when reused.
+  pool->DeallocateRaw(buffers[3]);
+  buffers[3] = pool->AllocateRaw(64, kMB);
+  EXPECT_EQ(1, pool->get_from_pool_count());
+  EXPECT_EQ(1, pool->page_in_count());
+  memset(buffers[3], 3, kMB);
+
+  for (void* p : buffers) {
+    pool->DeallocateRaw(p);
+  }
+  pool->Clear();
+  EXPECT_EQ(0, pool->ram_bytes());
+  EXPECT_EQ(0, pool->spilled_bytes());
+}
+
+TEST(PoolAllocatorTest, ReleasesPooledBuffersBeforeSpilling) {
+  std::unique_ptr<PoolAllocator> pool(NewSpillingPool(2, 2 * kMB));
+  pool->DeallocateRaw(pool->AllocateRaw(64, kMB));
+  void* p = pool->AllocateRaw(64, kMB + kMB / 2);
+  // The pooled 1MB buffer is not reusable for this size, so it was released
+  // to make room.
+  EXPECT_EQ(1, pool->evicted_count());
+  EXPECT_EQ(0, pool->spilled_bytes());
+  pool->DeallocateRaw(p);
+}
+
+TEST(PoolAllocatorTest, RunsGraphUnderBudgetSmallerThanPeak) {
+  // Sums eight 1MB tensors, which are all live when AddN runs, with a RAM
+  // budget of 4MB.
+  constexpr int kNumInputs = 8;
+  constexpr int kNumElements = kMB / sizeof(float);
+  std::unique_ptr<PoolAllocator> pool(NewSpillingPool(100, 4 * kMB));
+  SessionOptions options;
+  ThreadPoolDevice device(options, "/job:a/replica:0/task:0/device:CPU:0",
+                          Bytes(256 * kMB), DeviceLocality(), pool.get());
+
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  Node* dims = test::graph::Constant(g.get(),
+                                     test::AsTensor<int32>({kNumElements}));
+  std::vector<Node*> inputs;
+  for (int i = 0; i < kNumInputs; ++i) {
+    Node* value = test::graph::Constant(g.get(), test::AsScalar<float>(i + 1));
+    inputs.push_back(test::graph::Binary(g.get(), "Fill", dims, value));
+  }
+  test::graph::Retval(g.get(), 0, test::graph::Multi(g.get(), "AddN", inputs));
+  FixupSourceAndSinkEdges(g.get());
+
+  LocalExecutorParams params;
+  params.device = &device;
+  params.create_kernel =
+      [&device](const std::shared_ptr<const NodeProperties>& props,
+                OpKernel** kernel) {
+        return CreateNonCachedKernel(&device, nullptr, props,
+                                     TF_GRAPH_DEF_VERSION, kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  Executor* raw_executor = nullptr;
+  TF_ASSERT_OK(NewLocalExecutor(params, *g, &raw_executor));
+  std::unique_ptr<Executor> executor(raw_executor);
+
+  FunctionCallFrame call_frame({}, {DT_FLOAT});
+  Executor::Args args;
+  args.call_frame = &call_frame;
+  args.runner = [](std::function<void()> fn) { fn(); };
+  TF_ASSERT_OK(executor->Run(args));
+  std::vector<Tensor> rets;
+  TF_ASSERT_OK(call_frame.ConsumeRetvals(&rets, false));
+  ASSERT_EQ(1, rets.size());
+  Tensor expected(DT_FLOAT, TensorShape({kNumElements}));
+  expected.flat<float>().setConstant(kNumInputs * (kNumInputs + 1) / 2);
+  test::ExpectTensorEqual<float>(expected, rets[0]);
+
+  EXPECT_GT(pool->total_spilled_bytes(), 0);
+  EXPECT_LE(pool->ram_bytes(), 4 * kMB);
+  rets.clear();
+  executor.reset();
+  pool->Clear();
+  EXPECT_EQ(0, pool->spilled_bytes());
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
+}  // namespace tensorflow
@@ -61,8 +61,16 @@ ProcessState::MemDesc ProcessState::PtrType(const void* ptr) {
   return MemDesc();
 }
 
+bool ProcessState::EnableNUMA() {
+  mutex_lock lock(mu_);
+  if (!numa_enabled_ && cpu_allocators_.empty()) {
+    numa_enabled_.store(true, std::memory_order_release);
+  }
+  return numa_enabled_;
+}
+
 Allocator* ProcessState::GetCPUAllocator(int numa_node) {
-  if (!numa_enabled_ || numa_node == port::kNUMANoAffinity) numa_node = 0;
+  if (!numa_enabled() || numa_node == port::kNUMANoAffinity) numa_node = 0;
 
   // Check if allocator for the numa node is in lock-free cache.
   if (numa_node < cpu_allocators_cached_.load(std::memory_order_acquire)) {
@@ -70,23 +78,40 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
   }
 
   mutex_lock lock(mu_);
+  // NUMA cannot be enabled once the first allocator is created below.
+  const bool numa_enabled = numa_enabled_;
   while (cpu_allocators_.size() <= static_cast<size_t>(numa_node)) {
+    // Allocators are created in node order, so the one being built now
+    // belongs to node cpu_allocators_.size(), not necessarily to numa_node.
+    const int node = static_cast<int>(cpu_allocators_.size());
     // If visitors have been defined we need an Allocator built from
     // a SubAllocator.  Prefer BFCAllocator, but fall back to PoolAllocator
-    // depending on env var setting.
+    // depending on env var setting.  NUMA-local allocators default to
+    // BFCAllocator so that freed node-local memory is reused on that node.
     const bool alloc_visitors_defined =
         (!cpu_alloc_visitors_.empty() || !cpu_free_visitors_.empty());
     bool use_bfc_allocator = false;
-    Status status = ReadBoolFromEnvVar(
-        "TF_CPU_ALLOCATOR_USE_BFC", alloc_visitors_defined, &use_bfc_allocator);
+    Status status = ReadBoolFromEnvVar("TF_CPU_ALLOCATOR_USE_BFC",
+                                       alloc_visitors_defined || numa_enabled,
+                                       &use_bfc_allocator);
     if (!status.ok()) {
       LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
     }
+    // A RAM budget for the CPU PoolAllocator enables its out-of-core tier.
+    int64 pool_ram_budget_in_mb = 0;
+    status = ReadInt64FromEnvVar("TF_CPU_POOL_ALLOCATOR_RAM_BUDGET_IN_MB", 0,
+                                 &pool_ram_budget_in_mb);
+    if (!status.ok()) {
+      LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+    }
+    const bool use_spilling_pool =
+        !use_bfc_allocator && pool_ram_budget_in_mb > 0;
     Allocator* allocator = nullptr;
     SubAllocator* sub_allocator =
-        (numa_enabled_ || alloc_visitors_defined || use_bfc_allocator)
+        (numa_enabled || alloc_visitors_defined || use_bfc_allocator ||
+         use_spilling_pool)
             ? new BasicCPUAllocator(
-                  numa_enabled_ ? numa_node : port::kNUMANoAffinity,
+                  numa_enabled ? node : port::kNUMANoAffinity,
                   cpu_alloc_visitors_, cpu_free_visitors_)
             : nullptr;
     if (use_bfc_allocator) {
@@ -100,19 +125,44 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
       }
       int64 cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
       DCHECK(sub_allocator);
-      allocator =
-          new BFCAllocator(sub_allocator, cpu_mem_limit, /*allow_growth=*/true,
-                           /*name=*/"bfc_cpu_allocator_for_gpu");
+      BFCAllocator* bfc_allocator = new BFCAllocator(
+          sub_allocator, cpu_mem_limit, /*allow_growth=*/true,
+          /*name=*/numa_enabled
+              ? strings::StrCat("bfc_cpu_allocator_numa_", node)
+              : "bfc_cpu_allocator_for_gpu");
+      bool use_thread_local_cache = false;
+      status = ReadBoolFromEnvVar("TF_CPU_BFC_THREAD_LOCAL_CACHE", false,
+                                  &use_thread_local_cache);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
+      if (use_thread_local_cache) bfc_allocator->EnableThreadLocalCache();
+      allocator = bfc_allocator;
       VLOG(2) << "Using BFCAllocator with memory limit of "
-              << cpu_mem_limit_in_mb << " MB for ProcessState CPU allocator";
+              << cpu_mem_limit_in_mb << " MB for ProcessState CPU allocator"
+              << (use_thread_local_cache ? " and a thread-local cache" : "")
+              << " numa_enabled_=" << numa_enabled << " numa_node=" << node;
     } else if (sub_allocator) {
       DCHECK(sub_allocator);
-      allocator =
+      PoolAllocator* pool_allocator =
           new PoolAllocator(/*pool_size_limit=*/100, /*auto_resize=*/true,
                             sub_allocator, new NoopRounder, "cpu_pool");
+      if (use_spilling_pool) {
+        PoolAllocator::SpillOptions spill_options;
+        spill_options.ram_budget_bytes = pool_ram_budget_in_mb * (1LL << 20);
+        status = ReadStringFromEnvVar("TF_CPU_POOL_ALLOCATOR_SPILL_DIR", "",
+                                      &spill_options.scratch_dir);
+        if (status.ok()) {
+          status = pool_allocator->EnableSpilling(spill_options);
+        }
+        if (!status.ok()) {
+          LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+        }
+      }
+      allocator = pool_allocator;
       VLOG(2) << "Using PoolAllocator for ProcessState CPU allocator "
-              << "numa_enabled_=" << numa_enabled_
-              << " numa_node=" << numa_node;
+              << "numa_enabled_=" << numa_enabled
+              << " numa_node=" << node;
     } else {
       DCHECK(!sub_allocator);
       allocator = cpu_allocator_base();
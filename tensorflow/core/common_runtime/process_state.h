@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PROCESS_STATE_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_PROCESS_STATE_H_
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <unordered_map>
@@ -55,9 +56,15 @@ class ProcessState : public ProcessStateInterface {
     string DebugString();
   };
 
-  // If NUMA Allocators are desired, call this before calling any
-  // Allocator accessor.
-  void EnableNUMA() { numa_enabled_ = true; }
+  // Makes GetCPUAllocator() return a NUMA-local allocator for each node.
+  // Allocators are created once per process, so this only takes effect if no
+  // CPU allocator has been handed out yet. Returns whether NUMA allocators
+  // are enabled afterwards. Thread-safe, and calling it again is a no-op.
+  bool EnableNUMA();
+
+  bool numa_enabled() const {
+    return numa_enabled_.load(std::memory_order_acquire);
+  }
 
   // Returns what we know about the memory at ptr.
   // If we know nothing, it's called CPU 0 with no other attributes.
@@ -93,7 +100,8 @@ class ProcessState : public ProcessStateInterface {
   void TestOnlyReset();
 
   static ProcessState* instance_;
-  bool numa_enabled_;
+  // Only set while `cpu_allocators_` is empty, under `mu_`.
+  std::atomic<bool> numa_enabled_;
 
   mutex mu_;
 
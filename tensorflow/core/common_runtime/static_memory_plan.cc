@@ -0,0 +1,175 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+StaticMemoryPlan::StaticMemoryPlan(Allocator* allocator,
+                                   const std::vector<int>& num_outputs,
+                                   int64 arena_size, std::vector<Slot> slots)
+    : allocator_(allocator),
+      arena_size_(arena_size),
+      slots_(std::move(slots)),
+      output_slot_base_(num_outputs.size(), -1) {
+  std::vector<bool> planned(num_outputs.size(), false);
+  for (const Slot& slot : slots_) {
+    DCHECK_LT(slot.node_id, num_outputs.size());
+    DCHECK_LT(slot.output, num_outputs[slot.node_id]);
+    DCHECK_LE(slot.offset + slot.size, arena_size_);
+    planned[slot.node_id] = true;
+  }
+  // Kernels index the allocator array by any of their outputs, so a node's
+  // row covers all of its outputs, not just the planned ones.
+  int total_outputs = 0;
+  for (int id = 0; id < num_outputs.size(); ++id) {
+    if (planned[id]) {
+      output_slot_base_[id] = total_outputs;
+      total_outputs += num_outputs[id];
+    }
+  }
+  output_slot_.assign(total_outputs, -1);
+  for (int i = 0; i < slots_.size(); ++i) {
+    output_slot_[output_slot_base_[slots_[i].node_id] + slots_[i].output] = i;
+  }
+}
+
+StaticMemoryPlan::~StaticMemoryPlan() {
+  mutex_lock l(mu_);
+  for (StaticMemoryArena* arena : free_arenas_) {
+    arena->Unref();
+  }
+}
+
+int StaticMemoryPlan::slot_index(int node_id, int output) const {
+  const int base = output_slot_base_[node_id];
+  return base < 0 ? -1 : output_slot_[base + output];
+}
+
+StaticMemoryArena* StaticMemoryPlan::AcquireArena() {
+  {
+    mutex_lock l(mu_);
+    if (!free_arenas_.empty()) {
+      StaticMemoryArena* arena = free_arenas_.back();
+      free_arenas_.pop_back();
+      return arena;
+    }
+  }
+  void* base =
+      allocator_->AllocateRaw(Allocator::kAllocatorAlignment, arena_size_);
+  if (base == nullptr) {
+    LOG(WARNING) << "Failed to allocate a static memory arena of "
+                 << arena_size_ << " bytes from " << allocator_->Name()
+                 << "; falling back to dynamic allocation for this step.";
+    return nullptr;
+  }
+  return new StaticMemoryArena(this, base);
+}
+
+void StaticMemoryPlan::ReleaseArena(StaticMemoryArena* arena) {
+  mutex_lock l(mu_);
+  free_arenas_.push_back(arena);
+}
+
+// Serves one slot of a StaticMemoryArena. Every allocation, whether it is
+// served from the slot or from the fallback allocator, holds a reference on
+// the arena, because the returned buffer will call back into this object.
+class StaticMemoryArena::SlotAllocator : public Allocator {
+ public:
+  SlotAllocator(StaticMemoryArena* arena, int slot)
+      : arena_(arena), slot_(slot) {}
+
+  string Name() override { return "static_memory_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return AllocateRaw(alignment, num_bytes, AllocationAttributes());
+  }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes,
+                    const AllocationAttributes& allocation_attr) override {
+    void* ptr = nullptr;
+    if (num_bytes <= arena_->slot_sizes_[slot_] &&
+        alignment <= Allocator::kAllocatorAlignment) {
+      ptr = arena_->TryAcquireSlot(slot_);
+    }
+    if (ptr == nullptr) {
+      ptr = arena_->allocator_->AllocateRaw(alignment, num_bytes,
+                                            allocation_attr);
+    }
+    if (ptr != nullptr) arena_->Ref();
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    if (arena_->Contains(ptr)) {
+      arena_->ReleaseSlot(slot_);
+    } else {
+      arena_->allocator_->DeallocateRaw(ptr);
+    }
+    arena_->Unref();
+  }
+
+ private:
+  StaticMemoryArena* const arena_;  // Not owned.
+  const int slot_;
+};
+
+StaticMemoryArena::StaticMemoryArena(const StaticMemoryPlan* plan, void* base)
+    : plan_(plan),
+      allocator_(plan->allocator_),
+      base_(static_cast<char*>(base)),
+      arena_size_(plan->arena_size_),
+      slot_in_use_(new std::atomic<bool>[plan->slots_.size()]) {
+  const int num_slots = plan->slots_.size();
+  slot_allocators_.reserve(num_slots);
+  slot_aliases_.reserve(num_slots);
+  slot_offsets_.reserve(num_slots);
+  slot_sizes_.reserve(num_slots);
+  for (int i = 0; i < num_slots; ++i) {
+    const StaticMemoryPlan::Slot& slot = plan->slots_[i];
+    slot_allocators_.emplace_back(new SlotAllocator(this, i));
+    slot_in_use_[i].store(false, std::memory_order_relaxed);
+    slot_aliases_.push_back(slot.aliases);
+    slot_offsets_.push_back(slot.offset);
+    slot_sizes_.push_back(slot.size);
+  }
+  output_allocators_.reserve(plan->output_slot_.size());
+  for (int slot : plan->output_slot_) {
+    output_allocators_.push_back(slot < 0 ? nullptr
+                                          : slot_allocators_[slot].get());
+  }
+}
+
+StaticMemoryArena::~StaticMemoryArena() { allocator_->DeallocateRaw(base_); }
+
+void* StaticMemoryArena::TryAcquireSlot(int slot) {
+  // A slot and its aliases are never acquired concurrently within one step,
+  // because the planner only overlaps slots whose producers are ordered by
+  // the graph. An alias may however still be in use if its tensor outlived
+  // its planned live range, in which case the caller falls back.
+  if (slot_in_use_[slot].load(std::memory_order_acquire)) return nullptr;
+  for (int alias : slot_aliases_[slot]) {
+    if (slot_in_use_[alias].load(std::memory_order_acquire)) return nullptr;
+  }
+  slot_in_use_[slot].store(true, std::memory_order_relaxed);
+  return base_ + slot_offsets_[slot];
+}
+
+void StaticMemoryArena::ReleaseSlot(int slot) {
+  slot_in_use_[slot].store(false, std::memory_order_release);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,146 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class StaticMemoryArena;
+
+// A StaticMemoryPlan assigns node outputs with statically known sizes to
+// fixed offsets ("slots") in a single arena. Two slots may overlap in memory
+// only if their live ranges are ordered by the graph's dependencies; such
+// slots are recorded as aliases of each other.
+//
+// The plan also owns a pool of arenas, so that a step can take a pre-sized
+// arena without calling into the device allocator once the pool is warm.
+class StaticMemoryPlan {
+ public:
+  struct Slot {
+    int node_id;
+    int output;
+    int64 offset;
+    int64 size;
+    // Indices of the slots that overlap with this one in the arena.
+    std::vector<int> aliases;
+  };
+
+  // `slots` must not overlap except where recorded in `Slot::aliases`, and
+  // must fit in `arena_size` bytes. `num_outputs` is indexed by the node ids
+  // of the planned graph and holds the number of outputs of each node.
+  // Arenas are allocated from `allocator`, which must outlive the plan and
+  // all tensors that it serves.
+  StaticMemoryPlan(Allocator* allocator, const std::vector<int>& num_outputs,
+                   int64 arena_size, std::vector<Slot> slots);
+  ~StaticMemoryPlan();
+
+  Allocator* allocator() const { return allocator_; }
+  int64 arena_size() const { return arena_size_; }
+  const std::vector<Slot>& slots() const { return slots_; }
+
+  // Returns the index into `slots()` of output `output` of node `node_id`, or
+  // -1 if that output is not planned.
+  int slot_index(int node_id, int output) const;
+
+  // Returns an arena for the exclusive use of one step, or nullptr if the
+  // arena memory could not be allocated. The caller must pass the arena to
+  // `ReleaseArena()` when the step finishes.
+  StaticMemoryArena* AcquireArena();
+  void ReleaseArena(StaticMemoryArena* arena);
+
+ private:
+  friend class StaticMemoryArena;
+
+  Allocator* const allocator_;  // Not owned.
+  const int64 arena_size_;
+  const std::vector<Slot> slots_;
+  // `output_slot_base_[node_id]` is the index in `output_slot_` of output 0
+  // of `node_id`, or -1 if none of its outputs are planned. A node with a
+  // planned output has one entry per output, so that kernels may look up any
+  // of their outputs.
+  std::vector<int> output_slot_base_;
+  std::vector<int> output_slot_;
+
+  mutex mu_;
+  std::vector<StaticMemoryArena*> free_arenas_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticMemoryPlan);
+};
+
+// The memory for one step of a StaticMemoryPlan. Each planned output is served
+// by a per-slot Allocator that hands out the slot when it and all of its
+// aliases are free, and otherwise falls back to the plan's allocator. This
+// keeps execution correct when a tensor outlives its planned live range, for
+// example because a kernel forwarded its buffer or stored it in a resource.
+//
+// Every live tensor holds a reference on its arena, so the arena memory is
+// released only after the plan and all tensors that it served are gone.
+class StaticMemoryArena : public core::RefCounted {
+ public:
+  // Returns an array, indexed by output number, of the allocators for the
+  // outputs of `node_id`. The array has an entry for every output of the
+  // node, and entries for unplanned outputs are null. Returns nullptr if no
+  // output of `node_id` is planned. Must only be called while the plan is
+  // alive.
+  Allocator* const* output_allocators(int node_id) const {
+    const int base = plan_->output_slot_base_[node_id];
+    return base < 0 ? nullptr : output_allocators_.data() + base;
+  }
+
+ private:
+  friend class StaticMemoryPlan;
+  class SlotAllocator;
+
+  StaticMemoryArena(const StaticMemoryPlan* plan, void* base);
+  ~StaticMemoryArena() override;
+
+  // Marks `slot` as in use and returns its memory, or returns nullptr if
+  // `slot` or any of its aliases is in use.
+  void* TryAcquireSlot(int slot);
+  void ReleaseSlot(int slot);
+
+  bool Contains(const void* ptr) const {
+    return ptr >= base_ && ptr < base_ + arena_size_;
+  }
+
+  // The plan may be deleted while tensors still reference this arena, after
+  // which only the fields copied below may be used.
+  const StaticMemoryPlan* plan_;
+  Allocator* const allocator_;  // Not owned.
+  char* const base_;
+  const int64 arena_size_;
+  std::vector<std::unique_ptr<SlotAllocator>> slot_allocators_;
+  std::vector<Allocator*> output_allocators_;
+  std::unique_ptr<std::atomic<bool>[]> slot_in_use_;
+  std::vector<std::vector<int>> slot_aliases_;
+  std::vector<int64> slot_offsets_;
+  std::vector<int64> slot_sizes_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticMemoryArena);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
@@ -0,0 +1,230 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+// The reachability analysis uses N^2 bits for a graph with N nodes.
+constexpr int kMaxPlannedNodes = 8192;
+
+// A planned output and the nodes whose completion ends its live range.
+struct PlannedTensor {
+  const Node* producer;
+  int output;
+  int64 size;
+  std::vector<const Node*> consumers;
+  int64 offset = -1;
+};
+
+// Returns true if the outputs of `n` are usually allocated by its kernel,
+// rather than forwarded from an input or produced without a new buffer.
+bool AllocatesOutputs(const Node* n) {
+  if (!n->IsOp() || n->IsConstant() || n->IsVariable() || n->IsArg() ||
+      n->IsRecv() || n->IsIdentity() || n->IsControlFlow()) {
+    return false;
+  }
+  const string& op = n->type_string();
+  return op != "Reshape" && op != "ExpandDims" && op != "Squeeze" &&
+         op != "Bitcast" && op != "StopGradient" && op != "PreventGradient";
+}
+
+// Returns the shape of output `i` of `n` in `*shape` if it is fully known.
+bool GetStaticOutputShape(const ShapeRefiner& refiner, const Node* n, int i,
+                          TensorShape* shape) {
+  shape_inference::InferenceContext* c = refiner.GetContext(n);
+  if (c != nullptr && i < c->num_outputs() && c->FullyDefined(c->output(i))) {
+    const shape_inference::ShapeHandle h = c->output(i);
+    std::vector<int64> dims(c->Rank(h));
+    for (int d = 0; d < dims.size(); ++d) {
+      dims[d] = c->Value(c->Dim(h, d));
+    }
+    return TensorShapeUtils::MakeShape(dims, shape).ok();
+  }
+  if (n->attrs().Find("_output_shapes") != nullptr) {
+    std::vector<PartialTensorShape> output_shapes;
+    if (GetNodeAttr(n->attrs(), "_output_shapes", &output_shapes).ok() &&
+        i < output_shapes.size()) {
+      return output_shapes[i].AsTensorShape(shape);
+    }
+  }
+  return false;
+}
+
+int64 RoundUpToAlignment(int64 bytes) {
+  const int64 alignment = Allocator::kAllocatorAlignment;
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+Status PlanStaticMemory(const Graph& graph, Allocator* allocator,
+                        std::unique_ptr<StaticMemoryPlan>* plan) {
+  plan->reset();
+  if (graph.num_nodes() > kMaxPlannedNodes) {
+    VLOG(1) << "Not planning static memory for a graph with "
+            << graph.num_nodes() << " nodes.";
+    return Status::OK();
+  }
+  for (const Node* n : graph.op_nodes()) {
+    if (n->IsEnter() || n->IsExit() || n->IsNextIteration()) {
+      // Nodes in loops run more than once per step.
+      VLOG(1) << "Not planning static memory for a graph with loops.";
+      return Status::OK();
+    }
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+
+  ShapeRefiner refiner(graph.versions(), graph.op_registry());
+  refiner.set_require_shape_inference_fns(false);
+  std::vector<PlannedTensor> tensors;
+  for (const Node* n : order) {
+    if (!n->IsOp()) continue;
+    const Status s = refiner.AddNode(n);
+    if (!s.ok()) {
+      // The outputs of `n` (and everything downstream that depends on them)
+      // use the dynamic allocation path.
+      VLOG(2) << "Shape inference failed for " << n->name() << ": " << s;
+      continue;
+    }
+    if (!AllocatesOutputs(n)) continue;
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      const DataType dtype = n->output_type(i);
+      if (IsRefType(dtype) || !DataTypeCanUseMemcpy(dtype)) continue;
+      TensorShape shape;
+      if (!GetStaticOutputShape(refiner, n, i, &shape)) continue;
+      const int64 size = shape.num_elements() * DataTypeSize(dtype);
+      if (size <= 0) continue;
+
+      PlannedTensor t{n, i, RoundUpToAlignment(size), {}};
+      bool escapes = false;
+      for (const Edge* e : n->out_edges()) {
+        if (e->IsControlEdge() || e->src_output() != i) continue;
+        if (e->dst()->IsRetval() || e->dst()->IsSend()) escapes = true;
+        t.consumers.push_back(e->dst());
+      }
+      // Outputs without consumers are released after the producer's
+      // successors have been scheduled, so their live range is not ordered
+      // by the graph.
+      if (escapes || t.consumers.empty()) continue;
+      tensors.push_back(std::move(t));
+    }
+  }
+  if (tensors.empty()) return Status::OK();
+
+  // ancestors[pos(n)] has the bit pos(m) set iff m is a proper ancestor of n,
+  // where pos() is the position in `order`.
+  const int num_nodes = order.size();
+  const int words = (num_nodes + 63) / 64;
+  std::vector<int> pos(graph.num_node_ids(), -1);
+  for (int i = 0; i < num_nodes; ++i) pos[order[i]->id()] = i;
+  std::vector<uint64> ancestors(static_cast<size_t>(num_nodes) * words, 0);
+  for (int i = 0; i < num_nodes; ++i) {
+    uint64* dst = &ancestors[static_cast<size_t>(i) * words];
+    for (const Edge* e : order[i]->in_edges()) {
+      const int src = pos[e->src()->id()];
+      const uint64* src_bits = &ancestors[static_cast<size_t>(src) * words];
+      for (int w = 0; w < words; ++w) dst[w] |= src_bits[w];
+      dst[src / 64] |= uint64{1} << (src % 64);
+    }
+  }
+  auto is_ancestor = [&](const Node* a, const Node* b) {
+    const int pa = pos[a->id()];
+    return (ancestors[static_cast<size_t>(pos[b->id()]) * words + pa / 64] >>
+            (pa % 64)) &
+           1;
+  };
+  // Returns true if `a` is dead before `b` is allocated.
+  auto dies_before = [&](const PlannedTensor& a, const PlannedTensor& b) {
+    for (const Node* consumer : a.consumers) {
+      if (!is_ancestor(consumer, b.producer)) return false;
+    }
+    return true;
+  };
+
+  // Greedy-by-size placement: each tensor takes the lowest offset that does
+  // not overlap any already placed tensor whose live range it may share.
+  std::vector<int> by_size(tensors.size());
+  for (int i = 0; i < by_size.size(); ++i) by_size[i] = i;
+  std::stable_sort(by_size.begin(), by_size.end(), [&](int a, int b) {
+    return tensors[a].size > tensors[b].size;
+  });
+  int64 arena_size = 0;
+  std::vector<int> placed;
+  std::vector<std::pair<int64, int64>> conflicts;
+  for (int t : by_size) {
+    PlannedTensor& tensor = tensors[t];
+    conflicts.clear();
+    for (int p : placed) {
+      const PlannedTensor& other = tensors[p];
+      if (!dies_before(tensor, other) && !dies_before(other, tensor)) {
+        conflicts.emplace_back(other.offset, other.offset + other.size);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end());
+    int64 offset = 0;
+    for (const auto& interval : conflicts) {
+      if (interval.first >= offset + tensor.size) break;
+      offset = std::max(offset, interval.second);
+    }
+    tensor.offset = offset;
+    arena_size = std::max(arena_size, offset + tensor.size);
+    placed.push_back(t);
+  }
+
+  std::vector<StaticMemoryPlan::Slot> slots;
+  slots.reserve(tensors.size());
+  int64 total_size = 0;
+  for (const PlannedTensor& t : tensors) {
+    slots.push_back({t.producer->id(), t.output, t.offset, t.size, {}});
+    total_size += t.size;
+  }
+  for (int a = 0; a < slots.size(); ++a) {
+    for (int b = a + 1; b < slots.size(); ++b) {
+      if (slots[a].offset < slots[b].offset + slots[b].size &&
+          slots[b].offset < slots[a].offset + slots[a].size) {
+        slots[a].aliases.push_back(b);
+        slots[b].aliases.push_back(a);
+      }
+    }
+  }
+  VLOG(1) << "Planned " << slots.size() << " outputs totalling " << total_size
+          << " bytes into a static memory arena of " << arena_size
+          << " bytes.";
+  std::vector<int> num_outputs(graph.num_node_ids(), 0);
+  for (const Node* n : graph.nodes()) {
+    num_outputs[n->id()] = n->num_outputs();
+  }
+  *plan = absl::make_unique<StaticMemoryPlan>(allocator, num_outputs,
+                                              arena_size, std::move(slots));
+  return Status::OK();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,43 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+
+#include <memory>
+
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+// Computes a StaticMemoryPlan for the outputs of `graph` whose shapes are
+// fully known after shape inference (or from an `_output_shapes` attr), and
+// whose buffers do not leave the step through a `_Retval` or `_Send`.
+//
+// Planned outputs are packed greedily by decreasing size. Two outputs may
+// share memory only if every consumer of one is an ancestor of the producer
+// of the other, so that the first is dead before the second is allocated.
+//
+// Leaves `*plan` null if `graph` contains loops, has too many nodes for the
+// reachability analysis, or has no plannable outputs. Arenas for the plan are
+// allocated from `allocator`.
+Status PlanStaticMemory(const Graph& graph, Allocator* allocator,
+                        std::unique_ptr<StaticMemoryPlan>* plan);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
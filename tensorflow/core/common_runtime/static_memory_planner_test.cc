@@ -0,0 +1,175 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Builds Identity(MatMul(MatMul(MatMul(a, a)))) on 2x2 float matrices, so
+// that each MatMul output is 16 bytes and has one consumer.
+class StaticMemoryPlannerTest : public ::testing::Test {
+ protected:
+  StaticMemoryPlannerTest() : graph_(OpRegistry::Global()) {
+    Tensor a_tensor = test::AsTensor<float>({1, 2, 3, 4}, {2, 2});
+    Node* a = test::graph::Constant(&graph_, a_tensor);
+    m1_ = test::graph::Matmul(&graph_, a, a, false, false);
+    m2_ = test::graph::Matmul(&graph_, m1_, m1_, false, false);
+    m3_ = test::graph::Matmul(&graph_, m2_, m2_, false, false);
+    test::graph::Identity(&graph_, m3_);
+  }
+
+  const StaticMemoryPlan::Slot& SlotFor(const StaticMemoryPlan& plan,
+                                        const Node* n) {
+    const int index = plan.slot_index(n->id(), 0);
+    CHECK_GE(index, 0) << n->name();
+    return plan.slots()[index];
+  }
+
+  Graph graph_;
+  Node* m1_;
+  Node* m2_;
+  Node* m3_;
+};
+
+TEST_F(StaticMemoryPlannerTest, ReusesMemoryOfDeadTensors) {
+  std::unique_ptr<StaticMemoryPlan> plan;
+  TF_ASSERT_OK(PlanStaticMemory(graph_, cpu_allocator(), &plan));
+  ASSERT_NE(plan, nullptr);
+  EXPECT_EQ(3, plan->slots().size());
+
+  // m1 is dead once m2 has run, so m3 can take its place, but m2 overlaps
+  // with both of them.
+  const auto& s1 = SlotFor(*plan, m1_);
+  const auto& s2 = SlotFor(*plan, m2_);
+  const auto& s3 = SlotFor(*plan, m3_);
+  EXPECT_EQ(s1.offset, s3.offset);
+  EXPECT_NE(s1.offset, s2.offset);
+  EXPECT_EQ(2 * Allocator::kAllocatorAlignment, plan->arena_size());
+  EXPECT_EQ(1, s1.aliases.size());
+  EXPECT_TRUE(s2.aliases.empty());
+}
+
+TEST_F(StaticMemoryPlannerTest, FallsBackWhileAliasIsLive) {
+  std::unique_ptr<StaticMemoryPlan> plan;
+  TF_ASSERT_OK(PlanStaticMemory(graph_, cpu_allocator(), &plan));
+  ASSERT_NE(plan, nullptr);
+  StaticMemoryArena* arena = plan->AcquireArena();
+  ASSERT_NE(arena, nullptr);
+  Allocator* a1 = arena->output_allocators(m1_->id())[0];
+  Allocator* a3 = arena->output_allocators(m3_->id())[0];
+  ASSERT_NE(a1, nullptr);
+  ASSERT_NE(a3, nullptr);
+
+  {
+    Tensor t1(a1, DT_FLOAT, TensorShape({2, 2}));
+    {
+      // m1 is still live (e.g. because a kernel kept a reference to it), so
+      // m3 must not reuse its memory.
+      Tensor t3(a3, DT_FLOAT, TensorShape({2, 2}));
+      EXPECT_NE(t1.tensor_data().data(), t3.tensor_data().data());
+    }
+    // A larger tensor than planned is allocated dynamically.
+    Tensor big(a1, DT_FLOAT, TensorShape({4, 4}));
+    EXPECT_TRUE(big.IsInitialized());
+  }
+  const char* planned;
+  {
+    Tensor t1(a1, DT_FLOAT, TensorShape({2, 2}));
+    planned = t1.tensor_data().data();
+  }
+  {
+    Tensor t3(a3, DT_FLOAT, TensorShape({2, 2}));
+    EXPECT_EQ(planned, t3.tensor_data().data());
+  }
+  plan->ReleaseArena(arena);
+
+  // The pool hands the same arena to the next step.
+  EXPECT_EQ(arena, plan->AcquireArena());
+  plan->ReleaseArena(arena);
+}
+
+TEST_F(StaticMemoryPlannerTest, ArenaOutlivesPlan) {
+  std::unique_ptr<StaticMemoryPlan> plan;
+  TF_ASSERT_OK(PlanStaticMemory(graph_, cpu_allocator(), &plan));
+  ASSERT_NE(plan, nullptr);
+  StaticMemoryArena* arena = plan->AcquireArena();
+  ASSERT_NE(arena, nullptr);
+  Tensor t1(arena->output_allocators(m1_->id())[0], DT_FLOAT,
+            TensorShape({2, 2}));
+  t1.flat<float>().setConstant(1.0f);
+  plan->ReleaseArena(arena);
+  plan.reset();
+  // `t1` keeps the arena memory alive.
+  test::ExpectTensorEqual<float>(
+      t1, test::AsTensor<float>({1, 1, 1, 1}, TensorShape({2, 2})));
+}
+
+// Unpack only has its first output consumed, so only that output is planned,
+// but a kernel may still look up the allocator of any of its outputs.
+TEST(StaticMemoryPlannerMultiOutputTest, CoversUnplannedTrailingOutputs) {
+  Graph graph(OpRegistry::Global());
+  Tensor a_tensor = test::AsTensor<float>({1, 2, 3, 4}, {2, 2});
+  Node* a = test::graph::Constant(&graph, a_tensor);
+  Node* unpack;
+  TF_ASSERT_OK(NodeBuilder("unpack", "Unpack")
+                   .Input(a)
+                   .Attr("num", 2)
+                   .Attr("axis", 0)
+                   .Finalize(&graph, &unpack));
+  Node* neg = test::graph::Unary(&graph, "Neg", unpack, 0);
+  test::graph::Identity(&graph, neg);
+  // Planned after `unpack` so that its allocators follow those of `unpack`.
+  Node* m1 = test::graph::Matmul(&graph, a, a, false, false);
+  Node* m2 = test::graph::Matmul(&graph, m1, m1, false, false);
+  test::graph::Identity(&graph, m2);
+
+  std::unique_ptr<StaticMemoryPlan> plan;
+  TF_ASSERT_OK(PlanStaticMemory(graph, cpu_allocator(), &plan));
+  ASSERT_NE(plan, nullptr);
+  EXPECT_GE(plan->slot_index(unpack->id(), 0), 0);
+  EXPECT_EQ(-1, plan->slot_index(unpack->id(), 1));
+  StaticMemoryArena* arena = plan->AcquireArena();
+  ASSERT_NE(arena, nullptr);
+  Allocator* const* allocators = arena->output_allocators(unpack->id());
+  ASSERT_NE(allocators, nullptr);
+  EXPECT_NE(nullptr, allocators[0]);
+  EXPECT_EQ(nullptr, allocators[1]);
+  EXPECT_NE(nullptr, arena->output_allocators(m1->id())[0]);
+  plan->ReleaseArena(arena);
+}
+
+TEST(StaticMemoryPlannerUnknownShapeTest, DoesNotPlanUnknownShapes) {
+  Graph graph(OpRegistry::Global());
+  Node* arg = test::graph::Arg(&graph, 0, DT_FLOAT);
+  Node* m1 = test::graph::Matmul(&graph, arg, arg, false, false);
+  Node* m2 = test::graph::Matmul(&graph, m1, m1, false, false);
+  test::graph::Retval(&graph, 0, m2);
+  std::unique_ptr<StaticMemoryPlan> plan;
+  TF_ASSERT_OK(PlanStaticMemory(graph, cpu_allocator(), &plan));
+  EXPECT_EQ(plan, nullptr);
+}
+
+}  // namespace
+}  // namespace tensorflow
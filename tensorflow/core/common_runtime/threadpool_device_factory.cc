@@ -38,15 +38,29 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<std::unique_ptr<Device>>* devices) override {
     int num_numa_nodes = port::NUMANumNodes();
-    int n = 1;
+    const bool use_numa_affinity =
+        options.config.experimental().use_numa_affinity();
+    // In NUMA mode, default to one CPU device per NUMA node. Each device is
+    // backed by a node-local allocator, and LocalDevice gives it an intra-op
+    // threadpool pinned to the same node.
+    int n = use_numa_affinity ? num_numa_nodes : 1;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
       n = iter->second;
     }
+    // NUMA-local allocators must be enabled before the first CPU allocator is
+    // handed out. If another user of the process got there first, the devices
+    // keep their NUMA locality but share the process-wide allocator.
+    if (use_numa_affinity && port::NUMAEnabled() &&
+        !ProcessState::singleton()->EnableNUMA()) {
+      LOG(WARNING) << "CPU allocators were created before NUMA affinity was "
+                   << "requested, so CPU devices will not use NUMA-local "
+                   << "allocators.";
+    }
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/device:CPU:", i);
       std::unique_ptr<ThreadPoolDevice> tpd;
-      if (options.config.experimental().use_numa_affinity()) {
+      if (use_numa_affinity) {
         int numa_node = i % num_numa_nodes;
         if (numa_node != i) {
           LOG(INFO) << "Only " << num_numa_nodes
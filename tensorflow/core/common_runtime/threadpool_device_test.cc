@@ -15,7 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/process_state.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -68,5 +71,38 @@ TEST(ThreadPoolDeviceTest, CopyTensor) {
   device_context->Unref();
 }
 
+TEST(ThreadPoolDeviceFactoryTest, NumaAffinity) {
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_numa_affinity(true);
+  // More devices than nodes, so that devices share nodes on any machine.
+  const int num_numa_nodes = port::NUMANumNodes();
+  (*options.config.mutable_device_count())["CPU"] = num_numa_nodes + 1;
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::GetFactory(DEVICE_CPU)->CreateDevices(
+      options, "/job:localhost/replica:0/task:0", &devices));
+  ASSERT_EQ(devices.size(), num_numa_nodes + 1);
+
+  ProcessState* process_state = ProcessState::singleton();
+  for (int i = 0; i < devices.size(); ++i) {
+    const int numa_node = i % num_numa_nodes;
+    EXPECT_EQ(devices[i]->attributes().locality().numa_node(), numa_node);
+    Allocator* allocator = devices[i]->GetAllocator(AllocatorAttributes());
+    EXPECT_EQ(allocator, process_state->GetCPUAllocator(numa_node));
+    if (process_state->numa_enabled()) {
+      // Devices on different nodes use different allocators.
+      EXPECT_EQ(allocator == process_state->GetCPUAllocator(0),
+                numa_node == 0);
+    }
+  }
+
+  // Allocators have been handed out, so the switch no longer changes.
+  const bool numa_enabled = process_state->numa_enabled();
+  EXPECT_EQ(process_state->EnableNUMA(), numa_enabled);
+  EXPECT_EQ(process_state->numa_enabled(), numa_enabled);
+  if (!port::NUMAEnabled()) {
+    EXPECT_FALSE(numa_enabled);
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
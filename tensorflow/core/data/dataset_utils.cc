@@ -37,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/regexp.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
@@ -1141,6 +1142,35 @@ bool ShouldUseAutotuning(const Options& options) {
          options.optimization_options().autotune();
 }
 
+model::AutotuneAlgorithm GetAutotuneAlgorithm(const Options& options) {
+  const OptimizationOptions& optimization_options =
+      options.optimization_options();
+  model::AutotuneAlgorithm algorithm = model::AutotuneAlgorithm::HILL_CLIMB;
+  if (optimization_options.optional_autotune_algorithm_case() ==
+      OptimizationOptions::kAutotuneAlgorithm) {
+    algorithm = optimization_options.autotune_algorithm();
+  } else if (optimization_options.autotune_buffers()) {
+    algorithm = model::AutotuneAlgorithm::GRADIENT_DESCENT;
+  }
+  string name;
+  Status s = ReadStringFromEnvVar("TF_DATA_AUTOTUNE_ALGORITHM", "", &name);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to read TF_DATA_AUTOTUNE_ALGORITHM: " << s;
+    return algorithm;
+  }
+  if (name.empty()) {
+    return algorithm;
+  }
+  model::AutotuneAlgorithm env_algorithm;
+  if (!model::AutotuneAlgorithm_Parse(name, &env_algorithm)) {
+    LOG(WARNING) << "Ignoring unknown autotuning algorithm in "
+                 << "TF_DATA_AUTOTUNE_ALGORITHM: " << name << ". Using "
+                 << model::AutotuneAlgorithm_Name(algorithm) << " instead.";
+    return algorithm;
+  }
+  return env_algorithm;
+}
+
 bool ShouldApplyOptimizations(
     const Options& options,
     const absl::flat_hash_set<tstring>& optimizations_enabled,
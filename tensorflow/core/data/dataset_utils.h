@@ -360,6 +360,12 @@ bool ShouldUsePrivateThreadPool(const Options& options);
 // Determines whether autotuning should be used.
 bool ShouldUseAutotuning(const Options& options);
 
+// Returns the autotuning algorithm to use for `options`. Setting the
+// TF_DATA_AUTOTUNE_ALGORITHM environment variable to the name of an
+// `AutotuneAlgorithm` value overrides the options; unknown names are ignored
+// with a warning.
+model::AutotuneAlgorithm GetAutotuneAlgorithm(const Options& options);
+
 // Determines whether optimizations should be applied.
 bool ShouldApplyOptimizations(
     const Options& options,
@@ -717,6 +717,28 @@ INSTANTIATE_TEST_SUITE_P(
             /*optimizations_disabled=*/{"foo"},
             /*optimizations_default=*/{"baz"}, /*expected=*/{"bar", "baz"}}));
 
+TEST(DatasetUtilsTest, GetAutotuneAlgorithm) {
+  Options options;
+  EXPECT_EQ(GetAutotuneAlgorithm(options),
+            model::AutotuneAlgorithm::HILL_CLIMB);
+  options.mutable_optimization_options()->set_autotune_buffers(true);
+  EXPECT_EQ(GetAutotuneAlgorithm(options),
+            model::AutotuneAlgorithm::GRADIENT_DESCENT);
+  options.mutable_optimization_options()->set_autotune_algorithm(
+      model::AutotuneAlgorithm::ONLINE_COST_MODEL);
+  EXPECT_EQ(GetAutotuneAlgorithm(options),
+            model::AutotuneAlgorithm::ONLINE_COST_MODEL);
+
+  setenv("TF_DATA_AUTOTUNE_ALGORITHM", "HILL_CLIMB", 1);
+  EXPECT_EQ(GetAutotuneAlgorithm(options),
+            model::AutotuneAlgorithm::HILL_CLIMB);
+  // Unknown names fall back to the algorithm from the options.
+  setenv("TF_DATA_AUTOTUNE_ALGORITHM", "UNKNOWN_ALGORITHM", 1);
+  EXPECT_EQ(GetAutotuneAlgorithm(options),
+            model::AutotuneAlgorithm::ONLINE_COST_MODEL);
+  unsetenv("TF_DATA_AUTOTUNE_ALGORITHM");
+}
+
 REGISTER_DATASET_EXPERIMENT("test_only_experiment", 42);
 
 TEST(DatasetUtilsTest, DatasetExperimentRegistry) {
@@ -31,6 +31,7 @@ constexpr char kCpuBudget[] = "cpu_budget";
 constexpr char kRamBudget[] = "ram_budget_bytes";
 constexpr char kHillClimb[] = "hill_climb";
 constexpr char kGradientDescent[] = "gradient_descent";
+constexpr char kOnlineCostModel[] = "online_cost_model";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 
@@ -58,10 +59,7 @@ Status RootDataset::FromOptions(DatasetBase* input, DatasetBase** output) {
   }
   params.autotune = ShouldUseAutotuning(options);
   if (params.autotune) {
-    params.autotune_algorithm = model::AutotuneAlgorithm::HILL_CLIMB;
-    if (options.optimization_options().autotune_buffers()) {
-      params.autotune_algorithm = model::AutotuneAlgorithm::GRADIENT_DESCENT;
-    }
+    params.autotune_algorithm = GetAutotuneAlgorithm(options);
     params.autotune_cpu_budget =
         value_or_default(options.optimization_options().autotune_cpu_budget(),
                          0, port::NumSchedulableCPUs());
@@ -191,11 +189,14 @@ RootDataset::RootDataset(const DatasetBase* input, Params params)
       input_(input),
       params_(std::move(params)) {
   if (params_.autotune) {
-    traceme_metadata_.push_back(std::make_pair(
-        kAlgorithm,
-        params_.autotune_algorithm == model::AutotuneAlgorithm::HILL_CLIMB
-            ? kHillClimb
-            : kGradientDescent));
+    const char* algorithm = kGradientDescent;
+    if (params_.autotune_algorithm == model::AutotuneAlgorithm::HILL_CLIMB) {
+      algorithm = kHillClimb;
+    } else if (params_.autotune_algorithm ==
+               model::AutotuneAlgorithm::ONLINE_COST_MODEL) {
+      algorithm = kOnlineCostModel;
+    }
+    traceme_metadata_.push_back(std::make_pair(kAlgorithm, algorithm));
     traceme_metadata_.push_back(std::make_pair(
         kCpuBudget, strings::Printf("%lld", static_cast<long long>(
                                                 params_.autotune_cpu_budget))));
@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/data_service.h"
 
+#include <deque>
+
 #include "grpcpp/create_channel.h"
 #include "grpcpp/security/credentials.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/types/optional.h"
 #include "tensorflow/core/data/service/credentials_factory.h"
 #include "tensorflow/core/data/service/data_transfer.h"
@@ -33,7 +36,9 @@ namespace data {
 namespace {
 constexpr const char kParallelEpochs[] = "parallel_epochs";
 constexpr const char kDistributedEpoch[] = "distributed_epoch";
-
+constexpr const char kCodecNone[] = "none";
+constexpr const char kCodecSnappy[] = "snappy";
+constexpr const char kCodecZlib[] = "zlib";
 }  // namespace
 
 Status ParseProcessingMode(const std::string& s, ProcessingMode& mode) {
@@ -47,6 +52,22 @@ Status ParseProcessingMode(const std::string& s, ProcessingMode& mode) {
   return Status::OK();
 }
 
+Status ParseCompressionCodec(const std::string& s,
+                             CompressionCodecDef& codec) {
+  if (s.empty() || s == kCodecNone) {
+    codec = CODEC_NONE;
+  } else if (s == kCodecSnappy) {
+    codec = CODEC_SNAPPY;
+  } else if (s == kCodecZlib) {
+    codec = CODEC_ZLIB;
+  } else {
+    return errors::InvalidArgument("Unrecognized compression codec: ", s,
+                                   ". Supported codecs are none, snappy, and "
+                                   "zlib.");
+  }
+  return Status::OK();
+}
+
 std::string ProcessingModeToString(ProcessingMode mode) {
   switch (mode) {
     case ProcessingMode::PARALLEL_EPOCHS:
@@ -61,7 +82,8 @@ std::string ProcessingModeToString(ProcessingMode mode) {
 
 Status DataServiceDispatcherClient::WorkerHeartbeat(
     const std::string& worker_address, const std::string& transfer_address,
-    const std::vector<int64>& current_tasks, std::vector<TaskDef>& new_tasks,
+    const std::vector<int64>& current_tasks,
+    const absl::optional<WorkerLoad>& load, std::vector<TaskDef>& new_tasks,
     std::vector<int64>& tasks_to_delete) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
   WorkerHeartbeatRequest req;
@@ -70,6 +92,9 @@ Status DataServiceDispatcherClient::WorkerHeartbeat(
   for (int64 task : current_tasks) {
     req.add_current_tasks(task);
   }
+  if (load.has_value()) {
+    *req.mutable_load() = load.value();
+  }
   WorkerHeartbeatResponse resp;
   grpc::ClientContext client_ctx;
   grpc::Status status = stub_->WorkerHeartbeat(&client_ctx, req, &resp);
@@ -158,7 +183,7 @@ Status DataServiceDispatcherClient::RegisterDataset(const GraphDef& dataset,
 Status DataServiceDispatcherClient::GetOrCreateJob(
     int64 dataset_id, ProcessingMode processing_mode,
     const absl::optional<JobKey>& job_key, absl::optional<int64> num_consumers,
-    int64& job_client_id) {
+    const ElementBatchingDef& element_batching, int64& job_client_id) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
   GetOrCreateJobRequest req;
   req.set_dataset_id(dataset_id);
@@ -169,6 +194,7 @@ Status DataServiceDispatcherClient::GetOrCreateJob(
   if (num_consumers.has_value()) {
     req.set_num_consumers(num_consumers.value());
   }
+  *req.mutable_element_batching() = element_batching;
   GetOrCreateJobResponse resp;
   grpc::ClientContext client_ctx;
   grpc::Status status = stub_->GetOrCreateJob(&client_ctx, req, &resp);
@@ -289,67 +315,124 @@ Status DataServiceDispatcherClient::EnsureInitialized() {
 class GrpcDataTransferClient : public DataTransferClient {
  public:
   GrpcDataTransferClient(std::shared_ptr<grpc::ChannelCredentials> credentials,
-                         std::string address) {
+                         const Config& config)
+      : max_elements_per_request_(config.element_batching.max_elements()) {
     grpc::ChannelArguments args;
     args.SetMaxReceiveMessageSize(-1);
-    auto channel = grpc::CreateCustomChannel(address, credentials, args);
+    auto channel = grpc::CreateCustomChannel(config.address, credentials, args);
     stub_ = WorkerService::NewStub(channel);
   }
 
   Status GetElement(const GetElementRequest& req,
                     GetElementResult& result) override {
+    if (max_elements_per_request_ > 1 &&
+        req.optional_consumer_index_case() ==
+            GetElementRequest::OPTIONAL_CONSUMER_INDEX_NOT_SET) {
+      return GetBufferedElement(req, result);
+    }
+    GetElementResponse resp;
+    TF_RETURN_IF_ERROR(Call(
+        [&](grpc::ClientContext* ctx) {
+          return stub_->GetElement(ctx, req, &resp);
+        },
+        "Failed to get element"));
+    return MoveResponseToResult(resp, result);
+  }
+
+  void TryCancel() override {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    for (const auto& ctx : active_contexts_) {
+      ctx->TryCancel();
+    }
+  }
+
+ private:
+  // Elements fetched for a task but not yet returned by `GetElement`.
+  struct BufferedElements {
+    std::deque<GetElementResponse> elements;
+    // The error the worker reported after the buffered elements.
+    Status status;
+  };
+
+  // Makes an RPC with `call`, tracking its context for cancellation.
+  Status Call(const std::function<grpc::Status(grpc::ClientContext*)>& call,
+              const std::string& description) {
+    grpc::ClientContext ctx;
     {
       mutex_lock l(mu_);
       if (cancelled_) {
         return errors::Cancelled("Client was cancelled.");
       }
-    }
-    grpc::ClientContext ctx;
-    {
-      mutex_lock l(mu_);
       active_contexts_.insert(&ctx);
     }
-    GetElementResponse resp;
-    grpc::Status s = stub_->GetElement(&ctx, req, &resp);
-    result.end_of_sequence = resp.end_of_sequence();
-    result.skip = resp.skip_task();
-    switch (resp.element_case()) {
-      case GetElementResponse::kCompressed: {
-        Tensor tensor(DT_VARIANT, TensorShape{});
-        tensor.scalar<Variant>()() = std::move(resp.compressed());
-        result.components.push_back(tensor);
-        break;
-      }
-      case GetElementResponse::kUncompressed:
-        for (const auto& component : resp.uncompressed().components()) {
-          result.components.emplace_back();
-          if (!result.components.back().FromProto(component)) {
-            return errors::Internal("Failed to parse tensor.");
-          }
-        }
-        break;
-      case GetElementResponse::ELEMENT_NOT_SET:
-        break;
-    }
+    grpc::Status s = call(&ctx);
     {
       mutex_lock l(mu_);
       active_contexts_.erase(&ctx);
     }
     if (!s.ok()) {
-      return grpc_util::WrapError("Failed to get element", s);
+      return grpc_util::WrapError(description, s);
     }
     return Status::OK();
   }
 
-  void TryCancel() override {
+  // Serves `req` from the elements buffered for its task, fetching a new
+  // batch from the worker when there are none.
+  Status GetBufferedElement(const GetElementRequest& req,
+                            GetElementResult& result) {
+    {
+      mutex_lock l(mu_);
+      if (buffers_.contains(req.task_id())) {
+        return PopBufferedElement(req.task_id(), result);
+      }
+    }
+    GetElementsRequest batch_req;
+    *batch_req.mutable_request() = req;
+    GetElementsResponse batch_resp;
+    TF_RETURN_IF_ERROR(Call(
+        [&](grpc::ClientContext* ctx) {
+          return stub_->GetElements(ctx, batch_req, &batch_resp);
+        },
+        "Failed to get elements"));
+    TF_RETURN_IF_ERROR(UncompressElementBatch(batch_resp));
+    if (batch_resp.elements_size() == 0) {
+      return errors::Internal("Worker returned an empty batch of elements.");
+    }
     mutex_lock l(mu_);
-    cancelled_ = true;
-    for (const auto& ctx : active_contexts_) {
-      ctx->TryCancel();
+    BufferedElements& buffer = buffers_[req.task_id()];
+    for (auto& element : *batch_resp.mutable_elements()) {
+      buffer.elements.emplace_back();
+      buffer.elements.back().Swap(&element);
+    }
+    if (batch_resp.error_code() != error::OK) {
+      buffer.status = Status(static_cast<error::Code>(batch_resp.error_code()),
+                             batch_resp.error_message());
     }
+    return PopBufferedElement(req.task_id(), result);
   }
 
- private:
+  // Moves the next buffered element of task `task_id` into `result`, or
+  // returns the error the worker reported after the buffered elements. A
+  // buffer is erased once it has been consumed.
+  Status PopBufferedElement(int64 task_id, GetElementResult& result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    auto it = buffers_.find(task_id);
+    BufferedElements& buffer = it->second;
+    if (buffer.elements.empty()) {
+      Status s = buffer.status;
+      buffers_.erase(it);
+      return s;
+    }
+    Status s = MoveResponseToResult(buffer.elements.front(), result);
+    buffer.elements.pop_front();
+    if (buffer.elements.empty() && buffer.status.ok()) {
+      buffers_.erase(it);
+    }
+    return s;
+  }
+
+  const int64 max_elements_per_request_;
   mutex mu_;
   std::unique_ptr<WorkerService::Stub> stub_;
   // Set of all currently active clients contexts. Used to support
@@ -359,6 +442,9 @@ class GrpcDataTransferClient : public DataTransferClient {
   // Indicates that the client has been cancelled, so no further requests should
   // be accepted.
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  // Elements fetched in batches, keyed by task id. A buffer only exists while
+  // it holds elements or an error.
+  absl::flat_hash_map<int64, BufferedElements> buffers_ TF_GUARDED_BY(mu_);
 };
 
 class GrpcTransferClientRegistrar {
@@ -371,7 +457,7 @@ class GrpcTransferClientRegistrar {
           TF_RETURN_IF_ERROR(CredentialsFactory::CreateClientCredentials(
               config.protocol, &credentials));
           *out = std::make_unique<GrpcDataTransferClient>(credentials,
-                                                          config.address);
+                                                          config);
           return Status::OK();
         });
   }
@@ -389,8 +475,10 @@ Status DataServiceWorkerClient::EnsureInitialized() {
   if (client_) {
     return Status::OK();
   }
-  TF_RETURN_IF_ERROR(DataTransferClient::Build(
-      transfer_protocol_, {protocol_, address_}, &client_));
+  DataTransferClient::Config config{protocol_, address_, worker_address_,
+                                    element_batching_};
+  TF_RETURN_IF_ERROR(
+      DataTransferClient::Build(transfer_protocol_, config, &client_));
   return Status::OK();
 }
 
@@ -408,10 +496,11 @@ Status CreateDataServiceDispatcherClient(
 
 Status CreateDataServiceWorkerClient(
     const std::string& address, const std::string& protocol,
-    const std::string& transfer_protocol,
+    const std::string& transfer_protocol, const std::string& worker_address,
+    const ElementBatchingDef& element_batching,
     std::unique_ptr<DataServiceWorkerClient>& out) {
-  auto client = absl::make_unique<DataServiceWorkerClient>(address, protocol,
-                                                           transfer_protocol);
+  auto client = absl::make_unique<DataServiceWorkerClient>(
+      address, protocol, transfer_protocol, worker_address, element_batching);
   TF_RETURN_IF_ERROR(client->Initialize());
   out = std::move(client);
   return Status::OK();
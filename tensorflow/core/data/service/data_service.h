@@ -46,6 +46,11 @@ enum class ProcessingMode : int64 {
 // `mode`. Returns an InvalidArgument status if the string is not recognized.
 Status ParseProcessingMode(const std::string& s, ProcessingMode& mode);
 
+// Parses the name of a compression codec for batches of elements ("none",
+// "snappy", or "zlib"; empty means "none") and stores the result in `codec`.
+// Returns an InvalidArgument status if the name is not recognized.
+Status ParseCompressionCodec(const std::string& s, CompressionCodecDef& codec);
+
 // Converts a processing mode to its corresponding string.
 std::string ProcessingModeToString(ProcessingMode mode);
 
@@ -86,10 +91,12 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
   // registered with the dispatcher, this will register the worker. The
   // dispatcher will report which new tasks the worker should run, and which
   // tasks it should delete. This is stored into `new_tasks` and
-  // `tasks_to_delete`.
+  // `tasks_to_delete`. `load`, if set, reports the load of the worker since
+  // its previous heartbeat.
   Status WorkerHeartbeat(const std::string& worker_address,
                          const std::string& transfer_address,
                          const std::vector<int64>& current_tasks,
+                         const absl::optional<WorkerLoad>& load,
                          std::vector<TaskDef>& new_tasks,
                          std::vector<int64>& tasks_to_delete);
 
@@ -110,11 +117,13 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
   Status RegisterDataset(const GraphDef& dataset, int64& dataset_id);
 
   // If `job_key` is set, looks up a job matching `job_key`. If `job_key` is
-  // absent or no matching job is found, creates a new job. The resulting job
-  // id is stored in `job_client_id`.
+  // absent or no matching job is found, creates a new job, which batches its
+  // elements according to `element_batching`. The resulting job id is stored
+  // in `job_client_id`.
   Status GetOrCreateJob(int64 dataset_id, ProcessingMode processing_mode,
                         const absl::optional<JobKey>& job_key,
                         absl::optional<int64> num_consumers,
+                        const ElementBatchingDef& element_batching,
                         int64& job_client_id);
 
   // Releases a job client id, indicating that the id will no longer be used to
@@ -146,13 +155,27 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
 };
 
 // Client for communicating with the tf.data service worker.
+//
+// Elements of non-round-robin reads are fetched in batches when the job's
+// `ElementBatchingDef` allows more than one element per batch, to amortize
+// the cost of a round trip over several small elements. Batched elements are
+// buffered in the client until `GetElement` returns them, outside of the
+// iterator's `max_outstanding_requests` budget.
 class DataServiceWorkerClient : public DataServiceClientBase {
  public:
+  // `address` is the data transfer address of the worker, and
+  // `worker_address` its gRPC address, which transfer protocols may fall back
+  // to. `element_batching` is the batching of the job being read, as reported
+  // in its `TaskInfo`s.
   DataServiceWorkerClient(const std::string& address,
                           const std::string& protocol,
-                          const std::string& transfer_protocol)
+                          const std::string& transfer_protocol,
+                          const std::string& worker_address,
+                          const ElementBatchingDef& element_batching)
       : DataServiceClientBase(address, protocol),
-        transfer_protocol_(transfer_protocol) {}
+        transfer_protocol_(transfer_protocol),
+        worker_address_(worker_address),
+        element_batching_(element_batching) {}
 
   // Fetches an element from the worker.
   Status GetElement(const GetElementRequest& req, GetElementResult& result);
@@ -166,6 +189,8 @@ class DataServiceWorkerClient : public DataServiceClientBase {
 
  private:
   const std::string transfer_protocol_;
+  const std::string worker_address_;
+  const ElementBatchingDef element_batching_;
   mutex mu_;
   // Initialization is guarded by `mu_`, but using the stub does not require
   // holding `mu_`
@@ -180,7 +205,8 @@ Status CreateDataServiceDispatcherClient(
 // Creates and initializes a new tf.data service worker client.
 Status CreateDataServiceWorkerClient(
     const std::string& address, const std::string& protocol,
-    const std::string& transfer_protocol,
+    const std::string& transfer_protocol, const std::string& worker_address,
+    const ElementBatchingDef& element_batching,
     std::unique_ptr<DataServiceWorkerClient>& out);
 
 }  // namespace data
@@ -15,30 +15,289 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/data_service.h"
 
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+
 #include "grpcpp/create_channel.h"
 #include "grpcpp/security/credentials.h"
+#include "grpcpp/server.h"
+#include "grpcpp/server_builder.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/service/credentials_factory.h"
+#include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/dispatcher.grpc.pb.h"
 #include "tensorflow/core/data/service/dispatcher.pb.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/server_lib.h"
+#include "tensorflow/core/data/service/shared_memory_transfer.h"
 #include "tensorflow/core/data/service/test_cluster.h"
 #include "tensorflow/core/data/service/test_util.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace data {
 
 namespace {
 constexpr const char kProtocol[] = "grpc+local";
+
+// Returns a `GetElementT` which produces `num_elements` elements, each a
+// uint8 tensor of `element_size` bytes, and then reports end of sequence. The
+// elements are not compressed, so that the benchmarks measure the transfer
+// alone.
+DataTransferServer::GetElementT SyntheticGetElement(int64 element_size,
+                                                    int64 num_elements) {
+  Tensor element(DT_UINT8, TensorShape({element_size}));
+  element.flat<uint8>().setConstant(7);
+  auto produced = std::make_shared<std::atomic<int64>>(0);
+  return [element, num_elements, produced](const GetElementRequest* req,
+                                           GetElementResult* result) {
+    result->end_of_sequence = (*produced)++ >= num_elements;
+    result->skip = false;
+    result->element_index = 0;
+    if (!result->end_of_sequence) {
+      result->components = {element};
+    }
+    return Status::OK();
+  };
 }
 
+// Serves `get_element` over the gRPC WorkerService, the way workers serve
+// clients using the "grpc" transfer protocol. `GetElements` requests are
+// batched according to `element_batching`.
+class GrpcTransferServer : public WorkerService::Service {
+ public:
+  explicit GrpcTransferServer(
+      DataTransferServer::GetElementT get_element,
+      const ElementBatchingDef& element_batching = ElementBatchingDef())
+      : get_element_(std::move(get_element)),
+        element_batching_(element_batching) {}
+
+  Status Start() {
+    std::shared_ptr<::grpc::ServerCredentials> credentials;
+    TF_RETURN_IF_ERROR(
+        CredentialsFactory::CreateServerCredentials(kProtocol, &credentials));
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", credentials, &port_);
+    builder.SetMaxSendMessageSize(-1);
+    builder.RegisterService(this);
+    server_ = builder.BuildAndStart();
+    if (!server_) {
+      return errors::Unavailable("Failed to start the gRPC test server.");
+    }
+    return Status::OK();
+  }
+
+  std::string Address() const { return absl::StrCat("localhost:", port_); }
+
+  ::grpc::Status GetElement(::grpc::ServerContext* context,
+                            const GetElementRequest* request,
+                            GetElementResponse* response) override {
+    return ToGrpcStatus(GetElementInternal(*request, *response));
+  }
+
+  ::grpc::Status GetElements(::grpc::ServerContext* context,
+                             const GetElementsRequest* request,
+                             GetElementsResponse* response) override {
+    return ToGrpcStatus(GetElementBatch(
+        element_batching_, request->request(),
+        [this, request](GetElementResponse& element) {
+          return GetElementInternal(request->request(), element);
+        },
+        *response));
+  }
+
+ private:
+  Status GetElementInternal(const GetElementRequest& request,
+                            GetElementResponse& response) {
+    GetElementResult result;
+    TF_RETURN_IF_ERROR(get_element_(&request, &result));
+    response.set_end_of_sequence(result.end_of_sequence);
+    response.set_skip_task(result.skip);
+    if (!result.end_of_sequence && !result.skip) {
+      TF_RETURN_IF_ERROR(
+          MoveElementToResponse(std::move(result.components), response));
+    }
+    return Status::OK();
+  }
+
+  const DataTransferServer::GetElementT get_element_;
+  const ElementBatchingDef element_batching_;
+  int port_ = 0;
+  std::unique_ptr<::grpc::Server> server_;
+};
+
+Status StartSharedMemoryServer(
+    DataTransferServer::GetElementT get_element,
+    std::shared_ptr<DataTransferServer>* server,
+    const DataTransferServer::Config& config = DataTransferServer::Config()) {
+  TF_RETURN_IF_ERROR(DataTransferServer::Build(
+      kSharedMemoryTransferProtocol, std::move(get_element), config, server));
+  return (*server)->Start();
+}
+
+std::string SharedMemoryAddress(DataTransferServer* server) {
+  return absl::StrCat("localhost:", server->get_port());
+}
+
+// Reads from a single-task job of a test cluster.
+class JobReader {
+ public:
+  // Creates a new job reading `dataset_id`, which batches its elements
+  // according to `element_batching`.
+  static Status Create(
+      DataServiceDispatcherClient& dispatcher, int64 dataset_id,
+      std::unique_ptr<JobReader>& out,
+      const ElementBatchingDef& element_batching = ElementBatchingDef()) {
+    int64 job_client_id;
+    TF_RETURN_IF_ERROR(dispatcher.GetOrCreateJob(
+        dataset_id, ProcessingMode::PARALLEL_EPOCHS,
+        /*job_key=*/absl::nullopt, /*num_consumers=*/absl::nullopt,
+        element_batching, job_client_id));
+    ClientHeartbeatResponse resp;
+    do {
+      ClientHeartbeatRequest req;
+      req.set_job_client_id(job_client_id);
+      TF_RETURN_IF_ERROR(dispatcher.ClientHeartbeat(req, resp));
+    } while (resp.task_info().empty());
+    const TaskInfo& task_info = resp.task_info(0);
+    out = absl::WrapUnique(new JobReader(task_info.task_id()));
+    return CreateDataServiceWorkerClient(
+        task_info.transfer_address(), kProtocol, "grpc",
+        task_info.worker_address(), task_info.element_batching(),
+        out->worker_);
+  }
+
+  // Reads the next int64 scalar element of the job.
+  Status Read(int64& value) {
+    GetElementRequest req;
+    req.set_task_id(task_id_);
+    GetElementResult result;
+    Status s;
+    do {
+      // The worker may not have received the task yet.
+      s = worker_->GetElement(req, result);
+    } while (errors::IsUnavailable(s));
+    TF_RETURN_IF_ERROR(s);
+    if (result.end_of_sequence) {
+      return errors::OutOfRange("Unexpected end of sequence.");
+    }
+    value = result.components[0].scalar<int64>()();
+    return Status::OK();
+  }
+
+ private:
+  explicit JobReader(int64 task_id) : task_id_(task_id) {}
+
+  const int64 task_id_;
+  std::unique_ptr<DataServiceWorkerClient> worker_;
+};
+
+// Reports `cpu_utilization` as the load of the worker at `worker_address`.
+Status ReportCpuUtilization(DataServiceDispatcherClient& dispatcher,
+                            const std::string& worker_address,
+                            double cpu_utilization) {
+  WorkerLoad load;
+  load.set_cpu_utilization(cpu_utilization);
+  std::vector<TaskDef> new_tasks;
+  std::vector<int64> tasks_to_delete;
+  return dispatcher.WorkerHeartbeat(worker_address, worker_address,
+                                    /*current_tasks=*/{}, load, new_tasks,
+                                    tasks_to_delete);
+}
+
+// Creates a job and stores the addresses of the workers it runs on in
+// `worker_addresses`, sorted.
+Status CreateJobOnWorkers(DataServiceDispatcherClient& dispatcher,
+                          std::vector<std::string>& worker_addresses) {
+  test_util::GraphDefTestCase test_case;
+  TF_RETURN_IF_ERROR(test_util::map_test_case(&test_case));
+  int64 dataset_id;
+  TF_RETURN_IF_ERROR(
+      dispatcher.RegisterDataset(test_case.graph_def, dataset_id));
+  int64 job_client_id;
+  TF_RETURN_IF_ERROR(dispatcher.GetOrCreateJob(
+      dataset_id, ProcessingMode::PARALLEL_EPOCHS, /*job_key=*/absl::nullopt,
+      /*num_consumers=*/absl::nullopt, ElementBatchingDef(), job_client_id));
+  ClientHeartbeatRequest req;
+  req.set_job_client_id(job_client_id);
+  ClientHeartbeatResponse resp;
+  TF_RETURN_IF_ERROR(dispatcher.ClientHeartbeat(req, resp));
+  worker_addresses.clear();
+  for (const TaskInfo& task_info : resp.task_info()) {
+    worker_addresses.push_back(task_info.worker_address());
+  }
+  std::sort(worker_addresses.begin(), worker_addresses.end());
+  return Status::OK();
+}
+
+// Configs for a test cluster whose dispatcher places jobs on workers below
+// 50% CPU utilization, and whose workers only heartbeat to register, so that
+// tests control the loads known to the dispatcher.
+experimental::DispatcherConfig LoadAwareDispatcherConfig() {
+  experimental::DispatcherConfig config;
+  config.set_max_worker_cpu_utilization(0.5);
+  return config;
+}
+
+experimental::WorkerConfig RegisterOnlyWorkerConfig() {
+  experimental::WorkerConfig config;
+  config.set_heartbeat_interval_ms(3600 * 1000);
+  return config;
+}
+
+// Starts two jobs reading tf.data.Dataset.range(10).repeat() on a single
+// worker whose cross-job caches hold one element. The first job reads three
+// elements, and then the jobs alternate reads. Stores the elements read by
+// each job in `output1` and `output2`.
+void ReadTwoJobs(bool enable_cross_job_cache, std::vector<int64>& output1,
+                 std::vector<int64>& output2) {
+  experimental::DispatcherConfig dispatcher_config;
+  dispatcher_config.set_enable_cross_job_cache(enable_cross_job_cache);
+  experimental::WorkerConfig worker_config;
+  worker_config.set_cross_job_cache_size_bytes(sizeof(int64));
+  TestCluster cluster(/*num_workers=*/1, dispatcher_config, worker_config);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  test_util::GraphDefTestCase test_case;
+  TF_ASSERT_OK(test_util::repeated_range_test_case(&test_case));
+  int64 dataset_id;
+  TF_ASSERT_OK(dispatcher.RegisterDataset(test_case.graph_def, dataset_id));
+
+  std::unique_ptr<JobReader> job1, job2;
+  TF_ASSERT_OK(JobReader::Create(dispatcher, dataset_id, job1));
+  TF_ASSERT_OK(JobReader::Create(dispatcher, dataset_id, job2));
+  int64 value;
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(job1->Read(value));
+    output1.push_back(value);
+  }
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(job2->Read(value));
+    output2.push_back(value);
+    TF_ASSERT_OK(job1->Read(value));
+    output1.push_back(value);
+  }
+}
+}  // namespace
+
 TEST(DataService, ParseParallelEpochsProcessingMode) {
   ProcessingMode mode;
   TF_ASSERT_OK(ParseProcessingMode("parallel_epochs", mode));
@@ -74,5 +333,407 @@ TEST(DataService, GetWorkers) {
   EXPECT_EQ(1, workers.size());
 }
 
+TEST(DataService, CrossJobCache) {
+  std::vector<int64> output1, output2;
+  ReadTwoJobs(/*enable_cross_job_cache=*/true, output1, output2);
+  EXPECT_EQ(output1, std::vector<int64>({0, 1, 2, 3, 4}));
+  // The second job starts at the only cached element, and then reads the
+  // elements produced by either job.
+  EXPECT_EQ(output2, std::vector<int64>({2, 3}));
+}
+
+TEST(DataService, CrossJobCacheDisabled) {
+  std::vector<int64> output1, output2;
+  ReadTwoJobs(/*enable_cross_job_cache=*/false, output1, output2);
+  EXPECT_EQ(output1, std::vector<int64>({0, 1, 2, 3, 4}));
+  EXPECT_EQ(output2, std::vector<int64>({0, 1}));
+}
+
+TEST(DataService, LoadAwareTaskAssignment) {
+  TestCluster cluster(/*num_workers=*/3, LoadAwareDispatcherConfig(),
+                      RegisterOnlyWorkerConfig());
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  TF_ASSERT_OK(ReportCpuUtilization(dispatcher, cluster.WorkerAddress(0), 0.9));
+  TF_ASSERT_OK(ReportCpuUtilization(dispatcher, cluster.WorkerAddress(1), 0.2));
+  std::vector<std::string> worker_addresses;
+  TF_ASSERT_OK(CreateJobOnWorkers(dispatcher, worker_addresses));
+  // Worker 2 has not reported its load, so it counts as idle.
+  std::vector<std::string> expected = {cluster.WorkerAddress(1),
+                                       cluster.WorkerAddress(2)};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(worker_addresses, expected);
+}
+
+TEST(DataService, LoadAwareTaskAssignmentAllWorkersOverloaded) {
+  TestCluster cluster(/*num_workers=*/2, LoadAwareDispatcherConfig(),
+                      RegisterOnlyWorkerConfig());
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  TF_ASSERT_OK(ReportCpuUtilization(dispatcher, cluster.WorkerAddress(0), 0.9));
+  TF_ASSERT_OK(ReportCpuUtilization(dispatcher, cluster.WorkerAddress(1), 0.7));
+  std::vector<std::string> worker_addresses;
+  TF_ASSERT_OK(CreateJobOnWorkers(dispatcher, worker_addresses));
+  EXPECT_EQ(worker_addresses,
+            std::vector<std::string>({cluster.WorkerAddress(1)}));
+}
+
+TEST(DataService, LoadIgnoredWithoutCpuUtilizationLimit) {
+  TestCluster cluster(/*num_workers=*/2, experimental::DispatcherConfig(),
+                      RegisterOnlyWorkerConfig());
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  TF_ASSERT_OK(ReportCpuUtilization(dispatcher, cluster.WorkerAddress(0), 0.9));
+  std::vector<std::string> worker_addresses;
+  TF_ASSERT_OK(CreateJobOnWorkers(dispatcher, worker_addresses));
+  EXPECT_EQ(worker_addresses.size(), 2);
+}
+
+TEST(SharedMemoryTransfer, IsLocalAddress) {
+  EXPECT_TRUE(IsLocalAddress("localhost:1234"));
+  EXPECT_TRUE(IsLocalAddress("127.0.0.1:1234"));
+  EXPECT_TRUE(IsLocalAddress("[::1]:1234"));
+  EXPECT_TRUE(IsLocalAddress(absl::StrCat(port::Hostname(), ":1234")));
+  EXPECT_FALSE(IsLocalAddress("remote.invalid:1234"));
+}
+
+TEST(SharedMemoryTransfer, GetElements) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_ASSERT_OK(StartSharedMemoryServer(
+      SyntheticGetElement(/*element_size=*/1024, /*num_elements=*/2), &server));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  Tensor expected(DT_UINT8, TensorShape({1024}));
+  expected.flat<uint8>().setConstant(7);
+  GetElementRequest req;
+  for (int i = 0; i < 2; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(req, result));
+    EXPECT_FALSE(result.end_of_sequence);
+    ASSERT_EQ(result.components.size(), 1);
+    test::ExpectTensorEqual<uint8>(result.components[0], expected);
+  }
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(req, result));
+  EXPECT_TRUE(result.end_of_sequence);
+}
+
+TEST(SharedMemoryTransfer, ElementLargerThanBuffer) {
+  DataTransferServer::Config config;
+  config.shared_memory_buffer_size_bytes = 1 << 20;
+  std::shared_ptr<DataTransferServer> server;
+  TF_ASSERT_OK(StartSharedMemoryServer(
+      SyntheticGetElement(/*element_size=*/2 << 20, /*num_elements=*/1),
+      &server, config));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(result.components.size(), 1);
+  EXPECT_EQ(result.components[0].NumElements(), 2 << 20);
+}
+
+TEST(SharedMemoryTransfer, ConcurrentReaders) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_ASSERT_OK(StartSharedMemoryServer(
+      SyntheticGetElement(/*element_size=*/1024, /*num_elements=*/100),
+      &server));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  std::atomic<int64> num_elements(0);
+  std::vector<std::unique_ptr<Thread>> readers;
+  for (int i = 0; i < 8; ++i) {
+    readers.push_back(absl::WrapUnique(Env::Default()->StartThread(
+        {}, "reader", [&client, &num_elements] {
+          while (true) {
+            GetElementResult result;
+            TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+            if (result.end_of_sequence) return;
+            ASSERT_EQ(result.components.size(), 1);
+            EXPECT_EQ(result.components[0].flat<uint8>()(1023), 7);
+            ++num_elements;
+          }
+        })));
+  }
+  readers.clear();
+  EXPECT_EQ(num_elements, 100);
+}
+
+TEST(SharedMemoryTransfer, PropagatesErrors) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_ASSERT_OK(StartSharedMemoryServer(
+      [](const GetElementRequest*, GetElementResult*) {
+        return errors::FailedPrecondition("Task not found.");
+      },
+      &server));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  GetElementResult result;
+  Status s = client->GetElement(GetElementRequest(), result);
+  EXPECT_EQ(s.code(), error::FAILED_PRECONDITION);
+  EXPECT_EQ(s.error_message(), "Task not found.");
+}
+
+TEST(SharedMemoryTransfer, CancelledClient) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_ASSERT_OK(StartSharedMemoryServer(
+      SyntheticGetElement(/*element_size=*/16, /*num_elements=*/1), &server));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  client->TryCancel();
+  GetElementResult result;
+  Status s = client->GetElement(GetElementRequest(), result);
+  EXPECT_EQ(s.code(), error::CANCELLED);
+}
+
+TEST(SharedMemoryTransfer, FallsBackToGrpcForRemoteAddress) {
+  GrpcTransferServer grpc_server(
+      SyntheticGetElement(/*element_size=*/16, /*num_elements=*/1));
+  TF_ASSERT_OK(grpc_server.Start());
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, "remote.invalid:1234", grpc_server.Address()}, &client));
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(result.components.size(), 1);
+  EXPECT_EQ(result.components[0].NumElements(), 16);
+}
+
+TEST(SharedMemoryTransfer, RemoteAddressWithoutWorkerAddress) {
+  std::unique_ptr<DataTransferClient> client;
+  Status s = DataTransferClient::Build(kSharedMemoryTransferProtocol,
+                                       {kProtocol, "remote.invalid:1234", ""},
+                                       &client);
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+}
+
+TEST(GrpcTransfer, BatchedElements) {
+  for (CompressionCodecDef codec : {CODEC_NONE, CODEC_SNAPPY, CODEC_ZLIB}) {
+    ElementBatchingDef batching;
+    batching.set_max_elements(4);
+    batching.set_max_bytes(16 << 20);
+    batching.set_codec(codec);
+    GrpcTransferServer server(
+        SyntheticGetElement(/*element_size=*/1000, /*num_elements=*/10),
+        batching);
+    TF_ASSERT_OK(server.Start());
+    DataTransferClient::Config config{kProtocol, server.Address()};
+    config.element_batching = batching;
+    std::unique_ptr<DataTransferClient> client;
+    TF_ASSERT_OK(DataTransferClient::Build("grpc", config, &client));
+    GetElementRequest req;
+    for (int i = 0; i < 10; ++i) {
+      GetElementResult result;
+      TF_ASSERT_OK(client->GetElement(req, result));
+      ASSERT_FALSE(result.end_of_sequence);
+      ASSERT_EQ(result.components.size(), 1);
+      EXPECT_EQ(result.components[0].NumElements(), 1000);
+    }
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(req, result));
+    EXPECT_TRUE(result.end_of_sequence);
+  }
+}
+
+TEST(GrpcTransfer, BatchedElementsFromWorker) {
+  TestCluster cluster(/*num_workers=*/1);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(),
+                                         kProtocol);
+  test_util::GraphDefTestCase test_case;
+  TF_ASSERT_OK(test_util::map_test_case(&test_case));
+  int64 dataset_id;
+  TF_ASSERT_OK(dispatcher.RegisterDataset(test_case.graph_def, dataset_id));
+  ElementBatchingDef batching;
+  batching.set_max_elements(3);
+  batching.set_max_bytes(16 << 20);
+  batching.set_codec(CODEC_ZLIB);
+  std::unique_ptr<JobReader> reader;
+  TF_ASSERT_OK(JobReader::Create(dispatcher, dataset_id, reader, batching));
+
+  for (int64 i = 0; i < 10; ++i) {
+    int64 value;
+    TF_ASSERT_OK(reader->Read(value));
+    EXPECT_EQ(value, i * i);
+  }
+  int64 value;
+  EXPECT_TRUE(errors::IsOutOfRange(reader->Read(value)));
+}
+
+TEST(DataService, ParseCompressionCodec) {
+  CompressionCodecDef codec;
+  TF_ASSERT_OK(ParseCompressionCodec("", codec));
+  EXPECT_EQ(codec, CODEC_NONE);
+  TF_ASSERT_OK(ParseCompressionCodec("snappy", codec));
+  EXPECT_EQ(codec, CODEC_SNAPPY);
+  TF_ASSERT_OK(ParseCompressionCodec("zlib", codec));
+  EXPECT_EQ(codec, CODEC_ZLIB);
+  TF_ASSERT_OK(ParseCompressionCodec("none", codec));
+  EXPECT_EQ(codec, CODEC_NONE);
+  Status s = ParseCompressionCodec("lz4", codec);
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+}
+
+// Reads elements of `state.range(0)` bytes from `client`.
+void RunTransferBenchmark(::testing::benchmark::State& state,
+                          DataTransferClient* client) {
+  GetElementRequest req;
+  for (auto s : state) {
+    GetElementResult result;
+    TF_CHECK_OK(client->GetElement(req, result));
+    CHECK(!result.end_of_sequence);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) *
+                          state.range(0));
+}
+
+// A shared memory buffer whose slots fit the largest benchmarked elements.
+DataTransferServer::Config SharedMemoryBenchmarkConfig() {
+  DataTransferServer::Config config;
+  config.shared_memory_buffer_size_bytes = 128 << 20;
+  return config;
+}
+
+void BM_SharedMemoryTransfer(::testing::benchmark::State& state) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(StartSharedMemoryServer(
+      SyntheticGetElement(state.range(0), kint64max), &server,
+      SharedMemoryBenchmarkConfig()));
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  RunTransferBenchmark(state, client.get());
+}
+
+BENCHMARK(BM_SharedMemoryTransfer)
+    ->Arg(1 << 10)
+    ->Arg(64 << 10)
+    ->Arg(1 << 20)
+    ->Arg(16 << 20);
+
+void BM_GrpcTransfer(::testing::benchmark::State& state) {
+  GrpcTransferServer server(SyntheticGetElement(state.range(0), kint64max));
+  TF_CHECK_OK(server.Start());
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build("grpc", {kProtocol, server.Address()},
+                                        &client));
+  RunTransferBenchmark(state, client.get());
+}
+
+BENCHMARK(BM_GrpcTransfer)
+    ->Arg(1 << 10)
+    ->Arg(64 << 10)
+    ->Arg(1 << 20)
+    ->Arg(16 << 20);
+
+// Reads elements of `state.range(0)` bytes from `client` with `state.range(1)`
+// concurrent requests, the way an iterator with several outstanding requests
+// reads from a worker.
+void RunParallelTransferBenchmark(::testing::benchmark::State& state,
+                                  DataTransferClient* client) {
+  const int num_readers = state.range(1);
+  thread::ThreadPool pool(Env::Default(), "transfer_benchmark", num_readers);
+  for (auto s : state) {
+    BlockingCounter counter(num_readers);
+    for (int i = 0; i < num_readers; ++i) {
+      pool.Schedule([client, &counter] {
+        GetElementResult result;
+        TF_CHECK_OK(client->GetElement(GetElementRequest(), result));
+        CHECK(!result.end_of_sequence);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()) *
+                          num_readers);
+  state.SetBytesProcessed(static_cast<int64>(state.iterations()) *
+                          num_readers * state.range(0));
+}
+
+void BM_SharedMemoryParallelTransfer(::testing::benchmark::State& state) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(StartSharedMemoryServer(
+      SyntheticGetElement(state.range(0), kint64max), &server,
+      SharedMemoryBenchmarkConfig()));
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build(
+      kSharedMemoryTransferProtocol,
+      {kProtocol, SharedMemoryAddress(server.get()), ""}, &client));
+  RunParallelTransferBenchmark(state, client.get());
+}
+
+BENCHMARK(BM_SharedMemoryParallelTransfer)
+    ->Args({64 << 10, 1})
+    ->Args({64 << 10, 4})
+    ->Args({1 << 20, 1})
+    ->Args({1 << 20, 4})
+    ->Args({8 << 20, 1})
+    ->Args({8 << 20, 4});
+
+void BM_GrpcParallelTransfer(::testing::benchmark::State& state) {
+  GrpcTransferServer server(SyntheticGetElement(state.range(0), kint64max));
+  TF_CHECK_OK(server.Start());
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build("grpc", {kProtocol, server.Address()},
+                                        &client));
+  RunParallelTransferBenchmark(state, client.get());
+}
+
+BENCHMARK(BM_GrpcParallelTransfer)
+    ->Args({64 << 10, 1})
+    ->Args({64 << 10, 4})
+    ->Args({1 << 20, 1})
+    ->Args({1 << 20, 4})
+    ->Args({8 << 20, 1})
+    ->Args({8 << 20, 4});
+
+// Reads elements of `state.range(0)` bytes over gRPC, fetching up to
+// `state.range(1)` elements per request and compressing batches with codec
+// `state.range(2)`. One element per request is the unbatched GetElement RPC.
+// The synthetic elements are constant, so they compress better than real
+// data.
+void BM_GrpcBatchedTransfer(::testing::benchmark::State& state) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(state.range(1));
+  batching.set_max_bytes(16 << 20);
+  batching.set_codec(static_cast<CompressionCodecDef>(state.range(2)));
+  GrpcTransferServer server(SyntheticGetElement(state.range(0), kint64max),
+                            batching);
+  TF_CHECK_OK(server.Start());
+  DataTransferClient::Config config{kProtocol, server.Address()};
+  config.element_batching = batching;
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build("grpc", config, &client));
+  RunTransferBenchmark(state, client.get());
+}
+
+BENCHMARK(BM_GrpcBatchedTransfer)
+    ->Args({64, 1, CODEC_NONE})
+    ->Args({64, 16, CODEC_NONE})
+    ->Args({64, 128, CODEC_NONE})
+    ->Args({64, 128, CODEC_SNAPPY})
+    ->Args({64, 128, CODEC_ZLIB})
+    ->Args({1 << 20, 1, CODEC_NONE})
+    ->Args({1 << 20, 16, CODEC_NONE})
+    ->Args({1 << 20, 16, CODEC_SNAPPY})
+    ->Args({1 << 20, 16, CODEC_ZLIB});
+
 }  // namespace data
 }  // namespace tensorflow
@@ -15,11 +15,19 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/data_transfer.h"
 
+#include <zlib.h>
+
+#include <algorithm>
 #include <functional>
 
 #include "absl/strings/str_join.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/snappy.h"
 
 namespace tensorflow {
 namespace data {
@@ -31,9 +39,7 @@ mutex* get_lock() {
 }
 
 using DataTransferServerFactories =
-    std::unordered_map<std::string,
-                       std::function<std::shared_ptr<DataTransferServer>(
-                           DataTransferServer::GetElementT)>>;
+    std::unordered_map<std::string, DataTransferServer::FactoryT>;
 DataTransferServerFactories& transfer_server_factories() {
   static auto& factories = *new DataTransferServerFactories();
   return factories;
@@ -45,11 +51,70 @@ DataTransferClientFactories& transfer_client_factories() {
   static auto& factories = *new DataTransferClientFactories();
   return factories;
 }
+
+// Compresses `input` into `output` using `codec`.
+Status CompressBatch(CompressionCodecDef codec, const std::string& input,
+                     std::string& output) {
+  switch (codec) {
+    case CODEC_SNAPPY:
+      if (!port::Snappy_Compress(input.data(), input.size(), &output)) {
+        return errors::Internal(
+            "Failed to compress element batch with snappy.");
+      }
+      return Status::OK();
+    case CODEC_ZLIB: {
+      uLongf size = compressBound(input.size());
+      output.resize(size);
+      int ret = compress2(reinterpret_cast<Bytef*>(&output[0]), &size,
+                          reinterpret_cast<const Bytef*>(input.data()),
+                          input.size(), Z_BEST_SPEED);
+      if (ret != Z_OK) {
+        return errors::Internal(
+            "Failed to compress element batch with zlib. Error code: ", ret);
+      }
+      output.resize(size);
+      return Status::OK();
+    }
+    default:
+      return errors::InvalidArgument("Unsupported compression codec ",
+                                     CompressionCodecDef_Name(codec));
+  }
+}
+
+// Uncompresses `input`, compressed using `codec`, into `output`.
+Status UncompressBatch(CompressionCodecDef codec, const std::string& input,
+                       size_t uncompressed_size, std::string& output) {
+  output.resize(uncompressed_size);
+  switch (codec) {
+    case CODEC_SNAPPY: {
+      size_t size;
+      if (!port::Snappy_GetUncompressedLength(input.data(), input.size(),
+                                              &size) ||
+          size != uncompressed_size ||
+          !port::Snappy_Uncompress(input.data(), input.size(), &output[0])) {
+        return errors::DataLoss(
+            "Failed to uncompress element batch with snappy.");
+      }
+      return Status::OK();
+    }
+    case CODEC_ZLIB: {
+      uLongf size = uncompressed_size;
+      int ret = uncompress(reinterpret_cast<Bytef*>(&output[0]), &size,
+                           reinterpret_cast<const Bytef*>(input.data()),
+                           input.size());
+      if (ret != Z_OK || size != uncompressed_size) {
+        return errors::DataLoss(
+            "Failed to uncompress element batch with zlib. Error code: ", ret);
+      }
+      return Status::OK();
+    }
+    default:
+      return errors::InvalidArgument("Unsupported compression codec ", codec);
+  }
+}
 }  // namespace
 
-void DataTransferServer::Register(
-    std::string name,
-    std::function<std::shared_ptr<DataTransferServer>(GetElementT)> factory) {
+void DataTransferServer::Register(std::string name, FactoryT factory) {
   mutex_lock l(*get_lock());
   if (!transfer_server_factories().insert({name, factory}).second) {
     LOG(ERROR)
@@ -59,11 +124,12 @@ void DataTransferServer::Register(
 }
 
 Status DataTransferServer::Build(std::string name, GetElementT get_element,
+                                 const Config& config,
                                  std::shared_ptr<DataTransferServer>* out) {
   mutex_lock l(*get_lock());
   auto it = transfer_server_factories().find(name);
   if (it != transfer_server_factories().end()) {
-    *out = it->second(get_element);
+    *out = it->second(get_element, config);
     return Status::OK();
   }
 
@@ -89,11 +155,21 @@ void DataTransferClient::Register(std::string name, FactoryT factory) {
 
 Status DataTransferClient::Build(std::string name, Config config,
                                  std::unique_ptr<DataTransferClient>* out) {
-  mutex_lock l(*get_lock());
-  auto it = transfer_client_factories().find(name);
-  if (it != transfer_client_factories().end()) {
-    return it->second(config, out);
+  FactoryT factory;
+  {
+    mutex_lock l(*get_lock());
+    auto it = transfer_client_factories().find(name);
+    if (it != transfer_client_factories().end()) {
+      factory = it->second;
+    }
   }
+  // The factory is called without holding the lock, so that it can build a
+  // client of another protocol to fall back to.
+  if (factory) {
+    return factory(config, out);
+  }
+
+  mutex_lock l(*get_lock());
 
   std::vector<string> available_names;
   for (const auto& factory : transfer_client_factories()) {
@@ -106,5 +182,136 @@ Status DataTransferClient::Build(std::string name, Config config,
       " ]");
 }
 
+Status MoveElementToResponse(std::vector<Tensor>&& element,
+                             GetElementResponse& resp) {
+  if (element.size() != 1 || element[0].dtype() != DT_VARIANT ||
+      !TensorShapeUtils::IsScalar(element[0].shape())) {
+    for (const auto& component : element) {
+      UncompressedElement* uncompressed = resp.mutable_uncompressed();
+      component.AsProtoTensorContent(uncompressed->add_components());
+    }
+    return Status::OK();
+  }
+  Variant& variant = element[0].scalar<Variant>()();
+  CompressedElement* compressed = variant.get<CompressedElement>();
+  if (compressed == nullptr) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a CompressedElement variant tensor, but "
+        "it produced ",
+        variant.TypeName());
+  }
+  *resp.mutable_compressed() = *compressed;
+  return Status::OK();
+}
+
+Status MoveResponseToResult(GetElementResponse& resp,
+                            GetElementResult& result) {
+  result.end_of_sequence = resp.end_of_sequence();
+  result.skip = resp.skip_task();
+  switch (resp.element_case()) {
+    case GetElementResponse::kCompressed: {
+      Tensor tensor(DT_VARIANT, TensorShape{});
+      tensor.scalar<Variant>()() = std::move(*resp.mutable_compressed());
+      result.components.push_back(tensor);
+      break;
+    }
+    case GetElementResponse::kUncompressed:
+      for (const auto& component : resp.uncompressed().components()) {
+        result.components.emplace_back();
+        if (!result.components.back().FromProto(component)) {
+          return errors::Internal("Failed to parse tensor.");
+        }
+      }
+      break;
+    case GetElementResponse::ELEMENT_NOT_SET:
+      break;
+  }
+  return Status::OK();
+}
+
+Status GetElementBatch(
+    const ElementBatchingDef& batching, const GetElementRequest& req,
+    const std::function<Status(GetElementResponse&)>& get_element,
+    GetElementsResponse& resp) {
+  int64 max_elements = std::max<int64>(batching.max_elements(), 1);
+  if (req.optional_consumer_index_case() !=
+      GetElementRequest::OPTIONAL_CONSUMER_INDEX_NOT_SET) {
+    max_elements = 1;
+  }
+  int64 batch_bytes = 0;
+  int64 deadline_micros = kint64max;
+  // Whether every element is already compressed by the dataset, so that
+  // compressing the batch again would be wasted work.
+  bool elements_compressed = true;
+  while (resp.elements_size() < max_elements &&
+         (batching.max_bytes() <= 0 || batch_bytes < batching.max_bytes()) &&
+         Env::Default()->NowMicros() < deadline_micros) {
+    GetElementResponse* element = resp.add_elements();
+    Status s = get_element(*element);
+    if (!s.ok()) {
+      resp.mutable_elements()->RemoveLast();
+      if (resp.elements_size() == 0) {
+        return s;
+      }
+      resp.set_error_code(s.code());
+      resp.set_error_message(s.error_message());
+      break;
+    }
+    batch_bytes += element->ByteSizeLong();
+    if (element->element_case() == GetElementResponse::kUncompressed) {
+      elements_compressed = false;
+    }
+    if (element->end_of_sequence() || element->skip_task()) {
+      break;
+    }
+    if (resp.elements_size() == 1) {
+      deadline_micros = Env::Default()->NowMicros() + kMaxBatchDelayMicros;
+    }
+  }
+  const CompressionCodecDef codec = batching.codec();
+  // Jobs created by newer clients may use codecs this worker does not know;
+  // those batches are sent uncompressed.
+  if (codec == CODEC_NONE || !CompressionCodecDef_IsValid(codec) ||
+      elements_compressed) {
+    return Status::OK();
+  }
+  ElementBatch batch;
+  batch.mutable_elements()->Swap(resp.mutable_elements());
+  std::string serialized = batch.SerializeAsString();
+  std::string compressed;
+  Status s = CompressBatch(codec, serialized, compressed);
+  if (!s.ok() || compressed.size() >= serialized.size()) {
+    if (!s.ok()) {
+      LOG(WARNING) << "Sending element batch uncompressed: " << s;
+    }
+    resp.mutable_elements()->Swap(batch.mutable_elements());
+    return Status::OK();
+  }
+  VLOG(3) << "Compressed batch of " << batch.elements_size()
+          << " elements from " << serialized.size() << " bytes to "
+          << compressed.size() << " bytes";
+  resp.set_compressed_elements(std::move(compressed));
+  resp.set_codec(codec);
+  resp.set_uncompressed_size(serialized.size());
+  return Status::OK();
+}
+
+Status UncompressElementBatch(GetElementsResponse& resp) {
+  if (resp.codec() == CODEC_NONE) {
+    return Status::OK();
+  }
+  std::string serialized;
+  TF_RETURN_IF_ERROR(UncompressBatch(resp.codec(), resp.compressed_elements(),
+                                     resp.uncompressed_size(), serialized));
+  ElementBatch batch;
+  if (!batch.ParseFromString(serialized)) {
+    return errors::DataLoss("Failed to parse element batch.");
+  }
+  resp.mutable_elements()->Swap(batch.mutable_elements());
+  resp.clear_compressed_elements();
+  resp.set_codec(CODEC_NONE);
+  return Status::OK();
+}
+
 }  // namespace data
 }  // namespace tensorflow
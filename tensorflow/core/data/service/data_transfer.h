@@ -50,6 +50,12 @@ class DataTransferClient {
   struct Config {
     absl::string_view protocol;
     std::string address;
+    // The gRPC address of the worker, for clients that fall back to gRPC.
+    std::string worker_address;
+    // The batching of the job being read. When `max_elements` is greater than
+    // 1, clients that support batching fetch batches of elements with
+    // GetElements and serve later GetElement calls from the batch.
+    ElementBatchingDef element_batching;
   };
   using FactoryT =
       std::function<Status(Config, std::unique_ptr<DataTransferClient>*)>;
@@ -71,11 +77,51 @@ class DataTransferClient {
                       std::unique_ptr<DataTransferClient>* out);
 };
 
+// Moves `element` into `resp`. If the element is a single CompressedElement
+// variant, the move is zero-copy. Otherwise, the tensor data is serialized as
+// TensorProtos.
+Status MoveElementToResponse(std::vector<Tensor>&& element,
+                             GetElementResponse& resp);
+
+// Moves the element of `resp` into `result`, and copies its flags.
+Status MoveResponseToResult(GetElementResponse& resp, GetElementResult& result);
+
+// Fills `resp` with a batch of elements for `req`, calling `get_element` once
+// per element, and compresses it with `batching.codec()` if its elements are
+// uncompressed. The batch ends after `batching.max_elements()` elements, once
+// it reaches `batching.max_bytes()` bytes, after a response that reports end
+// of sequence or a skipped round, or when `kMaxBatchDelayMicros` have passed
+// since the first element was produced. The deadline is only checked between
+// calls to `get_element`, which blocks until the input produces an element, so
+// a slow input can delay the elements already produced by up to the time it
+// takes to produce one more element. Round robin requests get a single
+// element. If `get_element` fails after producing some elements, the error is
+// stored in `resp` after them, so that no produced element is lost.
+Status GetElementBatch(
+    const ElementBatchingDef& batching, const GetElementRequest& req,
+    const std::function<Status(GetElementResponse&)>& get_element,
+    GetElementsResponse& resp);
+
+// How long `GetElementBatch` keeps adding elements to a batch after producing
+// its first element.
+constexpr int64 kMaxBatchDelayMicros = 1000;
+
+// Uncompresses the batch of `resp`, if it is compressed, into
+// `resp.elements()`.
+Status UncompressElementBatch(GetElementsResponse& resp);
+
 // Server for communicating with the tf.data service transfer client.
 class DataTransferServer {
  public:
   using GetElementT =
       std::function<Status(const GetElementRequest*, GetElementResult*)>;
+  struct Config {
+    // The size in bytes of the shared memory buffer of each client of servers
+    // that transfer elements through shared memory. 0 uses their default.
+    int64 shared_memory_buffer_size_bytes = 0;
+  };
+  using FactoryT = std::function<std::shared_ptr<DataTransferServer>(
+      GetElementT, const Config&)>;
   virtual ~DataTransferServer() = default;
 
   // Starts DataTransferServer, it should be available for requests afterwards.
@@ -85,12 +131,11 @@ class DataTransferServer {
   virtual int get_port() = 0;
 
   // Register a DataTransferServer factory under `name`.
-  static void Register(
-      std::string name,
-      std::function<std::shared_ptr<DataTransferServer>(GetElementT)> factory);
+  static void Register(std::string name, FactoryT factory);
 
   // Builds a DataTransferServer from the factory registered with `name`.
   static Status Build(std::string name, GetElementT get_element,
+                      const Config& config,
                       std::shared_ptr<DataTransferServer>* out);
 };
 
@@ -16,12 +16,224 @@ limitations under the License.
 
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
+// Returns a function which produces `num_elements` uncompressed elements, each
+// a uint8 tensor of `element_size` bytes, and then reports end of sequence.
+std::function<Status(GetElementResponse&)> RangeElements(int64 num_elements,
+                                                         int64 element_size) {
+  auto produced = std::make_shared<int64>(0);
+  return [=](GetElementResponse& resp) {
+    if (*produced >= num_elements) {
+      resp.set_end_of_sequence(true);
+      return Status::OK();
+    }
+    Tensor element(DT_UINT8, TensorShape({element_size}));
+    element.flat<uint8>().setConstant((*produced)++);
+    return MoveElementToResponse({element}, resp);
+  };
+}
+
+// Checks that `resp` holds the uncompressed elements `first`, `first` + 1, ...
+// produced by `RangeElements`.
+void CheckElements(GetElementsResponse& resp, int64 first, int64 num_elements) {
+  TF_ASSERT_OK(UncompressElementBatch(resp));
+  ASSERT_EQ(resp.elements_size(), num_elements);
+  for (int64 i = 0; i < num_elements; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(MoveResponseToResult(*resp.mutable_elements(i), result));
+    ASSERT_EQ(result.components.size(), 1);
+    EXPECT_EQ(result.components[0].flat<uint8>()(0), first + i);
+  }
+}
+
+TEST(DataTransferTest, GetElementBatchMaxElements) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(3);
+  GetElementRequest req;
+  auto get_element = RangeElements(/*num_elements=*/10, /*element_size=*/8);
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(batching, req, get_element, resp));
+  CheckElements(resp, /*first=*/0, /*num_elements=*/3);
+  resp.Clear();
+  TF_ASSERT_OK(GetElementBatch(batching, req, get_element, resp));
+  CheckElements(resp, /*first=*/3, /*num_elements=*/3);
+}
+
+TEST(DataTransferTest, GetElementBatchMaxBytes) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(100);
+  batching.set_max_bytes(2500);
+  GetElementRequest req;
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(
+      batching, req, RangeElements(/*num_elements=*/10, /*element_size=*/1000),
+      resp));
+  CheckElements(resp, /*first=*/0, /*num_elements=*/3);
+}
+
+TEST(DataTransferTest, GetElementBatchEndOfSequence) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(100);
+  GetElementRequest req;
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(
+      batching, req, RangeElements(/*num_elements=*/2, /*element_size=*/8),
+      resp));
+  ASSERT_EQ(resp.elements_size(), 3);
+  EXPECT_TRUE(resp.elements(2).end_of_sequence());
+}
+
+TEST(DataTransferTest, GetElementBatchRoundRobin) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(100);
+  GetElementRequest req;
+  req.set_consumer_index(0);
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(
+      batching, req, RangeElements(/*num_elements=*/10, /*element_size=*/8),
+      resp));
+  CheckElements(resp, /*first=*/0, /*num_elements=*/1);
+}
+
+TEST(DataTransferTest, GetElementBatchErrorAfterElements) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(100);
+  GetElementRequest req;
+  auto range = RangeElements(/*num_elements=*/10, /*element_size=*/8);
+  int64 calls = 0;
+  auto get_element = [&](GetElementResponse& resp) {
+    if (calls++ == 2) {
+      return errors::Unavailable("Worker is shutting down");
+    }
+    return range(resp);
+  };
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(batching, req, get_element, resp));
+  EXPECT_EQ(resp.error_code(), error::UNAVAILABLE);
+  CheckElements(resp, /*first=*/0, /*num_elements=*/2);
+}
+
+TEST(DataTransferTest, GetElementBatchError) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(100);
+  GetElementRequest req;
+  GetElementsResponse resp;
+  Status s = GetElementBatch(
+      batching, req,
+      [](GetElementResponse&) { return errors::NotFound("Task not found"); },
+      resp);
+  EXPECT_EQ(s.code(), error::NOT_FOUND);
+}
+
+TEST(DataTransferTest, GetElementBatchDeadline) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(10);
+  GetElementRequest req;
+  auto range = RangeElements(/*num_elements=*/10, /*element_size=*/8);
+  auto get_element = [&](GetElementResponse& resp) {
+    Env::Default()->SleepForMicroseconds(10 * kMaxBatchDelayMicros);
+    return range(resp);
+  };
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(batching, req, get_element, resp));
+  EXPECT_GE(resp.elements_size(), 1);
+  EXPECT_LE(resp.elements_size(), 2);
+}
+
+TEST(DataTransferTest, GetElementBatchSlowInputDelaysProducedElements) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(10);
+  GetElementRequest req;
+  auto range = RangeElements(/*num_elements=*/10, /*element_size=*/8);
+  int64 calls = 0;
+  auto get_element = [&](GetElementResponse& resp) {
+    if (calls++ > 0) {
+      Env::Default()->SleepForMicroseconds(10 * kMaxBatchDelayMicros);
+    }
+    return range(resp);
+  };
+  GetElementsResponse resp;
+  int64 start_micros = Env::Default()->NowMicros();
+  TF_ASSERT_OK(GetElementBatch(batching, req, get_element, resp));
+  int64 elapsed_micros = Env::Default()->NowMicros() - start_micros;
+  // The first element is ready immediately, but the batch waits for the
+  // second one, which takes longer than the deadline.
+  EXPECT_LE(resp.elements_size(), 2);
+  if (resp.elements_size() == 2) {
+    EXPECT_GE(elapsed_micros, 10 * kMaxBatchDelayMicros);
+  }
+}
+
+class GetElementBatchCodecTest
+    : public ::testing::TestWithParam<CompressionCodecDef> {};
+
+TEST_P(GetElementBatchCodecTest, RoundTrip) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(5);
+  batching.set_codec(GetParam());
+  GetElementRequest req;
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(
+      batching, req, RangeElements(/*num_elements=*/10, /*element_size=*/1000),
+      resp));
+  EXPECT_EQ(resp.codec(), GetParam());
+  if (GetParam() != CODEC_NONE) {
+    EXPECT_LT(resp.compressed_elements().size(), resp.uncompressed_size());
+  }
+  CheckElements(resp, /*first=*/0, /*num_elements=*/5);
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, GetElementBatchCodecTest,
+                         ::testing::Values(CODEC_NONE, CODEC_SNAPPY,
+                                           CODEC_ZLIB));
+
+// The transfer codec only compresses elements which the dataset leaves
+// uncompressed (compression=None); per-element compression takes precedence.
+TEST(DataTransferTest, GetElementBatchSkipsCompressedElements) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(5);
+  batching.set_codec(CODEC_ZLIB);
+  GetElementRequest req;
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(
+      batching, req,
+      [](GetElementResponse& resp) {
+        resp.mutable_compressed()->set_data(std::string(1000, 'a'));
+        return Status::OK();
+      },
+      resp));
+  EXPECT_EQ(resp.codec(), CODEC_NONE);
+  EXPECT_EQ(resp.elements_size(), 5);
+}
+
+TEST(DataTransferTest, GetElementBatchUnknownCodec) {
+  ElementBatchingDef batching;
+  batching.set_max_elements(5);
+  batching.set_codec(static_cast<CompressionCodecDef>(100));
+  GetElementRequest req;
+  GetElementsResponse resp;
+  TF_ASSERT_OK(GetElementBatch(
+      batching, req, RangeElements(/*num_elements=*/10, /*element_size=*/1000),
+      resp));
+  EXPECT_EQ(resp.codec(), CODEC_NONE);
+  CheckElements(resp, /*first=*/0, /*num_elements=*/5);
+}
+
+TEST(DataTransferTest, UncompressCorruptedBatch) {
+  GetElementsResponse resp;
+  resp.set_codec(CODEC_ZLIB);
+  resp.set_compressed_elements("not compressed");
+  resp.set_uncompressed_size(100);
+  EXPECT_EQ(UncompressElementBatch(resp).code(), error::DATA_LOSS);
+}
+
 class TestDataTransferServer : public DataTransferServer {
  public:
   explicit TestDataTransferServer(bool* called) : called_(called) {}
@@ -37,12 +249,12 @@ class TestDataTransferServer : public DataTransferServer {
 
 TEST(DataTransferTest, RegisterDataTransferServerBuilder) {
   bool called = false;
-  DataTransferServer::Register("test", [&called](auto _) {
+  DataTransferServer::Register("test", [&called](auto, auto) {
     return std::make_shared<TestDataTransferServer>(&called);
   });
 
   std::shared_ptr<DataTransferServer> server;
-  TF_ASSERT_OK(DataTransferServer::Build("test", {}, &server));
+  TF_ASSERT_OK(DataTransferServer::Build("test", {}, {}, &server));
   EXPECT_FALSE(called);
 
   TF_ASSERT_OK(server->Start());
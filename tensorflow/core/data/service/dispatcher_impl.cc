@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/dispatcher_impl.h"
 
+#include <cmath>
 #include <memory>
 #include <tuple>
 #include <utility>
@@ -38,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/journal.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/errors.h"
@@ -54,6 +56,8 @@ namespace {
 constexpr char kJournalDir[] = "tf_data_dispatcher_journal";
 // The name of the datasets directory inside the dispatcher's working directory.
 constexpr char kDatasetsDir[] = "datasets";
+// The default number of journaled updates between journal compactions.
+constexpr int64 kDefaultJournalCompactionInterval = 10000;
 
 constexpr std::array<const char*, 8> kNodeNameSharingOps = {
     "HashTable",
@@ -159,10 +163,19 @@ Status DataServiceDispatcherImpl::Start() {
       env_, JournalDir(config_.work_dir()));
   LOG(INFO) << "Attempting to restore dispatcher state from journal in "
             << JournalDir(config_.work_dir());
+  FileJournalReader reader(env_, JournalDir(config_.work_dir()));
+  DispatcherStateSnapshot snapshot;
+  Status s = reader.ReadSnapshot(snapshot);
+  if (s.ok()) {
+    TF_RETURN_IF_ERROR(state_.Restore(snapshot));
+    LOG(INFO) << "Restored dispatcher state from journal snapshot with "
+              << snapshot.jobs_size() << " jobs.";
+  } else if (!errors::IsNotFound(s)) {
+    return s;
+  }
   Update update;
   bool end_of_journal = false;
-  FileJournalReader reader(env_, JournalDir(config_.work_dir()));
-  Status s = reader.Read(update, end_of_journal);
+  s = reader.Read(update, end_of_journal);
   if (errors::IsNotFound(s)) {
     LOG(INFO) << "No journal found. Starting dispatcher from new state.";
   } else if (!s.ok()) {
@@ -170,6 +183,7 @@ Status DataServiceDispatcherImpl::Start() {
   } else {
     while (!end_of_journal) {
       TF_RETURN_IF_ERROR(ApplyWithoutJournaling(update));
+      updates_since_compaction_++;
       TF_RETURN_IF_ERROR(reader.Read(update, end_of_journal));
     }
   }
@@ -268,6 +282,8 @@ Status DataServiceDispatcherImpl::FindNewTasks(
     if (task->job->num_consumers.has_value()) {
       task_def->set_num_consumers(task->job->num_consumers.value());
     }
+    task_def->set_use_cross_job_cache(UseCrossJobCache(*task->job));
+    *task_def->mutable_element_batching() = task->job->element_batching;
   }
   return Status::OK();
 }
@@ -279,6 +295,14 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
           << request->worker_address();
   mutex_lock l(mu_);
   const std::string& worker_address = request->worker_address();
+  if (request->has_load()) {
+    const WorkerLoad& load = request->load();
+    worker_loads_[worker_address] = load;
+    metrics::RecordTFDataServiceWorkerLoad(
+        worker_address, std::lround(load.buffer_occupancy() * 100),
+        std::lround(load.elements_per_second()),
+        std::lround(load.cpu_utilization() * 100));
+  }
   // Assigned tasks from the perspective of the dispatcher.
   std::vector<std::shared_ptr<const Task>> assigned_tasks;
   Status s = state_.TasksForWorker(worker_address, assigned_tasks);
@@ -315,7 +339,14 @@ Status DataServiceDispatcherImpl::WorkerUpdate(
   for (auto& update : request->updates()) {
     int64 task_id = update.task_id();
     std::shared_ptr<const Task> task;
-    TF_RETURN_IF_ERROR(state_.TaskFromId(task_id, task));
+    Status s = state_.TaskFromId(task_id, task);
+    if (errors::IsNotFound(s)) {
+      // Tasks of garbage collected jobs are not restored from a journal
+      // snapshot.
+      VLOG(1) << "Received update for unknown task " << task_id;
+      continue;
+    }
+    TF_RETURN_IF_ERROR(s);
     if (update.completed()) {
       if (task->finished) {
         VLOG(1) << "Received completion update for already-finished task "
@@ -494,7 +525,7 @@ Status DataServiceDispatcherImpl::GetOrCreateJob(
     }
     TF_RETURN_IF_ERROR(CreateJob(request->dataset_id(),
                                  requested_processing_mode, key, num_consumers,
-                                 job));
+                                 request->element_batching(), job));
     int64 job_client_id;
     TF_RETURN_IF_ERROR(AcquireJobClientId(job, job_client_id));
     response->set_job_client_id(job_client_id);
@@ -588,7 +619,8 @@ Status DataServiceDispatcherImpl::ValidateMatchingJob(
 Status DataServiceDispatcherImpl::CreateJob(
     int64 dataset_id, ProcessingMode processing_mode,
     absl::optional<NamedJobKey> named_job_key,
-    absl::optional<int64> num_consumers, std::shared_ptr<const Job>& job)
+    absl::optional<int64> num_consumers,
+    const ElementBatchingDef& element_batching, std::shared_ptr<const Job>& job)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   switch (processing_mode) {
     case ProcessingMode::PARALLEL_EPOCHS:
@@ -615,6 +647,7 @@ Status DataServiceDispatcherImpl::CreateJob(
   if (num_consumers.has_value()) {
     create_job->set_num_consumers(num_consumers.value());
   }
+  *create_job->mutable_element_batching() = element_batching;
   TF_RETURN_IF_ERROR(Apply(update));
   TF_RETURN_IF_ERROR(state_.JobFromId(job_id, job));
   return Status::OK();
@@ -654,7 +687,8 @@ Status DataServiceDispatcherImpl::CreateTasksForJob(
     std::shared_ptr<const Job> job,
     std::vector<std::shared_ptr<const Task>>& tasks)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  std::vector<std::shared_ptr<const Worker>> workers = state_.ListWorkers();
+  std::vector<std::shared_ptr<const Worker>> workers =
+      SelectWorkersForJob(*job);
   tasks.clear();
   tasks.reserve(workers.size());
   for (const auto& worker : workers) {
@@ -665,6 +699,47 @@ Status DataServiceDispatcherImpl::CreateTasksForJob(
   return Status::OK();
 }
 
+std::vector<std::shared_ptr<const Worker>>
+DataServiceDispatcherImpl::SelectWorkersForJob(const Job& job)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  std::vector<std::shared_ptr<const Worker>> workers = state_.ListWorkers();
+  // Round robin jobs need a task on every worker to keep their consumers in
+  // sync.
+  if (config_.max_worker_cpu_utilization() <= 0 || job.IsRoundRobin() ||
+      workers.empty()) {
+    return workers;
+  }
+  std::vector<std::shared_ptr<const Worker>> selected;
+  std::shared_ptr<const Worker> least_loaded;
+  double least_utilization = 0.0;
+  for (const auto& worker : workers) {
+    // Workers that have not reported their load yet have just registered, so
+    // they are treated as idle.
+    double utilization = 0.0;
+    auto it = worker_loads_.find(worker->address);
+    if (it != worker_loads_.end()) {
+      utilization = it->second.cpu_utilization();
+    }
+    if (utilization < config_.max_worker_cpu_utilization()) {
+      selected.push_back(worker);
+    }
+    if (!least_loaded || utilization < least_utilization) {
+      least_loaded = worker;
+      least_utilization = utilization;
+    }
+  }
+  if (selected.empty()) {
+    selected.push_back(least_loaded);
+  }
+  if (selected.size() < workers.size()) {
+    VLOG(1) << "Starting job " << job.job_id << " on " << selected.size()
+            << " of " << workers.size()
+            << " workers; the others are above the CPU utilization limit of "
+            << config_.max_worker_cpu_utilization();
+  }
+  return selected;
+}
+
 Status DataServiceDispatcherImpl::CreatePendingTask(
     std::shared_ptr<const Job> job, const std::string& worker_address)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -765,6 +840,8 @@ Status DataServiceDispatcherImpl::AssignTask(std::shared_ptr<const Task> task)
   if (task->job->num_consumers.has_value()) {
     task_def->set_num_consumers(task->job->num_consumers.value());
   }
+  task_def->set_use_cross_job_cache(UseCrossJobCache(*task->job));
+  *task_def->mutable_element_batching() = task->job->element_batching;
   ProcessTaskResponse resp;
   WorkerService::Stub* stub;
   TF_RETURN_IF_ERROR(GetOrCreateWorkerStub(task->worker_address, stub));
@@ -779,6 +856,17 @@ Status DataServiceDispatcherImpl::AssignTask(std::shared_ptr<const Task> task)
   return Status::OK();
 }
 
+bool DataServiceDispatcherImpl::UseCrossJobCache(
+    const DispatcherState::Job& job) const {
+  // Jobs reading the same dataset share its id, since datasets are registered
+  // by fingerprint. Distributed epoch jobs each receive their own splits, and
+  // round robin jobs need to control the order of their elements, so neither
+  // can share elements with other jobs.
+  return config_.enable_cross_job_cache() &&
+         job.processing_mode == ProcessingMode::PARALLEL_EPOCHS &&
+         !job.IsRoundRobin();
+}
+
 Status DataServiceDispatcherImpl::ClientHeartbeat(
     const ClientHeartbeatRequest* request, ClientHeartbeatResponse* response) {
   TF_RETURN_IF_ERROR(CheckStarted());
@@ -855,6 +943,7 @@ Status DataServiceDispatcherImpl::ClientHeartbeat(
     task_info->set_task_id(task->task_id);
     task_info->set_job_id(job->job_id);
     task_info->set_starting_round(task->starting_round);
+    *task_info->mutable_element_batching() = job->element_batching;
   }
   response->set_job_finished(job->finished);
   VLOG(4) << "Found " << response->task_info_size()
@@ -904,10 +993,39 @@ Status DataServiceDispatcherImpl::ApplyWithoutJournaling(const Update& update)
 
 Status DataServiceDispatcherImpl::Apply(const Update& update)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  if (journal_writer_.has_value()) {
-    TF_RETURN_IF_ERROR(journal_writer_.value()->Write(update));
+  if (!journal_writer_.has_value()) {
+    return state_.Apply(update);
   }
-  return state_.Apply(update);
+  TF_RETURN_IF_ERROR(journal_writer_.value()->Write(update));
+  TF_RETURN_IF_ERROR(state_.Apply(update));
+  int64 compaction_interval = config_.journal_compaction_interval();
+  if (compaction_interval == 0) {
+    compaction_interval = kDefaultJournalCompactionInterval;
+  }
+  if (compaction_interval > 0 &&
+      ++updates_since_compaction_ >= compaction_interval) {
+    // The update is already durable in the journal, so a failed compaction
+    // only delays the next one.
+    Status s = CompactJournal();
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to compact dispatcher journal: " << s;
+    }
+    updates_since_compaction_ = 0;
+  }
+  return Status::OK();
+}
+
+Status DataServiceDispatcherImpl::CompactJournal()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  int64 start_micros = env_->NowMicros();
+  DispatcherStateSnapshot snapshot;
+  state_.Snapshot(snapshot);
+  int64 num_jobs = snapshot.jobs_size();
+  TF_RETURN_IF_ERROR(journal_writer_.value()->Compact(std::move(snapshot)));
+  VLOG(1) << "Compacted " << updates_since_compaction_
+          << " journal updates into a snapshot of " << num_jobs << " jobs in "
+          << env_->NowMicros() - start_micros << " microseconds";
+  return Status::OK();
 }
 
 void DataServiceDispatcherImpl::JobGcThread() {
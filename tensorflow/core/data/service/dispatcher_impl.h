@@ -177,6 +177,7 @@ class DataServiceDispatcherImpl {
   Status CreateJob(int64 dataset_id, ProcessingMode processing_mode,
                    absl::optional<DispatcherState::NamedJobKey> named_job_key,
                    absl::optional<int64> num_consumers,
+                   const ElementBatchingDef& element_batching,
                    std::shared_ptr<const DispatcherState::Job>& job)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Creates tasks for the specified worker, one task for every unfinished job.
@@ -200,13 +201,21 @@ class DataServiceDispatcherImpl {
   Status AcquireJobClientId(
       const std::shared_ptr<const DispatcherState::Job>& job,
       int64& job_client_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
-  // Creates one task for each worker, for the given job. The created tasks are
-  // stored in `tasks`. This method only updates dispatcher metadata with the
-  // new tasks, but doesn't assign the tasks to the workers.
+  // Creates one task for each worker selected by `SelectWorkersForJob`, for
+  // the given job. The created tasks are stored in `tasks`. This method only
+  // updates dispatcher metadata with the new tasks, but doesn't assign the
+  // tasks to the workers.
   Status CreateTasksForJob(
       std::shared_ptr<const DispatcherState::Job> job,
       std::vector<std::shared_ptr<const DispatcherState::Task>>& tasks)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns the workers to run the tasks of a new job on. If
+  // `max_worker_cpu_utilization` is set, these are the workers whose last
+  // reported CPU utilization is below it, or the least loaded worker if there
+  // are none. Otherwise, and for round robin jobs, these are all workers.
+  std::vector<std::shared_ptr<const DispatcherState::Worker>>
+  SelectWorkersForJob(const DispatcherState::Job& job)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   // Creates a new task for a job. The created task may be either pending or
   // active.
@@ -237,6 +246,10 @@ class DataServiceDispatcherImpl {
   Status ValidateMatchingJob(std::shared_ptr<const DispatcherState::Job> job,
                              ProcessingMode processing_mode, int64 dataset_id)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns whether the tasks of `job` may share the elements they produce
+  // with the tasks of other jobs that read the same dataset on the same
+  // worker.
+  bool UseCrossJobCache(const DispatcherState::Job& job) const;
   // Checks that the dispatcher has started, returning UNAVAILABLE if it hasn't.
   Status CheckStarted() TF_LOCKS_EXCLUDED(mu_);
   // Records that a split was produced by a call to `GetSplit`.
@@ -244,6 +257,9 @@ class DataServiceDispatcherImpl {
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Applies a state update, updating both the journal and the in-memory state.
   Status Apply(const Update& update) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Replaces the journal with a snapshot of `state_`. Called by `Apply` every
+  // `DispatcherConfig.journal_compaction_interval` updates.
+  Status CompactJournal() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Applies a state update, but doesn't update the journal. Only meant to be
   // used when recovering state when the dispatcher starts.
   Status ApplyWithoutJournaling(const Update& update)
@@ -273,6 +289,10 @@ class DataServiceDispatcherImpl {
   // Cached worker stubs for communicating with workers.
   absl::flat_hash_map<std::string, std::unique_ptr<WorkerService::Stub>>
       worker_stubs_ TF_GUARDED_BY(mu_);
+  // The load last reported by each worker, keyed by worker address. Load is
+  // not journaled, since it is refreshed by every heartbeat.
+  absl::flat_hash_map<std::string, WorkerLoad> worker_loads_
+      TF_GUARDED_BY(mu_);
   // Store of dataset definitions.
   std::unique_ptr<DatasetStore> dataset_store_ TF_GUARDED_BY(mu_);
   // Mapping from job id to `SplitProvider`s for jobs with processing mode
@@ -289,6 +309,9 @@ class DataServiceDispatcherImpl {
   absl::optional<std::unique_ptr<JournalWriter>> journal_writer_
       TF_GUARDED_BY(mu_);
   DispatcherState state_ TF_GUARDED_BY(mu_);
+  // Number of journaled updates since the journal was last compacted,
+  // including the updates replayed from its tail on restart.
+  int64 updates_since_compaction_ TF_GUARDED_BY(mu_) = 0;
   // Condition variable for waking up the job gc thread.
   condition_variable job_gc_thread_cv_;
   std::unique_ptr<Thread> job_gc_thread_;
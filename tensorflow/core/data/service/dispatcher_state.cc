@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/dispatcher_state.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "tensorflow/core/data/service/journal.h"
@@ -23,6 +24,30 @@ limitations under the License.
 namespace tensorflow {
 namespace data {
 
+namespace {
+// Returns the keys of `map` in sorted order, so that snapshots of equal states
+// are equal.
+template <typename Map>
+std::vector<typename Map::key_type> SortedKeys(const Map& map) {
+  std::vector<typename Map::key_type> keys;
+  keys.reserve(map.size());
+  for (const auto& it : map) {
+    keys.push_back(it.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+void SnapshotTask(const DispatcherState::Task& task, TaskSnapshot& snapshot) {
+  snapshot.set_task_id(task.task_id);
+  snapshot.set_worker_address(task.worker_address);
+  snapshot.set_transfer_address(task.transfer_address);
+  snapshot.set_starting_round(task.starting_round);
+  snapshot.set_finished(task.finished);
+  snapshot.set_removed(task.removed);
+}
+}  // namespace
+
 DispatcherState::DispatcherState() {}
 
 Status DispatcherState::Apply(const Update& update) {
@@ -106,7 +131,8 @@ void DispatcherState::CreateJob(const CreateJobUpdate& create_job) {
   }
   auto job = std::make_shared<Job>(job_id, create_job.dataset_id(),
                                    ProcessingMode(create_job.processing_mode()),
-                                   named_job_key, num_consumers);
+                                   named_job_key, num_consumers,
+                                   create_job.element_batching());
   DCHECK(!jobs_.contains(job_id));
   jobs_[job_id] = job;
   tasks_by_job_[job_id] = std::vector<std::shared_ptr<Task>>();
@@ -249,6 +275,163 @@ void DispatcherState::FinishTask(const FinishTaskUpdate& finish_task) {
   jobs_[task->job->job_id]->finished = all_finished;
 }
 
+void DispatcherState::Snapshot(DispatcherStateSnapshot& snapshot) const {
+  snapshot.Clear();
+  snapshot.set_next_available_dataset_id(next_available_dataset_id_);
+  snapshot.set_next_available_job_id(next_available_job_id_);
+  snapshot.set_next_available_job_client_id(next_available_job_client_id_);
+  snapshot.set_next_available_task_id(next_available_task_id_);
+  for (int64 dataset_id : SortedKeys(datasets_by_id_)) {
+    const Dataset& dataset = *datasets_by_id_.at(dataset_id);
+    RegisterDatasetUpdate* dataset_snapshot = snapshot.add_datasets();
+    dataset_snapshot->set_dataset_id(dataset.dataset_id);
+    dataset_snapshot->set_fingerprint(dataset.fingerprint);
+  }
+  for (const std::string& address : SortedKeys(workers_)) {
+    RegisterWorkerUpdate* worker_snapshot = snapshot.add_workers();
+    worker_snapshot->set_worker_address(address);
+    worker_snapshot->set_transfer_address(
+        workers_.at(address)->transfer_address);
+  }
+  for (int64 job_id : SortedKeys(jobs_)) {
+    const Job& job = *jobs_.at(job_id);
+    // Garbage collected anonymous jobs can't be referenced again, so they are
+    // dropped. Garbage collected named jobs are kept, without their tasks, so
+    // that the dispatcher keeps rejecting reuse of their names.
+    if (job.garbage_collected && !job.named_job_key.has_value()) {
+      continue;
+    }
+    JobSnapshot* job_snapshot = snapshot.add_jobs();
+    CreateJobUpdate* create_job = job_snapshot->mutable_create_job();
+    create_job->set_job_id(job.job_id);
+    create_job->set_dataset_id(job.dataset_id);
+    create_job->set_processing_mode(ProcessingModeDef(job.processing_mode));
+    if (job.named_job_key.has_value()) {
+      NamedJobKeyDef* key = create_job->mutable_named_job_key();
+      key->set_name(job.named_job_key->name);
+      key->set_index(job.named_job_key->index);
+    }
+    if (job.num_consumers.has_value()) {
+      create_job->set_num_consumers(job.num_consumers.value());
+    }
+    *create_job->mutable_element_batching() = job.element_batching;
+    if (job.distributed_epoch_state.has_value()) {
+      job_snapshot->set_repetition(job.distributed_epoch_state->repetition);
+      job_snapshot->set_split_provider_index(
+          job.distributed_epoch_state->split_provider_index);
+    }
+    job_snapshot->set_num_clients(job.num_clients);
+    job_snapshot->set_last_client_released_micros(
+        job.last_client_released_micros);
+    job_snapshot->set_finished(job.finished);
+    job_snapshot->set_garbage_collected(job.garbage_collected);
+    if (job.garbage_collected) {
+      continue;
+    }
+    for (const auto& task : tasks_by_job_.at(job_id)) {
+      SnapshotTask(*task, *job_snapshot->add_tasks());
+    }
+    std::queue<PendingTask> pending_tasks = job.pending_tasks;
+    while (!pending_tasks.empty()) {
+      const PendingTask& pending_task = pending_tasks.front();
+      PendingTaskSnapshot* pending_snapshot = job_snapshot->add_pending_tasks();
+      SnapshotTask(*pending_task.task, *pending_snapshot->mutable_task());
+      pending_snapshot->set_target_round(pending_task.target_round);
+      std::vector<int64> ready_consumers(pending_task.ready_consumers.begin(),
+                                         pending_task.ready_consumers.end());
+      std::sort(ready_consumers.begin(), ready_consumers.end());
+      for (int64 job_client_id : ready_consumers) {
+        pending_snapshot->add_ready_consumers(job_client_id);
+      }
+      pending_snapshot->set_failures(pending_task.failures);
+      pending_tasks.pop();
+    }
+  }
+  for (int64 job_client_id : SortedKeys(jobs_for_client_ids_)) {
+    const std::shared_ptr<Job>& job = jobs_for_client_ids_.at(job_client_id);
+    // `JobForJobClientId` may insert null entries for unknown clients.
+    if (!job) {
+      continue;
+    }
+    AcquireJobClientUpdate* job_client = snapshot.add_job_clients();
+    job_client->set_job_id(job->job_id);
+    job_client->set_job_client_id(job_client_id);
+  }
+}
+
+Status DispatcherState::Restore(const DispatcherStateSnapshot& snapshot) {
+  if (!datasets_by_id_.empty() || !workers_.empty() || !jobs_.empty()) {
+    return errors::FailedPrecondition(
+        "Dispatcher state can only be restored from a snapshot before any "
+        "update is applied.");
+  }
+  for (const auto& dataset : snapshot.datasets()) {
+    RegisterDataset(dataset);
+  }
+  for (const auto& worker : snapshot.workers()) {
+    RegisterWorker(worker);
+  }
+  for (const auto& job_snapshot : snapshot.jobs()) {
+    CreateJob(job_snapshot.create_job());
+    int64 job_id = job_snapshot.create_job().job_id();
+    std::shared_ptr<Job> job = jobs_[job_id];
+    if (job->distributed_epoch_state.has_value()) {
+      job->distributed_epoch_state->repetition = job_snapshot.repetition();
+      job->distributed_epoch_state->split_provider_index =
+          job_snapshot.split_provider_index();
+    }
+    job->num_clients = job_snapshot.num_clients();
+    job->last_client_released_micros =
+        job_snapshot.last_client_released_micros();
+    job->finished = job_snapshot.finished();
+    job->garbage_collected = job_snapshot.garbage_collected();
+    for (const auto& task_snapshot : job_snapshot.tasks()) {
+      tasks_by_job_[job_id].push_back(RestoreTask(job, task_snapshot));
+    }
+    for (const auto& pending_snapshot : job_snapshot.pending_tasks()) {
+      PendingTask pending_task(RestoreTask(job, pending_snapshot.task()),
+                               pending_snapshot.target_round());
+      pending_task.ready_consumers.insert(
+          pending_snapshot.ready_consumers().begin(),
+          pending_snapshot.ready_consumers().end());
+      pending_task.failures = pending_snapshot.failures();
+      job->pending_tasks.push(std::move(pending_task));
+    }
+  }
+  for (const auto& job_client : snapshot.job_clients()) {
+    jobs_for_client_ids_[job_client.job_client_id()] =
+        jobs_[job_client.job_id()];
+  }
+  next_available_dataset_id_ = std::max(next_available_dataset_id_,
+                                        snapshot.next_available_dataset_id());
+  next_available_job_id_ =
+      std::max(next_available_job_id_, snapshot.next_available_job_id());
+  next_available_job_client_id_ =
+      std::max(next_available_job_client_id_,
+               snapshot.next_available_job_client_id());
+  next_available_task_id_ =
+      std::max(next_available_task_id_, snapshot.next_available_task_id());
+  return Status::OK();
+}
+
+std::shared_ptr<DispatcherState::Task> DispatcherState::RestoreTask(
+    const std::shared_ptr<Job>& job, const TaskSnapshot& task_snapshot) {
+  auto task = std::make_shared<Task>(task_snapshot.task_id(), job,
+                                     task_snapshot.worker_address(),
+                                     task_snapshot.transfer_address());
+  task->starting_round = task_snapshot.starting_round();
+  task->finished = task_snapshot.finished();
+  task->removed = task_snapshot.removed();
+  if (task->removed) {
+    return task;
+  }
+  tasks_[task->task_id] = task;
+  if (!task->finished) {
+    tasks_by_worker_[task->worker_address][task->task_id] = task;
+  }
+  return task;
+}
+
 int64 DispatcherState::NextAvailableDatasetId() const {
   return next_available_dataset_id_;
 }
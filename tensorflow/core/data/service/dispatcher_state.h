@@ -60,6 +60,15 @@ class DispatcherState {
   // Applies the given update to the dispatcher's state.
   Status Apply(const Update& update);
 
+  // Stores a snapshot of the dispatcher's state in `snapshot`. Applying the
+  // snapshot with `Restore` reproduces the current state, without replaying
+  // the updates that led to it. Garbage collected jobs are compacted away:
+  // anonymous ones are dropped, and named ones are kept without their tasks.
+  void Snapshot(DispatcherStateSnapshot& snapshot) const;
+  // Restores the dispatcher's state from `snapshot`. Returns
+  // FAILED_PRECONDITION if any update has already been applied.
+  Status Restore(const DispatcherStateSnapshot& snapshot);
+
   // A dataset registered with the dispatcher.
   struct Dataset {
     explicit Dataset(int64 dataset_id, int64 fingerprint)
@@ -125,12 +134,14 @@ class DispatcherState {
   struct Job {
     explicit Job(int64 job_id, int64 dataset_id, ProcessingMode processing_mode,
                  absl::optional<NamedJobKey> named_job_key,
-                 absl::optional<int64> num_consumers)
+                 absl::optional<int64> num_consumers,
+                 const ElementBatchingDef& element_batching)
         : job_id(job_id),
           dataset_id(dataset_id),
           processing_mode(processing_mode),
           named_job_key(named_job_key),
-          num_consumers(num_consumers) {
+          num_consumers(num_consumers),
+          element_batching(element_batching) {
       if (processing_mode == ProcessingMode::DISTRIBUTED_EPOCH) {
         distributed_epoch_state = DistributedEpochState();
       }
@@ -152,6 +163,7 @@ class DispatcherState {
     const absl::optional<NamedJobKey> named_job_key;
     absl::optional<DistributedEpochState> distributed_epoch_state;
     absl::optional<int64> num_consumers;
+    const ElementBatchingDef element_batching;
     std::queue<PendingTask> pending_tasks;
     int64 num_clients = 0;
     int64 last_client_released_micros = -1;
@@ -237,6 +249,10 @@ class DispatcherState {
   void ClientHeartbeat(const ClientHeartbeatUpdate& client_heartbeat);
   void CreateTask(const CreateTaskUpdate& create_task);
   void FinishTask(const FinishTaskUpdate& finish_task);
+  // Recreates a task of `job` from its snapshot, without adding it to the
+  // job's tasks.
+  std::shared_ptr<Task> RestoreTask(const std::shared_ptr<Job>& job,
+                                    const TaskSnapshot& task_snapshot);
 
   int64 next_available_dataset_id_ = 1000;
   // Registered datasets, keyed by dataset ids.
@@ -46,6 +46,7 @@ void GrpcWorkerImpl::Stop() { impl_.Stop(); }
   }
 HANDLER(ProcessTask);
 HANDLER(GetElement);
+HANDLER(GetElements);
 HANDLER(GetWorkerTasks);
 #undef HANDLER
 
@@ -50,6 +50,7 @@ class GrpcWorkerImpl : public WorkerService::Service {
                         method##Response* response) override;
   HANDLER(ProcessTask);
   HANDLER(GetElement);
+  HANDLER(GetElements);
   HANDLER(GetWorkerTasks);
 #undef HANDLER
 
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/journal.h"
 
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/record_writer.h"
@@ -29,6 +30,12 @@ namespace data {
 
 namespace {
 constexpr StringPiece kJournal = "journal";
+constexpr char kSnapshot[] = "snapshot";
+constexpr char kSnapshotTmp[] = "snapshot.tmp";
+
+bool IsJournalFile(const std::string& filename) {
+  return absl::StartsWith(filename, absl::StrCat(kJournal, "_"));
+}
 
 Status ParseSequenceNumber(const std::string& journal_file,
                            int64* sequence_number) {
@@ -46,6 +53,10 @@ std::string DataServiceJournalFile(const std::string& journal_dir,
                       absl::StrCat(kJournal, "_", sequence_number));
 }
 
+std::string DataServiceJournalSnapshotFile(const std::string& journal_dir) {
+  return io::JoinPath(journal_dir, kSnapshot);
+}
+
 FileJournalWriter::FileJournalWriter(Env* env, const std::string& journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -58,14 +69,22 @@ Status FileJournalWriter::EnsureInitialized() {
   TF_RETURN_IF_ERROR(env_->GetChildren(journal_dir_, &journal_files));
   int64 latest_sequence_number = -1;
   for (const auto& file : journal_files) {
+    if (!IsJournalFile(file)) {
+      continue;
+    }
     int64 sequence_number;
     TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
     latest_sequence_number = std::max(latest_sequence_number, sequence_number);
   }
+  return OpenFile(latest_sequence_number + 1);
+}
+
+Status FileJournalWriter::OpenFile(int64 sequence_number) {
   std::string journal_file =
-      DataServiceJournalFile(journal_dir_, latest_sequence_number + 1);
+      DataServiceJournalFile(journal_dir_, sequence_number);
   TF_RETURN_IF_ERROR(env_->NewAppendableFile(journal_file, &file_));
   writer_ = absl::make_unique<io::RecordWriter>(file_.get());
+  sequence_number_ = sequence_number;
   VLOG(1) << "Created journal writer to write to " << journal_file;
   return Status::OK();
 }
@@ -86,6 +105,46 @@ Status FileJournalWriter::Write(const Update& update) {
   return Status::OK();
 }
 
+Status FileJournalWriter::Compact(DispatcherStateSnapshot snapshot) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  // Updates written from now on go to a new journal file, so that the snapshot
+  // covers whole journal files. Every write is already synced, so the old file
+  // can be closed without flushing.
+  writer_.reset();
+  file_.reset();
+  TF_RETURN_IF_ERROR(OpenFile(sequence_number_ + 1));
+  snapshot.set_journal_sequence_number(sequence_number_);
+  std::string s = snapshot.SerializeAsString();
+  if (s.empty()) {
+    return errors::Internal("Failed to serialize dispatcher state snapshot");
+  }
+  std::string tmp_file = io::JoinPath(journal_dir_, kSnapshotTmp);
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(tmp_file, &file));
+    TF_RETURN_IF_ERROR(file->Append(s));
+    TF_RETURN_IF_ERROR(file->Sync());
+    TF_RETURN_IF_ERROR(file->Close());
+  }
+  TF_RETURN_IF_ERROR(
+      env_->RenameFile(tmp_file, DataServiceJournalSnapshotFile(journal_dir_)));
+  std::vector<std::string> journal_files;
+  TF_RETURN_IF_ERROR(env_->GetChildren(journal_dir_, &journal_files));
+  for (const auto& file : journal_files) {
+    if (!IsJournalFile(file)) {
+      continue;
+    }
+    int64 sequence_number;
+    TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
+    if (sequence_number < sequence_number_) {
+      TF_RETURN_IF_ERROR(env_->DeleteFile(io::JoinPath(journal_dir_, file)));
+    }
+  }
+  VLOG(1) << "Compacted journal " << journal_dir_ << " into a "
+          << s.size() << " byte snapshot";
+  return Status::OK();
+}
+
 FileJournalReader::FileJournalReader(Env* env, StringPiece journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -93,7 +152,24 @@ Status FileJournalReader::EnsureInitialized() {
   if (reader_) {
     return Status::OK();
   }
-  return UpdateFile(DataServiceJournalFile(journal_dir_, 0));
+  if (!read_snapshot_ &&
+      env_->FileExists(DataServiceJournalSnapshotFile(journal_dir_)).ok()) {
+    return errors::FailedPrecondition(
+        "Journal ", journal_dir_,
+        " has been compacted; its snapshot must be read before its updates.");
+  }
+  return UpdateFile(DataServiceJournalFile(journal_dir_, sequence_number_));
+}
+
+Status FileJournalReader::ReadSnapshot(DispatcherStateSnapshot& snapshot) {
+  std::string snapshot_file = DataServiceJournalSnapshotFile(journal_dir_);
+  TF_RETURN_IF_ERROR(env_->FileExists(snapshot_file));
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env_, snapshot_file, &snapshot));
+  sequence_number_ = snapshot.journal_sequence_number();
+  read_snapshot_ = true;
+  VLOG(1) << "Read journal snapshot " << snapshot_file
+          << ", covering journal files before " << sequence_number_;
+  return Status::OK();
 }
 
 Status FileJournalReader::Read(Update& update, bool& end_of_journal) {
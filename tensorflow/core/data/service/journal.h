@@ -28,12 +28,18 @@ namespace data {
 std::string DataServiceJournalFile(const std::string& journal_dir,
                                    int64 sequence_number);
 
+// Returns the location of the snapshot file within the journal directory.
+std::string DataServiceJournalSnapshotFile(const std::string& journal_dir);
+
 // Interface for writing to a journal.
 class JournalWriter {
  public:
   virtual ~JournalWriter() = default;
   // Writes and syncs an update to the journal.
   virtual Status Write(const Update& update) = 0;
+  // Replaces all updates written so far with `snapshot`, which must reflect
+  // the state after applying them.
+  virtual Status Compact(DispatcherStateSnapshot snapshot) = 0;
   // Initializes the writer if it is not yet initialized.
   virtual Status EnsureInitialized() = 0;
 };
@@ -45,6 +51,7 @@ class JournalWriter {
 // directory is laid out in the following format:
 //
 // journal_dir/
+//   snapshot
 //   journal_0
 //   journal_1
 //   ...
@@ -54,6 +61,12 @@ class JournalWriter {
 // "journal_0", "journal_1", and "journal_2", the writer will write to
 // "journal_3". The writer will flush updates as they are written, so that they
 // can be stored durably in case of machine failure.
+//
+// `Compact` starts a new journal file, atomically replaces the snapshot file
+// with a snapshot that covers all earlier journal files, and then deletes
+// them. If the writer fails part way through, the old snapshot or journal
+// files it leaves behind are ignored by readers, and deleted by the next
+// compaction.
 class FileJournalWriter : public JournalWriter {
  public:
   // Creates a journal writer to write to the given journal directory.
@@ -64,11 +77,17 @@ class FileJournalWriter : public JournalWriter {
   FileJournalWriter& operator=(const FileJournalWriter&) = delete;
 
   Status Write(const Update& update) override;
+  Status Compact(DispatcherStateSnapshot snapshot) override;
   Status EnsureInitialized() override;
 
  private:
+  // Opens the journal file with the given sequence number for writing.
+  Status OpenFile(int64 sequence_number);
+
   Env* env_;
   const std::string journal_dir_;
+  // Sequence number of the journal file being written.
+  int64 sequence_number_ = -1;
   std::unique_ptr<WritableFile> file_;
   std::unique_ptr<io::RecordWriter> writer_;
 };
@@ -87,12 +106,18 @@ class JournalReader {
 //
 // The journal reader reads through all journal files in the configured journal
 // directory, in order of their sequence numbers. See FileJournalWriter above.
+//
+// If the journal has been compacted, `ReadSnapshot` must be called before
+// `Read`, which then only returns the updates written after the snapshot.
 class FileJournalReader : public JournalReader {
  public:
   explicit FileJournalReader(Env* env, StringPiece journal_dir);
   FileJournalReader(const FileJournalReader&) = delete;
   FileJournalReader& operator=(const FileJournalReader&) = delete;
 
+  // Reads the snapshot of the last compaction into `snapshot`. Returns
+  // NOT_FOUND if the journal has never been compacted.
+  Status ReadSnapshot(DispatcherStateSnapshot& snapshot);
   Status Read(Update& update, bool& end_of_journal) override;
 
  private:
@@ -105,6 +130,8 @@ class FileJournalReader : public JournalReader {
   const std::string journal_dir_;
   // Sequence number of current journal file.
   int64 sequence_number_ = 0;
+  // Whether `ReadSnapshot` found a snapshot.
+  bool read_snapshot_ = false;
   // Current offset into `file_`.
   uint64 offset_ = 0;
   std::unique_ptr<RandomAccessFile> file_;
@@ -61,9 +61,21 @@ Update MakeRegisterDatasetUpdate() {
   return update;
 }
 
+DispatcherStateSnapshot MakeSnapshot() {
+  DispatcherStateSnapshot snapshot;
+  snapshot.set_next_available_dataset_id(3);
+  *snapshot.add_datasets() = MakeRegisterDatasetUpdate().register_dataset();
+  return snapshot;
+}
+
 Status CheckJournalContent(StringPiece journal_dir,
                            const std::vector<Update>& expected) {
   FileJournalReader reader(Env::Default(), journal_dir);
+  DispatcherStateSnapshot snapshot;
+  Status s = reader.ReadSnapshot(snapshot);
+  if (!errors::IsNotFound(s)) {
+    TF_RETURN_IF_ERROR(s);
+  }
   for (const auto& update : expected) {
     Update result;
     bool end_of_journal = true;
@@ -109,6 +121,83 @@ TEST(Journal, AppendExistingJournal) {
   TF_EXPECT_OK(CheckJournalContent(journal_dir, updates));
 }
 
+TEST(Journal, CompactDropsCoveredUpdates) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+  TF_EXPECT_OK(writer.Write(MakeCreateJobUpdate()));
+  TF_EXPECT_OK(writer.Compact(MakeSnapshot()));
+  TF_EXPECT_OK(writer.Write(MakeFinishTaskUpdate()));
+
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, {MakeFinishTaskUpdate()}));
+  EXPECT_TRUE(errors::IsNotFound(Env::Default()->FileExists(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/0))));
+  FileJournalReader reader(Env::Default(), journal_dir);
+  DispatcherStateSnapshot snapshot;
+  TF_ASSERT_OK(reader.ReadSnapshot(snapshot));
+  EXPECT_EQ(snapshot.journal_sequence_number(), 1);
+  DispatcherStateSnapshot expected = MakeSnapshot();
+  expected.set_journal_sequence_number(1);
+  EXPECT_EQ(snapshot.SerializeAsString(), expected.SerializeAsString());
+}
+
+TEST(Journal, CompactTwice) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+  TF_EXPECT_OK(writer.Compact(MakeSnapshot()));
+  TF_EXPECT_OK(writer.Write(MakeCreateJobUpdate()));
+  TF_EXPECT_OK(writer.Compact(MakeSnapshot()));
+
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, {}));
+  std::vector<std::string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(journal_dir, &files));
+  EXPECT_THAT(files, ::testing::UnorderedElementsAre("snapshot", "journal_2"));
+}
+
+TEST(Journal, AppendCompactedJournal) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+    TF_EXPECT_OK(writer.Compact(MakeSnapshot()));
+    TF_EXPECT_OK(writer.Write(MakeCreateJobUpdate()));
+  }
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeFinishTaskUpdate()));
+
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeCreateJobUpdate(), MakeFinishTaskUpdate()}));
+}
+
+TEST(Journal, ReadCompactedJournalWithoutSnapshot) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Compact(MakeSnapshot()));
+  TF_EXPECT_OK(writer.Write(MakeCreateJobUpdate()));
+
+  FileJournalReader reader(Env::Default(), journal_dir);
+  Update result;
+  bool end_of_journal = true;
+  Status s = reader.Read(result, end_of_journal);
+  EXPECT_EQ(s.code(), error::FAILED_PRECONDITION);
+}
+
+TEST(Journal, MissingSnapshot) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeCreateJobUpdate()));
+
+  FileJournalReader reader(Env::Default(), journal_dir);
+  DispatcherStateSnapshot snapshot;
+  EXPECT_TRUE(errors::IsNotFound(reader.ReadSnapshot(snapshot)));
+}
+
 TEST(Journal, MissingFile) {
   std::string journal_dir;
   EXPECT_TRUE(NewJournalDir(journal_dir));
@@ -140,13 +140,24 @@ Status WorkerGrpcDataServer::StartServiceInternal() {
   std::string transfer_address = worker_address;
   std::string transfer_protocol = config_.data_transfer_protocol();
   if (!transfer_protocol.empty() && transfer_protocol != "grpc") {
+    DataTransferServer::Config transfer_config;
+    transfer_config.shared_memory_buffer_size_bytes =
+        config_.shared_memory_transfer_buffer_size_bytes();
     TF_RETURN_IF_ERROR(DataTransferServer::Build(
-        transfer_protocol, service_->get_element_getter(), &transfer_server_));
+        transfer_protocol, service_->get_element_getter(), transfer_config,
+        &transfer_server_));
     TF_RETURN_IF_ERROR(transfer_server_->Start());
     LOG(INFO) << "Data transfer server started at 0.0.0.0:"
               << transfer_server_->get_port();
+    std::string transfer_address_template = config_.data_transfer_address();
+    if (transfer_address_template.empty()) {
+      // Serve data transfers from the host of the worker.
+      transfer_address_template =
+          absl::StrCat(worker_address.substr(0, worker_address.rfind(':')),
+                       ":", kPortPlaceholder);
+    }
     transfer_address = str_util::StringReplace(
-        config_.data_transfer_address(), kPortPlaceholder,
+        transfer_address_template, kPortPlaceholder,
         absl::StrCat(transfer_server_->get_port()),
         /*replace_all=*/false);
   }
@@ -0,0 +1,637 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shared_memory_transfer.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(_WIN32)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/error.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// POSIX shared memory and sockets are not available on Windows, where the
+// protocol is not registered.
+#if !defined(_WIN32)
+namespace {
+
+constexpr int64 kDefaultBufferSizeBytes = 8 << 20;
+
+// The shared memory buffer of a connection is a ring of `kNumSlots` slots,
+// preceded by the state of each slot. The server serializes each response into
+// the next free slot and marks it in use. The client marks the slot free again
+// once it has parsed the response, which it does outside of the lock of the
+// control channel, so that concurrent readers of a worker copy their elements
+// out of shared memory in parallel.
+constexpr int kNumSlots = 4;
+constexpr size_t kSlotAlignment = 64;
+constexpr size_t kSlotStatesSize = kSlotAlignment;
+constexpr uint32 kSlotFree = 0;
+constexpr uint32 kSlotInUse = 1;
+static_assert(kNumSlots * sizeof(std::atomic<uint32>) <= kSlotStatesSize,
+              "The slot states do not fit before the first slot.");
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "Slot states are shared between processes, so they must be "
+              "lock free.");
+
+// The header of each response sent over the control channel. If `code` is not
+// OK, the error message follows on the control channel. Otherwise, the
+// serialized `GetElementResponse` is in slot `slot` of the shared memory
+// buffer if `slot` is not negative, and follows on the control channel if it
+// is.
+struct ResponseHeader {
+  int32 code;
+  int32 slot;
+  uint64 size;
+};
+
+// Allocates the `size` bytes of the shared memory segment `fd`. Growing the
+// segment with ftruncate() alone does not allocate its pages, so running out of
+// memory for them would raise SIGBUS when a response is written to the buffer
+// instead of failing here.
+int AllocateSharedMemory(int fd, size_t size) {
+#if defined(__linux__)
+  int error;
+  do {
+    error = posix_fallocate(fd, 0, size);
+  } while (error == EINTR);
+  return error;
+#else
+  return ftruncate(fd, size) == 0 ? 0 : errno;
+#endif
+}
+
+Status WriteFully(int fd, const void* data, size_t size) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return IOError("Failed to write to the shared memory transfer channel",
+                     errno);
+    }
+    p += n;
+    size -= n;
+  }
+  return Status::OK();
+}
+
+Status ReadFully(int fd, void* data, size_t size) {
+  char* p = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t n = recv(fd, p, size, /*flags=*/0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return IOError("Failed to read from the shared memory transfer channel",
+                     errno);
+    }
+    if (n == 0) {
+      return errors::Unavailable(
+          "The shared memory transfer channel was closed.");
+    }
+    p += n;
+    size -= n;
+  }
+  return Status::OK();
+}
+
+// Writes `data` prefixed with its size.
+Status WriteString(int fd, const std::string& data) {
+  const uint64 size = data.size();
+  TF_RETURN_IF_ERROR(WriteFully(fd, &size, sizeof(size)));
+  return WriteFully(fd, data.data(), data.size());
+}
+
+// Reads a string written by `WriteString()`.
+Status ReadString(int fd, std::string* data) {
+  uint64 size;
+  TF_RETURN_IF_ERROR(ReadFully(fd, &size, sizeof(size)));
+  data->resize(size);
+  return ReadFully(fd, &(*data)[0], size);
+}
+
+// A POSIX shared memory segment mapped into this process.
+class SharedMemoryBuffer {
+ public:
+  // Creates a segment of `size` bytes and maps it. The segment is unlinked when
+  // the buffer is destroyed, unless `Unlink()` was called.
+  static Status Create(size_t size, std::unique_ptr<SharedMemoryBuffer>* out) {
+    const std::string name =
+        absl::StrCat("/tf_data_shm_", getpid(), "_", random::New64());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+      return IOError(absl::StrCat("Failed to create shared memory ", name),
+                     errno);
+    }
+    auto buffer = absl::WrapUnique(new SharedMemoryBuffer(name, size));
+    buffer->linked_ = true;
+    Status s;
+    const int error = AllocateSharedMemory(fd, size);
+    if (error != 0) {
+      s = IOError(absl::StrCat("Failed to allocate ", size,
+                               " bytes of shared memory ", name),
+                  error);
+    } else {
+      s = buffer->Map(fd);
+    }
+    close(fd);
+    TF_RETURN_IF_ERROR(s);
+    *out = std::move(buffer);
+    return Status::OK();
+  }
+
+  // Maps the existing segment `name` of `size` bytes.
+  static Status Open(const std::string& name, size_t size,
+                     std::unique_ptr<SharedMemoryBuffer>* out) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      return IOError(absl::StrCat("Failed to open shared memory ", name),
+                     errno);
+    }
+    auto buffer = absl::WrapUnique(new SharedMemoryBuffer(name, size));
+    Status s = buffer->Map(fd);
+    close(fd);
+    TF_RETURN_IF_ERROR(s);
+    *out = std::move(buffer);
+    return Status::OK();
+  }
+
+  ~SharedMemoryBuffer() {
+    if (data_ != nullptr) munmap(data_, size_);
+    Unlink();
+  }
+
+  // Removes the name of the segment. Its memory is released once every
+  // process that mapped it has unmapped it.
+  void Unlink() {
+    if (linked_) {
+      shm_unlink(name_.c_str());
+      linked_ = false;
+    }
+  }
+
+  const std::string& name() const { return name_; }
+  size_t size() const { return size_; }
+
+  // The size of each slot of the ring, in bytes.
+  size_t slot_size() const {
+    if (size_ <= kSlotStatesSize) return 0;
+    return (size_ - kSlotStatesSize) / kNumSlots / kSlotAlignment *
+           kSlotAlignment;
+  }
+  char* slot(int i) const {
+    return data_ + kSlotStatesSize + static_cast<size_t>(i) * slot_size();
+  }
+
+  // Returns a free slot and marks it in use, or returns -1 if every slot is in
+  // use. Only the server acquires slots.
+  int AcquireSlot() {
+    for (int i = 0; i < kNumSlots; ++i) {
+      const int candidate = (next_slot_ + i) % kNumSlots;
+      if (slot_state(candidate).load(std::memory_order_acquire) ==
+          kSlotFree) {
+        slot_state(candidate).store(kSlotInUse, std::memory_order_relaxed);
+        next_slot_ = (candidate + 1) % kNumSlots;
+        return candidate;
+      }
+    }
+    return -1;
+  }
+
+  // Marks slot `i` free once its response has been read.
+  void ReleaseSlot(int i) {
+    slot_state(i).store(kSlotFree, std::memory_order_release);
+  }
+
+ private:
+  SharedMemoryBuffer(std::string name, size_t size)
+      : name_(std::move(name)), size_(size) {}
+
+  // New segments are zero-filled, so every slot starts free.
+  std::atomic<uint32>& slot_state(int i) const {
+    return reinterpret_cast<std::atomic<uint32>*>(data_)[i];
+  }
+
+  Status Map(int fd) {
+    void* data =
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      return IOError(absl::StrCat("Failed to map shared memory ", name_),
+                     errno);
+    }
+    data_ = static_cast<char*>(data);
+    return Status::OK();
+  }
+
+  const std::string name_;
+  const size_t size_;
+  char* data_ = nullptr;
+  bool linked_ = false;
+  int next_slot_ = 0;
+};
+
+class SharedMemoryTransferServer : public DataTransferServer {
+ public:
+  SharedMemoryTransferServer(GetElementT get_element, const Config& config)
+      : get_element_(std::move(get_element)),
+        buffer_size_(config.shared_memory_buffer_size_bytes > 0
+                         ? config.shared_memory_buffer_size_bytes
+                         : kDefaultBufferSizeBytes) {}
+
+  ~SharedMemoryTransferServer() override {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      // Unblock the threads waiting in accept() and recv().
+      if (listen_fd_ >= 0) shutdown(listen_fd_, SHUT_RDWR);
+      for (const auto& connection : connections_) {
+        shutdown(connection->fd, SHUT_RDWR);
+      }
+    }
+    accept_thread_.reset();
+    std::vector<std::unique_ptr<Connection>> connections;
+    {
+      mutex_lock l(mu_);
+      connections = std::move(connections_);
+    }
+    connections.clear();
+    if (listen_fd_ >= 0) close(listen_fd_);
+  }
+
+  Status Start() override {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      return IOError("Failed to create the shared memory transfer socket",
+                     errno);
+    }
+    // Only clients on the local host can use the shared memory, so the
+    // control channel does not accept remote connections.
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0 ||
+        listen(listen_fd_, SOMAXCONN) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr),
+                    &addr_len) != 0) {
+      return IOError("Failed to listen for shared memory transfer clients",
+                     errno);
+    }
+    port_ = ntohs(addr.sin_port);
+    accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_shm_transfer_accept", [this] { AcceptLoop(); }));
+    return Status::OK();
+  }
+
+  int get_port() override { return port_; }
+
+ private:
+  // The state of a connected client.
+  struct Connection {
+    ~Connection() {
+      thread.reset();
+      close(fd);
+    }
+
+    int fd = -1;
+    std::unique_ptr<SharedMemoryBuffer> buffer;
+    std::unique_ptr<Thread> thread;
+    // Set once `thread` is about to return.
+    bool finished = false;
+  };
+
+  void AcceptLoop() {
+    while (true) {
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0 && errno == EINTR) continue;
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        if (fd >= 0) close(fd);
+        return;
+      }
+      if (fd < 0) {
+        LOG(ERROR) << "Shared memory transfer server stopped accepting "
+                   << "clients: " << strerror(errno);
+        return;
+      }
+      // Release the connections of the clients that have disconnected.
+      connections_.erase(
+          std::remove_if(connections_.begin(), connections_.end(),
+                         [](const std::unique_ptr<Connection>& connection) {
+                           return connection->finished;
+                         }),
+          connections_.end());
+      auto connection = absl::make_unique<Connection>();
+      connection->fd = fd;
+      Connection* c = connection.get();
+      c->thread = absl::WrapUnique(Env::Default()->StartThread(
+          {}, "tf_data_shm_transfer", [this, c] { Serve(c); }));
+      connections_.push_back(std::move(connection));
+    }
+  }
+
+  void Serve(Connection* c) {
+    Status s = Handshake(c);
+    while (s.ok()) {
+      std::string request;
+      s = ReadString(c->fd, &request);
+      if (s.ok()) {
+        s = Respond(c, request);
+      }
+    }
+    VLOG(1) << "Closing shared memory transfer connection: " << s;
+    mutex_lock l(mu_);
+    c->finished = true;
+  }
+
+  // Creates the buffer of the client and tells it where to find it. The
+  // buffer is unlinked once the client has tried to map it, so that it is
+  // released when either side exits. If the buffer cannot be allocated, the
+  // client is told so with an empty name, and if the client cannot map it, it
+  // says so in its acknowledgement. Either way, all responses are then sent
+  // over the control channel.
+  Status Handshake(Connection* c) {
+    Status s = SharedMemoryBuffer::Create(buffer_size_, &c->buffer);
+    if (!s.ok()) {
+      LOG(WARNING) << "Sending shared memory transfer responses over the "
+                   << "control channel: " << s;
+      c->buffer.reset();
+    }
+    TF_RETURN_IF_ERROR(WriteString(c->fd, c->buffer ? c->buffer->name() : ""));
+    const uint64 size = c->buffer ? c->buffer->size() : 0;
+    TF_RETURN_IF_ERROR(WriteFully(c->fd, &size, sizeof(size)));
+    char mapped;
+    TF_RETURN_IF_ERROR(ReadFully(c->fd, &mapped, sizeof(mapped)));
+    if (c->buffer && !mapped) {
+      LOG(WARNING) << "Sending shared memory transfer responses over the "
+                   << "control channel: the client could not map "
+                   << c->buffer->name();
+    }
+    if (!mapped) c->buffer.reset();
+    if (c->buffer) c->buffer->Unlink();
+    return Status::OK();
+  }
+
+  // Serves a GetElement request. Errors are reported to the client; only
+  // errors of the control channel are returned.
+  Status Respond(Connection* c, const std::string& serialized_request) {
+    GetElementResponse resp;
+    Status s = GetElement(serialized_request, resp);
+    ResponseHeader header = {};
+    header.code = s.code();
+    if (!s.ok()) {
+      const std::string& message = s.error_message();
+      header.size = message.size();
+      TF_RETURN_IF_ERROR(WriteFully(c->fd, &header, sizeof(header)));
+      return WriteFully(c->fd, message.data(), message.size());
+    }
+    header.size = resp.ByteSizeLong();
+    header.slot = -1;
+    if (c->buffer && header.size <= c->buffer->slot_size()) {
+      header.slot = c->buffer->AcquireSlot();
+    }
+    if (header.slot >= 0) {
+      if (resp.SerializeToArray(c->buffer->slot(header.slot), header.size)) {
+        return WriteFully(c->fd, &header, sizeof(header));
+      }
+      c->buffer->ReleaseSlot(header.slot);
+      header.slot = -1;
+    }
+    const std::string serialized_response = resp.SerializeAsString();
+    TF_RETURN_IF_ERROR(WriteFully(c->fd, &header, sizeof(header)));
+    return WriteFully(c->fd, serialized_response.data(),
+                      serialized_response.size());
+  }
+
+  Status GetElement(const std::string& serialized_request,
+                    GetElementResponse& resp) {
+    GetElementRequest req;
+    if (!req.ParseFromString(serialized_request)) {
+      return errors::InvalidArgument("Failed to parse GetElementRequest.");
+    }
+    GetElementResult result;
+    TF_RETURN_IF_ERROR(get_element_(&req, &result));
+    resp.set_end_of_sequence(result.end_of_sequence);
+    resp.set_skip_task(result.skip);
+    if (result.end_of_sequence || result.skip) {
+      return Status::OK();
+    }
+    return MoveElementToResponse(std::move(result.components), resp);
+  }
+
+  const GetElementT get_element_;
+  const size_t buffer_size_;
+  int listen_fd_ = -1;
+  int port_ = -1;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<Connection>> connections_ TF_GUARDED_BY(mu_);
+};
+
+class SharedMemoryTransferClient : public DataTransferClient {
+ public:
+  // Connects to the server listening at `address` on the local host.
+  static Status Create(const std::string& address,
+                       std::unique_ptr<DataTransferClient>* out) {
+    int port;
+    if (!absl::SimpleAtoi(address.substr(address.rfind(':') + 1), &port)) {
+      return errors::InvalidArgument(
+          "Failed to parse the port of shared memory transfer address ",
+          address);
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      return IOError("Failed to create the shared memory transfer socket",
+                     errno);
+    }
+    auto client = absl::WrapUnique(new SharedMemoryTransferClient(fd));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+      return IOError(
+          absl::StrCat("Failed to connect to shared memory transfer server ",
+                       address),
+          errno);
+    }
+    std::string name;
+    TF_RETURN_IF_ERROR(ReadString(fd, &name));
+    uint64 size;
+    TF_RETURN_IF_ERROR(ReadFully(fd, &size, sizeof(size)));
+    // An empty name means that the server could not allocate a buffer. If
+    // this process cannot map it, e.g. because the address names this host but
+    // the server runs in another container, the server is told to send all
+    // responses over the control channel instead.
+    if (!name.empty()) {
+      Status s = SharedMemoryBuffer::Open(name, size, &client->buffer_);
+      if (!s.ok()) {
+        LOG(WARNING) << "Reading shared memory transfer responses from the "
+                     << "control channel: " << s;
+        client->buffer_.reset();
+      }
+    }
+    const char mapped = client->buffer_ != nullptr;
+    TF_RETURN_IF_ERROR(WriteFully(fd, &mapped, sizeof(mapped)));
+    *out = std::move(client);
+    return Status::OK();
+  }
+
+  ~SharedMemoryTransferClient() override { close(fd_); }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override {
+    ResponseHeader header;
+    std::string serialized_response;
+    {
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        return errors::Cancelled("Client was cancelled.");
+      }
+      Status s = Exchange(req, header, serialized_response);
+      if (!s.ok() && cancelled_) {
+        return errors::Cancelled("Client was cancelled.");
+      }
+      TF_RETURN_IF_ERROR(s);
+    }
+    GetElementResponse resp;
+    bool parsed;
+    if (header.slot >= 0) {
+      // The server does not reuse the slot until it is released.
+      parsed = resp.ParseFromArray(buffer_->slot(header.slot), header.size);
+      buffer_->ReleaseSlot(header.slot);
+    } else {
+      parsed = resp.ParseFromString(serialized_response);
+    }
+    if (!parsed) {
+      return errors::DataLoss("Failed to parse GetElementResponse.");
+    }
+    return MoveResponseToResult(resp, result);
+  }
+
+  void TryCancel() override {
+    cancelled_ = true;
+    // Unblock the request in progress, if any.
+    shutdown(fd_, SHUT_RDWR);
+  }
+
+ private:
+  explicit SharedMemoryTransferClient(int fd) : fd_(fd) {}
+
+  // Sends `req` and reads the header of its response. Responses sent over the
+  // control channel are read into `serialized_response`.
+  Status Exchange(const GetElementRequest& req, ResponseHeader& header,
+                  std::string& serialized_response)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    TF_RETURN_IF_ERROR(WriteString(fd_, req.SerializeAsString()));
+    TF_RETURN_IF_ERROR(ReadFully(fd_, &header, sizeof(header)));
+    if (header.code != error::OK) {
+      std::string message(header.size, '\0');
+      TF_RETURN_IF_ERROR(ReadFully(fd_, &message[0], message.size()));
+      return Status(static_cast<error::Code>(header.code), message);
+    }
+    if (header.slot >= 0) {
+      if (!buffer_ || header.slot >= kNumSlots ||
+          header.size > buffer_->slot_size()) {
+        return errors::Internal("Shared memory transfer response of ",
+                                header.size, " bytes in slot ", header.slot,
+                                " does not fit in the buffer.");
+      }
+      return Status::OK();
+    }
+    serialized_response.resize(header.size);
+    return ReadFully(fd_, &serialized_response[0], serialized_response.size());
+  }
+
+  const int fd_;
+  std::unique_ptr<SharedMemoryBuffer> buffer_;
+  std::atomic<bool> cancelled_{false};
+  // Serializes the use of the control channel. Responses in the buffer are
+  // parsed outside of it.
+  mutex mu_;
+};
+
+class SharedMemoryTransferRegistrar {
+ public:
+  SharedMemoryTransferRegistrar() {
+    DataTransferServer::Register(
+        kSharedMemoryTransferProtocol,
+        [](DataTransferServer::GetElementT get_element,
+           const DataTransferServer::Config& config) {
+          return std::make_shared<SharedMemoryTransferServer>(
+              std::move(get_element), config);
+        });
+    DataTransferClient::Register(
+        kSharedMemoryTransferProtocol,
+        [](DataTransferClient::Config config,
+           std::unique_ptr<DataTransferClient>* out) {
+          if (IsLocalAddress(config.address)) {
+            return SharedMemoryTransferClient::Create(config.address, out);
+          }
+          if (config.worker_address.empty()) {
+            return errors::InvalidArgument(
+                "Shared memory transfer address ", config.address,
+                " is not on the local host, and there is no worker address to "
+                "fall back to.");
+          }
+          VLOG(1) << "Falling back to gRPC to read from worker "
+                  << config.worker_address << " on another host.";
+          config.address = config.worker_address;
+          return DataTransferClient::Build("grpc", config, out);
+        });
+  }
+};
+static SharedMemoryTransferRegistrar registrar;
+
+}  // namespace
+#endif  // !defined(_WIN32)
+
+bool IsLocalAddress(absl::string_view address) {
+  absl::string_view host = address.substr(0, address.rfind(':'));
+  return host == "localhost" || host == "127.0.0.1" || host == "[::1]" ||
+         host == port::Hostname();
+}
+
+}  // namespace data
+}  // namespace tensorflow
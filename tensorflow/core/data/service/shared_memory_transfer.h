@@ -0,0 +1,54 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHARED_MEMORY_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHARED_MEMORY_TRANSFER_H_
+
+#include "absl/strings/string_view.h"
+
+namespace tensorflow {
+namespace data {
+
+// The name under which the shared memory data transfer client and server are
+// registered with `DataTransferClient` and `DataTransferServer`.
+//
+// The shared memory transfer serves clients running on the same host as the
+// worker. The server listens on a loopback port, its control channel, and maps
+// a POSIX shared memory buffer for each client that connects. The buffer is a
+// ring of slots. For each GetElement request sent over the control channel, the
+// server serializes the `GetElementResponse` into a free slot and only sends
+// its location back, so that elements do not go through the network stack.
+// Clients copy responses out of their slots concurrently, and free the slots
+// afterwards. Responses are sent over the control channel instead when they do
+// not fit in a slot, when every slot is in use, or when the server could not
+// allocate the buffer.
+//
+// Clients whose transfer address is not on the local host fall back to gRPC,
+// using the gRPC address of the worker. Clients that cannot map the buffer
+// read all responses from the control channel.
+//
+// The size of the buffer of each client is
+// `WorkerConfig.shared_memory_transfer_buffer_size_bytes`, 8MB by default. The
+// memory of the buffer is allocated when the client connects.
+//
+// The protocol is not available on Windows.
+constexpr char kSharedMemoryTransferProtocol[] = "shm";
+
+// Returns true if `address`, in the form "host:port", names the local host.
+bool IsLocalAddress(absl::string_view address);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHARED_MEMORY_TRANSFER_H_
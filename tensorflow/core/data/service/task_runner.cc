@@ -15,9 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/task_runner.h"
 
+#include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/errors.h"
@@ -31,6 +34,24 @@ namespace {
 // Time to wait before skipping a round if data still isn't available.
 const int64 kWaitBeforeSkipUs = 100 * 1000;  // 100ms.
 
+// Returns the number of bytes that `element` occupies. Compressed elements are
+// measured by their compressed size.
+int64 ElementSizeBytes(const std::vector<Tensor>& element) {
+  int64 size = 0;
+  for (const Tensor& component : element) {
+    if (component.dtype() == DT_VARIANT && component.NumElements() == 1) {
+      const CompressedElement* compressed =
+          component.flat<Variant>()(0).get<CompressedElement>();
+      if (compressed != nullptr) {
+        size += compressed->ByteSizeLong();
+        continue;
+      }
+    }
+    size += component.TotalBytes();
+  }
+  return size;
+}
+
 }  // namespace
 
 StandaloneTaskIterator::StandaloneTaskIterator(
@@ -96,6 +117,134 @@ void FirstComeFirstServedTaskRunner::Cancel() {
   // Nothing to cancel.
 }
 
+CrossJobCache::CrossJobCache(std::unique_ptr<TaskIterator> iterator,
+                             int64 max_size_bytes)
+    : iterator_(std::move(iterator)), max_size_bytes_(max_size_bytes) {
+  VLOG(1) << "Creating cross-job cache of " << max_size_bytes << " bytes";
+}
+
+Status CrossJobCache::GetNext(int64 consumer_id, std::vector<Tensor>& element,
+                              int64& index, bool& end_of_sequence) {
+  end_of_sequence = false;
+  bool produced = false;
+  std::shared_ptr<const CachedElement> cached;
+  while (!cached) {
+    {
+      mutex_lock l(mu_);
+      while (true) {
+        if (cancelled_consumers_.contains(consumer_id)) {
+          return errors::Cancelled("Consumer ", consumer_id,
+                                   " of the cross-job cache was cancelled.");
+        }
+        TF_RETURN_IF_ERROR(status_);
+        auto it = next_indices_.find(consumer_id);
+        index = first_index_;
+        if (it != next_indices_.end()) {
+          if (it->second < first_index_) {
+            VLOG(2) << "Consumer " << consumer_id << " fell behind the "
+                    << "cross-job cache; skipping from element " << it->second
+                    << " to element " << first_index_;
+          }
+          index = std::max(it->second, first_index_);
+        }
+        if (index < first_index_ + static_cast<int64>(cache_.size())) {
+          cached = cache_[index - first_index_];
+          next_indices_[consumer_id] = index + 1;
+          break;
+        }
+        if (end_of_sequence_) {
+          end_of_sequence = true;
+          return Status::OK();
+        }
+        if (!producing_) {
+          producing_ = true;
+          break;
+        }
+        cv_.wait(l);
+      }
+    }
+    if (!cached) {
+      TF_RETURN_IF_ERROR(ProduceElement());
+      produced = true;
+    }
+  }
+  metrics::RecordTFDataServiceCrossJobCacheQuery(/*hit=*/!produced);
+  if (!produced) {
+    metrics::RecordTFDataServiceCrossJobCacheSavedTime(
+        cached->production_time_us);
+  }
+  // Elements are not modified after they are produced, so consumers can share
+  // their tensors.
+  element = cached->components;
+  return Status::OK();
+}
+
+Status CrossJobCache::ProduceElement() TF_LOCKS_EXCLUDED(mu_) {
+  auto element = std::make_shared<CachedElement>();
+  bool end_of_sequence;
+  int64 start_us = Env::Default()->NowMicros();
+  Status s = iterator_->GetNext(element->components, end_of_sequence);
+  element->production_time_us = Env::Default()->NowMicros() - start_us;
+  element->size_bytes = ElementSizeBytes(element->components);
+  mutex_lock l(mu_);
+  producing_ = false;
+  cv_.notify_all();
+  if (!s.ok()) {
+    status_ = s;
+    return s;
+  }
+  if (end_of_sequence) {
+    end_of_sequence_ = true;
+    return Status::OK();
+  }
+  size_bytes_ += element->size_bytes;
+  cache_.push_back(std::move(element));
+  while (size_bytes_ > max_size_bytes_ && cache_.size() > 1) {
+    size_bytes_ -= cache_.front()->size_bytes;
+    cache_.pop_front();
+    ++first_index_;
+  }
+  return Status::OK();
+}
+
+void CrossJobCache::Cancel(int64 consumer_id) {
+  mutex_lock l(mu_);
+  cancelled_consumers_.insert(consumer_id);
+  cv_.notify_all();
+}
+
+void CrossJobCache::RemoveConsumer(int64 consumer_id) {
+  mutex_lock l(mu_);
+  next_indices_.erase(consumer_id);
+  cancelled_consumers_.erase(consumer_id);
+}
+
+double CrossJobCache::BufferOccupancy() {
+  mutex_lock l(mu_);
+  return std::min(1.0, static_cast<double>(size_bytes_) / max_size_bytes_);
+}
+
+CrossJobCacheTaskRunner::CrossJobCacheTaskRunner(
+    std::shared_ptr<CrossJobCache> cache, int64 task_id)
+    : cache_(std::move(cache)), task_id_(task_id) {}
+
+CrossJobCacheTaskRunner::~CrossJobCacheTaskRunner() {
+  cache_->RemoveConsumer(task_id_);
+}
+
+Status CrossJobCacheTaskRunner::GetNext(const GetElementRequest& req,
+                                        GetElementResult& result) {
+  result.skip = false;
+  return cache_->GetNext(task_id_, result.components, result.element_index,
+                         result.end_of_sequence);
+}
+
+void CrossJobCacheTaskRunner::Cancel() { cache_->Cancel(task_id_); }
+
+absl::optional<double> CrossJobCacheTaskRunner::BufferOccupancy() {
+  return cache_->BufferOccupancy();
+}
+
 RoundRobinTaskRunner::RoundRobinTaskRunner(
     std::unique_ptr<TaskIterator> iterator, int64 num_consumers,
     string worker_address)
@@ -229,6 +378,10 @@ void RoundRobinTaskRunner::Cancel() {
   new_round_cv_.notify_all();
 }
 
+absl::optional<double> RoundRobinTaskRunner::BufferOccupancy() {
+  return prefetch_thread_.BufferOccupancy();
+}
+
 PrefetchThread::PrefetchThread(std::unique_ptr<TaskIterator> iterator,
                                int64 round_size)
     : iterator_(std::move(iterator)), round_size_(round_size) {
@@ -310,5 +463,10 @@ Status PrefetchThread::GetStatus() {
   mutex_lock l(mu_);
   return status_;
 }
+
+double PrefetchThread::BufferOccupancy() {
+  mutex_lock l(mu_);
+  return static_cast<double>(buffer_.size()) / round_size_;
+}
 }  // namespace data
 }  // namespace tensorflow
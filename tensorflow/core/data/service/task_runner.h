@@ -15,6 +15,13 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
 
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/worker.pb.h"
@@ -68,6 +75,9 @@ class TaskRunner {
                          GetElementResult& result) = 0;
   // Cancels in-progress `GetNext` requests.
   virtual void Cancel() = 0;
+  // Returns the fraction of the runner's prefetch buffer that is full, or
+  // `absl::nullopt` if the runner produces elements on demand.
+  virtual absl::optional<double> BufferOccupancy() { return absl::nullopt; }
 };
 
 // A task runner which provides elements on a first-come first-served basis.
@@ -112,6 +122,8 @@ class PrefetchThread {
   Status FillBuffer(int64 wait_us, std::vector<std::unique_ptr<Element>>& out);
   // Returns the status for any failures encountered by the prefetch thread.
   Status GetStatus();
+  // Returns the fraction of the next round that has been prefetched.
+  double BufferOccupancy();
 
  private:
   const std::unique_ptr<TaskIterator> iterator_;
@@ -131,6 +143,82 @@ class PrefetchThread {
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
 };
 
+// A sliding window over the elements of a dataset, shared by the tasks of
+// several jobs that read the dataset on the same worker. Each element is
+// produced once, by the first consumer to request it, and is kept until the
+// window exceeds `max_size_bytes`. The window always holds at least the most
+// recent element.
+//
+// Consumers start reading at the oldest element in the window. A consumer
+// that falls behind the window skips to its oldest element, so consumers may
+// not see every element of the dataset. This is intended for datasets with
+// infinite cardinality.
+class CrossJobCache {
+ public:
+  CrossJobCache(std::unique_ptr<TaskIterator> iterator, int64 max_size_bytes);
+
+  // Gets the next element for the consumer with id `consumer_id`, storing it
+  // in `element` and its index within the dataset in `index`. Sets
+  // `end_of_sequence` if the consumer has read the last element of the
+  // dataset.
+  Status GetNext(int64 consumer_id, std::vector<Tensor>& element,
+                 int64& index, bool& end_of_sequence);
+  // Cancels the in-progress `GetNext` requests of `consumer_id`, and causes
+  // future ones to return Cancelled.
+  void Cancel(int64 consumer_id);
+  // Forgets the consumer with id `consumer_id`.
+  void RemoveConsumer(int64 consumer_id);
+  // Returns the fraction of `max_size_bytes` used by the cached elements.
+  double BufferOccupancy();
+
+ private:
+  struct CachedElement {
+    std::vector<Tensor> components;
+    int64 size_bytes;
+    // How long it took to produce the element.
+    int64 production_time_us;
+  };
+
+  // Produces the next element of `iterator_` and appends it to `cache_`,
+  // evicting the oldest elements if the cache is full. The caller must have
+  // set `producing_`, so that only one thread produces elements at a time.
+  Status ProduceElement() TF_LOCKS_EXCLUDED(mu_);
+
+  const std::unique_ptr<TaskIterator> iterator_;
+  const int64 max_size_bytes_;
+  mutex mu_;
+  // Notified when an element is produced and when a consumer is cancelled.
+  condition_variable cv_;
+  std::deque<std::shared_ptr<const CachedElement>> cache_ TF_GUARDED_BY(mu_);
+  // The index of the first element in `cache_`.
+  int64 first_index_ TF_GUARDED_BY(mu_) = 0;
+  int64 size_bytes_ TF_GUARDED_BY(mu_) = 0;
+  // Whether a consumer is producing the next element.
+  bool producing_ TF_GUARDED_BY(mu_) = false;
+  bool end_of_sequence_ TF_GUARDED_BY(mu_) = false;
+  // The first error returned by `iterator_`.
+  Status status_ TF_GUARDED_BY(mu_);
+  // The index of the next element of each consumer.
+  absl::flat_hash_map<int64, int64> next_indices_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_set<int64> cancelled_consumers_ TF_GUARDED_BY(mu_);
+};
+
+// A task runner which reads the elements of its task from a `CrossJobCache`
+// shared with the tasks of other jobs.
+class CrossJobCacheTaskRunner : public TaskRunner {
+ public:
+  CrossJobCacheTaskRunner(std::shared_ptr<CrossJobCache> cache, int64 task_id);
+  ~CrossJobCacheTaskRunner() override;
+  Status GetNext(const GetElementRequest& req,
+                 GetElementResult& result) override;
+  void Cancel() override;
+  absl::optional<double> BufferOccupancy() override;
+
+ private:
+  const std::shared_ptr<CrossJobCache> cache_;
+  const int64 task_id_;
+};
+
 // A task runner which enforces round-robin order for consuming a task's
 // elements. `RoundRobinTaskRunner` provides elements in a series of "rounds".
 // In each successive round, the runner waits to receive requests from all
@@ -156,6 +244,7 @@ class RoundRobinTaskRunner : public TaskRunner {
   Status GetNext(const GetElementRequest& req,
                  GetElementResult& result) override;
   void Cancel() override;
+  absl::optional<double> BufferOccupancy() override;
 
  private:
   // Prepares a full round of data. `wait_us` indicates how long to wait before
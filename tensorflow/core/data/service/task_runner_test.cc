@@ -65,6 +65,28 @@ Status RunConsumer(int64 consumer_index, int64 start_index, int64 end_index,
   }
   return Status::OK();
 }
+
+// Reads `num_elements` elements from `task_runner`, storing them in `*output`.
+Status ReadElements(TaskRunner& task_runner, int64 num_elements,
+                    std::vector<int64>& output) {
+  for (int64 i = 0; i < num_elements; ++i) {
+    GetElementResult result;
+    TF_RETURN_IF_ERROR(task_runner.GetNext(GetElementRequest(), result));
+    if (result.end_of_sequence) {
+      return errors::OutOfRange("Unexpected end of sequence.");
+    }
+    output.push_back(result.components[0].flat<int64>()(0));
+  }
+  return Status::OK();
+}
+
+std::vector<std::vector<Tensor>> RangeElements(int64 num_elements) {
+  std::vector<std::vector<Tensor>> elements;
+  for (int64 i = 0; i < num_elements; ++i) {
+    elements.push_back({Tensor(i)});
+  }
+  return elements;
+}
 }  // namespace
 
 TEST(FirstComeFirstServedTaskRunner, GetNext) {
@@ -185,5 +207,103 @@ TEST(RoundRobinTaskRunner, ConsumeParallelPartialRound) {
               expected_consumer_results[consumer]);
   }
 }
+
+TEST(CrossJobCacheTaskRunner, ConsumersShareElements) {
+  auto cache = std::make_shared<CrossJobCache>(
+      absl::make_unique<TestTaskIterator>(RangeElements(10)),
+      /*max_size_bytes=*/1 << 20);
+  CrossJobCacheTaskRunner runner1(cache, /*task_id=*/1);
+  CrossJobCacheTaskRunner runner2(cache, /*task_id=*/2);
+  std::vector<int64> output1, output2;
+  TF_ASSERT_OK(ReadElements(runner1, 5, output1));
+  // The second consumer starts at the oldest cached element instead of
+  // consuming the shared iterator.
+  TF_ASSERT_OK(ReadElements(runner2, 7, output2));
+  TF_ASSERT_OK(ReadElements(runner1, 2, output1));
+  std::vector<int64> expected = {0, 1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(output1, expected);
+  EXPECT_EQ(output2, expected);
+}
+
+TEST(CrossJobCacheTaskRunner, SlowConsumerSkipsEvictedElements) {
+  // Each element is a scalar int64, so the cache holds two elements.
+  auto cache = std::make_shared<CrossJobCache>(
+      absl::make_unique<TestTaskIterator>(RangeElements(10)),
+      /*max_size_bytes=*/2 * sizeof(int64));
+  CrossJobCacheTaskRunner fast(cache, /*task_id=*/1);
+  CrossJobCacheTaskRunner slow(cache, /*task_id=*/2);
+  std::vector<int64> fast_output, slow_output;
+  TF_ASSERT_OK(ReadElements(slow, 1, slow_output));
+  TF_ASSERT_OK(ReadElements(fast, 6, fast_output));
+  TF_ASSERT_OK(ReadElements(slow, 3, slow_output));
+  EXPECT_EQ(fast_output, std::vector<int64>({0, 1, 2, 3, 4, 5}));
+  EXPECT_EQ(slow_output, std::vector<int64>({0, 4, 5, 6}));
+}
+
+TEST(CrossJobCacheTaskRunner, ConcurrentConsumers) {
+  const int64 num_consumers = 8;
+  const int64 num_elements = 100;
+  auto cache = std::make_shared<CrossJobCache>(
+      absl::make_unique<TestTaskIterator>(RangeElements(10)),
+      /*max_size_bytes=*/1 << 20);
+  std::vector<std::unique_ptr<CrossJobCacheTaskRunner>> runners;
+  std::vector<std::vector<int64>> outputs(num_consumers);
+  std::vector<Status> statuses(num_consumers);
+  for (int64 i = 0; i < num_consumers; ++i) {
+    runners.push_back(absl::make_unique<CrossJobCacheTaskRunner>(cache, i));
+  }
+  {
+    std::vector<std::unique_ptr<Thread>> consumers;
+    for (int64 i = 0; i < num_consumers; ++i) {
+      consumers.push_back(absl::WrapUnique(Env::Default()->StartThread(
+          {}, absl::StrCat("consumer_", i), [&, i] {
+            statuses[i] = ReadElements(*runners[i], num_elements, outputs[i]);
+          })));
+    }
+  }
+  std::vector<int64> expected;
+  for (int64 i = 0; i < num_elements; ++i) {
+    expected.push_back(i % 10);
+  }
+  for (int64 i = 0; i < num_consumers; ++i) {
+    TF_ASSERT_OK(statuses[i]);
+    EXPECT_EQ(outputs[i], expected);
+  }
+}
+
+TEST(CrossJobCacheTaskRunner, BufferOccupancy) {
+  auto cache = std::make_shared<CrossJobCache>(
+      absl::make_unique<TestTaskIterator>(RangeElements(10)),
+      /*max_size_bytes=*/4 * sizeof(int64));
+  CrossJobCacheTaskRunner runner(cache, /*task_id=*/1);
+  EXPECT_EQ(runner.BufferOccupancy(), 0.0);
+  std::vector<int64> output;
+  TF_ASSERT_OK(ReadElements(runner, 1, output));
+  EXPECT_EQ(runner.BufferOccupancy(), 0.25);
+  TF_ASSERT_OK(ReadElements(runner, 5, output));
+  EXPECT_EQ(runner.BufferOccupancy(), 1.0);
+}
+
+TEST(FirstComeFirstServedTaskRunner, NoBufferOccupancy) {
+  FirstComeFirstServedTaskRunner runner(
+      absl::make_unique<TestTaskIterator>(RangeElements(10)));
+  EXPECT_FALSE(runner.BufferOccupancy().has_value());
+}
+
+TEST(CrossJobCacheTaskRunner, Cancel) {
+  auto cache = std::make_shared<CrossJobCache>(
+      absl::make_unique<TestTaskIterator>(RangeElements(10)),
+      /*max_size_bytes=*/1 << 20);
+  CrossJobCacheTaskRunner cancelled(cache, /*task_id=*/1);
+  CrossJobCacheTaskRunner other(cache, /*task_id=*/2);
+  cancelled.Cancel();
+  GetElementResult result;
+  Status s = cancelled.GetNext(GetElementRequest(), result);
+  EXPECT_EQ(s.code(), error::CANCELLED);
+  // Other consumers of the cache are unaffected.
+  std::vector<int64> output;
+  TF_ASSERT_OK(ReadElements(other, 2, output));
+  EXPECT_EQ(output, std::vector<int64>({0, 1}));
+}
 }  // namespace data
 }  // namespace tensorflow
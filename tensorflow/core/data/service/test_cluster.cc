@@ -38,7 +38,16 @@ Status AddressFromTarget(absl::string_view target, std::string* address) {
 }
 }  // namespace
 
-TestCluster::TestCluster(int num_workers) : num_workers_(num_workers) {}
+TestCluster::TestCluster(int num_workers)
+    : TestCluster(num_workers, experimental::DispatcherConfig(),
+                  experimental::WorkerConfig()) {}
+
+TestCluster::TestCluster(
+    int num_workers, const experimental::DispatcherConfig& dispatcher_config,
+    const experimental::WorkerConfig& worker_config)
+    : num_workers_(num_workers),
+      dispatcher_config_(dispatcher_config),
+      worker_config_(worker_config) {}
 
 Status TestCluster::Initialize() {
   if (initialized_) {
@@ -46,7 +55,7 @@ Status TestCluster::Initialize() {
         "Test cluster has already been initialized.");
   }
   initialized_ = true;
-  experimental::DispatcherConfig config;
+  experimental::DispatcherConfig config = dispatcher_config_;
   config.set_port(0);
   config.set_protocol(kProtocol);
   TF_RETURN_IF_ERROR(NewDispatchServer(config, dispatcher_));
@@ -62,7 +71,7 @@ Status TestCluster::Initialize() {
 
 Status TestCluster::AddWorker() {
   std::unique_ptr<WorkerGrpcDataServer> worker;
-  experimental::WorkerConfig config;
+  experimental::WorkerConfig config = worker_config_;
   config.set_port(0);
   config.set_protocol(kProtocol);
   config.set_dispatcher_address(dispatcher_address_);
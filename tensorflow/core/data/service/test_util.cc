@@ -38,6 +38,12 @@ constexpr char kTestdataDir[] =
 // g.ParseFromString(ds._as_serialized_graph().numpy())
 // print(g)
 constexpr char kMapGraphDefFile[] = "map_graph_def.pbtxt";
+
+// Proto content generated as above, for
+//
+// ds = tf.data.Dataset.range(10)
+// ds = ds.repeat()
+constexpr char kRepeatedRangeGraphDefFile[] = "repeated_range_graph_def.pbtxt";
 }  // namespace
 
 Status map_test_case(GraphDefTestCase* test_case) {
@@ -53,6 +59,19 @@ Status map_test_case(GraphDefTestCase* test_case) {
   return Status::OK();
 }
 
+Status repeated_range_test_case(GraphDefTestCase* test_case) {
+  std::string filepath = io::JoinPath(kTestdataDir, kRepeatedRangeGraphDefFile);
+  GraphDef graph_def;
+  TF_RETURN_IF_ERROR(ReadTextProto(Env::Default(), filepath, &graph_def));
+  int num_elements = 10;
+  std::vector<std::vector<Tensor>> outputs(num_elements);
+  for (int i = 0; i < num_elements; ++i) {
+    outputs[i] = CreateTensors<int64>(TensorShape{}, {{i}});
+  }
+  *test_case = {"RepeatedRangeGraph", graph_def, outputs};
+  return Status::OK();
+}
+
 }  // namespace test_util
 }  // namespace data
 }  // namespace tensorflow
@@ -37,6 +37,11 @@ struct GraphDefTestCase {
 // dataset graph execution.
 Status map_test_case(GraphDefTestCase* test_case);
 
+// Fills in the input test_case pointer with test case data representing the
+// dataset tf.data.Dataset.range(10).repeat(). The expected output holds the
+// first repetition.
+Status repeated_range_test_case(GraphDefTestCase* test_case);
+
 }  // namespace test_util
 }  // namespace data
 }  // namespace tensorflow
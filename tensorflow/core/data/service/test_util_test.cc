@@ -52,6 +52,30 @@ TEST(TestUtil, MapTestCase) {
   }
 }
 
+TEST(TestUtil, RepeatedRangeTestCase) {
+  GraphDefTestCase test_case;
+  TF_ASSERT_OK(repeated_range_test_case(&test_case));
+  standalone::Dataset::Params params;
+  std::unique_ptr<standalone::Dataset> dataset;
+  TF_ASSERT_OK(
+      standalone::Dataset::FromGraph(params, test_case.graph_def, &dataset));
+  EXPECT_EQ(dataset->Get()->Cardinality(), kInfiniteCardinality);
+
+  std::unique_ptr<standalone::Iterator> iterator;
+  TF_ASSERT_OK(dataset->MakeIterator(&iterator));
+  // Reads two repetitions.
+  for (int repetition = 0; repetition < 2; ++repetition) {
+    for (const auto& expected : test_case.output) {
+      std::vector<tensorflow::Tensor> outputs;
+      bool end_of_input;
+      TF_ASSERT_OK(iterator->GetNext(&outputs, &end_of_input));
+      ASSERT_FALSE(end_of_input);
+      TF_EXPECT_OK(DatasetOpsTestBase::ExpectEqual(outputs, expected,
+                                                   /*compare_order=*/true));
+    }
+  }
+}
+
 }  // namespace test_util
 }  // namespace data
 }  // namespace tensorflow
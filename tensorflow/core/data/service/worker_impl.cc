@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/snappy.h"
@@ -46,33 +47,7 @@ namespace tensorflow {
 namespace data {
 
 const constexpr uint64 kRetryIntervalMicros = 5ull * 1000 * 1000;
-
-namespace {
-// Moves the element into the response. If the tensor contains a single
-// CompressedElement variant, the move will be zero-copy. Otherwise, the tensor
-// data will be serialized as TensorProtos.
-Status MoveElementToResponse(std::vector<Tensor>&& element,
-                             GetElementResponse& resp) {
-  if (element.size() != 1 || element[0].dtype() != DT_VARIANT ||
-      !TensorShapeUtils::IsScalar(element[0].shape())) {
-    for (const auto& component : element) {
-      UncompressedElement* uncompressed = resp.mutable_uncompressed();
-      component.AsProtoTensorContent(uncompressed->add_components());
-    }
-    return Status::OK();
-  }
-  Variant& variant = element[0].scalar<Variant>()();
-  CompressedElement* compressed = variant.get<CompressedElement>();
-  if (compressed == nullptr) {
-    return errors::FailedPrecondition(
-        "Expected dataset to produce a CompressedElement variant tensor, but "
-        "it produced ",
-        variant.TypeName());
-  }
-  *resp.mutable_compressed() = *compressed;
-  return Status::OK();
-}
-}  // namespace
+const constexpr int64 kDefaultCrossJobCacheSizeBytes = 256 << 20;
 
 DataServiceWorkerImpl::DataServiceWorkerImpl(
     const experimental::WorkerConfig& config)
@@ -180,6 +155,9 @@ Status DataServiceWorkerImpl::GetElementResult(
     cv_.notify_all();
   });
   TF_RETURN_IF_ERROR(task->task_runner->GetNext(*request, *result));
+  if (!result->end_of_sequence && !result->skip) {
+    elements_served_++;
+  }
   return Status::OK();
 }
 
@@ -206,11 +184,18 @@ Status DataServiceWorkerImpl::ProcessTaskInternal(const TaskDef& task_def)
 }
 
 Status DataServiceWorkerImpl::EnsureTaskInitialized(
-    DataServiceWorkerImpl::Task& task) {
+    DataServiceWorkerImpl::Task& task) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   mutex_lock l(task.mu);
   if (task.initialized) {
     return Status::OK();
   }
+  if (MaybeUseCrossJobCache(task)) {
+    task.initialized = true;
+    VLOG(3) << "Task " << task.task_def.task_id()
+            << " reads from the cross-job cache of dataset "
+            << task.task_def.dataset_id();
+    return Status::OK();
+  }
   standalone::Dataset::Params params;
   std::unique_ptr<standalone::Dataset> dataset;
   std::unique_ptr<standalone::Iterator> iterator;
@@ -255,6 +240,28 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
   }
   auto task_iterator = absl::make_unique<StandaloneTaskIterator>(
       std::move(dataset), std::move(iterator));
+  if (task.task_def.use_cross_job_cache()) {
+    // Consumers that fall behind the cache skip elements, which is only
+    // acceptable for infinite datasets.
+    if (task_iterator->Cardinality() == kInfiniteCardinality) {
+      int64 cache_size_bytes = config_.cross_job_cache_size_bytes() > 0
+                                   ? config_.cross_job_cache_size_bytes()
+                                   : kDefaultCrossJobCacheSizeBytes;
+      auto cache = std::make_shared<CrossJobCache>(std::move(task_iterator),
+                                                   cache_size_bytes);
+      cross_job_caches_[task.task_def.dataset_id()] = cache;
+      task.task_runner = absl::make_unique<CrossJobCacheTaskRunner>(
+          std::move(cache), task.task_def.task_id());
+      task.initialized = true;
+      VLOG(3) << "Created cross-job cache for dataset "
+              << task.task_def.dataset_id() << " in task "
+              << task.task_def.task_id();
+      return Status::OK();
+    }
+    VLOG(1) << "Not sharing the elements of dataset "
+            << task.task_def.dataset_id()
+            << " across jobs because its cardinality is not infinite.";
+  }
   TF_RETURN_IF_ERROR(TaskRunner::Create(
       config_, task.task_def, std::move(task_iterator), task.task_runner));
 
@@ -263,6 +270,25 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
   return Status::OK();
 }
 
+bool DataServiceWorkerImpl::MaybeUseCrossJobCache(Task& task)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (!task.task_def.use_cross_job_cache()) {
+    return false;
+  }
+  auto it = cross_job_caches_.find(task.task_def.dataset_id());
+  if (it == cross_job_caches_.end()) {
+    return false;
+  }
+  std::shared_ptr<CrossJobCache> cache = it->second.lock();
+  if (!cache) {
+    cross_job_caches_.erase(it);
+    return false;
+  }
+  task.task_runner = absl::make_unique<CrossJobCacheTaskRunner>(
+      std::move(cache), task.task_def.task_id());
+  return true;
+}
+
 void DataServiceWorkerImpl::StopTask(Task& task) TF_LOCKS_EXCLUDED(mu_) {
   {
     mutex_lock l(task.mu);
@@ -298,6 +324,27 @@ Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
   return Status::OK();
 }
 
+Status DataServiceWorkerImpl::GetElements(const GetElementsRequest* request,
+                                          GetElementsResponse* response) {
+  VLOG(3) << "Received GetElements request for task "
+          << request->request().task_id();
+  ElementBatchingDef batching;
+  {
+    mutex_lock l(mu_);
+    auto it = tasks_.find(request->request().task_id());
+    if (it != tasks_.end()) {
+      batching = it->second->task_def.element_batching();
+    }
+  }
+  // Unknown tasks fail in `GetElement`.
+  return GetElementBatch(
+      batching, request->request(),
+      [this, request](GetElementResponse& element) {
+        return GetElement(&request->request(), &element);
+      },
+      *response);
+}
+
 Status DataServiceWorkerImpl::GetWorkerTasks(
     const GetWorkerTasksRequest* request, GetWorkerTasksResponse* response) {
   mutex_lock l(mu_);
@@ -395,10 +442,11 @@ Status DataServiceWorkerImpl::Heartbeat() TF_LOCKS_EXCLUDED(mu_) {
       current_tasks.push_back(task.first);
     }
   }
+  absl::optional<WorkerLoad> load = MeasureLoad();
   std::vector<TaskDef> new_tasks;
   std::vector<int64> task_ids_to_delete;
   TF_RETURN_IF_ERROR(dispatcher_->WorkerHeartbeat(
-      worker_address_, transfer_address_, current_tasks, new_tasks,
+      worker_address_, transfer_address_, current_tasks, load, new_tasks,
       task_ids_to_delete));
   std::vector<std::shared_ptr<Task>> tasks_to_delete;
   {
@@ -426,5 +474,44 @@ Status DataServiceWorkerImpl::Heartbeat() TF_LOCKS_EXCLUDED(mu_) {
   return Status::OK();
 }
 
+absl::optional<WorkerLoad> DataServiceWorkerImpl::MeasureLoad()
+    TF_LOCKS_EXCLUDED(mu_) {
+  const int64 now_us = Env::Default()->NowMicros();
+  const std::clock_t cpu_time = std::clock();
+  const int64 elements_served = elements_served_;
+  mutex_lock l(mu_);
+  absl::optional<WorkerLoad> load;
+  if (last_load_time_us_ > 0 && now_us > last_load_time_us_) {
+    const double elapsed_seconds = (now_us - last_load_time_us_) / 1.0e6;
+    load.emplace();
+    load->set_elements_per_second(
+        (elements_served - last_load_elements_served_) / elapsed_seconds);
+    load->set_cpu_utilization(
+        static_cast<double>(cpu_time - last_load_cpu_time_) / CLOCKS_PER_SEC /
+        elapsed_seconds / port::NumSchedulableCPUs());
+    double total_occupancy = 0.0;
+    int64 num_buffering_tasks = 0;
+    for (const auto& entry : tasks_) {
+      Task& task = *entry.second;
+      mutex_lock task_lock(task.mu);
+      if (!task.initialized || !task.task_runner) {
+        continue;
+      }
+      absl::optional<double> occupancy = task.task_runner->BufferOccupancy();
+      if (occupancy.has_value()) {
+        total_occupancy += occupancy.value();
+        ++num_buffering_tasks;
+      }
+    }
+    if (num_buffering_tasks > 0) {
+      load->set_buffer_occupancy(total_occupancy / num_buffering_tasks);
+    }
+  }
+  last_load_time_us_ = now_us;
+  last_load_cpu_time_ = cpu_time;
+  last_load_elements_served_ = elements_served;
+  return load;
+}
+
 }  // namespace data
 }  // namespace tensorflow
@@ -15,6 +15,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 
+#include <atomic>
+#include <ctime>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/data/service/common.pb.h"
@@ -63,6 +66,8 @@ class DataServiceWorkerImpl {
   /// Client-facing API.
   Status GetElement(const GetElementRequest* request,
                     GetElementResponse* response);
+  Status GetElements(const GetElementsRequest* request,
+                     GetElementsResponse* response);
   Status GetWorkerTasks(const GetWorkerTasksRequest* request,
                         GetWorkerTasksResponse* response);
 
@@ -82,7 +87,10 @@ class DataServiceWorkerImpl {
   // Creates an iterator to process a task.
   Status ProcessTaskInternal(const TaskDef& task)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
-  Status EnsureTaskInitialized(Task& task);
+  Status EnsureTaskInitialized(Task& task) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Initializes `task` to read from the cross-job cache of its dataset, if
+  // there is one.
+  bool MaybeUseCrossJobCache(Task& task) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Stops a task, cancelling the task's outstanding requests and waiting for
   // them to finish.
   void StopTask(Task& task) TF_LOCKS_EXCLUDED(mu_);
@@ -92,6 +100,9 @@ class DataServiceWorkerImpl {
   void HeartbeatThread() TF_LOCKS_EXCLUDED(mu_);
   // Performs a heartbeat to the dispatcher.
   Status Heartbeat() TF_LOCKS_EXCLUDED(mu_);
+  // Measures the load of the worker since the previous call. Returns
+  // `absl::nullopt` on the first call.
+  absl::optional<WorkerLoad> MeasureLoad() TF_LOCKS_EXCLUDED(mu_);
 
   const experimental::WorkerConfig config_;
   // The worker's own address.
@@ -103,6 +114,10 @@ class DataServiceWorkerImpl {
   condition_variable cv_;
   // Information about tasks, keyed by task ids.
   absl::flat_hash_map<int64, std::shared_ptr<Task>> tasks_ TF_GUARDED_BY(mu_);
+  // Cross-job caches, keyed by dataset id. Tasks reference the cache they
+  // read from, so a cache is destroyed along with its last task.
+  absl::flat_hash_map<int64, std::weak_ptr<CrossJobCache>> cross_job_caches_
+      TF_GUARDED_BY(mu_);
   // Ids of tasks that have finished.
   absl::flat_hash_set<int64> finished_tasks_ TF_GUARDED_BY(mu_);
   // Completed tasks which haven't yet been communicated to the dispatcher.
@@ -117,6 +132,13 @@ class DataServiceWorkerImpl {
   std::unique_ptr<Thread> heartbeat_thread_;
   condition_variable heartbeat_cv_ TF_GUARDED_BY(mu_);
   int64 outstanding_requests_ TF_GUARDED_BY(mu_) = 0;
+  // The number of elements served, for measuring the load of the worker.
+  std::atomic<int64> elements_served_{0};
+  // The time, process CPU time and number of elements served when the load
+  // was last measured.
+  int64 last_load_time_us_ TF_GUARDED_BY(mu_) = 0;
+  std::clock_t last_load_cpu_time_ TF_GUARDED_BY(mu_) = 0;
+  int64 last_load_elements_served_ TF_GUARDED_BY(mu_) = 0;
   CancellationManager cancellation_manager_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(DataServiceWorkerImpl);
@@ -32,6 +32,10 @@ ABSL_CONST_INIT const char kDroppedElements[] = "dropped_elements";
 ABSL_CONST_INIT const char kFeaturesCount[] = "features_count";
 ABSL_CONST_INIT const char kFeatureValuesCount[] = "feature_values_count";
 ABSL_CONST_INIT const char kExamplesCount[] = "examples_count";
+ABSL_CONST_INIT const char kMemoryCacheHits[] = "memory_cache_hits";
+ABSL_CONST_INIT const char kMemoryCacheMisses[] = "memory_cache_misses";
+ABSL_CONST_INIT const char kSpilledBytes[] = "spilled_bytes";
+ABSL_CONST_INIT const char kConsumerWaitTime[] = "consumer_wait_time";
 
 string ExecutionTimeHistogramName(const string& prefix) {
   return strings::StrCat(prefix, kDelimiter, kExecutionTime);
@@ -69,6 +73,14 @@ string FeatureValueHistogramName(const string& prefix) {
   return strings::StrCat(prefix, kDelimiter, kFeatureValuesCount);
 }
 
+string SpilledBytesScalarName(const string& prefix) {
+  return strings::StrCat(prefix, kDelimiter, kSpilledBytes);
+}
+
+string ConsumerWaitTimeHistogramName(const string& prefix) {
+  return strings::StrCat(prefix, kDelimiter, kConsumerWaitTime);
+}
+
 }  // namespace stats_utils
 }  // namespace data
 }  // namespace tensorflow
@@ -31,6 +31,10 @@ extern const char kDroppedElements[];
 extern const char kFeaturesCount[];
 extern const char kFeatureValuesCount[];
 extern const char kExamplesCount[];
+extern const char kMemoryCacheHits[];
+extern const char kMemoryCacheMisses[];
+extern const char kSpilledBytes[];
+extern const char kConsumerWaitTime[];
 
 // Name for tf.data function execution time (in ns) histogram metrics.
 string ExecutionTimeHistogramName(const string& prefix);
@@ -61,6 +65,13 @@ string FeatureHistogramName(const string& prefix);
 // Name for feature-values count histogram metrics.
 string FeatureValueHistogramName(const string& prefix);
 
+// Name for the scalar metrics of bytes spilled to disk by a memory cache.
+string SpilledBytesScalarName(const string& prefix);
+
+// Name for the histogram metrics of the time (in us) that consumers of a
+// buffer waited for it to become non-empty.
+string ConsumerWaitTimeHistogramName(const string& prefix);
+
 }  // namespace stats_utils
 }  // namespace data
 }  // namespace tensorflow
@@ -12,9 +12,13 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
-
 #include "tensorflow/core/framework/local_rendezvous.h"
 
+#include <atomic>
+#include <thread>  // NOLINT
+#include <type_traits>
+#include <utility>
+
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -26,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -63,6 +68,14 @@ struct LocalRendezvous::Item {
   // Link to next item in an ItemQueue.
   Item* next = nullptr;
 
+  // A Recv item in lock-free mode whose cancellation callback is registered
+  // holds a second reference for that callback, because the callback may run
+  // after the item has been consumed. All other items have one reference.
+  std::atomic<int> refs{1};
+  bool cancellation_callback_holds_ref = false;
+  // Set by the lock-free cancellation callback before it looks for the item.
+  std::atomic<bool> cancelled{false};
+
   // The validity of `send_state` or `recv_state` is determined by `type ==
   // kSend` or `type == kRecv` respectively.
   union {
@@ -96,21 +109,197 @@ void LocalRendezvous::ItemQueue::push_back(Item* item) {
   }
 }
 
+namespace {
+
+// The number of slots in the lock-free table, which must be a power of two,
+// and the number of items preallocated for it.
+constexpr int kLockFreeSlots = 512;
+constexpr int kLockFreeItemPoolSize = 256;
+// The number of slots probed for a key before it uses the mutex-protected
+// table instead.
+constexpr int kLockFreeMaxProbes = 8;
+
+// The state of a slot is either a pointer to the pending Item, tagged with
+// kRecvTag if it is a Recv, or one of the values below. Items are at least
+// 8-byte aligned, so none of these is a valid pointer.
+constexpr uintptr_t kEmpty = 0;
+constexpr uintptr_t kRecvTag = 1;
+// The pending item is being moved to the mutex-protected table.
+constexpr uintptr_t kMigrating = 2;
+// All calls for this key use the mutex-protected table.
+constexpr uintptr_t kMigrated = 4;
+// The rendezvous has been aborted.
+constexpr uintptr_t kAborted = 6;
+
+bool IsItem(uintptr_t state) { return state > kAborted; }
+bool IsRecvItem(uintptr_t state) { return IsItem(state) && (state & kRecvTag); }
+bool IsSendItem(uintptr_t state) {
+  return IsItem(state) && !(state & kRecvTag);
+}
+
+bool LockFreeByDefault() {
+  static const bool lock_free = [] {
+    bool value = false;
+    Status s =
+        ReadBoolFromEnvVar("TF_LOCAL_RENDEZVOUS_LOCK_FREE", false, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return false;
+    }
+    return value;
+  }();
+  return lock_free;
+}
+
+Status RecvCancelledStatus() {
+  return StatusGroup::MakeDerived(errors::Cancelled("RecvAsync is cancelled."));
+}
+
+}  // namespace
+
+// A fixed-size pool of storage for Items with a lock-free free list. The head
+// of the free list packs a tag, which is incremented on every update, with
+// the index (plus one) of the first free item, so that Allocate() cannot be
+// confused by an item that was taken and returned concurrently.
+class LocalRendezvous::ItemPool {
+ public:
+  explicit ItemPool(int size)
+      : size_(size),
+        storage_(new Storage[size]),
+        next_(new std::atomic<uint32>[size]) {
+    for (int i = 0; i < size; ++i) {
+      next_[i].store(i + 1 < size ? i + 2 : 0, std::memory_order_relaxed);
+    }
+    head_.store(size > 0 ? 1 : 0, std::memory_order_release);
+  }
+
+  // Returns uninitialized storage for an Item, or nullptr if all items of the
+  // pool are in use.
+  void* Allocate() {
+    uint64 head = head_.load(std::memory_order_acquire);
+    while (true) {
+      const uint32 index = static_cast<uint32>(head);
+      if (index == 0) return nullptr;
+      const uint64 next = NextTag(head) | next_[index - 1].load(
+                                              std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+        return &storage_[index - 1];
+      }
+    }
+  }
+
+  // Returns storage obtained from Allocate() to the pool.
+  void Free(void* ptr) {
+    const uint32 index = static_cast<Storage*>(ptr) - storage_.get() + 1;
+    uint64 head = head_.load(std::memory_order_relaxed);
+    do {
+      next_[index - 1].store(static_cast<uint32>(head),
+                             std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, NextTag(head) | index,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  bool Contains(const void* ptr) const {
+    return ptr >= storage_.get() && ptr < storage_.get() + size_;
+  }
+
+ private:
+  typedef std::aligned_storage<sizeof(Item), alignof(Item)>::type Storage;
+
+  static uint64 NextTag(uint64 head) { return ((head >> 32) + 1) << 32; }
+
+  const int size_;
+  std::unique_ptr<Storage[]> storage_;
+  std::unique_ptr<std::atomic<uint32>[]> next_;
+  std::atomic<uint64> head_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ItemPool);
+};
+
+struct LocalRendezvous::Slot {
+  // The hash of the key that owns this slot, or 0 if the slot is unclaimed.
+  // A slot is never released by its key.
+  std::atomic<uint64> key_hash{0};
+  std::atomic<uintptr_t> state{kEmpty};
+};
+
+struct LocalRendezvous::LockFreeTable {
+  LockFreeTable() : slots(new Slot[kLockFreeSlots]), pool(kLockFreeItemPoolSize) {}
+
+  std::unique_ptr<Slot[]> slots;
+  ItemPool pool;
+};
+
+LocalRendezvous::LocalRendezvous(Rendezvous* owner)
+    : LocalRendezvous(owner, LockFreeByDefault()) {}
+
+LocalRendezvous::LocalRendezvous(Rendezvous* owner, bool lock_free)
+    : rc_owner_(owner),
+      lock_free_(lock_free ? new LockFreeTable : nullptr) {}
+
 LocalRendezvous::~LocalRendezvous() {
-  if (!table_.empty()) {
+  bool pending = !table_.empty();
+  if (lock_free_ != nullptr) {
+    for (int i = 0; i < kLockFreeSlots && !pending; ++i) {
+      pending = IsItem(lock_free_->slots[i].state.load());
+    }
+  }
+  if (pending) {
     StartAbort(errors::Cancelled("LocalRendezvous deleted"));
   }
 }
 
-namespace {
-uint64 KeyHash(const StringPiece& k) { return Hash64(k.data(), k.size()); }
-}  // namespace
+template <typename... T>
+LocalRendezvous::Item* LocalRendezvous::NewItem(T&&... args) {
+  void* storage = lock_free_ != nullptr ? lock_free_->pool.Allocate() : nullptr;
+  if (storage == nullptr) {
+    return new Item(std::forward<T>(args)...);
+  }
+  return new (storage) Item(std::forward<T>(args)...);
+}
+
+void LocalRendezvous::ReleaseItem(Item* item) {
+  // No other reference can be added, so a count of one is the last reference.
+  if (item->refs.load(std::memory_order_acquire) != 1 &&
+      item->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  if (lock_free_ != nullptr && lock_free_->pool.Contains(item)) {
+    item->~Item();
+    lock_free_->pool.Free(item);
+  } else {
+    delete item;
+  }
+}
+
+void LocalRendezvous::InvokeWaiter(Item* item, const Status& s,
+                                   const Rendezvous::Args& send_args,
+                                   const Tensor& val, bool is_dead) {
+  DCHECK_EQ(item->type, Item::kRecv);
+  // If the cancellation callback cannot be deregistered because the
+  // cancellation manager has started cancelling, the callback will run and
+  // drop its references itself.
+  if (item->cancellation_callback_holds_ref &&
+      item->args.cancellation_manager->TryDeregisterCallback(
+          item->recv_state.cancellation_token)) {
+    ReleaseItem(item);
+    if (rc_owner_) rc_owner_->Unref();
+  }
+  (*item->recv_state.waiter)(s, send_args, item->args, val, is_dead);
+}
+
+Status LocalRendezvous::GetStatus() {
+  mutex_lock l(mu_);
+  return status_;
+}
 
 Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
                              const Rendezvous::Args& send_args,
                              const Tensor& val, const bool is_dead) {
-  uint64 key_hash = KeyHash(key.FullKey());
-  DVLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
+  DVLOG(2) << "Send " << this << " " << key.FullKeyHash() << " "
+           << key.FullKey();
 
   if (is_dead) {
     static auto* rendezvous_dead_values_sent = monitoring::Counter<2>::New(
@@ -122,6 +311,82 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
         ->IncrementBy(1);
   }
 
+  if (lock_free_ != nullptr) {
+    Slot* slot = FindSlot(key.FullKeyHash());
+    if (slot != nullptr) {
+      return LockFreeSend(slot, key, send_args, val, is_dead);
+    }
+  }
+  return TableSend(key, send_args, val, is_dead);
+}
+
+void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
+                                const Rendezvous::Args& recv_args,
+                                Rendezvous::DoneCallback done) {
+  DVLOG(2) << "Recv " << this << " " << key.FullKeyHash() << " "
+           << key.FullKey();
+
+  if (lock_free_ != nullptr) {
+    Slot* slot = FindSlot(key.FullKeyHash());
+    if (slot != nullptr) {
+      LockFreeRecvAsync(slot, key, recv_args, std::move(done));
+      return;
+    }
+  }
+  TableRecvAsync(key, recv_args, std::move(done));
+}
+
+LocalRendezvous::Item* LocalRendezvous::PopFrontLocked(uint64 key_hash,
+                                                       ItemQueue* queue) {
+  Item* item = queue->head;
+  // Delete the queue when the last element has been consumed.
+  if (item->next == nullptr) {
+    DVLOG(2) << "Clean up Send/Recv queue (key hash:" << key_hash << "). ";
+    table_.erase(key_hash);
+  } else {
+    queue->head = item->next;
+  }
+  return item;
+}
+
+template <typename Predicate>
+LocalRendezvous::Item* LocalRendezvous::RemoveRecvItemLocked(uint64 key_hash,
+                                                             Predicate pred) {
+  auto it = table_.find(key_hash);
+  if (it == table_.end()) return nullptr;
+  ItemQueue* queue = &it->second;
+  if (queue->head == nullptr || queue->head->type != Item::kRecv) {
+    return nullptr;
+  }
+  for (Item *prev = nullptr, *curr = queue->head; curr != nullptr;
+       prev = curr, curr = curr->next) {
+    if (pred(curr)) {
+      if (queue->head->next == nullptr) {
+        // We have a single-element queue, so we can erase it from the table.
+        table_.erase(it);
+      } else {
+        // Remove the current item from the queue.
+        if (curr == queue->head) {
+          DCHECK_EQ(prev, nullptr);
+          queue->head = curr->next;
+        } else {
+          DCHECK_NE(prev, nullptr);
+          prev->next = curr->next;
+        }
+        if (queue->tail == curr) {
+          queue->tail = prev;
+        }
+      }
+      return curr;
+    }
+  }
+  return nullptr;
+}
+
+Status LocalRendezvous::TableSend(const Rendezvous::ParsedKey& key,
+                                  const Rendezvous::Args& send_args,
+                                  const Tensor& val, const bool is_dead) {
+  const uint64 key_hash = key.FullKeyHash();
   mu_.lock();
   if (!status_.ok()) {
     // Rendezvous has been aborted.
@@ -138,38 +403,27 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
     // TODO(b/143786186): Investigate moving the allocation of `Item` outside
     // the lock.
     DVLOG(2) << "Enqueue Send Item (key:" << key.FullKey() << "). ";
-    queue->push_back(new Item(send_args, val, is_dead));
+    queue->push_back(NewItem(send_args, val, is_dead));
     mu_.unlock();
     return Status::OK();
   }
 
   DVLOG(2) << "Consume Recv Item (key:" << key.FullKey() << "). ";
   // There is an earliest waiter to consume this message.
-  Item* item = queue->head;
-
-  // Delete the queue when the last element has been consumed.
-  if (item->next == nullptr) {
-    DVLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-    table_.erase(key_hash);
-  } else {
-    queue->head = item->next;
-  }
+  Item* item = PopFrontLocked(key_hash, queue);
   mu_.unlock();
 
   // Notify the waiter by invoking its done closure, outside the
   // lock.
-  DCHECK_EQ(item->type, Item::kRecv);
-  (*item->recv_state.waiter)(Status::OK(), send_args, item->args, val, is_dead);
-  delete item;
+  InvokeWaiter(item, Status::OK(), send_args, val, is_dead);
+  ReleaseItem(item);
   return Status::OK();
 }
 
-void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
-                                const Rendezvous::Args& recv_args,
-                                Rendezvous::DoneCallback done) {
-  uint64 key_hash = KeyHash(key.FullKey());
-  DVLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
-
+void LocalRendezvous::TableRecvAsync(const Rendezvous::ParsedKey& key,
+                                     const Rendezvous::Args& recv_args,
+                                     Rendezvous::DoneCallback done) {
+  const uint64 key_hash = key.FullKeyHash();
   mu_.lock();
   if (!status_.ok()) {
     // Rendezvous has been aborted.
@@ -206,43 +460,17 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
         Item* item = nullptr;
         {
           mutex_lock l(mu_);
-          ItemQueue* queue = &table_[key_hash];
           // Find an item in the queue with a cancellation token that matches
           // `token`, and remove it.
-          if (queue->head != nullptr && queue->head->type == Item::kRecv) {
-            for (Item *prev = nullptr, *curr = queue->head; curr != nullptr;
-                 prev = curr, curr = curr->next) {
-              if (curr->recv_state.cancellation_token == token) {
-                item = curr;
-                if (queue->head->next == nullptr) {
-                  // We have a single-element queue, so we can erase it from
-                  // the table.
-                  table_.erase(key_hash);
-                } else {
-                  // Remove the current item from the queue.
-                  if (curr == queue->head) {
-                    DCHECK_EQ(prev, nullptr);
-                    queue->head = curr->next;
-                  } else {
-                    DCHECK_NE(prev, nullptr);
-                    prev->next = curr->next;
-                  }
-                  if (queue->tail == curr) {
-                    queue->tail = prev;
-                  }
-                }
-                break;
-              }
-            }
-          }
+          item = RemoveRecvItemLocked(key_hash, [token](const Item* curr) {
+            return curr->recv_state.cancellation_token == token;
+          });
         }
 
         if (item != nullptr) {
-          (*item->recv_state.waiter)(
-              StatusGroup::MakeDerived(
-                  errors::Cancelled("RecvAsync is cancelled.")),
-              Rendezvous::Args(), item->args, Tensor(), /*is_dead=*/false);
-          delete item;
+          (*item->recv_state.waiter)(RecvCancelledStatus(), Rendezvous::Args(),
+                                     item->args, Tensor(), /*is_dead=*/false);
+          ReleaseItem(item);
         }
         // Unref case (1) and (4)
         if (rc_owner_) rc_owner_->Unref();
@@ -252,9 +480,8 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
       mu_.unlock();
       // Unref case (2)
       if (rc_owner_) rc_owner_->Unref();
-      done(StatusGroup::MakeDerived(
-               errors::Cancelled("RecvAsync is cancelled.")),
-           Rendezvous::Args(), recv_args, Tensor(), /*is_dead=*/false);
+      done(RecvCancelledStatus(), Rendezvous::Args(), recv_args, Tensor(),
+           /*is_dead=*/false);
       return;
     }
 
@@ -266,7 +493,7 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
       // NOTE(mrry): We must wrap `done` with code that deregisters the
       // cancellation callback before calling the `done` callback, because the
       // cancellation manager may no longer be live after `done` is called.
-      queue->push_back(new Item(
+      queue->push_back(NewItem(
           recv_args,
           [this, cm, token, done = std::move(done)](
               const Status& s, const Rendezvous::Args& send_args,
@@ -283,7 +510,7 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
           },
           token));
     } else {
-      queue->push_back(new Item(recv_args, std::move(done), token));
+      queue->push_back(NewItem(recv_args, std::move(done), token));
     }
 
     mu_.unlock();
@@ -293,22 +520,256 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
   DVLOG(2) << "Consume Send Item (key:" << key.FullKey() << "). ";
   // A message has already arrived and is queued in the table under
   // this key.  Consumes the message and invokes the done closure.
-  Item* item = queue->head;
-
-  // Delete the queue when the last element has been consumed.
-  if (item->next == nullptr) {
-    DVLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-    table_.erase(key_hash);
-  } else {
-    queue->head = item->next;
-  }
+  Item* item = PopFrontLocked(key_hash, queue);
   mu_.unlock();
 
   // Invoke done() without holding the table lock.
   DCHECK_EQ(item->type, Item::kSend);
   done(Status::OK(), item->args, recv_args, *item->send_state.value,
        item->send_state.is_dead);
-  delete item;
+  ReleaseItem(item);
+}
+
+void LocalRendezvous::TableRecvItem(uint64 key_hash, Item* item) {
+  mu_.lock();
+  Status s = status_;
+  if (s.ok() && item->cancelled.load()) {
+    // The cancellation callback did not find `item` in either table.
+    s = RecvCancelledStatus();
+  }
+  if (!s.ok()) {
+    mu_.unlock();
+    InvokeWaiter(item, s, Rendezvous::Args(), Tensor(), false);
+    ReleaseItem(item);
+    return;
+  }
+
+  ItemQueue* queue = &table_[key_hash];
+  if (queue->head == nullptr || queue->head->type == Item::kRecv) {
+    queue->push_back(item);
+    mu_.unlock();
+    return;
+  }
+
+  Item* message = PopFrontLocked(key_hash, queue);
+  mu_.unlock();
+
+  InvokeWaiter(item, Status::OK(), message->args, *message->send_state.value,
+               message->send_state.is_dead);
+  ReleaseItem(item);
+  ReleaseItem(message);
+}
+
+LocalRendezvous::Slot* LocalRendezvous::FindSlot(uint64 key_hash) {
+  // 0 marks an unclaimed slot.
+  if (key_hash == 0) key_hash = 1;
+  for (int i = 0; i < kLockFreeMaxProbes; ++i) {
+    Slot* slot = &lock_free_->slots[(key_hash + i) & (kLockFreeSlots - 1)];
+    uint64 owner = slot->key_hash.load(std::memory_order_acquire);
+    if (owner == 0 && slot->key_hash.compare_exchange_strong(
+                          owner, key_hash, std::memory_order_acq_rel,
+                          std::memory_order_acquire)) {
+      return slot;
+    }
+    if (owner == key_hash) return slot;
+  }
+  // Slots are never released, so every later call for this key also ends up
+  // here.
+  return nullptr;
+}
+
+void LocalRendezvous::MigrateSlot(Slot* slot, uint64 key_hash, Item* item) {
+  DVLOG(2) << "Migrate Send/Recv slot (key hash:" << key_hash << "). ";
+  Status s;
+  {
+    mutex_lock l(mu_);
+    s = status_;
+    if (s.ok() && item->type == Item::kRecv && item->cancelled.load()) {
+      // The cancellation callback did not find `item` in either table.
+      s = RecvCancelledStatus();
+    }
+    if (s.ok()) {
+      DCHECK(table_.find(key_hash) == table_.end());
+      table_[key_hash].push_back(item);
+    }
+  }
+  if (!s.ok()) {
+    if (item->type == Item::kRecv) {
+      InvokeWaiter(item, s, Rendezvous::Args(), Tensor(), false);
+    }
+    ReleaseItem(item);
+  }
+  // Other calls for this key wait until the item is in the table. This fails
+  // only if StartAbort() has replaced the state meanwhile.
+  uintptr_t expected = kMigrating;
+  slot->state.compare_exchange_strong(expected, kMigrated);
+}
+
+Status LocalRendezvous::LockFreeSend(Slot* slot,
+                                     const Rendezvous::ParsedKey& key,
+                                     const Rendezvous::Args& send_args,
+                                     const Tensor& val, const bool is_dead) {
+  Item* item = nullptr;
+  uintptr_t state = slot->state.load(std::memory_order_acquire);
+  while (true) {
+    if (state == kEmpty) {
+      // There is no waiter for this message, so leave it in the slot.
+      if (item == nullptr) item = NewItem(send_args, val, is_dead);
+      if (slot->state.compare_exchange_weak(
+              state, reinterpret_cast<uintptr_t>(item))) {
+        return Status::OK();
+      }
+    } else if (IsRecvItem(state)) {
+      if (slot->state.compare_exchange_weak(state, kEmpty)) {
+        if (item != nullptr) ReleaseItem(item);
+        Item* waiter = reinterpret_cast<Item*>(state & ~kRecvTag);
+        InvokeWaiter(waiter, Status::OK(), send_args, val, is_dead);
+        ReleaseItem(waiter);
+        return Status::OK();
+      }
+    } else if (state == kMigrating) {
+      std::this_thread::yield();
+      state = slot->state.load(std::memory_order_acquire);
+    } else if (state == kAborted) {
+      if (item != nullptr) ReleaseItem(item);
+      return GetStatus();
+    } else if (state == kMigrated) {
+      if (item != nullptr) ReleaseItem(item);
+      return TableSend(key, send_args, val, is_dead);
+    } else {
+      // A message is already pending, so this key needs a queue.
+      DCHECK(IsSendItem(state));
+      if (slot->state.compare_exchange_weak(state, kMigrating)) {
+        if (item != nullptr) ReleaseItem(item);
+        MigrateSlot(slot, key.FullKeyHash(), reinterpret_cast<Item*>(state));
+        return TableSend(key, send_args, val, is_dead);
+      }
+    }
+  }
+}
+
+LocalRendezvous::Item* LocalRendezvous::NewLockFreeWaiter(
+    Slot* slot, uint64 key_hash, const Rendezvous::Args& recv_args,
+    Rendezvous::DoneCallback done) {
+  CancellationManager* cm = recv_args.cancellation_manager;
+  if (cm == nullptr) {
+    return NewItem(recv_args, std::move(done),
+                   CancellationManager::kInvalidToken);
+  }
+  // As in TableRecvAsync(), the owner is kept alive until the cancellation
+  // callback has run or has been deregistered. The callback also holds a
+  // reference on the item, so that the item cannot be reused while the
+  // callback may still look for it.
+  if (rc_owner_) rc_owner_->Ref();
+  const CancellationToken token = cm->get_cancellation_token();
+  Item* item = NewItem(recv_args, std::move(done), token);
+  item->refs.store(2, std::memory_order_relaxed);
+  item->cancellation_callback_holds_ref = true;
+  if (!cm->RegisterCallback(token, [this, slot, key_hash, item] {
+        CancelLockFreeWaiter(slot, key_hash, item);
+      })) {
+    (*item->recv_state.waiter)(RecvCancelledStatus(), Rendezvous::Args(),
+                               recv_args, Tensor(), /*is_dead=*/false);
+    ReleaseItem(item);
+    ReleaseItem(item);
+    if (rc_owner_) rc_owner_->Unref();
+    return nullptr;
+  }
+  return item;
+}
+
+void LocalRendezvous::CancelLockFreeWaiter(Slot* slot, uint64 key_hash,
+                                           Item* item) {
+  // Whoever installs `item` in the slot or the table checks `cancelled`
+  // afterwards, so the item is found either here or by that check.
+  item->cancelled.store(true);
+  uintptr_t expected = reinterpret_cast<uintptr_t>(item) | kRecvTag;
+  bool removed = slot->state.compare_exchange_strong(expected, kEmpty);
+  if (!removed) {
+    mutex_lock l(mu_);
+    removed = RemoveRecvItemLocked(key_hash, [item](const Item* curr) {
+                return curr == item;
+              }) != nullptr;
+  }
+  if (removed) {
+    (*item->recv_state.waiter)(RecvCancelledStatus(), Rendezvous::Args(),
+                               item->args, Tensor(), /*is_dead=*/false);
+    ReleaseItem(item);
+  }
+  // The references held by this callback.
+  ReleaseItem(item);
+  if (rc_owner_) rc_owner_->Unref();
+}
+
+void LocalRendezvous::LockFreeRecvAsync(Slot* slot,
+                                        const Rendezvous::ParsedKey& key,
+                                        const Rendezvous::Args& recv_args,
+                                        Rendezvous::DoneCallback done) {
+  const uint64 key_hash = key.FullKeyHash();
+  // The waiter for this call, created once it has to wait in the slot. Once
+  // it exists, `done` has been moved into it.
+  Item* item = nullptr;
+  uintptr_t state = slot->state.load(std::memory_order_acquire);
+  while (true) {
+    if (IsSendItem(state)) {
+      // A message has already arrived.
+      if (!slot->state.compare_exchange_weak(state, kEmpty)) continue;
+      Item* message = reinterpret_cast<Item*>(state);
+      if (item == nullptr) {
+        done(Status::OK(), message->args, recv_args,
+             *message->send_state.value, message->send_state.is_dead);
+      } else {
+        InvokeWaiter(item, Status::OK(), message->args,
+                     *message->send_state.value, message->send_state.is_dead);
+        ReleaseItem(item);
+      }
+      ReleaseItem(message);
+      return;
+    } else if (state == kEmpty) {
+      if (item == nullptr) {
+        item = NewLockFreeWaiter(slot, key_hash, recv_args, std::move(done));
+        if (item == nullptr) return;
+      }
+      const uintptr_t waiting = reinterpret_cast<uintptr_t>(item) | kRecvTag;
+      if (!slot->state.compare_exchange_weak(state, waiting)) continue;
+      if (item->cancelled.load()) {
+        // The cancellation callback ran before the item was in the slot.
+        uintptr_t expected = waiting;
+        if (slot->state.compare_exchange_strong(expected, kEmpty)) {
+          InvokeWaiter(item, RecvCancelledStatus(), Rendezvous::Args(),
+                       Tensor(), false);
+          ReleaseItem(item);
+        }
+      }
+      return;
+    } else if (state == kMigrating) {
+      std::this_thread::yield();
+      state = slot->state.load(std::memory_order_acquire);
+    } else if (state == kAborted) {
+      const Status s = GetStatus();
+      if (item == nullptr) {
+        done(s, Rendezvous::Args(), recv_args, Tensor(), false);
+      } else {
+        InvokeWaiter(item, s, Rendezvous::Args(), Tensor(), false);
+        ReleaseItem(item);
+      }
+      return;
+    } else {
+      if (state != kMigrated) {
+        // Another Recv is already waiting, so this key needs a queue.
+        DCHECK(IsRecvItem(state));
+        if (!slot->state.compare_exchange_weak(state, kMigrating)) continue;
+        MigrateSlot(slot, key_hash,
+                    reinterpret_cast<Item*>(state & ~kRecvTag));
+      }
+      if (item == nullptr) {
+        TableRecvAsync(key, recv_args, std::move(done));
+      } else {
+        TableRecvItem(key_hash, item);
+      }
+      return;
+    }
+  }
 }
 
 void LocalRendezvous::StartAbort(const Status& status) {
@@ -319,16 +780,28 @@ void LocalRendezvous::StartAbort(const Status& status) {
     status_.Update(status);
     table_.swap(table);
   }
+  if (lock_free_ != nullptr) {
+    // Every later call that finds a slot sees kAborted, and the others see
+    // `status_` in the mutex-protected table.
+    for (int i = 0; i < kLockFreeSlots; ++i) {
+      const uintptr_t state = lock_free_->slots[i].state.exchange(kAborted);
+      if (!IsItem(state)) continue;
+      Item* item = reinterpret_cast<Item*>(state & ~kRecvTag);
+      if (item->type == Item::kRecv) {
+        InvokeWaiter(item, status, Rendezvous::Args(), Tensor(), false);
+      }
+      ReleaseItem(item);
+    }
+  }
   for (auto& p : table) {
     Item* item = p.second.head;
     while (item != nullptr) {
       if (item->type == Item::kRecv) {
-        (*item->recv_state.waiter)(status, Rendezvous::Args(),
-                                   Rendezvous::Args(), Tensor(), false);
+        InvokeWaiter(item, status, Rendezvous::Args(), Tensor(), false);
       }
-      Item* to_delete = item;
+      Item* to_release = item;
       item = item->next;
-      delete to_delete;
+      ReleaseItem(to_release);
     }
   }
 }
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 #define TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 
+#include <memory>
+
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -33,13 +35,26 @@ namespace tensorflow {
 // IntraProcessRendezvous or RemoteRendezvous. This class does not implement
 // RendezvousInterface because virtual dispatch to LocalRendezvous methods
 // is not expected to be needed.
+//
+// By default, all keys are matched in a table guarded by a single mutex. In
+// lock-free mode, each key is first assigned a slot in a fixed-size table
+// that holds at most one pending Send or Recv, and is updated with atomic
+// compare-and-swap. This covers the common case of one Send and one Recv per
+// key and step without taking a lock, and the items for pending calls are
+// taken from a pool that is preallocated with the rendezvous. A key whose
+// slot would need to queue a second item (e.g. two Sends before a Recv), and
+// keys that find no free slot, are matched in the mutex-protected table.
 class LocalRendezvous {
  public:
   // If the class wrapping LocalRendezvous is refcounted (i.e., extending
   // Rendezvous), pass in its pointer in constructor so the LocalRendezvous
   // can make sure it outlives the async recv requests.
   // Pass in nullptr if the wrapping class is not refcounted.
-  explicit LocalRendezvous(Rendezvous* owner) : rc_owner_(owner) {}
+  //
+  // Lock-free mode is used if the TF_LOCAL_RENDEZVOUS_LOCK_FREE environment
+  // variable is true.
+  explicit LocalRendezvous(Rendezvous* owner);
+  LocalRendezvous(Rendezvous* owner, bool lock_free);
   ~LocalRendezvous();
 
   Status Send(const Rendezvous::ParsedKey& key,
@@ -52,6 +67,9 @@ class LocalRendezvous {
 
  private:
   struct Item;
+  struct Slot;
+  class ItemPool;
+  struct LockFreeTable;
 
   // By invariant, the item queue under each key is of the form
   //   [item.type == kSend]* meaning each item is a sent message.
@@ -66,6 +84,53 @@ class LocalRendezvous {
 
   typedef gtl::FlatMap<uint64, ItemQueue> Table;
 
+  template <typename... T>
+  Item* NewItem(T&&... args);
+  // Drops a reference on `item`, and destroys it with the last one.
+  void ReleaseItem(Item* item);
+  // Calls the done callback of the Recv `item`.
+  void InvokeWaiter(Item* item, const Status& s,
+                    const Rendezvous::Args& send_args, const Tensor& val,
+                    bool is_dead);
+  Status GetStatus();
+
+  // Matching in the mutex-protected table.
+  Status TableSend(const Rendezvous::ParsedKey& key,
+                   const Rendezvous::Args& send_args, const Tensor& val,
+                   bool is_dead);
+  void TableRecvAsync(const Rendezvous::ParsedKey& key,
+                      const Rendezvous::Args& recv_args,
+                      Rendezvous::DoneCallback done);
+  // Matches or enqueues an existing Recv `item` from the lock-free table.
+  void TableRecvItem(uint64 key_hash, Item* item);
+  // Removes the first item of `queue`, which is stored under `key_hash`.
+  Item* PopFrontLocked(uint64 key_hash, ItemQueue* queue)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Removes and returns the first Recv item under `key_hash` for which
+  // `pred` returns true, or nullptr if there is none.
+  template <typename Predicate>
+  Item* RemoveRecvItemLocked(uint64 key_hash, Predicate pred)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Matching in the lock-free table.
+  Slot* FindSlot(uint64 key_hash);
+  Status LockFreeSend(Slot* slot, const Rendezvous::ParsedKey& key,
+                      const Rendezvous::Args& send_args, const Tensor& val,
+                      bool is_dead);
+  void LockFreeRecvAsync(Slot* slot, const Rendezvous::ParsedKey& key,
+                         const Rendezvous::Args& recv_args,
+                         Rendezvous::DoneCallback done);
+  // Returns a new Recv item for the lock-free table with its cancellation
+  // callback registered, or calls `done` and returns nullptr if the Recv is
+  // already cancelled.
+  Item* NewLockFreeWaiter(Slot* slot, uint64 key_hash,
+                          const Rendezvous::Args& recv_args,
+                          Rendezvous::DoneCallback done);
+  void CancelLockFreeWaiter(Slot* slot, uint64 key_hash, Item* item);
+  // Moves `item`, which was pending in `slot`, to the mutex-protected table,
+  // after which all calls for the key of `slot` use that table.
+  void MigrateSlot(Slot* slot, uint64 key_hash, Item* item);
+
   // Pointer to the owner class of this LocalRendezvous if it is refcounted.
   const Rendezvous* rc_owner_;
 
@@ -74,6 +139,9 @@ class LocalRendezvous {
   Table table_ TF_GUARDED_BY(mu_);
   Status status_ TF_GUARDED_BY(mu_);
 
+  // Null unless in lock-free mode.
+  std::unique_ptr<LockFreeTable> lock_free_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(LocalRendezvous);
 };
 
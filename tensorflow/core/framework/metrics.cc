@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/gauge.h"
 #include "tensorflow/core/lib/monitoring/sampler.h"
 
 namespace tensorflow {
@@ -62,6 +63,12 @@ auto* graph_run_output_tensor_bytes = monitoring::Sampler<0>::New(
     // Power of 2 with bucket count 14 (256MB)
     {monitoring::Buckets::Exponential(1, 4, 14)});
 
+auto* executor_dispatches = monitoring::Counter<1>::New(
+    "/tensorflow/core/executor_dispatches",
+    "The number of ready nodes that executors ran on the thread that made "
+    "them ready (inline), or handed to their runner (scheduled).",
+    "kind");
+
 auto* graph_unused_outputs = monitoring::Counter<1>::New(
     "/tensorflow/core/graph_unused_outputs",
     "The number of unused outputs for ops of a given type.", "name");
@@ -69,6 +76,19 @@ auto* graph_unused_outputs = monitoring::Counter<1>::New(
 auto* tf_data_autotune_counter = monitoring::Counter<1>::New(
     "/tensorflow/data/autotune", "tf.data autotuning", "name");
 
+auto* tf_data_autotune_allocation_histogram = monitoring::Sampler<1>::New(
+    {"/tensorflow/data/autotune_allocation",
+     "The CPU (in cores) and RAM (in bytes) budgets allocated to a tf.data "
+     "input pipeline for a round of autotuning.",
+     "resource"},
+    // Power of 2 with bucket count 40 (512 GB).
+    {monitoring::Buckets::Exponential(1, 2, 40)});
+
+auto* tf_data_autotune_models_gauge = monitoring::Gauge<int64, 0>::New(
+    "/tensorflow/data/autotune_models",
+    "The number of tf.data input pipelines among which the autotuning budgets "
+    "are divided.");
+
 auto* tf_data_bytes_consumed_counter = monitoring::Counter<1>::New(
     "/tensorflow/data/bytes_consumed",
     "The number of bytes consumed by a tf.data Dataset.", "name");
@@ -85,6 +105,22 @@ auto* tf_data_bytes_fetched_counter = monitoring::Counter<0>::New(
     "/tensorflow/data/bytes_fetched",
     "The number of bytes fetched from tf.data Dataset iterator.");
 
+auto* tf_data_cache_compression_counter = monitoring::Counter<1>::New(
+    "/tensorflow/data/memory_cache_compression_bytes",
+    "The number of bytes of elements stored in compressed tf.data memory "
+    "caches, before and after compression.",
+    "kind");
+
+auto* tf_data_cache_decompression_bytes_counter = monitoring::Counter<0>::New(
+    "/tensorflow/data/memory_cache_decompression_bytes",
+    "The number of bytes decompressed when reading compressed tf.data memory "
+    "caches.");
+
+auto* tf_data_cache_decompression_time_counter = monitoring::Counter<0>::New(
+    "/tensorflow/data/memory_cache_decompression_time_usecs",
+    "The time (in microseconds) spent decompressing elements of compressed "
+    "tf.data memory caches.");
+
 auto* tf_data_elements_counter = monitoring::Counter<1>::New(
     "/tensorflow/data/elements", "tf.data elements", "name");
 
@@ -103,6 +139,13 @@ auto* tf_data_get_next_duration_usecs_histogram = monitoring::Sampler<0>::New(
     {monitoring::Buckets::Explicit(
         {2., 4., 8., 16., 32., 64., 128., 256., 512., 1024., 1e6})});
 
+auto* tf_data_prefetch_wait_usecs_histogram = monitoring::Sampler<0>::New(
+    {"/tensorflow/data/prefetch_wait",
+     "Microseconds that the consumer of a tf.data prefetch buffer waited for "
+     "an element because the buffer was empty."},
+    // Power of 2 with bucket count 30 (~18 minutes).
+    {monitoring::Buckets::Exponential(1, 2, 30)});
+
 auto* tf_data_iterator_busy_counter =
     monitoring::Counter<0>::New("/tensorflow/data/iterator_busy",
                                 "The time (in microseconds) during which a "
@@ -121,6 +164,40 @@ auto* tf_data_service_workers_created_counter =
     monitoring::Counter<0>::New("/tensorflow/data/service/workers_created",
                                 "Number of tf.data service workers created");
 
+auto* tf_data_service_worker_buffer_occupancy_gauge =
+    monitoring::Gauge<int64, 1>::New(
+        "/tensorflow/data/service/worker_buffer_occupancy",
+        "The percentage of the prefetch buffers of a tf.data service worker "
+        "that is full, as last reported to the dispatcher.",
+        "worker_address");
+
+auto* tf_data_service_worker_elements_per_second_gauge =
+    monitoring::Gauge<int64, 1>::New(
+        "/tensorflow/data/service/worker_elements_per_second",
+        "The number of elements per second served by a tf.data service "
+        "worker, as last reported to the dispatcher.",
+        "worker_address");
+
+auto* tf_data_service_worker_cpu_utilization_gauge =
+    monitoring::Gauge<int64, 1>::New(
+        "/tensorflow/data/service/worker_cpu_utilization",
+        "The percentage of its CPUs used by a tf.data service worker, as last "
+        "reported to the dispatcher.",
+        "worker_address");
+
+auto* tf_data_service_cross_job_cache_queries_counter =
+    monitoring::Counter<1>::New(
+        "/tensorflow/data/service/cross_job_cache_queries",
+        "Number of reads from the cross-job element caches of tf.data service "
+        "workers, by whether they hit the cache.",
+        "result");
+
+auto* tf_data_service_cross_job_cache_saved_time_counter =
+    monitoring::Counter<0>::New(
+        "/tensorflow/data/service/cross_job_cache_saved_time",
+        "The time (in microseconds) that tf.data service workers would have "
+        "spent producing elements served from their cross-job element caches.");
+
 auto* tf_data_filename_counter = monitoring::Counter<2>::New(
     "/tensorflow/data/filename", "The file name read by a tf.data Dataset.",
     "name", "filename");
@@ -178,6 +255,15 @@ void RecordTFDataAutotune(const string& name) {
   tf_data_autotune_counter->GetCell(name)->IncrementBy(1);
 }
 
+void RecordTFDataAutotuneAllocation(int64 cpu_budget, int64 ram_budget) {
+  tf_data_autotune_allocation_histogram->GetCell("cpu")->Add(cpu_budget);
+  tf_data_autotune_allocation_histogram->GetCell("ram")->Add(ram_budget);
+}
+
+void RecordTFDataAutotuneModels(int64 num_models) {
+  tf_data_autotune_models_gauge->GetCell()->Set(num_models);
+}
+
 monitoring::CounterCell* GetTFDataBytesConsumedCounter(const string& name) {
   return tf_data_bytes_consumed_counter->GetCell(name);
 }
@@ -198,6 +284,20 @@ void RecordTFDataBytesFetched(int64 num_bytes) {
   tf_data_bytes_fetched_counter->GetCell()->IncrementBy(num_bytes);
 }
 
+void RecordTFDataCacheCompression(int64 uncompressed_bytes,
+                                  int64 compressed_bytes) {
+  tf_data_cache_compression_counter->GetCell("uncompressed")
+      ->IncrementBy(uncompressed_bytes);
+  tf_data_cache_compression_counter->GetCell("compressed")
+      ->IncrementBy(compressed_bytes);
+}
+
+void RecordTFDataCacheDecompression(int64 num_bytes, uint64 duration_us) {
+  tf_data_cache_decompression_bytes_counter->GetCell()->IncrementBy(num_bytes);
+  tf_data_cache_decompression_time_counter->GetCell()->IncrementBy(
+      duration_us);
+}
+
 void RecordTFDataExperiment(const string& name) {
   tf_data_experiment_counter->GetCell(name)->IncrementBy(1);
 }
@@ -212,6 +312,12 @@ void RecordTFDataGetNextDuration(uint64 duration_us) {
   tf_data_get_next_duration_cell->Add(duration_us);
 }
 
+void RecordTFDataPrefetchWait(uint64 wait_us) {
+  static auto* tf_data_prefetch_wait_cell =
+      tf_data_prefetch_wait_usecs_histogram->GetCell();
+  tf_data_prefetch_wait_cell->Add(wait_us);
+}
+
 void RecordTFDataIteratorBusy(uint64 duration_us) {
   static auto* tf_data_iterator_busy_cell =
       tf_data_iterator_busy_counter->GetCell();
@@ -232,6 +338,29 @@ void RecordTFDataServiceWorkerCreated() {
   tf_data_service_workers_created_counter->GetCell()->IncrementBy(1);
 }
 
+void RecordTFDataServiceWorkerLoad(const string& worker_address,
+                                   int64 buffer_occupancy_percent,
+                                   int64 elements_per_second,
+                                   int64 cpu_utilization_percent) {
+  tf_data_service_worker_buffer_occupancy_gauge->GetCell(worker_address)
+      ->Set(buffer_occupancy_percent);
+  tf_data_service_worker_elements_per_second_gauge->GetCell(worker_address)
+      ->Set(elements_per_second);
+  tf_data_service_worker_cpu_utilization_gauge->GetCell(worker_address)
+      ->Set(cpu_utilization_percent);
+}
+
+void RecordTFDataServiceCrossJobCacheQuery(bool hit) {
+  tf_data_service_cross_job_cache_queries_counter
+      ->GetCell(hit ? "hit" : "miss")
+      ->IncrementBy(1);
+}
+
+void RecordTFDataServiceCrossJobCacheSavedTime(uint64 duration_us) {
+  tf_data_service_cross_job_cache_saved_time_counter->GetCell()->IncrementBy(
+      duration_us);
+}
+
 void RecordTFDataFilename(const string& name, const string& filename) {
   tf_data_filename_counter->GetCell(name, filename)->IncrementBy(1);
 }
@@ -283,6 +412,17 @@ void UpdateGraphExecTime(const uint64 running_time_usecs) {
   }
 }
 
+void RecordExecutorDispatches(int64 num_inline, int64 num_scheduled) {
+  static auto* inline_cell = executor_dispatches->GetCell("inline");
+  static auto* scheduled_cell = executor_dispatches->GetCell("scheduled");
+  if (num_inline > 0) inline_cell->IncrementBy(num_inline);
+  if (num_scheduled > 0) scheduled_cell->IncrementBy(num_scheduled);
+}
+
+monitoring::CounterCell* GetExecutorDispatchesCounter(const string& kind) {
+  return executor_dispatches->GetCell(kind);
+}
+
 void UpdateGraphPendingQueueLength(uint64 len) {
   static auto* graph_pending_queue_length_cell =
       graph_pending_queue_length_histogram->GetCell();
@@ -27,6 +27,15 @@ namespace metrics {
 // The `name` argument identifies the Dataset type (e.g. "ParallelMap").
 void RecordTFDataAutotune(const string& name);
 
+// Records the CPU budget (in cores) and RAM budget (in bytes) allocated to a
+// tf.data input pipeline for one round of autotuning, after the budgets of the
+// process have been divided among its concurrently autotuned pipelines.
+void RecordTFDataAutotuneAllocation(int64 cpu_budget, int64 ram_budget);
+
+// Records the number of tf.data input pipelines among which the autotuning
+// budgets of the process are divided.
+void RecordTFDataAutotuneModels(int64 num_models);
+
 // Returns a counter that can be used to record the number of bytes produced by
 // a tf.data.Dataset.
 //
@@ -56,6 +65,16 @@ monitoring::CounterCell* GetTFDataElementsCounter(const string& name);
 // Records the number of bytes fetched from tf.data.Dataset iterator.
 void RecordTFDataBytesFetched(int64 num_bytes);
 
+// Records the size of an element stored in a compressed tf.data memory cache
+// before and after compression. The ratio of the two totals is the compression
+// ratio of the cache.
+void RecordTFDataCacheCompression(int64 uncompressed_bytes,
+                                  int64 compressed_bytes);
+
+// Records that `num_bytes` of compressed tf.data memory cache elements were
+// decompressed in `duration_us` microseconds.
+void RecordTFDataCacheDecompression(int64 num_bytes, uint64 duration_us);
+
 // Records the number of times tf.data experiment is applied to input pipelines.
 void RecordTFDataExperiment(const string& name);
 
@@ -70,6 +89,10 @@ void RecordTFDataGetNextDuration(uint64 duration_us);
 // created using GraphHash().
 void RecordTFDataFingerprint(const string& name);
 
+// Records the time (in microseconds) that the consumer of a tf.data prefetch
+// buffer waited for an element because the buffer was empty.
+void RecordTFDataPrefetchWait(uint64 wait_us);
+
 // Records the time (in microseconds) during which `IteratorResource` was busy
 // processing at least one `GetNext()` request.
 void RecordTFDataIteratorBusy(uint64 duration_us);
@@ -87,6 +110,22 @@ void RecordTFDataOptimization(const string& name, int64 num_changes);
 // Records that a tf.data service worker has been created.
 void RecordTFDataServiceWorkerCreated();
 
+// Records a read from the cross-job element cache of a tf.data service worker.
+// `hit` is false if the element had to be produced for the read.
+void RecordTFDataServiceCrossJobCacheQuery(bool hit);
+
+// Records the load that the tf.data service worker at `worker_address` last
+// reported to the dispatcher. Fractions are recorded as percentages.
+void RecordTFDataServiceWorkerLoad(const string& worker_address,
+                                   int64 buffer_occupancy_percent,
+                                   int64 elements_per_second,
+                                   int64 cpu_utilization_percent);
+
+// Records the time (in microseconds) that a tf.data service worker saved by
+// serving an element from its cross-job element cache instead of producing it
+// again.
+void RecordTFDataServiceCrossJobCacheSavedTime(uint64 duration_us);
+
 // Records the file name read by a tf.data Dataset.
 //
 // The `name` argument identifies the Dataset type (e.g. "TFRecordDataset").
@@ -111,6 +150,15 @@ void RecordTPUXlaSpmdCoresPerReplica(int64 cores_per_replica);
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Records that an executor ran `num_inline` ready nodes on the thread that
+// made them ready, and handed `num_scheduled` ready nodes to its runner.
+void RecordExecutorDispatches(int64 num_inline, int64 num_scheduled);
+
+// Returns the counter of ready nodes dispatched by executors.
+//
+// The `kind` argument is either "inline" or "scheduled".
+monitoring::CounterCell* GetExecutorDispatchesCounter(const string& kind);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
@@ -1566,6 +1566,36 @@ Status Node::FromProto(ModelProto::Node node_proto,
   return Status::OK();
 }
 
+// static
+AutotuneCoordinator* AutotuneCoordinator::Global() {
+  static AutotuneCoordinator* const coordinator = new AutotuneCoordinator();
+  return coordinator;
+}
+
+double AutotuneCoordinator::Update(const void* model, double demand) {
+  mutex_lock l(mu_);
+  demands_[model] = std::max(demand, 0.0);
+  double total_demand = 0;
+  for (const auto& it : demands_) {
+    total_demand += it.second;
+  }
+  const double even_share = 1.0 / demands_.size();
+  if (total_demand <= 0) {
+    return even_share;
+  }
+  return 0.5 * even_share + 0.5 * demands_[model] / total_demand;
+}
+
+void AutotuneCoordinator::Remove(const void* model) {
+  mutex_lock l(mu_);
+  demands_.erase(model);
+}
+
+int64 AutotuneCoordinator::num_models() const {
+  tf_shared_lock l(mu_);
+  return demands_.size();
+}
+
 bool Model::publish_ = false;
 
 void Model::AddNode(Node::Factory factory, const string& name,
@@ -1631,6 +1661,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64 cpu_budget,
       OptimizeGradientDescent(snapshot, optimization_params,
                               cancellation_manager);
       break;
+    case AutotuneAlgorithm::ONLINE_COST_MODEL:
+      OptimizeOnlineCostModel(snapshot, optimization_params,
+                              cancellation_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -1713,8 +1747,16 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64 cpu_budget,
       },
       /*deregister_fn=*/&unused));
 
+  AutotuneCoordinator* coordinator = AutotuneCoordinator::Global();
+  auto cleanup = gtl::MakeCleanup([this, coordinator]() {
+    coordinator->Remove(this);
+    metrics::RecordTFDataAutotuneModels(coordinator->num_models());
+  });
+
   int64 last_optimization_ms = 0;
   int64 current_time_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
+  int64 last_num_elements = 0;
+  int64 last_demand_ns = EnvTime::NowNanos();
   while (true) {
     {
       mutex_lock l(mu_);
@@ -1731,8 +1773,25 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm, int64 cpu_budget,
       }
     }
 
+    int64 num_elements = 0;
+    {
+      tf_shared_lock l(mu_);
+      if (output_) num_elements = output_->num_elements();
+    }
+    const int64 now_ns = EnvTime::NowNanos();
+    const double share =
+        coordinator->Update(this, Demand(num_elements - last_num_elements,
+                                         now_ns - last_demand_ns));
+    last_num_elements = num_elements;
+    last_demand_ns = now_ns;
+    const int64 cpu_share =
+        std::max<int64>(1, std::llround(cpu_budget * share));
+    const int64 ram_share = static_cast<int64>(ram_budget * share);
+    metrics::RecordTFDataAutotuneModels(coordinator->num_models());
+    metrics::RecordTFDataAutotuneAllocation(cpu_share, ram_share);
+
     int64 start_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
-    Optimize(algorithm, cpu_budget, ram_budget, /*model_input_time=*/0,
+    Optimize(algorithm, cpu_share, ram_share, /*model_input_time=*/0,
              cancellation_manager);
     int64 end_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
     VLOG(2) << "Optimized for " << end_ms - start_ms << " ms.";
@@ -1885,6 +1944,162 @@ void Model::OptimizeHillClimb(std::shared_ptr<Node> snapshot,
   UpdateStateValues(&parameters);
 }
 
+double Model::UpdateProcessingTimeEstimates(std::shared_ptr<Node> snapshot) {
+  // Expected relative drift of the processing time between two optimizations.
+  constexpr double kDrift = 0.05L;
+  // Weight of the latest observation in the element variance estimate.
+  constexpr double kElementVarianceWeight = 0.2L;
+
+  mutex_lock l(estimates_mu_);
+  double total_mean = 0;
+  double total_variance = 0;
+  std::deque<std::shared_ptr<Node>> queue = {snapshot};
+  while (!queue.empty()) {
+    auto node = queue.front();
+    queue.pop_front();
+    for (auto input : node->inputs()) {
+      queue.push_back(input);
+    }
+    const int64 num_elements = node->num_elements();
+    const int64 processing_time = node->processing_time();
+    auto& estimate = processing_time_estimates_[node->long_name()];
+    const int64 new_elements = num_elements - estimate.num_elements;
+    if (new_elements > 0) {
+      // The average processing time of the new elements is an observation of
+      // the mean whose variance is `element_variance / new_elements`.
+      const double observation =
+          static_cast<double>(processing_time - estimate.processing_time) /
+          new_elements;
+      if (estimate.num_elements == 0) {
+        // Until there is more data, assume that the standard deviation of the
+        // processing time of an element is equal to its mean.
+        estimate.mean = observation;
+        estimate.element_variance = Square(observation);
+        estimate.variance = estimate.element_variance / new_elements;
+      } else {
+        const double residual = observation - estimate.mean;
+        estimate.variance += Square(kDrift * estimate.mean);
+        const double observation_variance =
+            estimate.element_variance / new_elements;
+        const double gain = estimate.variance /
+                            (estimate.variance + observation_variance + 1e-9);
+        estimate.mean += gain * residual;
+        estimate.variance *= 1 - gain;
+        estimate.element_variance =
+            (1 - kElementVarianceWeight) * estimate.element_variance +
+            kElementVarianceWeight * new_elements * Square(residual);
+      }
+      estimate.num_elements = num_elements;
+      estimate.processing_time = processing_time;
+    }
+    if (estimate.num_elements == 0) {
+      continue;
+    }
+    node->add_processing_time(std::llround(estimate.mean * num_elements) -
+                              processing_time);
+    total_mean += estimate.mean;
+    total_variance += estimate.variance;
+  }
+  if (total_mean <= 0) {
+    return 0;
+  }
+  return std::sqrt(total_variance) / total_mean;
+}
+
+void Model::OptimizeOnlineCostModel(
+    std::shared_ptr<Node> snapshot,
+    const OptimizationParams& optimization_params,
+    CancellationManager* cancellation_manager) {
+  VLOG(2) << "Starting optimization of tunable parameters with Online Cost "
+             "Model.";
+  const double relative_stddev = UpdateProcessingTimeEstimates(snapshot);
+  const double processing_time = TotalProcessingTime(snapshot);
+  auto parameters = CollectTunableParameters(snapshot);
+  if (parameters.empty()) {
+    VLOG(2) << "The Online Cost Model optimization is terminated since no node "
+               "with tunable parameters has recorded elements.";
+    return;
+  }
+  VLOG(2) << "Number of tunable parameters: " << parameters.size();
+
+  // The optimization stops once the output time is within this many standard
+  // deviations of the estimates of the target output time.
+  constexpr double kTargetStddevs = 2.0L;
+  // Buffer size parameter will only be incremented if the output latency
+  // improvement is greater than this constant.
+  constexpr double kBufferSizeMinDelta = 1.0L;
+
+  auto within_budgets = [&]() {
+    double parallelism = 0;
+    for (auto& pair : parameters) {
+      if (pair.second->name == kParallelism) {
+        parallelism += pair.second->value;
+      }
+    }
+    return parallelism <= optimization_params.cpu_budget() &&
+           TotalMaximumBufferedBytes(snapshot) <=
+               optimization_params.ram_budget();
+  };
+  auto output_time = [&]() {
+    return OutputTime(snapshot, optimization_params.model_input_time(),
+                      /*gradients=*/nullptr);
+  };
+
+  // Decreases the parameter whose decrease increases the output time the least
+  // until the budgets are respected.
+  while (!cancellation_manager->IsCancelled() && !within_budgets()) {
+    const double current_output_time = output_time();
+    double best_delta = std::numeric_limits<double>::max();
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      if (pair.second->value <= pair.second->min) {
+        continue;
+      }
+      pair.second->value--;
+      const double delta = output_time() - current_output_time;
+      if (delta < best_delta) {
+        best_delta = delta;
+        best_parameter = pair.second.get();
+      }
+      pair.second->value++;
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value--;
+  }
+
+  while (!cancellation_manager->IsCancelled()) {
+    const double current_output_time = output_time();
+    if (current_output_time < (1 + kTargetStddevs * relative_stddev) *
+                                  processing_time /
+                                  optimization_params.cpu_budget()) {
+      break;
+    }
+    double best_delta = 0;
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      if (pair.second->value >= pair.second->max) {
+        continue;
+      }
+      pair.second->value++;
+      const double delta = current_output_time - output_time();
+      if (delta > best_delta &&
+          (delta > kBufferSizeMinDelta || pair.second->name != kBufferSize) &&
+          within_budgets()) {
+        best_delta = delta;
+        best_parameter = pair.second.get();
+      }
+      pair.second->value--;
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value++;
+  }
+  UpdateStateValues(&parameters);
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node, double model_input_time,
                          Model::ParameterGradients* gradients) {
   // To store the input time for each node.
@@ -1908,6 +2123,25 @@ double Model::TotalMaximumBufferedBytes(std::shared_ptr<Node> node) {
   return node->TotalMaximumBufferedBytes();
 }
 
+double Model::Demand(int64 num_elements, int64 duration_ns) {
+  if (num_elements <= 0 || duration_ns <= 0) {
+    return 0;
+  }
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock l(mu_);
+    if (!output_) return 0;
+    snapshot = output_->Snapshot();
+  }
+  const double elements_per_ns =
+      static_cast<double>(num_elements) / duration_ns;
+  const double cores = TotalProcessingTime(snapshot) * elements_per_ns;
+  const double wait_ratio =
+      OutputTime(snapshot, /*model_input_time=*/0, /*gradients=*/nullptr) *
+      elements_per_ns;
+  return cores * (1 + wait_ratio);
+}
+
 double Model::TotalProcessingTime(std::shared_ptr<Node> node) {
   return node->TotalProcessingTime(/*processing_times=*/nullptr);
 }
@@ -623,6 +623,39 @@ std::shared_ptr<Node> MakeUnknownRatioNode(Node::Args args);
 // as pass-through between inputs and output.
 std::shared_ptr<Node> MakeUnknownNode(Node::Args args);
 
+// Divides the CPU and RAM budgets of the process among the models that are
+// concurrently running `Model::OptimizeLoop`, so that input pipelines sharing a
+// process do not each tune themselves to use all of its cores and memory.
+//
+// Before every optimization round, a model reports its demand and receives the
+// fraction of its budgets that it may use. Half of the budgets are split evenly
+// among the models, so that a model whose demand is not known yet is not
+// starved, and the other half in proportion to the reported demands. A model
+// that is the only one in the process is allocated its entire budgets.
+class AutotuneCoordinator {
+ public:
+  AutotuneCoordinator() = default;
+
+  // Returns the process-wide coordinator.
+  static AutotuneCoordinator* Global();
+
+  // Records the (non-negative) demand of the given model and returns the
+  // fraction of the budgets allocated to it.
+  double Update(const void* model, double demand) TF_LOCKS_EXCLUDED(mu_);
+
+  // Stops allocating budgets to the given model.
+  void Remove(const void* model) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of models the budgets are divided among.
+  int64 num_models() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  mutable mutex mu_;
+  absl::flat_hash_map<const void*, double> demands_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AutotuneCoordinator);
+};
+
 // Abstract representation of a TensorFlow input pipeline that can be used
 // for collecting runtime information and optimizing performance. It collects
 // runtime information about execution of the input pipeline that is used to
@@ -706,7 +739,8 @@ class Model {
       TF_LOCKS_EXCLUDED(mu_);
 
   // Uses the given algorithm and resource budgets to periodically perform the
-  // autotuning optimization.
+  // autotuning optimization. The budgets are shared with the other models of
+  // the process through `AutotuneCoordinator::Global()`.
   //
   // To terminate the execution of the optimization loop, the caller needs to
   // invoke `cancellation_mgr->StartCancel()`.
@@ -814,6 +848,29 @@ class Model {
                                const OptimizationParams& optimization_params,
                                CancellationManager* cancellation_manager);
 
+  // This optimization algorithm maintains an online estimate of the per-element
+  // processing time of every node, which is updated with the processing times
+  // recorded since the previous optimization using a Kalman filter, so that
+  // noisy measurements are smoothed while drifts are still tracked. Instead of
+  // starting from the minimum values, it starts from the current parameter
+  // values: it first decreases parameters until the CPU and RAM budgets are
+  // respected, then repeatedly increases the parameter whose increase
+  // decreases the output time the most while respecting the budgets, until the
+  // output time is within the uncertainty of the estimates of the processing
+  // time needed to produce an element divided by CPU budget. Compared to
+  // `OptimizeHillClimb`, this converges in fewer optimizations and does not
+  // oscillate when processing times are noisy.
+  void OptimizeOnlineCostModel(std::shared_ptr<Node> snapshot,
+                               const OptimizationParams& optimization_params,
+                               CancellationManager* cancellation_manager);
+
+  // Updates `processing_time_estimates_` with the processing time recorded by
+  // the nodes of the given snapshot and replaces the processing time of the
+  // snapshot nodes with the estimates. Returns the relative standard deviation
+  // of the sum of the estimates.
+  double UpdateProcessingTimeEstimates(std::shared_ptr<Node> snapshot)
+      TF_LOCKS_EXCLUDED(estimates_mu_);
+
   // Determines if we should stop the gradient descent optimization iterations
   // based on number of increasable parameters, CPU budget, RAM budget and
   // current resource usage.
@@ -826,6 +883,12 @@ class Model {
   // Collects the processing time for the given node.
   double TotalProcessingTime(std::shared_ptr<Node> node);
 
+  // Returns the demand reported to `AutotuneCoordinator`: the number of cores
+  // needed to produce `num_elements` elements in `duration_ns` nanoseconds,
+  // scaled up by the ratio of the output latency of the model to the time
+  // between consecutive elements, which is how much the consumer waits.
+  double Demand(int64 num_elements, int64 duration_ns);
+
   // Collects the total number of bytes buffered in all nodes in the subtree
   // rooted in the given node for which autotuning is enabled.
   double TotalBufferedBytes(std::shared_ptr<Node> node);
@@ -872,6 +935,24 @@ class Model {
   // Used for coordinating the saving loop and model optimization.
   condition_variable save_cond_var_;
 
+  // Online estimate of the per-element processing time of a node.
+  struct ProcessingTimeEstimate {
+    // Mean and variance of the estimate.
+    double mean = 0;
+    double variance = 0;
+    // Estimated variance of the processing time of a single element.
+    double element_variance = 0;
+    // Number of elements and processing time recorded by the node when the
+    // estimate was last updated.
+    int64 num_elements = 0;
+    int64 processing_time = 0;
+  };
+
+  // Used by the `ONLINE_COST_MODEL` algorithm, keyed by node long name.
+  mutex estimates_mu_;
+  absl::flat_hash_map<string, ProcessingTimeEstimate> processing_time_estimates_
+      TF_GUARDED_BY(estimates_mu_);
+
   // Indicates whether the save thread is cancelled.
   bool save_thread_cancelled_ = false;
 
@@ -16,11 +16,14 @@ limitations under the License.
 #include "tensorflow/core/framework/model.h"
 
 #include <memory>
+#include <random>
 
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -1168,7 +1171,7 @@ TEST_P(OptimizeZeroRamBudgetTest, Model) {
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, OptimizeZeroRamBudgetTest,
-                         ::testing::Values(0, 1));
+                         ::testing::Values(0, 1, 2));
 
 TEST(RecordTimeTest, RecordTimeTest) {
   std::shared_ptr<Node> source = model::MakeSourceNode({});
@@ -1179,6 +1182,181 @@ TEST(RecordTimeTest, RecordTimeTest) {
   EXPECT_FALSE(source->is_recording());
 }
 
+// Returns a recorded model of a `map(num_parallel_calls=AUTOTUNE)`, `batch`,
+// `prefetch(AUTOTUNE)` pipeline whose nodes have produced a single element.
+ModelProto RecordedPipeline() {
+  model::Model model;
+  std::shared_ptr<Node> prefetch = model::MakeAsyncKnownRatioNode(
+      {1, "prefetch", nullptr}, 1,
+      {model::MakeParameter(
+          "buffer_size",
+          std::make_shared<SharedState>(model::kAutotune, nullptr, nullptr),
+          /*min=*/1, /*max=*/16)});
+  std::shared_ptr<Node> batch =
+      model::MakeKnownRatioNode({2, "batch", prefetch}, 8);
+  std::shared_ptr<Node> map = model::MakeAsyncKnownRatioNode(
+      {3, "map", batch}, 1,
+      {model::MakeParameter(
+          "parallelism",
+          std::make_shared<SharedState>(model::kAutotune, nullptr, nullptr),
+          /*min=*/1, /*max=*/16)});
+  std::shared_ptr<Node> source = model::MakeSourceNode({4, "source", map});
+  std::shared_ptr<Node> parent = nullptr;
+  for (std::shared_ptr<Node> node : {prefetch, batch, map, source}) {
+    node->record_element();
+    node->record_buffer_event(100, 1);
+    node->add_processing_time(node == map ? 50000 : 1000);
+    model.AddNode([&node](model::Node::Args args) { return node; },
+                  node->name(), parent, &node);
+    parent = node;
+  }
+  ModelProto proto;
+  TF_CHECK_OK(model.ToProto(&proto));
+  proto.mutable_optimization_params()->set_cpu_budget(16);
+  proto.mutable_optimization_params()->set_ram_budget(1 << 20);
+  return proto;
+}
+
+// Replays a recorded model for `num_rounds` optimizations. Before every
+// optimization, every node of the model produces `kElementsPerRound` elements
+// whose processing times are drawn from a normal distribution around the
+// per-element processing time recorded for the node, with the coefficient of
+// variation `noise`. Tunable parameters start at their minimum values.
+//
+// Returns the number of optimizations after which the tunable parameters no
+// longer changed and the output time of the model with the final parameters.
+void ReplayModel(const ModelProto& recorded, AutotuneAlgorithm algorithm,
+                 double noise, int num_rounds, int* rounds_to_convergence,
+                 double* output_time) {
+  constexpr int kElementsPerRound = 100;
+  std::unique_ptr<Model> model;
+  TF_CHECK_OK(Model::FromProto(recorded, &model));
+  std::vector<std::pair<std::shared_ptr<Node>, double>> nodes;
+  std::deque<std::shared_ptr<Node>> queue = {model->output()};
+  while (!queue.empty()) {
+    auto node = queue.front();
+    queue.pop_front();
+    nodes.push_back({node, node->SelfProcessingTime()});
+    for (auto input : node->inputs()) {
+      queue.push_back(input);
+    }
+  }
+  Model::ModelParameters parameters =
+      model->output()->CollectTunableParameters();
+  for (auto& pair : parameters) {
+    pair.second->value = pair.second->min;
+    pair.second->state->value = pair.second->min;
+  }
+
+  std::mt19937 random(42);
+  std::normal_distribution<double> normal(1.0, noise);
+  std::vector<std::vector<double>> history;
+  CancellationManager cancellation_manager;
+  for (int round = 0; round < num_rounds; ++round) {
+    for (auto& node : nodes) {
+      for (int i = 0; i < kElementsPerRound; ++i) {
+        node.first->record_element();
+        node.first->add_processing_time(
+            std::llround(node.second * std::max(0.0, normal(random))));
+      }
+    }
+    model->Optimize(algorithm, recorded.optimization_params().cpu_budget(),
+                    recorded.optimization_params().ram_budget(),
+                    /*model_input_time=*/0, &cancellation_manager);
+    history.emplace_back();
+    for (auto& pair : parameters) {
+      history.back().push_back(pair.second->state->value);
+    }
+  }
+  *rounds_to_convergence = num_rounds;
+  while (*rounds_to_convergence > 1 &&
+         history[*rounds_to_convergence - 2] == history.back()) {
+    --*rounds_to_convergence;
+  }
+  *output_time = model->OutputTime(model->output(), /*model_input_time=*/0,
+                                   /*gradients=*/nullptr);
+}
+
+TEST(OnlineCostModelTest, ConvergesWithNoisyProcessingTimes) {
+  constexpr int kNumRounds = 50;
+  const ModelProto recorded = RecordedPipeline();
+  int hill_climb_rounds, online_cost_model_rounds;
+  double hill_climb_output_time, online_cost_model_output_time;
+  ReplayModel(recorded, AutotuneAlgorithm::HILL_CLIMB, /*noise=*/0.5,
+              kNumRounds, &hill_climb_rounds, &hill_climb_output_time);
+  ReplayModel(recorded, AutotuneAlgorithm::ONLINE_COST_MODEL, /*noise=*/0.5,
+              kNumRounds, &online_cost_model_rounds,
+              &online_cost_model_output_time);
+  EXPECT_LT(online_cost_model_rounds, kNumRounds);
+  EXPECT_GT(online_cost_model_output_time, 0);
+  EXPECT_LE(online_cost_model_output_time, 2 * hill_climb_output_time);
+}
+
+// Compares autotuning algorithms by replaying a recorded model (see
+// `ReplayModel`). The model is read from the file named by the
+// `TF_DATA_AUTOTUNE_REPLAY_MODEL` environment variable, as saved to
+// `TF_DATA_AUTOTUNE_DEBUG_DIR` by `Model::Save`, or defaults to
+// `RecordedPipeline()`. Reports the number of optimizations until convergence
+// and the throughput predicted for the final parameters.
+void BM_ReplayOptimization(::testing::benchmark::State& state) {
+  const auto algorithm = static_cast<AutotuneAlgorithm>(state.range(0));
+  const double noise = state.range(1) / 100.0;
+  string filename;
+  TF_CHECK_OK(
+      ReadStringFromEnvVar("TF_DATA_AUTOTUNE_REPLAY_MODEL", "", &filename));
+  ModelProto recorded;
+  if (filename.empty()) {
+    recorded = RecordedPipeline();
+  } else {
+    TF_CHECK_OK(ReadBinaryProto(Env::Default(), filename, &recorded));
+  }
+
+  int rounds_to_convergence = 0;
+  double output_time = 0;
+  for (auto s : state) {
+    ReplayModel(recorded, algorithm, noise, /*num_rounds=*/100,
+                &rounds_to_convergence, &output_time);
+  }
+  state.SetLabel(strings::StrCat(
+      AutotuneAlgorithm_Name(algorithm), " rounds_to_convergence:",
+      rounds_to_convergence, " elements_per_sec:",
+      output_time > 0 ? EnvTime::kSecondsToNanos / output_time : 0));
+}
+
+BENCHMARK(BM_ReplayOptimization)
+    ->ArgPair(AutotuneAlgorithm::HILL_CLIMB, 10)
+    ->ArgPair(AutotuneAlgorithm::HILL_CLIMB, 50)
+    ->ArgPair(AutotuneAlgorithm::GRADIENT_DESCENT, 10)
+    ->ArgPair(AutotuneAlgorithm::GRADIENT_DESCENT, 50)
+    ->ArgPair(AutotuneAlgorithm::ONLINE_COST_MODEL, 10)
+    ->ArgPair(AutotuneAlgorithm::ONLINE_COST_MODEL, 50);
+
+TEST(AutotuneCoordinatorTest, DividesBudgetsByDemand) {
+  AutotuneCoordinator coordinator;
+  int a, b, c;
+  // A single model is allocated the entire budgets.
+  EXPECT_EQ(1.0, coordinator.Update(&a, 5));
+  EXPECT_EQ(1.0, coordinator.Update(&a, 0));
+
+  // Without any demand, the budgets are split evenly.
+  EXPECT_EQ(0.5, coordinator.Update(&b, 0));
+  EXPECT_EQ(0.5, coordinator.Update(&a, 0));
+  EXPECT_EQ(2, coordinator.num_models());
+
+  // Half of the budgets is split evenly and half in proportion to demand.
+  EXPECT_DOUBLE_EQ(0.75, coordinator.Update(&b, 4));
+  EXPECT_DOUBLE_EQ(0.25, coordinator.Update(&a, 0));
+  EXPECT_DOUBLE_EQ(1.0 / 6 + 0.25, coordinator.Update(&c, 4));
+  EXPECT_DOUBLE_EQ(1.0 / 6, coordinator.Update(&a, 0));
+  EXPECT_DOUBLE_EQ(1.0 / 6 + 0.25, coordinator.Update(&b, 4));
+  EXPECT_EQ(3, coordinator.num_models());
+
+  coordinator.Remove(&b);
+  coordinator.Remove(&c);
+  EXPECT_EQ(1, coordinator.num_models());
+  EXPECT_EQ(1.0, coordinator.Update(&a, 0));
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace data
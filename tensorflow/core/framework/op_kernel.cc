@@ -683,7 +683,13 @@ Status OpKernelContext::allocate_output(StringPiece name,
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+  return allocate_tensor(get_allocator(attr), type, shape, out_tensor,
+                         allocation_attr);
+}
+
+Status OpKernelContext::allocate_tensor(
+    Allocator* a, DataType type, const TensorShape& shape, Tensor* out_tensor,
+    const AllocationAttributes& allocation_attr) {
   Tensor new_tensor(
       a, type, shape,
       AllocationAttributes(
@@ -741,7 +747,17 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
   ScopedMemoryDebugAnnotation op_annotation(op_kernel().name_view().data(),
                                             step_id(), "output", type, &shape);
   auto output_tensor = MakeUnique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Allocator* planned_allocator = params_->output_allocator_array != nullptr
+                                     ? params_->output_allocator_array[index]
+                                     : nullptr;
+  Status s;
+  if (planned_allocator != nullptr && attr.value == 0 && attr.scope_id == 0 &&
+      !track_allocations()) {
+    s = allocate_tensor(planned_allocator, type, shape, output_tensor.get(),
+                        AllocationAttributes());
+  } else {
+    s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  }
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
@@ -592,6 +592,12 @@ class OpKernelContext {
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
+    // If non-null, array indexed by output number for this node. A non-null
+    // entry is used instead of the device allocator by `allocate_output()`
+    // when the output has default allocator attributes. The executor uses
+    // this to serve outputs from a statically planned per-step arena.
+    Allocator* const* output_allocator_array = nullptr;
+
     // Shared resources accessible by this op kernel invocation.
     ResourceMgr* resource_manager = nullptr;
 
@@ -1219,6 +1225,9 @@ class OpKernelContext {
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
                          const AllocationAttributes& allocation_attr);
+  Status allocate_tensor(Allocator* a, DataType type, const TensorShape& shape,
+                         Tensor* out_tensor,
+                         const AllocationAttributes& allocation_attr);
 
   // Helpers for `set_output()`.
 
@@ -47,6 +47,7 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  hash_ = b.hash_;
   return *this;
 }
 
@@ -109,6 +110,7 @@ Status Rendezvous::ParseKey(StringPiece key, ParsedKey* out) {
     out->src_device = StringPiece(parts[0].data(), parts[0].size());
     out->dst_device = StringPiece(parts[2].data(), parts[2].size());
     out->edge_name = StringPiece(parts[3].data(), parts[3].size());
+    out->hash_ = Hash64(out->buf_.data(), out->buf_.size());
     return Status::OK();
   }
   return errors::InvalidArgument("Invalid  rendezvous key: ", key);
@@ -152,6 +154,7 @@ namespace {
 class LocalRendezvousWrapper : public Rendezvous {
  public:
   LocalRendezvousWrapper() : impl_(this) {}
+  explicit LocalRendezvousWrapper(bool lock_free) : impl_(this, lock_free) {}
 
   Status Send(const ParsedKey& key, const Args& send_args, const Tensor& val,
               const bool is_dead) override {
@@ -174,4 +177,8 @@ class LocalRendezvousWrapper : public Rendezvous {
 
 Rendezvous* NewLocalRendezvous() { return new LocalRendezvousWrapper; }
 
+Rendezvous* NewLocalRendezvous(bool lock_free) {
+  return new LocalRendezvousWrapper(lock_free);
+}
+
 }  // end namespace tensorflow
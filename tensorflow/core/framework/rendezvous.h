@@ -70,11 +70,16 @@ class RendezvousInterface {
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
 
+    // A hash of FullKey(), computed once when the key is parsed so that
+    // rendezvous tables do not rehash the key on every Send and Recv.
+    uint64 FullKeyHash() const { return hash_; }
+
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     std::string buf_;
+    uint64 hash_ = 0;
   };
 
   // The caller is a tensor producer and it sends a message (a tensor
@@ -183,6 +188,11 @@ class Rendezvous : public RendezvousInterface, public core::RefCounted {
 // ownership of one Ref() on the returned object.
 Rendezvous* NewLocalRendezvous();
 
+// As above, but explicitly selects whether the returned rendezvous uses the
+// lock-free table of LocalRendezvous instead of the default set by the
+// TF_LOCAL_RENDEZVOUS_LOCK_FREE environment variable.
+Rendezvous* NewLocalRendezvous(bool lock_free);
+
 }  // end namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_FRAMEWORK_RENDEZVOUS_H_
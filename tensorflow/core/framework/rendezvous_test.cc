@@ -15,12 +15,15 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -65,10 +68,11 @@ TEST(RendezvousTest, Key) {
       Rendezvous::ParseKey(strings::StrCat(key, ";", key), &parsed).ok());
 }
 
-class LocalRendezvousTest : public ::testing::Test {
+// The parameter selects the lock-free table of LocalRendezvous.
+class LocalRendezvousTest : public ::testing::TestWithParam<bool> {
  public:
   LocalRendezvousTest() : threads_(Env::Default(), "test", 16) {
-    rendez_ = NewLocalRendezvous();
+    rendez_ = NewLocalRendezvous(GetParam());
   }
 
   ~LocalRendezvousTest() override { rendez_->Unref(); }
@@ -116,7 +120,7 @@ const Rendezvous::ParsedKey& KeyBar() {
   return *key;
 }
 
-TEST_F(LocalRendezvousTest, SendRecv) {
+TEST_P(LocalRendezvousTest, SendRecv) {
   Rendezvous::Args args;
   TF_ASSERT_OK(rendez_->Send(KeyFoo(), args, V("hello"), false));
   Tensor val(DT_STRING);
@@ -125,7 +129,7 @@ TEST_F(LocalRendezvousTest, SendRecv) {
   EXPECT_EQ("hello", V(val));
 }
 
-TEST_F(LocalRendezvousTest, RecvSend) {
+TEST_P(LocalRendezvousTest, RecvSend) {
   SchedClosure([this]() {
     Env::Default()->SleepForMicroseconds(10000);
     Rendezvous::Args args;
@@ -138,7 +142,7 @@ TEST_F(LocalRendezvousTest, RecvSend) {
   EXPECT_EQ("hello", V(val));
 }
 
-TEST_F(LocalRendezvousTest, PingPong) {
+TEST_P(LocalRendezvousTest, PingPong) {
   SchedClosure([this]() {
     Tensor t(DT_STRING);
     bool is_dead = false;
@@ -155,7 +159,7 @@ TEST_F(LocalRendezvousTest, PingPong) {
   EXPECT_EQ("secret msg", V(val));
 }
 
-TEST_F(LocalRendezvousTest, CancelBeforeRecv) {
+TEST_P(LocalRendezvousTest, CancelBeforeRecv) {
   auto* cm = new CancellationManager();
   Tensor val(DT_STRING);
   bool is_dead = false;
@@ -169,7 +173,7 @@ TEST_F(LocalRendezvousTest, CancelBeforeRecv) {
   delete cm;
 }
 
-TEST_F(LocalRendezvousTest, CancelAfterRecv) {
+TEST_P(LocalRendezvousTest, CancelAfterRecv) {
   auto* cm = new CancellationManager();
   Notification n;
   SchedClosure([cm, &n]() {
@@ -189,7 +193,7 @@ TEST_F(LocalRendezvousTest, CancelAfterRecv) {
   delete cm;
 }
 
-TEST_F(LocalRendezvousTest, CancelEmptyQueue) {
+TEST_P(LocalRendezvousTest, CancelEmptyQueue) {
   auto* cm = new CancellationManager();
   Notification n;
   SchedClosure([this, cm, &n]() {
@@ -209,7 +213,7 @@ TEST_F(LocalRendezvousTest, CancelEmptyQueue) {
   delete cm;
 }
 
-TEST_F(LocalRendezvousTest, CancelMultiple) {
+TEST_P(LocalRendezvousTest, CancelMultiple) {
   auto* cm = new CancellationManager();
   SchedClosure([this, cm]() {
     Env::Default()->SleepForMicroseconds(10000);
@@ -284,7 +288,7 @@ struct BlockingState {
   Notification done;
 };
 
-TEST_F(LocalRendezvousTest, RandomSendRecv) {
+TEST_P(LocalRendezvousTest, RandomSendRecv) {
   // We are scheduling 2*N closures in the this->threads_, which is
   // configured with only 16 threads. Furthermore, because the
   // threadpool may execute the closures in an arbitrary order, we
@@ -337,7 +341,7 @@ void RandomSleep() {
   }
 }
 
-TEST_F(LocalRendezvousTest, MultiSends) {
+TEST_P(LocalRendezvousTest, MultiSends) {
   static const int N = 100;
   const auto& key_foo = KeyFoo();
   Rendezvous::Args args;
@@ -355,7 +359,7 @@ TEST_F(LocalRendezvousTest, MultiSends) {
   }
 }
 
-TEST_F(LocalRendezvousTest, RecvAbort) {
+TEST_P(LocalRendezvousTest, RecvAbort) {
   rendez_->Ref();
   SchedClosure([this]() {
     rendez_->StartAbort(errors::Aborted(""));  // abort
@@ -370,7 +374,7 @@ TEST_F(LocalRendezvousTest, RecvAbort) {
 
 // Similar to RecvAbort. But this test case ensures the main thread
 // Recv() call happens after StartAbort().
-TEST_F(LocalRendezvousTest, RecvSleepAbort) {
+TEST_P(LocalRendezvousTest, RecvSleepAbort) {
   rendez_->Ref();
   SchedClosure([this]() {
     Env::Default()->SleepForMicroseconds(1000000);
@@ -384,7 +388,7 @@ TEST_F(LocalRendezvousTest, RecvSleepAbort) {
   EXPECT_TRUE(errors::IsAborted(status));
 }
 
-TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
+TEST_P(LocalRendezvousTest, AbortThenRecvOrSend) {
   rendez_->StartAbort(errors::Aborted(""));
   Tensor val(DT_STRING);
   bool val_dead = false;
@@ -394,6 +398,72 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
       errors::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+TEST_P(LocalRendezvousTest, QueuedRecvsAreServedInOrder) {
+  // The second RecvAsync for a key makes the lock-free table hand the key
+  // over to the mutex-protected table.
+  static const int N = 10;
+  std::vector<string> received;
+  for (int i = 0; i < N; ++i) {
+    rendez_->RecvAsync(
+        KeyFoo(), Rendezvous::Args(),
+        [&received](const Status& s, const Rendezvous::Args& send_args,
+                    const Rendezvous::Args& recv_args, const Tensor& val,
+                    const bool is_dead) {
+          TF_EXPECT_OK(s);
+          received.push_back(V(val));
+        });
+  }
+  Rendezvous::Args args;
+  for (int i = 0; i < N; ++i) {
+    TF_ASSERT_OK(rendez_->Send(KeyFoo(), args, V(strings::StrCat(i)), false));
+  }
+  ASSERT_EQ(N, received.size());
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(strings::StrCat(i), received[i]);
+  }
+}
+
+TEST_P(LocalRendezvousTest, ManyKeys) {
+  // More keys than the lock-free table has slots, and more pending items than
+  // it preallocates.
+  static const int N = 4096;
+  Rendezvous::Args args;
+  for (int i = 0; i < N; ++i) {
+    TF_ASSERT_OK(rendez_->Send(MakeKey(strings::StrCat(i)), args,
+                               V(strings::StrCat(i)), false));
+  }
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  for (int i = 0; i < N; ++i) {
+    TF_ASSERT_OK(
+        rendez_->Recv(MakeKey(strings::StrCat(i)), args, &val, &is_dead));
+    EXPECT_EQ(strings::StrCat(i), V(val));
+  }
+}
+
+TEST_P(LocalRendezvousTest, AbortPendingRecvs) {
+  static const int N = 16;
+  BlockingState state;
+  state.counter = N;
+  auto* cm = new CancellationManager();
+  for (int i = 0; i < N; ++i) {
+    Rendezvous::Args args;
+    if (i % 2 == 0) args.cancellation_manager = cm;
+    rendez_->RecvAsync(
+        MakeKey(strings::StrCat(i)), args,
+        [&state](const Status& s, const Rendezvous::Args& send_args,
+                 const Rendezvous::Args& recv_args, const Tensor& val,
+                 const bool is_dead) {
+          EXPECT_TRUE(errors::IsAborted(s));
+          mutex_lock l(state.lock);
+          if (--state.counter == 0) state.done.Notify();
+        });
+  }
+  rendez_->StartAbort(errors::Aborted(""));
+  state.done.WaitForNotification();
+  delete cm;
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -410,7 +480,7 @@ class DummyDeviceContext : public DeviceContext {
   const int stream_id_;
 };
 
-TEST_F(LocalRendezvousTest, TransferDummyDeviceContext) {
+TEST_P(LocalRendezvousTest, TransferDummyDeviceContext) {
   Rendezvous::Args args;
   args.device_context = new DummyDeviceContext(123);
 
@@ -434,6 +504,8 @@ TEST_F(LocalRendezvousTest, TransferDummyDeviceContext) {
   args1.device_context->Unref();
 }
 
+INSTANTIATE_TEST_SUITE_P(LockFree, LocalRendezvousTest, ::testing::Bool());
+
 void BM_SendRecv(::testing::benchmark::State& state) {
   Rendezvous* rendez = NewLocalRendezvous();
   Tensor orig = V("val");
@@ -518,5 +590,61 @@ void BM_PingPong(::testing::benchmark::State& state) {
 }
 BENCHMARK(BM_PingPong)->Arg(100)->Arg(200)->Arg(300);
 
+// Each iteration runs one step on a fresh rendezvous, in which `num_pairs`
+// producer threads Send and `num_pairs` consumer threads RecvAsync a disjoint
+// share of 256 keys each, as in a graph partitioned across CPU devices.
+void BM_SendRecvAcrossThreads(::testing::benchmark::State& state) {
+  const bool lock_free = state.range(0);
+  const int num_pairs = state.range(1);
+  const int kKeysPerPair = 256;
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < num_pairs * kKeysPerPair; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("edge_", i)));
+  }
+  thread::ThreadPool pool(Env::Default(), "test", 2 * num_pairs);
+  const Tensor orig = V("val");
+
+  for (auto s : state) {
+    Rendezvous* rendez = NewLocalRendezvous(lock_free);
+    BlockingCounter received(keys.size());
+    BlockingCounter producers(num_pairs);
+    for (int p = 0; p < num_pairs; ++p) {
+      pool.Schedule([rendez, &keys, &orig, &producers, p, num_pairs]() {
+        Rendezvous::Args args;
+        for (int i = p; i < keys.size(); i += num_pairs) {
+          TF_CHECK_OK(rendez->Send(keys[i], args, orig, false));
+        }
+        producers.DecrementCount();
+      });
+      pool.Schedule([rendez, &keys, &received, p, num_pairs]() {
+        Rendezvous::Args args;
+        for (int i = p; i < keys.size(); i += num_pairs) {
+          rendez->RecvAsync(keys[i], args,
+                            [&received](const Status& s,
+                                        const Rendezvous::Args& send_args,
+                                        const Rendezvous::Args& recv_args,
+                                        const Tensor& val, const bool is_dead) {
+                              TF_CHECK_OK(s);
+                              received.DecrementCount();
+                            });
+        }
+      });
+    }
+    producers.Wait();
+    received.Wait();
+    rendez->Unref();
+  }
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()) *
+                          keys.size());
+  state.SetLabel(lock_free ? "lock_free" : "mutex");
+}
+BENCHMARK(BM_SendRecvAcrossThreads)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1)
+    ->ArgPair(0, 4)
+    ->ArgPair(1, 4)
+    ->ArgPair(0, 16)
+    ->ArgPair(1, 16);
+
 }  // namespace
 }  // namespace tensorflow
@@ -40,6 +40,9 @@ namespace {
 // LINT.IfChange
 static constexpr int32 kMaxConcurrentHandlers = 128;
 // LINT.ThenChange(//tensorflow/core/framework/run_handler_test.cc)
+// Time (in ms) after which an active request is scheduled ahead of newer
+// requests regardless of its priority.
+static constexpr int32 kMaxStarvationMs = 1000;
 
 typedef typename internal::RunHandlerEnvironment::Task Task;
 typedef Eigen::RunQueue<Task, 1024> Queue;
@@ -728,6 +731,10 @@ class RunHandler::Impl {
   // Stores now time (in microseconds) since unix epoch when the handler is
   // requested via RunHandlerPool::Get().
   uint64 start_time_us() const { return start_time_us_; }
+  // Absolute deadline (in microseconds since unix epoch) derived from
+  // `RunHandlerPoolOptions::deadline_in_us`, or kuint64max if the request has
+  // no deadline.
+  uint64 deadline_us() const { return deadline_us_; }
   int64 step_id() const { return step_id_; }
   void ScheduleInterOpClosure(std::function<void()> fn);
   void ScheduleIntraOpClosure(std::function<void()> fn);
@@ -739,7 +746,7 @@ class RunHandler::Impl {
 
   internal::ThreadWorkSource* tws() { return &tws_; }
 
-  int64 priority() { return options_.priority(); }
+  int64 priority() const { return options_.priority(); }
 
  private:
   class ThreadPoolInterfaceWrapper : public thread::ThreadPoolInterface {
@@ -757,6 +764,7 @@ class RunHandler::Impl {
 
   RunHandlerPool::Impl* pool_impl_;  // NOT OWNED.
   uint64 start_time_us_;
+  uint64 deadline_us_;
   int64 step_id_;
   std::unique_ptr<thread::ThreadPoolInterface> thread_pool_interface_;
   internal::ThreadWorkSource tws_;
@@ -779,6 +787,10 @@ class RunHandlerPool::Impl {
             num_inter_op_threads, num_intra_op_threads, Env::Default(),
             ThreadOptions(), "tf_run_handler_pool", &waiters_mu_,
             &queue_waiters_)),
+        max_starvation_us_(static_cast<uint64>(ParamFromEnvWithDefault(
+                               "TF_RUN_HANDLER_MAX_STARVATION_MS",
+                               kMaxStarvationMs)) *
+                           1000),
         iterations_(0),
         version_(0),
         sub_thread_pool_end_request_percentage_(ParamFromEnvWithDefault(
@@ -854,27 +866,19 @@ class RunHandlerPool::Impl {
           return nullptr;
         }
       }
-      // Remove the last entry from free_handlers_ and add to the end of
+      // Remove the last entry from free_handlers_ and add it to
       // sorted_active_handlers_.
       handler_impl = free_handlers_.back();
       handler_impl->Reset(step_id, options);
       free_handlers_.pop_back();
+      sorted_active_handlers_.push_back(handler_impl);
+      SortActiveHandlers(handler_impl->start_time_us());
 
-      num_active_requests = sorted_active_handlers_.size() + 1;
+      num_active_requests = sorted_active_handlers_.size();
       thread_work_sources->resize(num_active_requests);
-      int priority = options.priority();
-      auto it = sorted_active_handlers_.cbegin();
-      bool new_handler_inserted = false;
-      for (int i = 0; i < num_active_requests; ++i) {
-        if (!new_handler_inserted && (it == sorted_active_handlers_.cend() ||
-                                      priority > (*it)->priority())) {
-          sorted_active_handlers_.insert(it, handler_impl);
-          new_handler_inserted = true;
-          // Point to the newly added handler.
-          --it;
-        }
-        (*thread_work_sources)[i] = (*it)->tws();
-        ++it;
+      int i = 0;
+      for (RunHandler::Impl* active_handler : sorted_active_handlers_) {
+        (*thread_work_sources)[i++] = active_handler->tws();
       }
       version = ++version_;
     }
@@ -923,7 +927,24 @@ class RunHandlerPool::Impl {
     return ret;
   }
 
+  std::vector<int64> GetActiveHandlerStepIdsForTesting()
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    std::vector<int64> ret;
+    for (const auto& handler_impl : sorted_active_handlers_) {
+      ret.push_back(handler_impl->step_id());
+    }
+    return ret;
+  }
+
  private:
+  // Orders sorted_active_handlers_ by decreasing priority and, within a
+  // priority, by increasing deadline. Handlers that have been active for at
+  // least max_starvation_us_ at time `now` are moved to the front in order of
+  // their start time, so that a steady stream of higher priority requests
+  // cannot starve them indefinitely.
+  void SortActiveHandlers(uint64 now) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   void RecomputePoolStats(
       int num_active_requests, uint64 version,
       const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
@@ -942,8 +963,7 @@ class RunHandlerPool::Impl {
 
   std::unique_ptr<internal::RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by SortActiveHandlers().
   // TODO(chaox): Consider other data structure for maintaining the sorted
   // active handlers if the searching overhead(currently O(n)) becomes the
   // bottleneck.
@@ -951,6 +971,11 @@ class RunHandlerPool::Impl {
   std::vector<RunHandler::Impl*> free_handlers_ TF_GUARDED_BY(mu_);
   std::vector<std::unique_ptr<RunHandler::Impl>> handlers_ TF_GUARDED_BY(mu_);
 
+  // Time after which an active handler is scheduled ahead of all handlers
+  // that have not been waiting as long, regardless of priority. Zero disables
+  // starvation avoidance.
+  const uint64 max_starvation_us_;
+
   // Histogram of elapsed runtime of every handler (in ms).
   histogram::Histogram time_hist_ TF_GUARDED_BY(mu_);
 
@@ -960,6 +985,26 @@ class RunHandlerPool::Impl {
   const std::vector<double> sub_thread_pool_end_request_percentage_;
 };
 
+void RunHandlerPool::Impl::SortActiveHandlers(uint64 now) {
+  auto starved = [this, now](const RunHandler::Impl* handler) {
+    return max_starvation_us_ > 0 && now > handler->start_time_us() &&
+           now - handler->start_time_us() >= max_starvation_us_;
+  };
+  // std::list::sort is stable, so handlers that compare equal keep their
+  // arrival order.
+  sorted_active_handlers_.sort(
+      [&starved](const RunHandler::Impl* a, const RunHandler::Impl* b) {
+        const bool a_starved = starved(a);
+        const bool b_starved = starved(b);
+        if (a_starved != b_starved) return a_starved;
+        if (a_starved) return a->start_time_us() < b->start_time_us();
+        if (a->priority() != b->priority()) {
+          return a->priority() > b->priority();
+        }
+        return a->deadline_us() < b->deadline_us();
+      });
+}
+
 void RunHandlerPool::Impl::RecomputePoolStats(
     int num_active_requests, uint64 version,
     const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
@@ -1067,6 +1112,9 @@ void RunHandler::Impl::Reset(
     int64 step_id,
     const RunOptions::Experimental::RunHandlerPoolOptions& options) {
   start_time_us_ = tensorflow::Env::Default()->NowMicros();
+  deadline_us_ = options.deadline_in_us() > 0
+                     ? start_time_us_ + options.deadline_in_us()
+                     : kuint64max;
   step_id_ = step_id;
   options_ = options;
   tws_.SetTracemeId(step_id);
@@ -1092,6 +1140,10 @@ std::vector<int64> RunHandlerPool::GetActiveHandlerPrioritiesForTesting()
   return impl_->GetActiveHandlerPrioritiesForTesting();
 }
 
+std::vector<int64> RunHandlerPool::GetActiveHandlerStepIdsForTesting() const {
+  return impl_->GetActiveHandlerStepIdsForTesting();
+}
+
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
 
 void RunHandler::ScheduleInterOpClosure(std::function<void()> fn) {
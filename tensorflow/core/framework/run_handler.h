@@ -63,6 +63,13 @@ class RunHandlerPool {
   // unique_ptr is destroyed.
   //
   // Will block unless there is an inactive handler.
+  //
+  // Inter-op work of active handlers is picked up by decreasing
+  // `options.priority()` and, within a priority, earliest deadline first (see
+  // `RunHandlerPoolOptions::deadline_in_us`). A handler that has been active
+  // for longer than TF_RUN_HANDLER_MAX_STARVATION_MS (1s by default) is
+  // favored over all newer handlers, which bounds the starvation of low
+  // priority requests.
   std::unique_ptr<RunHandler> Get(
       int64 step_id = 0, int64 timeout_in_ms = 0,
       const RunOptions::Experimental::RunHandlerPoolOptions& options =
@@ -72,6 +79,10 @@ class RunHandlerPool {
   // order of the active handler list.
   std::vector<int64> GetActiveHandlerPrioritiesForTesting() const;
 
+  // Get the step ids for active handlers, in the same order as
+  // GetActiveHandlerPrioritiesForTesting().
+  std::vector<int64> GetActiveHandlerStepIdsForTesting() const;
+
  private:
   class Impl;
   friend class RunHandler;
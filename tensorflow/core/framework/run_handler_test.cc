@@ -29,10 +29,14 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/histogram/histogram.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -113,6 +117,60 @@ TEST(RunHandlerUtilTest, PrioritySchedulingTest) {
   EXPECT_EQ(sorted_active_list[3], 1);
 }
 
+TEST(RunHandlerUtilTest, DeadlineSchedulingTest) {
+  int num_threads = 2;
+  std::unique_ptr<RunHandlerPool> pool(
+      new RunHandlerPool(num_threads, num_threads));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options =
+      RunOptions::Experimental::RunHandlerPoolOptions();
+  options.set_deadline_in_us(300000);
+  auto handler1 = pool->Get(/*step_id=*/1, /*timeout_in_ms=*/0, options);
+  options.set_deadline_in_us(0);
+  auto handler2 = pool->Get(/*step_id=*/2, /*timeout_in_ms=*/0, options);
+  options.set_deadline_in_us(100000);
+  auto handler3 = pool->Get(/*step_id=*/3, /*timeout_in_ms=*/0, options);
+  options.set_deadline_in_us(200000);
+  auto handler4 = pool->Get(/*step_id=*/4, /*timeout_in_ms=*/0, options);
+
+  // Requests with the same priority are ordered by deadline, and requests
+  // without a deadline come last.
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64>({3, 4, 1, 2}));
+
+  // Priority takes precedence over deadlines.
+  options.set_priority(1);
+  options.set_deadline_in_us(0);
+  auto handler5 = pool->Get(/*step_id=*/5, /*timeout_in_ms=*/0, options);
+  options.set_priority(-1);
+  options.set_deadline_in_us(1);
+  auto handler6 = pool->Get(/*step_id=*/6, /*timeout_in_ms=*/0, options);
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64>({5, 3, 4, 1, 2, 6}));
+}
+
+TEST(RunHandlerUtilTest, StarvationTest) {
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_MAX_STARVATION_MS", "50", true), 0);
+  int num_threads = 2;
+  std::unique_ptr<RunHandlerPool> pool(
+      new RunHandlerPool(num_threads, num_threads));
+  ASSERT_EQ(unsetenv("TF_RUN_HANDLER_MAX_STARVATION_MS"), 0);
+
+  RunOptions::Experimental::RunHandlerPoolOptions options =
+      RunOptions::Experimental::RunHandlerPoolOptions();
+  auto low_priority = pool->Get(/*step_id=*/1, /*timeout_in_ms=*/0, options);
+  options.set_priority(1);
+  auto high_priority1 = pool->Get(/*step_id=*/2, /*timeout_in_ms=*/0, options);
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64>({2, 1}));
+
+  // Once they have waited long enough, requests are ordered by start time.
+  Env::Default()->SleepForMicroseconds(60 * 1000);
+  auto high_priority2 = pool->Get(/*step_id=*/3, /*timeout_in_ms=*/0, options);
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64>({1, 2, 3}));
+}
+
 TEST(RunHandlerThreadPool, EnqueueTask) {
   Eigen::MaxSizeVector<mutex> waiters_mu(2);
   waiters_mu.resize(2);
@@ -811,5 +869,74 @@ TEST_F(RunHandlerTest, TestWaitTimeout) {
   EXPECT_NE(next_handle.get(), nullptr);
 }
 
+// Simulates `num_requests` concurrent requests sharing one RunHandlerPool, of
+// which `high_priority_percentage` percent are short, latency sensitive
+// requests with a higher priority and a deadline, and the rest are longer
+// batch requests. Reports the p50/p99 latency of each class in the label.
+void BM_MixedPriorityWorkload(::testing::benchmark::State& state) {
+  const int num_requests = state.range(0);
+  const int high_priority_percentage = state.range(1);
+  constexpr int kNumThreads = 4;
+  constexpr int kHighPriorityOps = 4;
+  constexpr int kLowPriorityOps = 32;
+  constexpr int kOpMicros = 20;
+
+  RunHandlerPool pool(kNumThreads, kNumThreads);
+  thread::ThreadPool clients(Env::Default(), "clients", num_requests);
+  mutex mu;
+  // Indexed by whether the request is high priority.
+  histogram::Histogram latency_ms[2];
+  int64 step_id = 0;
+  for (auto s : state) {
+    BlockingCounter requests_done(num_requests);
+    for (int r = 0; r < num_requests; ++r) {
+      const bool high_priority =
+          (r * high_priority_percentage) % 100 < high_priority_percentage;
+      const int64 id = ++step_id;
+      clients.Schedule([&, high_priority, id]() {
+        RunOptions::Experimental::RunHandlerPoolOptions options;
+        if (high_priority) {
+          options.set_priority(1);
+          options.set_deadline_in_us(1000);
+        }
+        const uint64 start_us = Env::Default()->NowMicros();
+        std::unique_ptr<RunHandler> handler =
+            pool.Get(id, /*timeout_in_ms=*/0, options);
+        const int num_ops = high_priority ? kHighPriorityOps : kLowPriorityOps;
+        BlockingCounter ops_done(num_ops);
+        for (int i = 0; i < num_ops; ++i) {
+          handler->ScheduleInterOpClosure([&ops_done]() {
+            const uint64 end_us = Env::Default()->NowMicros() + kOpMicros;
+            while (Env::Default()->NowMicros() < end_us) {
+            }
+            ops_done.DecrementCount();
+          });
+        }
+        ops_done.Wait();
+        handler.reset();
+        const double elapsed_ms =
+            (Env::Default()->NowMicros() - start_us) / 1000.0;
+        {
+          mutex_lock l(mu);
+          latency_ms[high_priority].Add(elapsed_ms);
+        }
+        requests_done.DecrementCount();
+      });
+    }
+    requests_done.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_requests);
+  mutex_lock l(mu);
+  state.SetLabel(strings::Printf(
+      "high p50=%.3fms p99=%.3fms low p50=%.3fms p99=%.3fms",
+      latency_ms[1].Median(), latency_ms[1].Percentile(99),
+      latency_ms[0].Median(), latency_ms[0].Percentile(99)));
+}
+BENCHMARK(BM_MixedPriorityWorkload)
+    ->ArgPair(16, 25)
+    ->ArgPair(64, 25)
+    ->ArgPair(64, 50)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace tensorflow
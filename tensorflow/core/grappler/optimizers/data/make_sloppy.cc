@@ -32,12 +32,13 @@ constexpr std::array<const char*, 3> kSloppyAttrOps = {
     "ParseExampleDataset",
 };
 
-constexpr std::array<const char*, 5> kDeterministicAttrOps = {
+constexpr std::array<const char*, 6> kDeterministicAttrOps = {
     "LegacyParallelInterleaveDatasetV2",
     "ParallelInterleaveDatasetV3",
     "ParallelInterleaveDatasetV4",
     "ParallelMapDatasetV2",
     "ParallelBatchDataset",
+    "PrefetchDataset",
 };
 }  // anonymous namespace
 
@@ -57,8 +58,11 @@ Status MakeSloppy::OptimizeAndCollectStats(Cluster* cluster,
       }
     }
     for (const auto& op_name : kDeterministicAttrOps) {
-      if (node.op() == op_name &&
-          node.attr().at("deterministic").s() == "default") {
+      // Graphs serialized before `PrefetchDataset` had a "deterministic"
+      // attr may not have it.
+      auto it = node.attr().find("deterministic");
+      if (node.op() == op_name && it != node.attr().end() &&
+          it->second.s() == "default") {
         (*node.mutable_attr())["deterministic"].set_s("false");
         stats->num_changes++;
         break;
@@ -188,6 +188,31 @@ TEST(ChangeDefault, ParallelBatch) {
   EXPECT_EQ(output.node(index).attr().at("deterministic").s(), "false");
 }
 
+TEST(ChangeDefault, Prefetch) {
+  using test::function::NDef;
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {NDef("start", "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}),
+       NDef("stop", "Const", {}, {{"value", 10}, {"dtype", DT_INT32}}),
+       NDef("step", "Const", {}, {{"value", 1}, {"dtype", DT_INT32}}),
+       NDef("range", "RangeDataset", {"start", "stop", "step"}, {}),
+       NDef("buffer_size", "Const", {}, {{"value", 1}, {"dtype", DT_INT64}}),
+       NDef("prefetch", "PrefetchDataset", {"range", "buffer_size"},
+            {{"deterministic", "default"}}),
+       NDef("prefetch_without_attr", "PrefetchDataset",
+            {"prefetch", "buffer_size"}, {})},
+      // FunctionLib
+      {});
+
+  MakeSloppy optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  int index = graph_utils::FindGraphNodeWithName("prefetch", output);
+  EXPECT_EQ(output.node(index).attr().at("deterministic").s(), "false");
+  index = graph_utils::FindGraphNodeWithName("prefetch_without_attr", output);
+  EXPECT_EQ(output.node(index).attr().count("deterministic"), 0);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
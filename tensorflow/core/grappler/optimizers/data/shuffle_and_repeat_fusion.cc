@@ -42,6 +42,15 @@ constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
 constexpr char kOutputShapes[] = "output_shapes";
 constexpr char kOutputTypes[] = "output_types";
 constexpr char kReshuffleEachIteration[] = "reshuffle_each_iteration";
+constexpr char kMemoryBudgetBytes[] = "memory_budget_bytes";
+
+// Copies the memory budget of the shuffle, which graphs that predate it do
+// not set.
+void CopyMemoryBudget(const NodeDef& shuffle_node, NodeDef* fused_node) {
+  if (shuffle_node.attr().contains(kMemoryBudgetBytes)) {
+    graph_utils::CopyAttribute(kMemoryBudgetBytes, shuffle_node, fused_node);
+  }
+}
 
 Status FuseShuffleV1AndRepeat(const NodeDef& shuffle_node,
                               const NodeDef& repeat_node,
@@ -71,6 +80,7 @@ Status FuseShuffleV1AndRepeat(const NodeDef& shuffle_node,
   for (auto key : {kOutputShapes, kOutputTypes, kReshuffleEachIteration}) {
     graph_utils::CopyAttribute(key, shuffle_node, fused_node);
   }
+  CopyMemoryBudget(shuffle_node, fused_node);
 
   return Status::OK();
 }
@@ -145,6 +155,7 @@ Status FuseShuffleV3AndRepeat(const NodeDef& shuffle_node,
   for (auto key : {kOutputShapes, kOutputTypes, kReshuffleEachIteration}) {
     graph_utils::CopyAttribute(key, shuffle_node, fused_node);
   }
+  CopyMemoryBudget(shuffle_node, fused_node);
 
   return Status::OK();
 }
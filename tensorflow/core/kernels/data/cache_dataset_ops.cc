@@ -14,13 +14,20 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <deque>
+
+#include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/stats_utils.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
@@ -37,6 +44,8 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const CacheDatasetOp::kMemoryBudgetBytes;
+/* static */ constexpr const char* const CacheDatasetOp::kCompression;
 
 namespace {
 
@@ -57,6 +66,11 @@ constexpr char kCache[] = "cache";
 constexpr char kSizeSuffix[] = ".size";
 constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
+constexpr char kNumSpilled[] = "num_spilled";
+constexpr char kSpilled[] = "spilled";
+constexpr char kNumComponents[] = "num_components";
+constexpr char kComponent[] = "component";
+constexpr char kNumElements[] = "num_elements";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
 constexpr char kIncompleteCacheErrorMessage[] =
@@ -66,6 +80,137 @@ constexpr char kIncompleteCacheErrorMessage[] =
     "an input pipeline similar to `dataset.cache().take(k).repeat()`. You "
     "should use `dataset.take(k).cache().repeat()` instead.";
 
+// Writes the elements of `spilled` to the checkpoint one at a time, so that
+// they do not all need to be in memory at once.
+Status WriteSpilledElementsToCheckpoint(IteratorStateWriter* writer,
+                                        const string& key_prefix,
+                                        const SpilledElements& spilled) {
+  TF_RETURN_IF_ERROR(
+      writer->WriteScalar(key_prefix, kNumSpilled, spilled.num_elements()));
+  std::unique_ptr<SpilledElements::Reader> reader;
+  TF_RETURN_IF_ERROR(spilled.NewReader(&reader));
+  std::vector<Tensor> element;
+  for (int64 i = 0; i < spilled.num_elements(); ++i) {
+    TF_RETURN_IF_ERROR(reader->Read(&element));
+    const string element_prefix =
+        strings::StrCat(key_prefix, "::", kSpilled, "_", i);
+    TF_RETURN_IF_ERROR(
+        writer->WriteScalar(element_prefix, kNumComponents, element.size()));
+    for (int j = 0; j < element.size(); ++j) {
+      TF_RETURN_IF_ERROR(writer->WriteTensor(
+          element_prefix, strings::StrCat(kComponent, "[", j, "]"),
+          element[j]));
+    }
+  }
+  return Status::OK();
+}
+
+// Reads the elements written by `WriteSpilledElementsToCheckpoint()` into a
+// new spill file. Leaves `*spilled` null if the checkpoint has none.
+Status ReadSpilledElementsFromCheckpoint(
+    IteratorContext* ctx, IteratorStateReader* reader, const string& key_prefix,
+    const string& spill_directory, std::unique_ptr<SpilledElements>* spilled) {
+  spilled->reset();
+  if (!reader->Contains(key_prefix, kNumSpilled)) return Status::OK();
+  int64 num_spilled;
+  TF_RETURN_IF_ERROR(reader->ReadScalar(key_prefix, kNumSpilled, &num_spilled));
+  TF_RETURN_IF_ERROR(
+      SpilledElements::Create(ctx->env(), spill_directory, spilled));
+  std::vector<Tensor> element;
+  for (int64 i = 0; i < num_spilled; ++i) {
+    const string element_prefix =
+        strings::StrCat(key_prefix, "::", kSpilled, "_", i);
+    int64 num_components;
+    TF_RETURN_IF_ERROR(
+        reader->ReadScalar(element_prefix, kNumComponents, &num_components));
+    element.resize(num_components);
+    for (int j = 0; j < num_components; ++j) {
+      TF_RETURN_IF_ERROR(reader->ReadTensor(
+          element_prefix, strings::StrCat(kComponent, "[", j, "]"),
+          &element[j]));
+    }
+    TF_RETURN_IF_ERROR((*spilled)->Append(element));
+  }
+  return Status::OK();
+}
+
+// Returns the `compression` attr value that creates caches like `cache`.
+string CacheCompression(const MemoryCache& cache) {
+  return cache.compressed() ? io::compression::kSnappy : "";
+}
+
+// Returns the number of bytes of tensor data in `element`. The elements of a
+// compressed cache count their compressed size.
+int64 ElementBytes(const std::vector<Tensor>& element) {
+  int64 bytes = 0;
+  for (const Tensor& t : element) {
+    const CompressedElement* compressed =
+        t.dtype() == DT_VARIANT && t.NumElements() == 1
+            ? t.scalar<Variant>()().get<CompressedElement>()
+            : nullptr;
+    bytes += compressed != nullptr ? compressed->data().size() : t.TotalBytes();
+  }
+  return bytes;
+}
+
+// Writes the in-memory elements of a cache to the checkpoint, in the format of
+// `WriteElementsToCheckpoint()`. The elements of a compressed cache are
+// uncompressed one at a time as they are written, so that checkpoints do not
+// depend on whether the cache is compressed, and the cache is never held
+// uncompressed in memory.
+Status WriteCacheToCheckpoint(IteratorStateWriter* writer,
+                              const string& key_prefix, bool compressed,
+                              const std::vector<std::vector<Tensor>>& data) {
+  if (!compressed) {
+    return WriteElementsToCheckpoint(writer, key_prefix, data);
+  }
+  TF_RETURN_IF_ERROR(
+      writer->WriteScalar(key_prefix, kNumElements, data.size()));
+  std::vector<Tensor> element;
+  for (size_t i = 0; i < data.size(); ++i) {
+    TF_RETURN_IF_ERROR(UncompressCacheElement(data[i], &element));
+    const string element_prefix = strings::StrCat(key_prefix, "::", i);
+    TF_RETURN_IF_ERROR(
+        writer->WriteScalar(element_prefix, kNumComponents, element.size()));
+    for (int j = 0; j < element.size(); ++j) {
+      TF_RETURN_IF_ERROR(writer->WriteTensor(
+          element_prefix, strings::StrCat(kComponent, "[", j, "]"),
+          element[j]));
+    }
+  }
+  return Status::OK();
+}
+
+// Reads the elements written by `WriteCacheToCheckpoint()`. If `compressed` is
+// true, each element is compressed as soon as it is read.
+Status ReadCacheFromCheckpoint(IteratorStateReader* reader,
+                               const string& key_prefix, bool compressed,
+                               std::vector<std::vector<Tensor>>* data) {
+  if (!compressed) {
+    return ReadElementsFromCheckpoint(reader, key_prefix, data);
+  }
+  int64 num_elements;
+  TF_RETURN_IF_ERROR(
+      reader->ReadScalar(key_prefix, kNumElements, &num_elements));
+  data->reserve(num_elements);
+  std::vector<Tensor> element;
+  for (int64 i = 0; i < num_elements; ++i) {
+    const string element_prefix = strings::StrCat(key_prefix, "::", i);
+    int64 num_components;
+    TF_RETURN_IF_ERROR(
+        reader->ReadScalar(element_prefix, kNumComponents, &num_components));
+    element.resize(num_components);
+    for (int j = 0; j < num_components; ++j) {
+      TF_RETURN_IF_ERROR(reader->ReadTensor(
+          element_prefix, strings::StrCat(kComponent, "[", j, "]"),
+          &element[j]));
+    }
+    data->emplace_back();
+    TF_RETURN_IF_ERROR(CompressCacheElement(element, &data->back()));
+  }
+  return Status::OK();
+}
+
 }  // namespace
 
 class CacheDatasetOp::FileDatasetBase : public DatasetBase {
@@ -735,8 +880,13 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       if (cache_->IsCompleted()) {
         TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCacheCompleted), ""));
-        TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+        TF_RETURN_IF_ERROR(WriteCacheToCheckpoint(
+            writer, prefix(), cache_->compressed(), cache_->data()));
+        std::shared_ptr<const SpilledElements> spilled = cache_->spilled();
+        if (spilled != nullptr) {
+          TF_RETURN_IF_ERROR(
+              WriteSpilledElementsToCheckpoint(writer, prefix(), *spilled));
+        }
       }
       return SaveInput(ctx, writer, iterator_);
     }
@@ -748,9 +898,13 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       cache_->Reset();
       if (reader->Contains(full_name(kCacheCompleted))) {
         std::vector<std::vector<Tensor>> temp_cache;
-        TF_RETURN_IF_ERROR(
-            ReadElementsFromCheckpoint(reader, prefix(), &temp_cache));
-        cache_->Complete(std::move(temp_cache));
+        TF_RETURN_IF_ERROR(ReadCacheFromCheckpoint(
+            reader, prefix(), cache_->compressed(), &temp_cache));
+        std::unique_ptr<SpilledElements> spilled;
+        TF_RETURN_IF_ERROR(ReadSpilledElementsFromCheckpoint(
+            ctx, reader, prefix(), cache_->spill_directory(), &spilled));
+        if (spilled != nullptr) TF_RETURN_IF_ERROR(spilled->Finish());
+        cache_->Complete(std::move(temp_cache), std::move(spilled));
       }
       TF_RETURN_IF_ERROR(InitializeIterator(ctx));
       return RestoreInput(ctx, reader, iterator_);
@@ -764,7 +918,8 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 
       ~MemoryWriterIterator() override {
         mutex_lock l(mu_);
-        if (!temp_cache_.empty() && !cache_->IsCompleted()) {
+        if ((!temp_cache_.empty() || temp_spilled_ != nullptr) &&
+            !cache_->IsCompleted()) {
           LOG(WARNING) << kIncompleteCacheErrorMessage;
           cache_->Reset();
         }
@@ -784,16 +939,15 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         if (*end_of_sequence) {
           if (!cache_->IsCompleted()) {
             VLOG(2) << "Finalizing the cache because EOF has been reached.";
-            cache_->Complete(std::move(temp_cache_));
+            TF_RETURN_IF_ERROR(CompleteCache());
           }
           return Status::OK();
         }
-        RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
-        if (temp_cache_.size() == dataset()->input_->Cardinality()) {
+        TF_RETURN_IF_ERROR(AddToCache(ctx, *out_tensors));
+        if (NumCachedElements() == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
-          cache_->Complete(std::move(temp_cache_));
+          TF_RETURN_IF_ERROR(CompleteCache());
         }
         return Status::OK();
       }
@@ -809,8 +963,13 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
         if (!cache_->IsCompleted()) {
-          TF_RETURN_IF_ERROR(
-              WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+          TF_RETURN_IF_ERROR(WriteCacheToCheckpoint(
+              writer, prefix(), cache_->compressed(), temp_cache_));
+          if (temp_spilled_ != nullptr) {
+            TF_RETURN_IF_ERROR(temp_spilled_->Flush());
+            TF_RETURN_IF_ERROR(WriteSpilledElementsToCheckpoint(
+                writer, prefix(), *temp_spilled_));
+          }
         }
         return SaveInput(ctx, writer, input_impl_);
       }
@@ -819,17 +978,85 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              IteratorStateReader* reader) override {
         mutex_lock l(mu_);
         if (!reader->Contains(full_name(kCacheCompleted))) {
-          TF_RETURN_IF_ERROR(
-              ReadElementsFromCheckpoint(reader, prefix(), &temp_cache_));
+          TF_RETURN_IF_ERROR(ReadCacheFromCheckpoint(
+              reader, prefix(), cache_->compressed(), &temp_cache_));
+          temp_cache_bytes_ = 0;
+          for (const auto& element : temp_cache_) {
+            temp_cache_bytes_ += ElementBytes(element);
+          }
+          TF_RETURN_IF_ERROR(ReadSpilledElementsFromCheckpoint(
+              ctx, reader, prefix(), cache_->spill_directory(),
+              &temp_spilled_));
         }
         return RestoreInput(ctx, reader, input_impl_);
       }
 
      private:
+      // Keeps `element` in memory while the memory budget allows, and spills
+      // it and all later elements otherwise. If the cache is compressed, the
+      // element is kept in memory compressed and the budget applies to its
+      // compressed size.
+      Status AddToCache(IteratorContext* ctx,
+                        const std::vector<Tensor>& element)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        const int64 budget = cache_->memory_budget_bytes();
+        int64 bytes = ElementBytes(element);
+        if (temp_spilled_ == nullptr) {
+          std::vector<Tensor> cached = element;
+          if (cache_->compressed()) {
+            TF_RETURN_IF_ERROR(CompressCacheElement(element, &cached));
+            bytes = ElementBytes(cached);
+          }
+          if (budget <= 0 || temp_cache_bytes_ + bytes <= budget) {
+            RecordBufferEnqueue(ctx, cached);
+            temp_cache_.push_back(std::move(cached));
+            temp_cache_bytes_ += bytes;
+            return Status::OK();
+          }
+        }
+        if (temp_spilled_ == nullptr) {
+          VLOG(1) << "Spilling the cache of " << dataset()->node_name()
+                  << " to disk after " << temp_cache_.size()
+                  << " elements because it exceeds the memory budget of "
+                  << budget << " bytes.";
+          TF_RETURN_IF_ERROR(SpilledElements::Create(
+              ctx->env(), cache_->spill_directory(), &temp_spilled_));
+        }
+        TF_RETURN_IF_ERROR(temp_spilled_->Append(element));
+        const auto& stats_aggregator = ctx->stats_aggregator();
+        if (stats_aggregator) {
+          stats_aggregator->AddScalar(
+              stats_utils::SpilledBytesScalarName(dataset()->node_name()),
+              static_cast<float>(temp_spilled_->num_bytes()), num_elements());
+          stats_aggregator->IncrementCounter(dataset()->node_name(),
+                                             stats_utils::kSpilledBytes,
+                                             static_cast<float>(bytes));
+        }
+        return Status::OK();
+      }
+
+      int64 NumCachedElements() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return temp_cache_.size() +
+               (temp_spilled_ ? temp_spilled_->num_elements() : 0);
+      }
+
+      Status CompleteCache() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (temp_spilled_ != nullptr) {
+          TF_RETURN_IF_ERROR(temp_spilled_->Finish());
+        }
+        cache_->Complete(std::move(temp_cache_), std::move(temp_spilled_));
+        return Status::OK();
+      }
+
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       std::vector<std::vector<Tensor>> temp_cache_ TF_GUARDED_BY(mu_);
+      // The number of bytes of tensor data in `temp_cache_`.
+      int64 temp_cache_bytes_ TF_GUARDED_BY(mu_) = 0;
+      // The elements that follow `temp_cache_`, if the memory budget was
+      // exceeded.
+      std::unique_ptr<SpilledElements> temp_spilled_ TF_GUARDED_BY(mu_);
     };  // MemoryWriterIterator
 
     class MemoryReaderIterator : public DatasetIterator<MemoryDatasetBase> {
@@ -839,6 +1066,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
             cache_(cache),
             index_(0) {}
 
+      ~MemoryReaderIterator() override {
+        mutex_lock l(mu_);
+        CancelDecompressions(&l);
+      }
+
       Status Initialize(IteratorContext* ctx) override {
         // The memory allocated for the cache is owned by the parent
         // dataset but performance modeling uses the iterator abstraction and
@@ -849,6 +1081,9 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         for (size_t i = 0; i < cache_->size(); ++i) {
           RecordBufferEnqueue(ctx, cache_->at(i));
         }
+        // Decompress as many elements ahead of the consumer as there are
+        // threads to decompress them.
+        max_decompressions_ = std::max(1, ctx->runner_threadpool_size());
         return Status::OK();
       }
 
@@ -856,12 +1091,56 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              std::vector<Tensor>* out_tensors,
                              bool* end_of_sequence) override {
         mutex_lock l(mu_);
+        const auto& stats_aggregator = ctx->stats_aggregator();
         if (index_ < cache_->size()) {
-          const std::vector<Tensor>& cache_tensors = cache_->at(index_);
-          out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
-                              cache_tensors.end());
+          if (cache_->compressed()) {
+            ScheduleDecompressions(ctx);
+            std::shared_ptr<Decompression> decompression =
+                decompressions_.front();
+            decompressions_.pop_front();
+            while (!decompression->done) {
+              cond_var_.wait(l);
+            }
+            if (!decompression->status.ok()) {
+              CancelDecompressions(&l);
+              return decompression->status;
+            }
+            out_tensors->insert(
+                out_tensors->begin(),
+                std::make_move_iterator(decompression->element.begin()),
+                std::make_move_iterator(decompression->element.end()));
+          } else {
+            const std::vector<Tensor>& cache_tensors = cache_->at(index_);
+            out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
+                                cache_tensors.end());
+          }
+          index_++;
+          *end_of_sequence = false;
+          if (stats_aggregator) {
+            stats_aggregator->IncrementCounter(dataset()->node_name(),
+                                               stats_utils::kMemoryCacheHits,
+                                               static_cast<float>(1));
+          }
+          return Status::OK();
+        } else if (index_ < NumElements()) {
+          // The element was spilled. Spilled elements are read sequentially,
+          // so the file is only opened (and positioned) once per pass.
+          if (spilled_reader_ == nullptr) {
+            TF_RETURN_IF_ERROR(cache_->spilled()->NewReader(&spilled_reader_));
+            TF_RETURN_IF_ERROR(spilled_reader_->Skip(index_ - cache_->size()));
+          }
+          std::vector<Tensor> element;
+          TF_RETURN_IF_ERROR(spilled_reader_->Read(&element));
+          out_tensors->insert(out_tensors->begin(),
+                              std::make_move_iterator(element.begin()),
+                              std::make_move_iterator(element.end()));
           index_++;
           *end_of_sequence = false;
+          if (stats_aggregator) {
+            stats_aggregator->IncrementCounter(dataset()->node_name(),
+                                               stats_utils::kMemoryCacheMisses,
+                                               static_cast<float>(1));
+          }
           return Status::OK();
         } else {
           *end_of_sequence = true;
@@ -889,19 +1168,82 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         {
           // kIndex will not be set if we are restoring from a checkpoint
           // written by a MemoryWriterIterator that has completed its cache.
-          int64 temp = cache_->size();
+          int64 temp = NumElements();
           if (reader->Contains(full_name(kIndex))) {
             TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kIndex), &temp));
           }
           index_ = static_cast<size_t>(temp);
         }
+        CancelDecompressions(&l);
+        spilled_reader_.reset();
         return Status::OK();
       }
 
      private:
+      // An element of a compressed cache being decompressed.
+      struct Decompression {
+        bool done = false;
+        Status status;
+        std::vector<Tensor> element;
+      };
+
+      // Starts decompressing the in-memory elements that follow the ones in
+      // `decompressions_`, up to `max_decompressions_` elements from `index_`.
+      void ScheduleDecompressions(IteratorContext* ctx)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        while (decompressions_.size() < max_decompressions_ &&
+               index_ + decompressions_.size() < cache_->size()) {
+          auto decompression = std::make_shared<Decompression>();
+          const std::vector<Tensor>& compressed =
+              cache_->at(index_ + decompressions_.size());
+          decompressions_.push_back(decompression);
+          ++num_outstanding_decompressions_;
+          // The cache is complete, so `compressed` is not modified while it
+          // is decompressed.
+          (*ctx->runner())([this, decompression, &compressed]() {
+            std::vector<Tensor> element;
+            Status s = UncompressCacheElement(compressed, &element);
+            mutex_lock l(mu_);
+            decompression->status = s;
+            decompression->element = std::move(element);
+            decompression->done = true;
+            --num_outstanding_decompressions_;
+            cond_var_.notify_all();
+          });
+        }
+      }
+
+      // Waits for the decompressions in flight, which refer to `mu_` and
+      // `cond_var_`, and discards their results.
+      void CancelDecompressions(mutex_lock* l)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        while (num_outstanding_decompressions_ > 0) {
+          cond_var_.wait(*l);
+        }
+        decompressions_.clear();
+      }
+
+      // Returns the number of elements in memory and spilled.
+      size_t NumElements() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        std::shared_ptr<const SpilledElements> spilled = cache_->spilled();
+        return cache_->size() + (spilled ? spilled->num_elements() : 0);
+      }
+
       mutex mu_;
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       size_t index_ TF_GUARDED_BY(mu_);
+      // Reads the spilled elements from `index_` on, once `index_` is past
+      // the elements in memory.
+      std::unique_ptr<SpilledElements::Reader> spilled_reader_
+          TF_GUARDED_BY(mu_);
+      condition_variable cond_var_;
+      // The maximum number of elements of a compressed cache decompressed
+      // ahead of `index_`.
+      size_t max_decompressions_ TF_GUARDED_BY(mu_) = 1;
+      // The decompressions of the elements from `index_` on, in order.
+      std::deque<std::shared_ptr<Decompression>> decompressions_
+          TF_GUARDED_BY(mu_);
+      int64 num_outstanding_decompressions_ TF_GUARDED_BY(mu_) = 0;
     };  // MemoryReaderIterator
 
     Status InitializeIterator(IteratorContext* ctx)
@@ -959,8 +1301,15 @@ class CacheDatasetOp::MemoryDataset : public CacheDatasetOp::MemoryDatasetBase {
     TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
     Node* filename_node = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(cache_->memory_budget_bytes(), &memory_budget_bytes);
+    AttrValue compression;
+    b->BuildAttrValue(CacheCompression(*cache_), &compression);
     TF_RETURN_IF_ERROR(
-        b->AddDataset(this, {input_node, filename_node}, output));
+        b->AddDataset(this, {input_node, filename_node},
+                      {std::make_pair(kMemoryBudgetBytes, memory_budget_bytes),
+                       std::make_pair(kCompression, compression)},
+                      output));
     return Status::OK();
   }
 
@@ -1008,8 +1357,15 @@ class CacheDatasetOp::MemoryDatasetV2
     Tensor handle(DT_RESOURCE, TensorShape({}));
     handle.scalar<ResourceHandle>()() = resource_handle_;
     TF_RETURN_IF_ERROR(b->AddTensor(handle, &resource_handle_node));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {input_node, filename_node, resource_handle_node}, output));
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(cache_->memory_budget_bytes(), &memory_budget_bytes);
+    AttrValue compression;
+    b->BuildAttrValue(CacheCompression(*cache_), &compression);
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {input_node, filename_node, resource_handle_node},
+                      {std::make_pair(kMemoryBudgetBytes, memory_budget_bytes),
+                       std::make_pair(kCompression, compression)},
+                      output));
     return Status::OK();
   }
 
@@ -1022,7 +1378,17 @@ class CacheDatasetOp::MemoryDatasetV2
 
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+  }
+  if (ctx->HasAttr(kCompression)) {
+    string compression;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kCompression, &compression));
+    OP_REQUIRES_OK(ctx, ParseCacheCompression(compression, &compressed_));
+  }
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
@@ -1045,8 +1411,10 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
         OP_REQUIRES_OK(
             ctx,
             ctx->resource_manager()->LookupOrCreate<MemoryCacheManager>(
-                container, name, &manager, [](MemoryCacheManager** manager) {
-                  *manager = new MemoryCacheManager();
+                container, name, &manager,
+                [this](MemoryCacheManager** manager) {
+                  *manager =
+                      new MemoryCacheManager(memory_budget_bytes_, compressed_);
                   return Status::OK();
                 }));
         handle = MakeResourceHandle<MemoryCacheManager>(ctx, container, name);
@@ -1060,8 +1428,10 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
       MemoryCacheManager* manager;
       OP_REQUIRES_OK(
           ctx, ctx->resource_manager()->LookupOrCreate<MemoryCacheManager>(
-                   container, name, &manager, [](MemoryCacheManager** manager) {
-                     *manager = new MemoryCacheManager();
+                   container, name, &manager,
+                   [this](MemoryCacheManager** manager) {
+                     *manager =
+                      new MemoryCacheManager(memory_budget_bytes_, compressed_);
                      return Status::OK();
                    }));
       auto handle =
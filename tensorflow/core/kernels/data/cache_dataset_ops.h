@@ -30,6 +30,9 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kFileName = "filename";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
+  static constexpr const char* const kCompression = "compression";
 
   explicit CacheDatasetOp(OpKernelConstruction* ctx);
 
@@ -44,6 +47,10 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   class MemoryDatasetV2;
 
   const int op_version_;
+  // The memory budget and compression of caches that the op creates. A cache
+  // passed to CacheDatasetV2 keeps its own.
+  int64 memory_budget_bytes_ = 0;
+  bool compressed_ = false;
 };
 
 }  // namespace data
@@ -11,6 +11,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <numeric>
+
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/platform/path.h"
@@ -29,10 +31,13 @@ class CacheDatasetParams : public DatasetParams {
   CacheDatasetParams(T input_dataset_params, string filename,
                      DataTypeVector output_dtypes,
                      std::vector<PartialTensorShape> output_shapes,
-                     string node_name)
+                     string node_name, int64 memory_budget_bytes = 0,
+                     string compression = "")
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
-        filename_(filename) {
+        filename_(filename),
+        memory_budget_bytes_(memory_budget_bytes),
+        compression_(std::move(compression)) {
     input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -52,7 +57,9 @@ class CacheDatasetParams : public DatasetParams {
 
   Status GetAttributes(AttributeVector* attr_vector) const override {
     *attr_vector = {{CacheDatasetOp::kOutputTypes, output_dtypes_},
-                    {CacheDatasetOp::kOutputShapes, output_shapes_}};
+                    {CacheDatasetOp::kOutputShapes, output_shapes_},
+                    {CacheDatasetOp::kMemoryBudgetBytes, memory_budget_bytes_},
+                    {CacheDatasetOp::kCompression, compression_}};
     return Status::OK();
   }
 
@@ -62,6 +69,8 @@ class CacheDatasetParams : public DatasetParams {
 
  private:
   string filename_;
+  int64 memory_budget_bytes_;
+  string compression_;
 };
 
 class CacheDatasetOpTest : public DatasetOpsTestBase {
@@ -199,6 +208,182 @@ TEST_P(ParameterizedGetNextTest, GetNext) {
 INSTANTIATE_TEST_SUITE_P(CacheDatasetOpTest, ParameterizedGetNextTest,
                          ::testing::ValuesIn(GetNextTestCases()));
 
+TEST_F(CacheDatasetOpTest, SpillsBeyondMemoryBudget) {
+  // Five elements of 512KB each, with a memory budget of 1MB, so that the
+  // first two elements are kept in memory and the other three are spilled.
+  constexpr int kNumElements = 5;
+  constexpr int kElementSize = 64 * 1024;
+  const string spill_dir = io::JoinPath(testing::TmpDir(), "cache_spill");
+  setenv("TF_DATA_MEMORY_CACHE_SPILL_DIR", spill_dir.c_str(), 1);
+  std::vector<int64> values(kNumElements * kElementSize);
+  std::iota(values.begin(), values.end(), 0);
+  auto dataset_params = CacheDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64>(
+              TensorShape{kNumElements, kElementSize}, values)},
+          /*node_name=*/"tensor_slice"),
+      /*filename=*/"", /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({kElementSize})}, kNodeName,
+      /*memory_budget_bytes=*/1 << 20);
+  Status s = Initialize(dataset_params);
+  unsetenv("TF_DATA_MEMORY_CACHE_SPILL_DIR");
+  TF_ASSERT_OK(s);
+
+  std::vector<Tensor> expected_outputs;
+  for (int i = 0; i < kNumElements; ++i) {
+    expected_outputs.push_back(CreateTensor<int64>(
+        TensorShape{kElementSize},
+        gtl::ArraySlice<int64>(values.data() + i * kElementSize,
+                               kElementSize)));
+  }
+
+  // The first pass writes the cache, and the second one reads it back from
+  // memory and from the spill file.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass > 0) {
+      TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(),
+                                          /*parent=*/nullptr,
+                                          dataset_params.iterator_prefix(),
+                                          &iterator_));
+    }
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    }
+    TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                             /*compare_order=*/true));
+  }
+  std::vector<string> spill_files;
+  TF_ASSERT_OK(device_->env()->GetMatchingPaths(
+      io::JoinPath(spill_dir, "tf_data_memory_cache_*"), &spill_files));
+  EXPECT_EQ(1, spill_files.size());
+
+  // Save a reader that is positioned in the spilled elements, and check that
+  // the restored reader continues from the same element.
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  for (int i = 3; i < kNumElements; ++i) {
+    out_tensors.clear();
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    TF_EXPECT_OK(ExpectEqual(out_tensors.back(), expected_outputs[i]));
+  }
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  EXPECT_TRUE(end_of_sequence);
+}
+
+TEST_F(CacheDatasetOpTest, CompressedMemoryCache) {
+  constexpr int kNumElements = 8;
+  constexpr int kElementSize = 4 * 1024;
+  // Repeated values, so that the elements compress well.
+  std::vector<int64> values(kNumElements * kElementSize);
+  for (int i = 0; i < values.size(); ++i) {
+    values[i] = i / kElementSize;
+  }
+  auto dataset_params = CacheDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64>(
+              TensorShape{kNumElements, kElementSize}, values)},
+          /*node_name=*/"tensor_slice"),
+      /*filename=*/"", /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({kElementSize})}, kNodeName,
+      /*memory_budget_bytes=*/0, /*compression=*/"SNAPPY");
+  TF_ASSERT_OK(Initialize(dataset_params));
+
+  std::vector<Tensor> expected_outputs;
+  for (int i = 0; i < kNumElements; ++i) {
+    expected_outputs.push_back(CreateTensor<int64>(
+        TensorShape{kElementSize},
+        gtl::ArraySlice<int64>(values.data() + i * kElementSize,
+                               kElementSize)));
+  }
+
+  // The first pass writes the compressed cache, and the second one
+  // decompresses it.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass > 0) {
+      TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(),
+                                          /*parent=*/nullptr,
+                                          dataset_params.iterator_prefix(),
+                                          &iterator_));
+    }
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    }
+    TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                             /*compare_order=*/true));
+  }
+
+  // Save a reader with decompressions in flight, and check that the restored
+  // reader continues from the same element.
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  for (int i = 3; i < kNumElements; ++i) {
+    out_tensors.clear();
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    TF_EXPECT_OK(ExpectEqual(out_tensors.back(), expected_outputs[i]));
+  }
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  EXPECT_TRUE(end_of_sequence);
+}
+
+TEST_F(CacheDatasetOpTest, UnsupportedCompression) {
+  auto dataset_params = CacheDatasetParams(
+      RangeDatasetParams(0, 3, 1),
+      /*filename=*/"", /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})}, kNodeName,
+      /*memory_budget_bytes=*/0, /*compression=*/"GZIP");
+  EXPECT_EQ(Initialize(dataset_params).code(), error::INVALID_ARGUMENT);
+}
+
 TEST_F(CacheDatasetOpTest, DatasetNodeName) {
   auto dataset_params = CacheDatasetParams1();
   TF_ASSERT_OK(Initialize(dataset_params));
@@ -14,29 +14,212 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kSpillFilePrefix[] = "tf_data_memory_cache_";
+
+std::shared_ptr<MemoryCache> NewMemoryCache(int64 memory_budget_bytes,
+                                            bool compressed) {
+  if (memory_budget_bytes <= 0) {
+    return std::make_shared<MemoryCache>(/*memory_budget_bytes=*/0,
+                                         /*spill_directory=*/"", compressed);
+  }
+  string spill_directory;
+  Status s = ReadStringFromEnvVar("TF_DATA_MEMORY_CACHE_SPILL_DIR", "",
+                                  &spill_directory);
+  if (!s.ok()) {
+    LOG(ERROR) << "MemoryCache: " << s.error_message();
+  }
+  return std::make_shared<MemoryCache>(memory_budget_bytes,
+                                       std::move(spill_directory), compressed);
+}
 
 }  // namespace
 
+Status ParseCacheCompression(const string& compression, bool* compressed) {
+  if (compression.empty()) {
+    *compressed = false;
+  } else if (compression == io::compression::kSnappy) {
+    *compressed = true;
+  } else {
+    return errors::InvalidArgument("Unsupported cache compression \"",
+                                   compression, "\", only \"",
+                                   io::compression::kSnappy,
+                                   "\" is supported.");
+  }
+  return Status::OK();
+}
+
+Status CompressCacheElement(const std::vector<Tensor>& element,
+                            std::vector<Tensor>* out) {
+  CompressedElement compressed;
+  TF_RETURN_IF_ERROR(CompressElement(element, &compressed));
+  int64 uncompressed_bytes = 0;
+  for (const auto& metadata : compressed.component_metadata()) {
+    uncompressed_bytes += metadata.tensor_size_bytes();
+  }
+  metrics::RecordTFDataCacheCompression(uncompressed_bytes,
+                                        compressed.data().size());
+  Tensor tensor(DT_VARIANT, TensorShape({}));
+  tensor.scalar<Variant>()() = std::move(compressed);
+  out->clear();
+  out->push_back(std::move(tensor));
+  return Status::OK();
+}
+
+Status UncompressCacheElement(const std::vector<Tensor>& compressed,
+                              std::vector<Tensor>* out) {
+  const CompressedElement* element =
+      compressed.size() == 1 && compressed[0].dtype() == DT_VARIANT &&
+              compressed[0].NumElements() == 1
+          ? compressed[0].scalar<Variant>()().get<CompressedElement>()
+          : nullptr;
+  if (element == nullptr) {
+    return errors::Internal("Expected a compressed cache element.");
+  }
+  const uint64 start_us = EnvTime::NowMicros();
+  out->clear();
+  TF_RETURN_IF_ERROR(UncompressElement(*element, out));
+  int64 uncompressed_bytes = 0;
+  for (const Tensor& t : *out) {
+    uncompressed_bytes += t.TotalBytes();
+  }
+  metrics::RecordTFDataCacheDecompression(uncompressed_bytes,
+                                          EnvTime::NowMicros() - start_us);
+  return Status::OK();
+}
+
+Status SpilledElements::Reader::Read(std::vector<Tensor>* element) {
+  tstring record;
+  TF_RETURN_IF_ERROR(reader_->ReadRecord(&record));
+  CompressedElement compressed;
+  if (!compressed.ParseFromArray(record.data(), record.size())) {
+    return errors::DataLoss("Failed to parse a spilled cache element.");
+  }
+  element->clear();
+  return UncompressElement(compressed, element);
+}
+
+Status SpilledElements::Reader::Skip(int64 num_elements) {
+  while (num_elements > 0) {
+    const int batch = static_cast<int>(
+        std::min<int64>(num_elements, std::numeric_limits<int>::max()));
+    int num_skipped = 0;
+    TF_RETURN_IF_ERROR(reader_->SkipRecords(batch, &num_skipped));
+    num_elements -= num_skipped;
+  }
+  return Status::OK();
+}
+
+Status SpilledElements::Create(Env* env, const string& directory,
+                               std::unique_ptr<SpilledElements>* out) {
+  string filename;
+  if (directory.empty()) {
+    if (!env->LocalTempFilename(&filename)) {
+      return errors::Unavailable(
+          "Failed to find a local temporary directory to spill the cache to.");
+    }
+  } else {
+    TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(directory));
+    filename = io::JoinPath(directory, strings::StrCat(kSpillFilePrefix,
+                                                       env->NowMicros(), "_",
+                                                       random::New64()));
+  }
+  std::unique_ptr<SpilledElements> spilled(
+      new SpilledElements(env, std::move(filename)));
+  TF_RETURN_IF_ERROR(env->NewWritableFile(spilled->filename_, &spilled->file_));
+  spilled->writer_ = absl::make_unique<io::RecordWriter>(spilled->file_.get());
+  *out = std::move(spilled);
+  return Status::OK();
+}
+
+SpilledElements::~SpilledElements() {
+  writer_.reset();
+  file_.reset();
+  Status s = env_->DeleteFile(filename_);
+  if (!s.ok() && !errors::IsNotFound(s)) {
+    LOG(WARNING) << "Failed to delete cache spill file " << filename_ << ": "
+                 << s;
+  }
+}
+
+Status SpilledElements::Append(const std::vector<Tensor>& element) {
+  if (writer_ == nullptr) {
+    return errors::FailedPrecondition("The spill file is already finished.");
+  }
+  CompressedElement compressed;
+  TF_RETURN_IF_ERROR(CompressElement(element, &compressed));
+  TF_RETURN_IF_ERROR(writer_->WriteRecord(compressed.SerializeAsString()));
+  ++num_elements_;
+  for (const Tensor& t : element) {
+    num_bytes_ += t.TotalBytes();
+  }
+  return Status::OK();
+}
+
+Status SpilledElements::Flush() {
+  if (writer_ == nullptr) return Status::OK();
+  return writer_->Flush();
+}
+
+Status SpilledElements::Finish() {
+  if (writer_ == nullptr) return Status::OK();
+  TF_RETURN_IF_ERROR(writer_->Close());
+  writer_.reset();
+  TF_RETURN_IF_ERROR(file_->Close());
+  file_.reset();
+  return Status::OK();
+}
+
+Status SpilledElements::NewReader(std::unique_ptr<Reader>* out) const {
+  auto reader = absl::WrapUnique(new Reader());
+  TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(filename_, &reader->file_));
+  reader->reader_ =
+      absl::make_unique<io::SequentialRecordReader>(reader->file_.get());
+  *out = std::move(reader);
+  return Status::OK();
+}
+
+MemoryCacheManager::MemoryCacheManager(int64 memory_budget_bytes,
+                                       bool compressed)
+    : cache_(NewMemoryCache(memory_budget_bytes, compressed)) {}
+
 string MemoryCacheManager::DebugString() const { return kMemoryCache; }
 
 void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
+  Complete(std::move(cache), nullptr);
+}
+
+void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache,
+                           std::unique_ptr<SpilledElements> spilled) {
   mutex_lock l(mu_);
   if (!completed_) {
     cache_ = std::move(cache);
+    spilled_ = std::move(spilled);
     completed_ = true;
   }
 }
@@ -50,6 +233,7 @@ void MemoryCache::Reset() {
   mutex_lock l(mu_);
   completed_ = false;
   cache_.clear();
+  spilled_.reset();
 }
 
 const std::vector<Tensor>& MemoryCache::at(int64 index) {
@@ -68,9 +252,29 @@ const std::vector<std::vector<Tensor>>& MemoryCache::data() {
   return cache_;
 }
 
+std::shared_ptr<const SpilledElements> MemoryCache::spilled() {
+  tf_shared_lock l(mu_);
+  return spilled_;
+}
+
+/* static */ constexpr const char* const
+    AnonymousMemoryCacheHandleOp::kMemoryBudgetBytes;
+/* static */ constexpr const char* const
+    AnonymousMemoryCacheHandleOp::kCompression;
+
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
     OpKernelConstruction* ctx)
-    : AnonymousResourceOp<MemoryCacheManager>(ctx) {}
+    : AnonymousResourceOp<MemoryCacheManager>(ctx) {
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+  }
+  if (ctx->HasAttr(kCompression)) {
+    string compression;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kCompression, &compression));
+    OP_REQUIRES_OK(ctx, ParseCacheCompression(compression, &compressed_));
+  }
+}
 
 string AnonymousMemoryCacheHandleOp::name() { return kMemoryCache; }
 
@@ -78,7 +282,7 @@ Status AnonymousMemoryCacheHandleOp::CreateResource(
     OpKernelContext* ctx, std::unique_ptr<FunctionLibraryDefinition> flib_def,
     std::unique_ptr<ProcessFunctionLibraryRuntime> pflr,
     FunctionLibraryRuntime* lib, MemoryCacheManager** manager) {
-  *manager = new MemoryCacheManager();
+  *manager = new MemoryCacheManager(memory_budget_bytes_, compressed_);
   return Status::OK();
 }
 
@@ -16,51 +16,168 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <memory>
+
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace data {
 
+// Dataset elements that did not fit in a memory budget (e.g. of a
+// `MemoryCache` or of a shuffle buffer), stored in order as compressed records
+// of a local TFRecord file. The file is deleted when this object is destroyed.
+class SpilledElements {
+ public:
+  // Reads the elements back in order. Any number of readers may read a
+  // finished file concurrently.
+  class Reader {
+   public:
+    // Reads the next element, or returns an `OutOfRange` error at the end.
+    Status Read(std::vector<Tensor>* element);
+
+    // Skips over the next `num_elements` elements.
+    Status Skip(int64 num_elements);
+
+   private:
+    friend class SpilledElements;
+
+    std::unique_ptr<RandomAccessFile> file_;
+    std::unique_ptr<io::SequentialRecordReader> reader_;
+  };
+
+  // Creates an empty spill file in `directory`, or in a local temporary
+  // directory if `directory` is empty.
+  static Status Create(Env* env, const string& directory,
+                       std::unique_ptr<SpilledElements>* out);
+
+  ~SpilledElements();
+
+  // Appends `element` to the file. Must not be called after `Finish()`.
+  Status Append(const std::vector<Tensor>& element);
+
+  // Flushes the elements appended so far, so that readers can see them.
+  Status Flush();
+
+  // Flushes and closes the file.
+  Status Finish();
+
+  // Returns a reader of the elements appended before the last `Flush()` or
+  // `Finish()`.
+  Status NewReader(std::unique_ptr<Reader>* out) const;
+
+  int64 num_elements() const { return num_elements_; }
+  // The number of bytes of tensor data in the spilled elements, before
+  // compression.
+  int64 num_bytes() const { return num_bytes_; }
+
+ private:
+  SpilledElements(Env* env, string filename)
+      : env_(env), filename_(std::move(filename)) {}
+
+  Env* const env_;
+  const string filename_;
+  std::unique_ptr<WritableFile> file_;
+  std::unique_ptr<io::RecordWriter> writer_;
+  int64 num_elements_ = 0;
+  int64 num_bytes_ = 0;
+};
+
+// Parses the `compression` attr of cache ops, which is "" for uncompressed
+// caches and "SNAPPY" for compressed ones.
+Status ParseCacheCompression(const string& compression, bool* compressed);
+
+// Compresses `element` into a single scalar DT_VARIANT tensor holding a
+// `CompressedElement`, which is how compressed `MemoryCache`s store elements.
+Status CompressCacheElement(const std::vector<Tensor>& element,
+                            std::vector<Tensor>* out);
+
+// Restores an element compressed by `CompressCacheElement()`.
+Status UncompressCacheElement(const std::vector<Tensor>& compressed,
+                              std::vector<Tensor>* out);
+
 // A thread-safe data structure for caching dataset elements.
 //
 // The expected use is that a single `MemoryWriterIterator` populates the
 // cache with dataset elements. Once all elements are cached, the cache can
 // be used by one or more `MemoryReaderIterator`s.
+//
+// If the cache has a memory budget, the writer keeps the elements in memory
+// until they exceed the budget, and spills the remaining elements to a
+// `SpilledElements` file. Readers read the elements in memory first, and
+// then the spilled ones.
+//
+// If the cache is compressed, the elements in memory are stored as returned
+// by `CompressCacheElement()`, and count against the memory budget by their
+// compressed size.
 class MemoryCache {
  public:
   MemoryCache() = default;
 
+  // A non-positive `memory_budget_bytes` means that all elements are kept in
+  // memory. Spill files are created in `spill_directory`.
+  MemoryCache(int64 memory_budget_bytes, string spill_directory,
+              bool compressed = false)
+      : memory_budget_bytes_(memory_budget_bytes),
+        spill_directory_(std::move(spill_directory)),
+        compressed_(compressed) {}
+
+  int64 memory_budget_bytes() const { return memory_budget_bytes_; }
+  const string& spill_directory() const { return spill_directory_; }
+  bool compressed() const { return compressed_; }
+
   // Marks the cache as completed.
   void Complete(std::vector<std::vector<Tensor>>&& cache);
 
+  // Marks the cache as completed, with the elements that follow `cache` in
+  // the finished file `spilled`.
+  void Complete(std::vector<std::vector<Tensor>>&& cache,
+                std::unique_ptr<SpilledElements> spilled);
+
   // Returns whether the cache is completed.
   bool IsCompleted();
 
   // Resets the cache.
   void Reset();
 
-  // Returns the element at the given index.
+  // Returns the in-memory element at the given index.
   const std::vector<Tensor>& at(int64 index);
 
-  // Returns the size of the cache.
+  // Returns the number of elements in memory.
   size_t size();
 
-  // Returns a reference to the cache's data. The returned reference will be
-  // invalidated by any call to Reset().
+  // Returns a reference to the cache's data in memory. The returned reference
+  // will be invalidated by any call to Reset().
   const std::vector<std::vector<Tensor>>& data();
 
+  // Returns the elements that follow `data()`, or nullptr if none were
+  // spilled.
+  std::shared_ptr<const SpilledElements> spilled();
+
  private:
+  const int64 memory_budget_bytes_ = 0;
+  const string spill_directory_;
+  const bool compressed_ = false;
   mutex mu_;
   // Determines whether all elements of the dataset have been cached.
   bool completed_ TF_GUARDED_BY(mu_) = false;
   std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
+  std::shared_ptr<const SpilledElements> spilled_ TF_GUARDED_BY(mu_);
 };
 
 // A resource wrapping a shared instance of a memory cache.
+//
+// A non-positive `memory_budget_bytes` keeps all elements in memory. Spill
+// files are created in the `TF_DATA_MEMORY_CACHE_SPILL_DIR` directory if that
+// environment variable is set, and in a local temporary directory otherwise.
+// If `compressed` is true, the elements kept in memory are compressed.
 class MemoryCacheManager : public ResourceBase {
  public:
-  MemoryCacheManager() : cache_(std::make_shared<MemoryCache>()) {}
+  explicit MemoryCacheManager(int64 memory_budget_bytes = 0,
+                              bool compressed = false);
 
   string DebugString() const override;
 
@@ -74,6 +191,10 @@ class MemoryCacheManager : public ResourceBase {
 class AnonymousMemoryCacheHandleOp
     : public AnonymousResourceOp<MemoryCacheManager> {
  public:
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
+  static constexpr const char* const kCompression = "compression";
+
   explicit AnonymousMemoryCacheHandleOp(OpKernelConstruction* ctx);
 
  private:
@@ -83,6 +204,9 @@ class AnonymousMemoryCacheHandleOp
                         std::unique_ptr<ProcessFunctionLibraryRuntime> pflr,
                         FunctionLibraryRuntime* lib,
                         MemoryCacheManager** manager) override;
+
+  int64 memory_budget_bytes_ = 0;
+  bool compressed_ = false;
 };
 
 // Deletes an instance of cache resource.
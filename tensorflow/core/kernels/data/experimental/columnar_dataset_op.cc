@@ -0,0 +1,474 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_dataset_op.h"
+
+#include <deque>
+
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/kernels/data/experimental/columnar_format.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const ColumnarDatasetOp::kDatasetType;
+/* static */ constexpr const char* const ColumnarDatasetOp::kFileNames;
+/* static */ constexpr const char* const ColumnarDatasetOp::kColumns;
+/* static */ constexpr const char* const ColumnarDatasetOp::kFilterColumns;
+/* static */ constexpr const char* const ColumnarDatasetOp::kFilterOps;
+/* static */ constexpr const char* const ColumnarDatasetOp::kFilterValues;
+/* static */ constexpr const char* const ColumnarDatasetOp::kFilterIntValues;
+/* static */ constexpr const char* const ColumnarDatasetOp::kBatchSize;
+/* static */ constexpr const char* const ColumnarDatasetOp::kNumParallelReads;
+/* static */ constexpr const char* const ColumnarDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const ColumnarDatasetOp::kOutputShapes;
+
+constexpr char kFileIndex[] = "file_index";
+constexpr char kRowGroup[] = "row_group";
+constexpr char kRowOffset[] = "row_offset";
+
+class ColumnarDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, std::vector<tstring> filenames,
+          std::vector<tstring> columns, std::vector<tstring> filter_columns,
+          std::vector<tstring> filter_ops,
+          std::vector<ColumnarFilter::Op> parsed_filter_ops,
+          std::vector<double> filter_values,
+          std::vector<int64> filter_int_values, int64 batch_size,
+          int64 num_parallel_reads, const DataTypeVector& output_types,
+          const std::vector<PartialTensorShape>& output_shapes)
+      : DatasetBase(DatasetContext(ctx)),
+        filenames_(std::move(filenames)),
+        columns_(std::move(columns)),
+        filter_columns_(std::move(filter_columns)),
+        filter_ops_(std::move(filter_ops)),
+        parsed_filter_ops_(std::move(parsed_filter_ops)),
+        filter_values_(std::move(filter_values)),
+        filter_int_values_(std::move(filter_int_values)),
+        batch_size_(batch_size),
+        num_parallel_reads_(num_parallel_reads),
+        output_types_(output_types),
+        output_shapes_(output_shapes) {}
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return absl::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override { return output_types_; }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    return name_utils::DatasetDebugString(kDatasetType);
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    return Status::OK();
+  }
+
+  Status CheckExternalState() const override { return Status::OK(); }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* filenames = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(filenames_, &filenames));
+    Node* columns = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(columns_, &columns));
+    Node* filter_columns = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(filter_columns_, &filter_columns));
+    Node* filter_ops = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(filter_ops_, &filter_ops));
+    Node* filter_values = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(filter_values_, &filter_values));
+    Node* filter_int_values = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(filter_int_values_, &filter_int_values));
+    Node* batch_size = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+    Node* num_parallel_reads = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(num_parallel_reads_, &num_parallel_reads));
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {filenames, columns, filter_columns, filter_ops, filter_values,
+         filter_int_values, batch_size, num_parallel_reads},
+        output));
+    return Status::OK();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params) {}
+
+    ~Iterator() override {
+      // The reads in flight refer to `mu_` and `cond_var_`.
+      mutex_lock l(mu_);
+      while (num_outstanding_reads_ > 0) {
+        cond_var_.wait(l);
+      }
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      num_parallel_reads_ = dataset()->num_parallel_reads_;
+      if (num_parallel_reads_ == model::kAutotune) {
+        num_parallel_reads_ = ctx->runner_threadpool_size();
+      }
+      return Status::OK();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      std::vector<Slice> slices;
+      int64 num_rows = 0;
+      while (num_rows < dataset()->batch_size_) {
+        TF_RETURN_IF_ERROR(ScheduleReads(ctx));
+        if (reads_.empty()) break;
+        std::shared_ptr<RowGroupRead> read = reads_.front();
+        while (!read->done) {
+          cond_var_.wait(l);
+        }
+        TF_RETURN_IF_ERROR(read->status);
+        const int64 count = std::min(read->num_rows - row_offset_,
+                                     dataset()->batch_size_ - num_rows);
+        if (count > 0) {
+          slices.push_back({read, row_offset_, count});
+          num_rows += count;
+          row_offset_ += count;
+        }
+        if (row_offset_ == read->num_rows) {
+          reads_.pop_front();
+          row_offset_ = 0;
+        }
+      }
+      if (num_rows == 0) {
+        *end_of_sequence = true;
+        return Status::OK();
+      }
+      *end_of_sequence = false;
+      return AssembleBatch(ctx, slices, num_rows, out_tensors);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      // Row groups that were read ahead are read again after a restore, so
+      // only the position of the next row to return is saved.
+      int64 file_index = file_index_;
+      int64 row_group = next_row_group_;
+      if (!reads_.empty()) {
+        file_index = reads_.front()->file_index;
+        row_group = reads_.front()->row_group;
+      }
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kFileIndex), file_index));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kRowGroup), row_group));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kRowOffset), row_offset_));
+      return Status::OK();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      while (num_outstanding_reads_ > 0) {
+        cond_var_.wait(l);
+      }
+      reads_.clear();
+      reader_.reset();
+      int64 file_index, row_group;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kFileIndex), &file_index));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kRowGroup), &row_group));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kRowOffset), &row_offset_));
+      file_index_ = file_index;
+      next_row_group_ = row_group;
+      return Status::OK();
+    }
+
+   private:
+    // The projected columns of the rows of a row group that satisfy the
+    // filters.
+    struct RowGroupRead {
+      RowGroupRead(int64 file_index, int row_group)
+          : file_index(file_index), row_group(row_group) {}
+
+      const int64 file_index;
+      const int row_group;
+      bool done = false;
+      Status status;
+      int64 num_rows = 0;
+      std::vector<Tensor> columns;
+    };
+
+    // Rows [start, start + count) of a row group read.
+    struct Slice {
+      std::shared_ptr<RowGroupRead> read;
+      int64 start;
+      int64 count;
+    };
+
+    // Opens the file at `file_index_` and resolves the projected and filtered
+    // columns against its schema.
+    Status OpenFile(Env* env) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const string filename = dataset()->filenames_[file_index_];
+      std::unique_ptr<ColumnarReader> reader;
+      TF_RETURN_IF_ERROR(ColumnarReader::Open(env, filename, &reader));
+      projection_.clear();
+      for (int i = 0; i < dataset()->columns_.size(); ++i) {
+        const tstring& name = dataset()->columns_[i];
+        const int column = reader->FindColumn(name);
+        if (column < 0) {
+          return errors::InvalidArgument("Column ", name, " is not in ",
+                                         filename);
+        }
+        const DataType dtype = reader->schema()[column].dtype;
+        if (dtype != dataset()->output_types_[i]) {
+          return errors::InvalidArgument(
+              "Column ", name, " of ", filename, " has type ",
+              DataTypeString(dtype), " but ",
+              DataTypeString(dataset()->output_types_[i]), " was expected");
+        }
+        projection_.push_back(column);
+      }
+      filters_.clear();
+      for (int i = 0; i < dataset()->filter_columns_.size(); ++i) {
+        const tstring& name = dataset()->filter_columns_[i];
+        const int column = reader->FindColumn(name);
+        if (column < 0) {
+          return errors::InvalidArgument("Filter column ", name, " is not in ",
+                                         filename);
+        }
+        if (reader->schema()[column].dtype == DT_STRING) {
+          return errors::InvalidArgument("Cannot filter on string column ",
+                                         name, " of ", filename);
+        }
+        filters_.push_back({column, dataset()->parsed_filter_ops_[i],
+                            dataset()->filter_values_[i],
+                            dataset()->filter_int_values_[i]});
+      }
+      reader_ = std::move(reader);
+      return Status::OK();
+    }
+
+    // Starts reading row groups until `num_parallel_reads_` reads are
+    // outstanding or all files have been scheduled. Row groups whose chunk
+    // statistics rule out the filters are skipped without being read.
+    Status ScheduleReads(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (reads_.size() < num_parallel_reads_) {
+        if (reader_ == nullptr) {
+          if (file_index_ >= dataset()->filenames_.size()) {
+            return Status::OK();
+          }
+          TF_RETURN_IF_ERROR(OpenFile(ctx->env()));
+        }
+        if (next_row_group_ >= reader_->row_groups().size()) {
+          reader_.reset();
+          ++file_index_;
+          next_row_group_ = 0;
+          continue;
+        }
+        const int row_group = next_row_group_++;
+        if (!reader_->MayMatch(row_group, filters_)) continue;
+        auto read = std::make_shared<RowGroupRead>(file_index_, row_group);
+        reads_.push_back(read);
+        ++num_outstanding_reads_;
+        (*ctx->runner())([this, read, reader = reader_,
+                          projection = projection_, filters = filters_,
+                          allocator = ctx->allocator({})]() {
+          std::vector<int64> rows;
+          Status s;
+          int64 num_rows = reader->row_groups()[read->row_group].num_rows;
+          const std::vector<int64>* selection = nullptr;
+          if (!filters.empty()) {
+            s = reader->FilterRows(read->row_group, filters, &rows);
+            // Only materialize the selected rows, unless they all are.
+            if (rows.size() < num_rows) selection = &rows;
+            num_rows = rows.size();
+          }
+          std::vector<Tensor> columns(projection.size());
+          for (int i = 0; s.ok() && num_rows > 0 && i < projection.size();
+               ++i) {
+            s = reader->ReadColumn(read->row_group, projection[i], selection,
+                                   allocator, &columns[i]);
+          }
+          mutex_lock l(mu_);
+          read->status = s;
+          read->num_rows = s.ok() ? num_rows : 0;
+          read->columns = std::move(columns);
+          read->done = true;
+          --num_outstanding_reads_;
+          cond_var_.notify_all();
+        });
+      }
+      return Status::OK();
+    }
+
+    // Concatenates `slices` into one tensor per projected column. A slice
+    // that covers a whole row group is returned as is.
+    Status AssembleBatch(IteratorContext* ctx, const std::vector<Slice>& slices,
+                         int64 num_rows, std::vector<Tensor>* out_tensors) {
+      out_tensors->clear();
+      for (int i = 0; i < dataset()->columns_.size(); ++i) {
+        const Slice& first = slices.front();
+        if (slices.size() == 1 && first.start == 0 &&
+            first.count == first.read->num_rows) {
+          out_tensors->push_back(first.read->columns[i]);
+          continue;
+        }
+        out_tensors->emplace_back(ctx->allocator({}),
+                                  dataset()->output_types_[i],
+                                  TensorShape({num_rows}));
+        int64 offset = 0;
+        for (const Slice& slice : slices) {
+          TF_RETURN_IF_ERROR(batch_util::CopyContiguousSlices(
+              slice.read->columns[i], slice.start, offset, slice.count,
+              &out_tensors->back()));
+          offset += slice.count;
+        }
+      }
+      return Status::OK();
+    }
+
+    mutex mu_;
+    condition_variable cond_var_;
+    int64 num_parallel_reads_ TF_GUARDED_BY(mu_) = 1;
+    int64 file_index_ TF_GUARDED_BY(mu_) = 0;
+    int next_row_group_ TF_GUARDED_BY(mu_) = 0;
+    // The number of rows of `reads_.front()` that have been returned.
+    int64 row_offset_ TF_GUARDED_BY(mu_) = 0;
+    std::shared_ptr<const ColumnarReader> reader_ TF_GUARDED_BY(mu_);
+    std::vector<int> projection_ TF_GUARDED_BY(mu_);
+    std::vector<ColumnarFilter> filters_ TF_GUARDED_BY(mu_);
+    std::deque<std::shared_ptr<RowGroupRead>> reads_ TF_GUARDED_BY(mu_);
+    int64 num_outstanding_reads_ TF_GUARDED_BY(mu_) = 0;
+  };
+
+  const std::vector<tstring> filenames_;
+  const std::vector<tstring> columns_;
+  const std::vector<tstring> filter_columns_;
+  const std::vector<tstring> filter_ops_;
+  const std::vector<ColumnarFilter::Op> parsed_filter_ops_;
+  const std::vector<double> filter_values_;
+  const std::vector<int64> filter_int_values_;
+  const int64 batch_size_;
+  const int64 num_parallel_reads_;
+  const DataTypeVector output_types_;
+  const std::vector<PartialTensorShape> output_shapes_;
+};
+
+ColumnarDatasetOp::ColumnarDatasetOp(OpKernelConstruction* ctx)
+    : DatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
+}
+
+void ColumnarDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                    DatasetBase** output) {
+  const Tensor* filenames_tensor;
+  OP_REQUIRES_OK(ctx, ctx->input(kFileNames, &filenames_tensor));
+  OP_REQUIRES(
+      ctx, filenames_tensor->dims() <= 1,
+      errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+  std::vector<tstring> filenames;
+  filenames.reserve(filenames_tensor->NumElements());
+  for (int i = 0; i < filenames_tensor->NumElements(); ++i) {
+    filenames.push_back(filenames_tensor->flat<tstring>()(i));
+  }
+
+  std::vector<tstring> columns;
+  OP_REQUIRES_OK(ctx, ParseVectorArgument<tstring>(ctx, kColumns, &columns));
+  OP_REQUIRES(ctx, columns.size() == output_types_.size(),
+              errors::InvalidArgument(
+                  "Expected one output type per column but got ",
+                  output_types_.size(), " types for ", columns.size(),
+                  " columns"));
+  for (DataType dtype : output_types_) {
+    OP_REQUIRES_OK(ctx, CheckColumnarType(dtype));
+  }
+
+  std::vector<tstring> filter_columns;
+  OP_REQUIRES_OK(ctx, ParseVectorArgument<tstring>(ctx, kFilterColumns,
+                                                   &filter_columns));
+  std::vector<tstring> filter_ops;
+  OP_REQUIRES_OK(ctx,
+                 ParseVectorArgument<tstring>(ctx, kFilterOps, &filter_ops));
+  std::vector<double> filter_values;
+  OP_REQUIRES_OK(
+      ctx, ParseVectorArgument<double>(ctx, kFilterValues, &filter_values));
+  std::vector<int64> filter_int_values;
+  OP_REQUIRES_OK(ctx, ParseVectorArgument<int64>(ctx, kFilterIntValues,
+                                                 &filter_int_values));
+  OP_REQUIRES(ctx,
+              filter_ops.size() == filter_columns.size() &&
+                  filter_values.size() == filter_columns.size() &&
+                  filter_int_values.size() == filter_columns.size(),
+              errors::InvalidArgument(
+                  "`filter_columns`, `filter_ops`, `filter_values` and "
+                  "`filter_int_values` must have the same length"));
+  std::vector<ColumnarFilter::Op> parsed_filter_ops(filter_ops.size());
+  for (int i = 0; i < filter_ops.size(); ++i) {
+    OP_REQUIRES_OK(
+        ctx, ColumnarFilter::ParseOp(filter_ops[i], &parsed_filter_ops[i]));
+  }
+
+  int64 batch_size;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, kBatchSize, &batch_size));
+  OP_REQUIRES(ctx, batch_size > 0,
+              errors::InvalidArgument("`batch_size` must be > 0"));
+  int64 num_parallel_reads;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, kNumParallelReads,
+                                                 &num_parallel_reads));
+  OP_REQUIRES(ctx,
+              num_parallel_reads > 0 || num_parallel_reads == model::kAutotune,
+              errors::InvalidArgument("`num_parallel_reads` must be > 0 or ",
+                                      model::kAutotune));
+
+  *output = new Dataset(ctx, std::move(filenames), std::move(columns),
+                        std::move(filter_columns), std::move(filter_ops),
+                        std::move(parsed_filter_ops), std::move(filter_values),
+                        std::move(filter_int_values), batch_size,
+                        num_parallel_reads, output_types_, output_shapes_);
+}
+
+namespace {
+
+REGISTER_KERNEL_BUILDER(Name("ColumnarDataset").Device(DEVICE_CPU),
+                        ColumnarDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,58 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_DATASET_OP_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_DATASET_OP_H_
+
+#include "tensorflow/core/framework/dataset.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Reads batches of rows from columnar files (see columnar_format.h). Only the
+// projected columns and the columns used by filters are read, row groups
+// whose statistics rule out the filters are skipped, and each element is a
+// tuple of 1-D column tensors.
+class ColumnarDatasetOp : public DatasetOpKernel {
+ public:
+  static constexpr const char* const kDatasetType = "Columnar";
+  static constexpr const char* const kFileNames = "filenames";
+  static constexpr const char* const kColumns = "columns";
+  static constexpr const char* const kFilterColumns = "filter_columns";
+  static constexpr const char* const kFilterOps = "filter_ops";
+  static constexpr const char* const kFilterValues = "filter_values";
+  static constexpr const char* const kFilterIntValues = "filter_int_values";
+  static constexpr const char* const kBatchSize = "batch_size";
+  static constexpr const char* const kNumParallelReads = "num_parallel_reads";
+  static constexpr const char* const kOutputTypes = "output_types";
+  static constexpr const char* const kOutputShapes = "output_shapes";
+
+  explicit ColumnarDatasetOp(OpKernelConstruction* ctx);
+
+ protected:
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override;
+
+ private:
+  class Dataset;
+
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_DATASET_OP_H_
@@ -0,0 +1,390 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_dataset_op.h"
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/kernels/data/experimental/columnar_format.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "columnar_dataset";
+constexpr int kRowsPerGroup = 4;
+constexpr int kNumRowGroups = 3;
+
+// Writes a new file with columns `id` (0, 1, ...), `score` (id / 2) and
+// `name` ("row<id>"), in row groups of `kRowsPerGroup` rows.
+tstring WriteTestFile() {
+  static int num_files = 0;
+  const string filename = io::JoinPath(
+      testing::TmpDir(), strings::StrCat("columnar_test_file_", num_files++));
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(Env::Default()->NewWritableFile(filename, &file));
+  ColumnarWriter writer(file.get(), {{"id", DT_INT64},
+                                     {"score", DT_FLOAT},
+                                     {"name", DT_STRING}});
+  for (int i = 0; i < kNumRowGroups; ++i) {
+    std::vector<int64> ids;
+    std::vector<float> scores;
+    std::vector<tstring> names;
+    for (int j = 0; j < kRowsPerGroup; ++j) {
+      const int64 id = i * kRowsPerGroup + j;
+      ids.push_back(id);
+      scores.push_back(id / 2.0);
+      names.push_back(strings::StrCat("row", id));
+    }
+    TF_CHECK_OK(writer.WriteRowGroup(
+        {CreateTensor<int64>(TensorShape({kRowsPerGroup}), ids),
+         CreateTensor<float>(TensorShape({kRowsPerGroup}), scores),
+         CreateTensor<tstring>(TensorShape({kRowsPerGroup}), names)}));
+  }
+  TF_CHECK_OK(writer.Finish());
+  TF_CHECK_OK(file->Close());
+  return filename;
+}
+
+class ColumnarDatasetParams : public DatasetParams {
+ public:
+  ColumnarDatasetParams(std::vector<tstring> filenames,
+                        std::vector<tstring> columns,
+                        std::vector<tstring> filter_columns,
+                        std::vector<tstring> filter_ops,
+                        std::vector<double> filter_values,
+                        std::vector<int64> filter_int_values, int64 batch_size,
+                        int64 num_parallel_reads, DataTypeVector output_dtypes,
+                        string node_name)
+      : DatasetParams(output_dtypes,
+                      std::vector<PartialTensorShape>(output_dtypes.size(),
+                                                      PartialTensorShape({-1})),
+                      std::move(node_name)),
+        filenames_(CreateTensor<tstring>(
+            TensorShape({static_cast<int64>(filenames.size())}), filenames)),
+        columns_(CreateTensor<tstring>(
+            TensorShape({static_cast<int64>(columns.size())}), columns)),
+        filter_columns_(CreateTensor<tstring>(
+            TensorShape({static_cast<int64>(filter_columns.size())}),
+            filter_columns)),
+        filter_ops_(CreateTensor<tstring>(
+            TensorShape({static_cast<int64>(filter_ops.size())}), filter_ops)),
+        filter_values_(CreateTensor<double>(
+            TensorShape({static_cast<int64>(filter_values.size())}),
+            filter_values)),
+        filter_int_values_(CreateTensor<int64>(
+            TensorShape({static_cast<int64>(filter_int_values.size())}),
+            filter_int_values)),
+        batch_size_(CreateTensor<int64>(TensorShape({}), {batch_size})),
+        num_parallel_reads_(
+            CreateTensor<int64>(TensorShape({}), {num_parallel_reads})) {}
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {filenames_,         columns_,          filter_columns_,
+            filter_ops_,        filter_values_,    filter_int_values_,
+            batch_size_,        num_parallel_reads_};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {ColumnarDatasetOp::kFileNames,
+                    ColumnarDatasetOp::kColumns,
+                    ColumnarDatasetOp::kFilterColumns,
+                    ColumnarDatasetOp::kFilterOps,
+                    ColumnarDatasetOp::kFilterValues,
+                    ColumnarDatasetOp::kFilterIntValues,
+                    ColumnarDatasetOp::kBatchSize,
+                    ColumnarDatasetOp::kNumParallelReads};
+    return Status::OK();
+  }
+
+  Status GetAttributes(AttributeVector* attributes) const override {
+    *attributes = {{ColumnarDatasetOp::kOutputTypes, output_dtypes_},
+                   {ColumnarDatasetOp::kOutputShapes, output_shapes_}};
+    return Status::OK();
+  }
+
+  string dataset_type() const override {
+    return ColumnarDatasetOp::kDatasetType;
+  }
+
+ private:
+  Tensor filenames_;
+  Tensor columns_;
+  Tensor filter_columns_;
+  Tensor filter_ops_;
+  Tensor filter_values_;
+  Tensor filter_int_values_;
+  Tensor batch_size_;
+  Tensor num_parallel_reads_;
+};
+
+class ColumnarDatasetOpTest : public DatasetOpsTestBase {};
+
+// Reads `id` and `name` in batches that straddle the row groups.
+ColumnarDatasetParams ProjectionParams() {
+  return {/*filenames=*/{WriteTestFile()},
+          /*columns=*/{"id", "name"},
+          /*filter_columns=*/{},
+          /*filter_ops=*/{},
+          /*filter_values=*/{},
+          /*filter_int_values=*/{},
+          /*batch_size=*/5,
+          /*num_parallel_reads=*/2,
+          /*output_dtypes=*/{DT_INT64, DT_STRING},
+          /*node_name=*/kNodeName};
+}
+
+// Keeps 6 <= id < 11. The statistics of the first row group rule it out.
+ColumnarDatasetParams FilterParams() {
+  return {/*filenames=*/{WriteTestFile()},
+          /*columns=*/{"id"},
+          /*filter_columns=*/{"id", "score"},
+          /*filter_ops=*/{">=", "<"},
+          /*filter_values=*/{6, 5.5},
+          /*filter_int_values=*/{6, 0},
+          /*batch_size=*/4,
+          /*num_parallel_reads=*/model::kAutotune,
+          /*output_dtypes=*/{DT_INT64},
+          /*node_name=*/kNodeName};
+}
+
+// Filters on a column that is not projected.
+ColumnarDatasetParams FilterOnUnprojectedColumnParams() {
+  return {/*filenames=*/{WriteTestFile(), WriteTestFile()},
+          /*columns=*/{"score"},
+          /*filter_columns=*/{"id"},
+          /*filter_ops=*/{"=="},
+          /*filter_values=*/{5},
+          /*filter_int_values=*/{5},
+          /*batch_size=*/8,
+          /*num_parallel_reads=*/1,
+          /*output_dtypes=*/{DT_FLOAT},
+          /*node_name=*/kNodeName};
+}
+
+ColumnarDatasetParams MissingColumnParams() {
+  return {/*filenames=*/{WriteTestFile()},
+          /*columns=*/{"label"},
+          /*filter_columns=*/{},
+          /*filter_ops=*/{},
+          /*filter_values=*/{},
+          /*filter_int_values=*/{},
+          /*batch_size=*/4,
+          /*num_parallel_reads=*/1,
+          /*output_dtypes=*/{DT_INT64},
+          /*node_name=*/kNodeName};
+}
+
+ColumnarDatasetParams TypeMismatchParams() {
+  return {/*filenames=*/{WriteTestFile()},
+          /*columns=*/{"score"},
+          /*filter_columns=*/{},
+          /*filter_ops=*/{},
+          /*filter_values=*/{},
+          /*filter_int_values=*/{},
+          /*batch_size=*/4,
+          /*num_parallel_reads=*/1,
+          /*output_dtypes=*/{DT_DOUBLE},
+          /*node_name=*/kNodeName};
+}
+
+ColumnarDatasetParams StringFilterParams() {
+  return {/*filenames=*/{WriteTestFile()},
+          /*columns=*/{"id"},
+          /*filter_columns=*/{"name"},
+          /*filter_ops=*/{"=="},
+          /*filter_values=*/{0},
+          /*filter_int_values=*/{0},
+          /*batch_size=*/4,
+          /*num_parallel_reads=*/1,
+          /*output_dtypes=*/{DT_INT64},
+          /*node_name=*/kNodeName};
+}
+
+ColumnarDatasetParams InvalidFilterOpParams() {
+  return {/*filenames=*/{WriteTestFile()},
+          /*columns=*/{"id"},
+          /*filter_columns=*/{"id"},
+          /*filter_ops=*/{"~="},
+          /*filter_values=*/{0},
+          /*filter_int_values=*/{0},
+          /*batch_size=*/4,
+          /*num_parallel_reads=*/1,
+          /*output_dtypes=*/{DT_INT64},
+          /*node_name=*/kNodeName};
+}
+
+std::vector<Tensor> ProjectionOutputs() {
+  return {CreateTensor<int64>(TensorShape({5}), {0, 1, 2, 3, 4}),
+          CreateTensor<tstring>(TensorShape({5}),
+                                {"row0", "row1", "row2", "row3", "row4"}),
+          CreateTensor<int64>(TensorShape({5}), {5, 6, 7, 8, 9}),
+          CreateTensor<tstring>(TensorShape({5}),
+                                {"row5", "row6", "row7", "row8", "row9"}),
+          CreateTensor<int64>(TensorShape({2}), {10, 11}),
+          CreateTensor<tstring>(TensorShape({2}), {"row10", "row11"})};
+}
+
+std::vector<GetNextTestCase<ColumnarDatasetParams>> GetNextTestCases() {
+  return {{/*dataset_params=*/ProjectionParams(),
+           /*expected_outputs=*/ProjectionOutputs()},
+          {/*dataset_params=*/FilterParams(),
+           /*expected_outputs=*/
+           {CreateTensor<int64>(TensorShape({4}), {6, 7, 8, 9}),
+            CreateTensor<int64>(TensorShape({1}), {10})}},
+          {/*dataset_params=*/FilterOnUnprojectedColumnParams(),
+           /*expected_outputs=*/
+           {CreateTensor<float>(TensorShape({2}), {2.5, 2.5})}}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(ColumnarDatasetOpTest, ColumnarDatasetParams,
+                         GetNextTestCases());
+
+std::vector<IteratorSaveAndRestoreTestCase<ColumnarDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {{/*dataset_params=*/ProjectionParams(),
+           /*breakpoints=*/{0, 1, 3},
+           /*expected_outputs=*/ProjectionOutputs()}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(ColumnarDatasetOpTest, ColumnarDatasetParams,
+                                 IteratorSaveAndRestoreTestCases());
+
+TEST_F(ColumnarDatasetOpTest, MissingColumn) {
+  auto dataset_params = MissingColumnParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      tensorflow::error::INVALID_ARGUMENT);
+}
+
+TEST_F(ColumnarDatasetOpTest, TypeMismatch) {
+  auto dataset_params = TypeMismatchParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      tensorflow::error::INVALID_ARGUMENT);
+}
+
+TEST_F(ColumnarDatasetOpTest, StringFilter) {
+  auto dataset_params = StringFilterParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      tensorflow::error::INVALID_ARGUMENT);
+}
+
+TEST_F(ColumnarDatasetOpTest, InvalidFilterOp) {
+  auto dataset_params = InvalidFilterOpParams();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
+TEST(ColumnarFormatTest, SkipsRowGroupsByStatistics) {
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), WriteTestFile(), &reader));
+  ASSERT_EQ(kNumRowGroups, reader->row_groups().size());
+  const int id = reader->FindColumn("id");
+  EXPECT_EQ(-1, reader->FindColumn("label"));
+
+  const std::vector<ColumnarFilter> filters = {
+      {id, ColumnarFilter::Op::kGreater, 5, 5}};
+  EXPECT_FALSE(reader->MayMatch(0, filters));
+  EXPECT_TRUE(reader->MayMatch(1, filters));
+  EXPECT_TRUE(reader->MayMatch(2, filters));
+
+  std::vector<int64> rows;
+  TF_ASSERT_OK(reader->FilterRows(1, filters, &rows));
+  EXPECT_EQ(std::vector<int64>({2, 3}), rows);
+  Tensor names;
+  TF_ASSERT_OK(reader->ReadColumn(1, reader->FindColumn("name"), &rows,
+                                  cpu_allocator(), &names));
+  test::ExpectTensorEqual<tstring>(
+      CreateTensor<tstring>(TensorShape({2}), {"row6", "row7"}), names);
+}
+
+TEST(ColumnarFormatTest, DetectsTruncatedFiles) {
+  const string filename = WriteTestFile();
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), filename, &contents));
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename,
+                                 contents.substr(0, contents.size() - 1)));
+  std::unique_ptr<ColumnarReader> reader;
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarReader::Open(Env::Default(), filename, &reader)));
+}
+
+TEST(ColumnarFormatTest, DetectsCorruptedChunks) {
+  const string filename = WriteTestFile();
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), filename, &reader));
+  const int id = reader->FindColumn("id");
+  const uint64 offset = reader->row_groups()[1].chunks[id].offset;
+
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), filename, &contents));
+  contents[offset] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, contents));
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), filename, &reader));
+  std::vector<int64> rows;
+  EXPECT_TRUE(errors::IsDataLoss(reader->FilterRows(
+      1, {{id, ColumnarFilter::Op::kGreater, 5, 5}}, &rows)));
+}
+
+TEST(ColumnarFormatTest, ComparesInt64Exactly) {
+  // 2^53 + 1 is the smallest int64 that a double cannot represent.
+  const int64 kLarge = (int64{1} << 53) + 1;
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "columnar_test_file_int64");
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(Env::Default()->NewWritableFile(filename, &file));
+  ColumnarWriter writer(file.get(), {{"id", DT_INT64}});
+  TF_ASSERT_OK(writer.WriteRowGroup(
+      {CreateTensor<int64>(TensorShape({2}), {kLarge - 1, kLarge})}));
+  TF_ASSERT_OK(writer.Finish());
+  TF_ASSERT_OK(file->Close());
+
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), filename, &reader));
+  std::vector<int64> rows;
+  TF_ASSERT_OK(reader->FilterRows(
+      0, {{0, ColumnarFilter::Op::kEqual, static_cast<double>(kLarge), kLarge}},
+      &rows));
+  EXPECT_EQ(std::vector<int64>({1}), rows);
+  const std::vector<ColumnarFilter> greater = {
+      {0, ColumnarFilter::Op::kGreater, static_cast<double>(kLarge), kLarge}};
+  EXPECT_FALSE(reader->MayMatch(0, greater));
+  TF_ASSERT_OK(reader->FilterRows(
+      0, {{0, ColumnarFilter::Op::kGreater, static_cast<double>(kLarge - 1),
+           kLarge - 1}},
+      &rows));
+  EXPECT_EQ(std::vector<int64>({1}), rows);
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,622 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_format.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/byte_order.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// The header holds the magic and the format version.
+constexpr uint64 kHeaderSize = kColumnarMagicSize + sizeof(uint32);
+// The trailer holds the footer length, the footer checksum and the magic.
+constexpr uint64 kTrailerSize =
+    sizeof(uint64) + sizeof(uint32) + kColumnarMagicSize;
+
+// Returns the CRC-32 of `data` following the bytes whose CRC-32 is `crc`.
+uint32 ExtendChecksum(uint32 crc, StringPiece data) {
+  const char* p = data.data();
+  size_t n = data.size();
+  while (n > 0) {
+    // zlib takes 32-bit lengths.
+    const uInt len = std::min<size_t>(n, 1 << 30);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(p), len);
+    p += len;
+    n -= len;
+  }
+  return crc;
+}
+
+uint32 Checksum(StringPiece data) { return ExtendChecksum(0, data); }
+
+void PutDouble(string* dst, double value) {
+  uint64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  core::PutFixed64(dst, bits);
+}
+
+// Decodes the fields of a footer, checking that they are in bounds.
+class FooterParser {
+ public:
+  explicit FooterParser(StringPiece input) : input_(input) {}
+
+  bool ReadFixed32(uint32* value) {
+    if (input_.size() < sizeof(uint32)) return false;
+    *value = core::DecodeFixed32(input_.data());
+    input_.remove_prefix(sizeof(uint32));
+    return true;
+  }
+
+  bool ReadFixed64(uint64* value) {
+    if (input_.size() < sizeof(uint64)) return false;
+    *value = core::DecodeFixed64(input_.data());
+    input_.remove_prefix(sizeof(uint64));
+    return true;
+  }
+
+  bool ReadDouble(double* value) {
+    uint64 bits;
+    if (!ReadFixed64(&bits)) return false;
+    std::memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+
+  bool ReadBytes(uint64 n, string* value) {
+    if (input_.size() < n) return false;
+    value->assign(input_.data(), n);
+    input_.remove_prefix(n);
+    return true;
+  }
+
+  bool done() const { return input_.empty(); }
+
+ private:
+  StringPiece input_;
+};
+
+template <typename T>
+bool Compare(ColumnarFilter::Op op, T v, T value) {
+  switch (op) {
+    case ColumnarFilter::Op::kEqual:
+      return v == value;
+    case ColumnarFilter::Op::kNotEqual:
+      return v != value;
+    case ColumnarFilter::Op::kLess:
+      return v < value;
+    case ColumnarFilter::Op::kLessEqual:
+      return v <= value;
+    case ColumnarFilter::Op::kGreater:
+      return v > value;
+    case ColumnarFilter::Op::kGreaterEqual:
+      return v >= value;
+  }
+  return false;
+}
+
+template <typename T>
+bool MayCompare(ColumnarFilter::Op op, T min, T max, T value) {
+  switch (op) {
+    case ColumnarFilter::Op::kEqual:
+      return min <= value && value <= max;
+    case ColumnarFilter::Op::kNotEqual:
+      return !(min == value && max == value);
+    case ColumnarFilter::Op::kLess:
+      return min < value;
+    case ColumnarFilter::Op::kLessEqual:
+      return min <= value;
+    case ColumnarFilter::Op::kGreater:
+      return max > value;
+    case ColumnarFilter::Op::kGreaterEqual:
+      return max >= value;
+  }
+  return true;
+}
+
+template <typename T>
+void SetFloatStatistics(typename TTypes<T>::ConstVec values,
+                        ColumnarChunk* chunk) {
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  for (int64 i = 0; i < values.size(); ++i) {
+    const double v = values(i);
+    if (std::isnan(v)) return;
+    min = std::min(min, v);
+    max = std::max(max, v);
+  }
+  chunk->has_statistics = true;
+  chunk->min = min;
+  chunk->max = max;
+}
+
+template <typename T>
+void SetIntStatistics(typename TTypes<T>::ConstVec values,
+                      ColumnarChunk* chunk) {
+  const auto min_max =
+      std::minmax_element(values.data(), values.data() + values.size());
+  chunk->has_statistics = true;
+  chunk->int_min = *min_max.first;
+  chunk->int_max = *min_max.second;
+}
+
+// Sets the statistics of `chunk` from the values of `column`.
+void SetStatistics(const Tensor& column, ColumnarChunk* chunk) {
+  if (column.NumElements() == 0) return;
+  switch (column.dtype()) {
+    case DT_FLOAT:
+      SetFloatStatistics<float>(column.vec<float>(), chunk);
+      break;
+    case DT_DOUBLE:
+      SetFloatStatistics<double>(column.vec<double>(), chunk);
+      break;
+    case DT_INT32:
+      SetIntStatistics<int32>(column.vec<int32>(), chunk);
+      break;
+    case DT_INT64:
+      SetIntStatistics<int64>(column.vec<int64>(), chunk);
+      break;
+    default:
+      break;
+  }
+}
+
+// Clears `(*selected)[i]` for the rows of a chunk of `n` values of type `T`
+// that do not satisfy `filter`. The values are compared as `U`s.
+template <typename T, typename U>
+void ApplyFilter(const ColumnarFilter& filter, const char* data, int64 n,
+                 std::vector<bool>* selected) {
+  for (int64 i = 0; i < n; ++i) {
+    if (!(*selected)[i]) continue;
+    T v;
+    std::memcpy(&v, data + i * sizeof(T), sizeof(T));
+    if (!filter.Matches(static_cast<U>(v))) (*selected)[i] = false;
+  }
+}
+
+}  // namespace
+
+Status CheckColumnarType(DataType dtype) {
+  switch (dtype) {
+    case DT_FLOAT:
+    case DT_DOUBLE:
+    case DT_INT32:
+    case DT_INT64:
+    case DT_STRING:
+      return Status::OK();
+    default:
+      return errors::InvalidArgument("Columnar files cannot store columns of ",
+                                     DataTypeString(dtype));
+  }
+}
+
+/* static */
+Status ColumnarFilter::ParseOp(StringPiece op, Op* out) {
+  if (op == "==") {
+    *out = Op::kEqual;
+  } else if (op == "!=") {
+    *out = Op::kNotEqual;
+  } else if (op == "<") {
+    *out = Op::kLess;
+  } else if (op == "<=") {
+    *out = Op::kLessEqual;
+  } else if (op == ">") {
+    *out = Op::kGreater;
+  } else if (op == ">=") {
+    *out = Op::kGreaterEqual;
+  } else {
+    return errors::InvalidArgument("Unsupported filter operator: ", op);
+  }
+  return Status::OK();
+}
+
+bool ColumnarFilter::Matches(double v) const { return Compare(op, v, value); }
+
+bool ColumnarFilter::Matches(int64 v) const {
+  if (CompareAsInt()) return Compare(op, v, int_value);
+  return Compare(op, static_cast<double>(v), value);
+}
+
+bool ColumnarFilter::MayMatch(double min, double max) const {
+  if (std::isnan(min) || std::isnan(max)) return true;
+  return MayCompare(op, min, max, value);
+}
+
+bool ColumnarFilter::MayMatch(int64 min, int64 max) const {
+  if (CompareAsInt()) return MayCompare(op, min, max, int_value);
+  return MayCompare(op, static_cast<double>(min), static_cast<double>(max),
+                    value);
+}
+
+ColumnarWriter::ColumnarWriter(WritableFile* file,
+                               std::vector<ColumnarColumn> schema)
+    : file_(file), schema_(std::move(schema)) {}
+
+Status ColumnarWriter::MaybeWriteHeader() {
+  if (offset_ > 0) return Status::OK();
+  string header(kColumnarMagic, kColumnarMagicSize);
+  core::PutFixed32(&header, kColumnarFormatVersion);
+  TF_RETURN_IF_ERROR(file_->Append(header));
+  offset_ = header.size();
+  return Status::OK();
+}
+
+Status ColumnarWriter::WriteRowGroup(const std::vector<Tensor>& columns) {
+  if (finished_) {
+    return errors::FailedPrecondition("The columnar file is already finished.");
+  }
+  if (columns.size() != schema_.size()) {
+    return errors::InvalidArgument("Expected ", schema_.size(),
+                                   " columns but got ", columns.size());
+  }
+  ColumnarRowGroup row_group;
+  for (int i = 0; i < columns.size(); ++i) {
+    const Tensor& column = columns[i];
+    if (column.dtype() != schema_[i].dtype || column.dims() != 1) {
+      return errors::InvalidArgument(
+          "Column ", schema_[i].name, " must be a vector of ",
+          DataTypeString(schema_[i].dtype), " but got a ",
+          DataTypeString(column.dtype()), " tensor of shape ",
+          column.shape().DebugString());
+    }
+    if (i > 0 && column.NumElements() != row_group.num_rows) {
+      return errors::InvalidArgument("Column ", schema_[i].name, " has ",
+                                     column.NumElements(), " rows but column ",
+                                     schema_[0].name, " has ",
+                                     row_group.num_rows);
+    }
+    row_group.num_rows = column.NumElements();
+  }
+  TF_RETURN_IF_ERROR(MaybeWriteHeader());
+  for (const Tensor& column : columns) {
+    ColumnarChunk chunk;
+    chunk.offset = offset_;
+    if (column.dtype() == DT_STRING) {
+      auto strings = column.vec<tstring>();
+      string offsets;
+      uint64 end = 0;
+      for (int64 i = 0; i < strings.size(); ++i) {
+        end += strings(i).size();
+        core::PutFixed64(&offsets, end);
+      }
+      TF_RETURN_IF_ERROR(file_->Append(offsets));
+      chunk.checksum = Checksum(offsets);
+      for (int64 i = 0; i < strings.size(); ++i) {
+        TF_RETURN_IF_ERROR(file_->Append(strings(i)));
+        chunk.checksum = ExtendChecksum(chunk.checksum, strings(i));
+      }
+      chunk.size = offsets.size() + end;
+    } else {
+      const StringPiece data = column.tensor_data();
+      SetStatistics(column, &chunk);
+      TF_RETURN_IF_ERROR(file_->Append(data));
+      chunk.checksum = Checksum(data);
+      chunk.size = data.size();
+    }
+    offset_ += chunk.size;
+    row_group.chunks.push_back(chunk);
+  }
+  row_groups_.push_back(std::move(row_group));
+  return Status::OK();
+}
+
+Status ColumnarWriter::Finish() {
+  if (finished_) {
+    return errors::FailedPrecondition("The columnar file is already finished.");
+  }
+  TF_RETURN_IF_ERROR(MaybeWriteHeader());
+  string footer;
+  core::PutFixed32(&footer, schema_.size());
+  for (const ColumnarColumn& column : schema_) {
+    core::PutFixed32(&footer, column.name.size());
+    footer.append(column.name);
+    core::PutFixed32(&footer, column.dtype);
+  }
+  core::PutFixed32(&footer, row_groups_.size());
+  for (const ColumnarRowGroup& row_group : row_groups_) {
+    core::PutFixed64(&footer, row_group.num_rows);
+    for (int i = 0; i < schema_.size(); ++i) {
+      const ColumnarChunk& chunk = row_group.chunks[i];
+      core::PutFixed64(&footer, chunk.offset);
+      core::PutFixed64(&footer, chunk.size);
+      core::PutFixed32(&footer, chunk.checksum);
+      core::PutFixed32(&footer, chunk.has_statistics);
+      if (DataTypeIsInteger(schema_[i].dtype)) {
+        core::PutFixed64(&footer, chunk.int_min);
+        core::PutFixed64(&footer, chunk.int_max);
+      } else {
+        PutDouble(&footer, chunk.min);
+        PutDouble(&footer, chunk.max);
+      }
+    }
+  }
+  const uint64 footer_size = footer.size();
+  const uint32 footer_checksum = Checksum(footer);
+  core::PutFixed64(&footer, footer_size);
+  core::PutFixed32(&footer, footer_checksum);
+  footer.append(kColumnarMagic, kColumnarMagicSize);
+  TF_RETURN_IF_ERROR(file_->Append(footer));
+  finished_ = true;
+  return file_->Flush();
+}
+
+/* static */
+Status ColumnarReader::Open(Env* env, const string& filename,
+                            std::unique_ptr<ColumnarReader>* out) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Columnar files can only be read on little-endian hosts.");
+  }
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+  std::unique_ptr<ColumnarReader> reader(
+      new ColumnarReader(filename, std::move(file)));
+  TF_RETURN_IF_ERROR(reader->ReadFooter(file_size));
+  *out = std::move(reader);
+  return Status::OK();
+}
+
+Status ColumnarReader::ReadFooter(uint64 file_size) {
+  if (file_size < kHeaderSize + kTrailerSize) {
+    return errors::DataLoss(filename_, " is not a columnar file.");
+  }
+  char header_scratch[kHeaderSize];
+  StringPiece header;
+  TF_RETURN_IF_ERROR(file_->Read(0, kHeaderSize, &header, header_scratch));
+  char trailer_scratch[kTrailerSize];
+  StringPiece trailer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - kTrailerSize, kTrailerSize,
+                                 &trailer, trailer_scratch));
+  const StringPiece magic(kColumnarMagic, kColumnarMagicSize);
+  if (header.substr(0, kColumnarMagicSize) != magic ||
+      trailer.substr(sizeof(uint64) + sizeof(uint32)) != magic) {
+    return errors::DataLoss(filename_, " is not a columnar file.");
+  }
+  const uint32 version =
+      core::DecodeFixed32(header.data() + kColumnarMagicSize);
+  if (version != kColumnarFormatVersion) {
+    return errors::Unimplemented(filename_, " has columnar format version ",
+                                 version, ", but only version ",
+                                 kColumnarFormatVersion, " is supported.");
+  }
+  const uint64 footer_size = core::DecodeFixed64(trailer.data());
+  const uint64 data_end = file_size - kTrailerSize;
+  if (footer_size > data_end - kHeaderSize) {
+    return errors::DataLoss("Corrupted footer in ", filename_);
+  }
+  const uint64 footer_offset = data_end - footer_size;
+  string footer_scratch(footer_size, '\0');
+  StringPiece footer;
+  TF_RETURN_IF_ERROR(file_->Read(footer_offset, footer_size, &footer,
+                                 &footer_scratch[0]));
+  if (Checksum(footer) !=
+      core::DecodeFixed32(trailer.data() + sizeof(uint64))) {
+    return errors::DataLoss("Checksum mismatch in the footer of ", filename_);
+  }
+
+  FooterParser parser(footer);
+  auto corrupted = [this]() {
+    return errors::DataLoss("Corrupted footer in ", filename_);
+  };
+  uint32 num_columns;
+  if (!parser.ReadFixed32(&num_columns)) return corrupted();
+  for (uint32 i = 0; i < num_columns; ++i) {
+    ColumnarColumn column;
+    uint32 name_size, dtype;
+    if (!parser.ReadFixed32(&name_size) ||
+        !parser.ReadBytes(name_size, &column.name) ||
+        !parser.ReadFixed32(&dtype)) {
+      return corrupted();
+    }
+    column.dtype = static_cast<DataType>(dtype);
+    TF_RETURN_IF_ERROR(CheckColumnarType(column.dtype));
+    schema_.push_back(std::move(column));
+  }
+  uint32 num_row_groups;
+  if (!parser.ReadFixed32(&num_row_groups)) return corrupted();
+  for (uint32 i = 0; i < num_row_groups; ++i) {
+    ColumnarRowGroup row_group;
+    uint64 num_rows;
+    // Every row takes at least four bytes in each chunk, so this also keeps
+    // the chunk sizes computed below from overflowing.
+    if (!parser.ReadFixed64(&num_rows) || num_rows > footer_offset) {
+      return corrupted();
+    }
+    row_group.num_rows = num_rows;
+    for (const ColumnarColumn& column : schema_) {
+      ColumnarChunk chunk;
+      uint32 has_statistics;
+      if (!parser.ReadFixed64(&chunk.offset) ||
+          !parser.ReadFixed64(&chunk.size) ||
+          !parser.ReadFixed32(&chunk.checksum) ||
+          !parser.ReadFixed32(&has_statistics) || has_statistics > 1) {
+        return corrupted();
+      }
+      chunk.has_statistics = has_statistics;
+      if (DataTypeIsInteger(column.dtype)) {
+        uint64 min, max;
+        if (!parser.ReadFixed64(&min) || !parser.ReadFixed64(&max)) {
+          return corrupted();
+        }
+        chunk.int_min = static_cast<int64>(min);
+        chunk.int_max = static_cast<int64>(max);
+      } else if (!parser.ReadDouble(&chunk.min) ||
+                 !parser.ReadDouble(&chunk.max)) {
+        return corrupted();
+      }
+      const uint64 min_size = column.dtype == DT_STRING
+                                  ? num_rows * sizeof(uint64)
+                                  : num_rows * DataTypeSize(column.dtype);
+      if (chunk.offset < kHeaderSize || chunk.offset > footer_offset ||
+          chunk.size > footer_offset - chunk.offset ||
+          (column.dtype == DT_STRING ? chunk.size < min_size
+                                     : chunk.size != min_size)) {
+        return corrupted();
+      }
+      row_group.chunks.push_back(chunk);
+    }
+    row_groups_.push_back(std::move(row_group));
+  }
+  if (!parser.done()) return corrupted();
+  return Status::OK();
+}
+
+int ColumnarReader::FindColumn(StringPiece name) const {
+  for (int i = 0; i < schema_.size(); ++i) {
+    if (schema_[i].name == name) return i;
+  }
+  return -1;
+}
+
+bool ColumnarReader::MayMatch(
+    int row_group, const std::vector<ColumnarFilter>& filters) const {
+  const ColumnarRowGroup& group = row_groups_[row_group];
+  for (const ColumnarFilter& filter : filters) {
+    const ColumnarChunk& chunk = group.chunks[filter.column];
+    if (!chunk.has_statistics) continue;
+    const bool may_match =
+        DataTypeIsInteger(schema_[filter.column].dtype)
+            ? filter.MayMatch(chunk.int_min, chunk.int_max)
+            : filter.MayMatch(chunk.min, chunk.max);
+    if (!may_match) return false;
+  }
+  return group.num_rows > 0;
+}
+
+Status ColumnarReader::ReadChunk(int row_group, int column, char* scratch,
+                                 StringPiece* chunk) const {
+  const ColumnarChunk& location = row_groups_[row_group].chunks[column];
+  Status s = file_->Read(location.offset, location.size, chunk, scratch);
+  if (errors::IsOutOfRange(s) || (s.ok() && chunk->size() != location.size)) {
+    return errors::DataLoss("Truncated chunk at ", location.offset, " in ",
+                            filename_);
+  }
+  TF_RETURN_IF_ERROR(s);
+  if (Checksum(*chunk) != location.checksum) {
+    return errors::DataLoss("Checksum mismatch in chunk at ", location.offset,
+                            " in ", filename_);
+  }
+  return Status::OK();
+}
+
+Status ColumnarReader::FilterRows(int row_group,
+                                  const std::vector<ColumnarFilter>& filters,
+                                  std::vector<int64>* rows) const {
+  const int64 num_rows = row_groups_[row_group].num_rows;
+  std::vector<bool> selected(num_rows, true);
+  for (const ColumnarFilter& filter : filters) {
+    const DataType dtype = schema_[filter.column].dtype;
+    if (dtype == DT_STRING) {
+      return errors::InvalidArgument("Cannot filter on string column ",
+                                     schema_[filter.column].name);
+    }
+    const ColumnarChunk& location =
+        row_groups_[row_group].chunks[filter.column];
+    std::unique_ptr<char[]> scratch(new char[location.size]);
+    StringPiece chunk;
+    TF_RETURN_IF_ERROR(
+        ReadChunk(row_group, filter.column, scratch.get(), &chunk));
+    switch (dtype) {
+      case DT_FLOAT:
+        ApplyFilter<float, double>(filter, chunk.data(), num_rows, &selected);
+        break;
+      case DT_DOUBLE:
+        ApplyFilter<double, double>(filter, chunk.data(), num_rows, &selected);
+        break;
+      case DT_INT32:
+        ApplyFilter<int32, int64>(filter, chunk.data(), num_rows, &selected);
+        break;
+      case DT_INT64:
+        ApplyFilter<int64, int64>(filter, chunk.data(), num_rows, &selected);
+        break;
+      default:
+        return errors::Internal("Unexpected columnar type ",
+                                DataTypeString(dtype));
+    }
+  }
+  rows->clear();
+  for (int64 i = 0; i < num_rows; ++i) {
+    if (selected[i]) rows->push_back(i);
+  }
+  return Status::OK();
+}
+
+Status ColumnarReader::ReadColumn(int row_group, int column,
+                                  const std::vector<int64>* rows,
+                                  Allocator* allocator, Tensor* out) const {
+  const DataType dtype = schema_[column].dtype;
+  const int64 num_rows = row_groups_[row_group].num_rows;
+  const int64 num_selected = rows ? rows->size() : num_rows;
+  const ColumnarChunk& location = row_groups_[row_group].chunks[column];
+  *out = Tensor(allocator, dtype, TensorShape({num_selected}));
+
+  if (dtype != DT_STRING && rows == nullptr) {
+    // The chunk has the layout of the tensor, so read it in place.
+    char* buffer = const_cast<char*>(out->tensor_data().data());
+    StringPiece chunk;
+    TF_RETURN_IF_ERROR(ReadChunk(row_group, column, buffer, &chunk));
+    if (chunk.data() != buffer) {
+      std::memcpy(buffer, chunk.data(), chunk.size());
+    }
+    return Status::OK();
+  }
+
+  std::unique_ptr<char[]> scratch(new char[location.size]);
+  StringPiece chunk;
+  TF_RETURN_IF_ERROR(ReadChunk(row_group, column, scratch.get(), &chunk));
+  if (dtype != DT_STRING) {
+    const size_t element_size = DataTypeSize(dtype);
+    char* buffer = const_cast<char*>(out->tensor_data().data());
+    for (int64 i = 0; i < num_selected; ++i) {
+      std::memcpy(buffer + i * element_size,
+                  chunk.data() + (*rows)[i] * element_size, element_size);
+    }
+    return Status::OK();
+  }
+
+  const char* offsets = chunk.data();
+  const char* data = offsets + num_rows * sizeof(uint64);
+  const uint64 data_size = chunk.size() - num_rows * sizeof(uint64);
+  auto strings = out->vec<tstring>();
+  for (int64 i = 0; i < num_selected; ++i) {
+    const int64 row = rows ? (*rows)[i] : i;
+    const uint64 begin =
+        row == 0 ? 0
+                 : core::DecodeFixed64(offsets + (row - 1) * sizeof(uint64));
+    const uint64 end = core::DecodeFixed64(offsets + row * sizeof(uint64));
+    if (begin > end || end > data_size) {
+      return errors::DataLoss("Corrupted string chunk at ", location.offset,
+                              " in ", filename_);
+    }
+    strings(i).assign(data + begin, end - begin);
+  }
+  return Status::OK();
+}
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
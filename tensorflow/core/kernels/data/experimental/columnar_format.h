@@ -0,0 +1,212 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_FORMAT_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_FORMAT_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/stringpiece.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// A columnar file stores a table whose rows are grouped into row groups. Each
+// column of a row group (a "chunk") is stored contiguously, so that a reader
+// only fetches the columns it needs. All integers are little-endian:
+//
+//   magic ("TFCOLUMN")
+//   format version (fixed32)
+//   chunk of column 0 of row group 0
+//   chunk of column 1 of row group 0
+//   ...
+//   footer
+//   footer length (fixed64)
+//   footer checksum (fixed32)
+//   magic
+//
+// A chunk of a numeric column holds its values back to back. A chunk of a
+// DT_STRING column holds `num_rows` fixed64 end offsets followed by the
+// concatenated bytes of the strings. The footer describes the schema and the
+// row groups:
+//
+//   num_columns (fixed32)
+//   per column: name length (fixed32), name, dtype (fixed32)
+//   num_row_groups (fixed32)
+//   per row group: num_rows (fixed64), then per column:
+//     offset (fixed64), size (fixed64), checksum (fixed32),
+//     has_statistics (fixed32), min (8 bytes), max (8 bytes)
+//
+// Checksums are the CRC-32 (as computed by zlib) of the chunk or footer bytes.
+// When `has_statistics` is 1, `min` and `max` bound the values of a numeric
+// chunk and let readers skip row groups that a filter cannot match. They are
+// int64s for integer columns and doubles for floating point columns. String
+// chunks, empty chunks and chunks with NaNs have no statistics.
+
+constexpr char kColumnarMagic[] = "TFCOLUMN";
+constexpr size_t kColumnarMagicSize = 8;
+// The version of the format written by `ColumnarWriter`. Readers reject files
+// with other versions.
+constexpr uint32 kColumnarFormatVersion = 1;
+
+struct ColumnarColumn {
+  string name;
+  DataType dtype;
+};
+
+struct ColumnarChunk {
+  uint64 offset = 0;
+  uint64 size = 0;
+  uint32 checksum = 0;
+  bool has_statistics = false;
+  // The statistics of floating point chunks.
+  double min = 0.0;
+  double max = 0.0;
+  // The statistics of integer chunks.
+  int64 int_min = 0;
+  int64 int_max = 0;
+};
+
+struct ColumnarRowGroup {
+  int64 num_rows = 0;
+  std::vector<ColumnarChunk> chunks;
+};
+
+// Returns OK if columns of type `dtype` can be stored in a columnar file.
+Status CheckColumnarType(DataType dtype);
+
+// A comparison of a numeric column with a constant. Floating point columns are
+// compared with `value`. Integer columns are compared with `int_value` when it
+// is the same constant as `value`, so that int64 values which doubles cannot
+// represent compare exactly, and with `value` otherwise (for example, when the
+// constant has a fraction).
+struct ColumnarFilter {
+  enum class Op {
+    kEqual,
+    kNotEqual,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual,
+  };
+
+  // Parses one of "==", "!=", "<", "<=", ">" and ">=".
+  static Status ParseOp(StringPiece op, Op* out);
+
+  // Returns true if `v` satisfies the filter.
+  bool Matches(double v) const;
+  bool Matches(int64 v) const;
+
+  // Returns false if no value in [`min`, `max`] satisfies the filter.
+  bool MayMatch(double min, double max) const;
+  bool MayMatch(int64 min, int64 max) const;
+
+  // Returns true if integers are compared with `int_value`.
+  bool CompareAsInt() const {
+    return static_cast<double>(int_value) == value;
+  }
+
+  int column;
+  Op op;
+  double value;
+  int64 int_value = 0;
+};
+
+// Writes a columnar file one row group at a time.
+class ColumnarWriter {
+ public:
+  // `file` must outlive the writer.
+  ColumnarWriter(WritableFile* file, std::vector<ColumnarColumn> schema);
+
+  // Appends a row group. `columns` holds one 1-D tensor per column of the
+  // schema, all with the same number of elements.
+  Status WriteRowGroup(const std::vector<Tensor>& columns);
+
+  // Writes the footer. The file is complete once this returns OK; the writer
+  // must not be used afterwards.
+  Status Finish();
+
+ private:
+  Status MaybeWriteHeader();
+
+  WritableFile* const file_;
+  const std::vector<ColumnarColumn> schema_;
+  std::vector<ColumnarRowGroup> row_groups_;
+  uint64 offset_ = 0;
+  bool finished_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ColumnarWriter);
+};
+
+// Reads the chunks of a columnar file. The footer is read when the file is
+// opened; chunks are read on demand. All methods are thread-safe.
+class ColumnarReader {
+ public:
+  static Status Open(Env* env, const string& filename,
+                     std::unique_ptr<ColumnarReader>* out);
+
+  const std::vector<ColumnarColumn>& schema() const { return schema_; }
+  const std::vector<ColumnarRowGroup>& row_groups() const {
+    return row_groups_;
+  }
+
+  // Returns the index of the column called `name`, or -1 if there is none.
+  int FindColumn(StringPiece name) const;
+
+  // Returns false if the chunk statistics show that no row of `row_group`
+  // satisfies all of `filters`.
+  bool MayMatch(int row_group,
+                const std::vector<ColumnarFilter>& filters) const;
+
+  // Reads only the columns of `filters` and stores the indices of the rows of
+  // `row_group` that satisfy all of them in `*rows`, in ascending order.
+  Status FilterRows(int row_group, const std::vector<ColumnarFilter>& filters,
+                    std::vector<int64>* rows) const;
+
+  // Reads `column` of `row_group` into a 1-D tensor. If `rows` is not null,
+  // only the rows it lists (in ascending order) are materialized.
+  Status ReadColumn(int row_group, int column, const std::vector<int64>* rows,
+                    Allocator* allocator, Tensor* out) const;
+
+ private:
+  ColumnarReader(string filename, std::unique_ptr<RandomAccessFile> file)
+      : filename_(std::move(filename)), file_(std::move(file)) {}
+
+  Status ReadFooter(uint64 file_size);
+
+  // Reads the bytes of a chunk into `*chunk`, using `scratch` if the file
+  // system needs a buffer, and verifies its checksum.
+  Status ReadChunk(int row_group, int column, char* scratch,
+                   StringPiece* chunk) const;
+
+  const string filename_;
+  const std::unique_ptr<RandomAccessFile> file_;
+  std::vector<ColumnarColumn> schema_;
+  std::vector<ColumnarRowGroup> row_groups_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ColumnarReader);
+};
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_FORMAT_H_
@@ -67,6 +67,11 @@ namespace data {
     DataServiceDatasetOp::kIterationCounter;
 /* static */ constexpr const char* const DataServiceDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const DataServiceDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const
+    DataServiceDatasetOp::kMaxElementsPerRequest;
+/* static */ constexpr const char* const
+    DataServiceDatasetOp::kMaxBytesPerRequest;
+/* static */ constexpr const char* const DataServiceDatasetOp::kTransferCodec;
 
 namespace {
 // Default interval between task list refreshes.
@@ -89,7 +94,9 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
           const std::string& data_transfer_protocol,
           const std::string& job_name, absl::optional<int64> consumer_index,
           absl::optional<int64> num_consumers, int64 max_outstanding_requests,
-          int64 task_refresh_interval_ms, IterationCounter* iteration_counter,
+          int64 task_refresh_interval_ms, const std::string& transfer_codec,
+          const ElementBatchingDef& element_batching,
+          IterationCounter* iteration_counter,
           bool owns_resource, ResourceHandle iteration_counter_handle,
           const DataTypeVector& output_types,
           const std::vector<PartialTensorShape>& output_shapes)
@@ -105,6 +112,8 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
         num_consumers_(num_consumers),
         max_outstanding_requests_(max_outstanding_requests),
         task_refresh_interval_ms_(task_refresh_interval_ms),
+        transfer_codec_(transfer_codec),
+        element_batching_(element_batching),
         iteration_counter_(iteration_counter),
         owns_resource_(owns_resource),
         iteration_counter_handle_(iteration_counter_handle),
@@ -210,12 +219,24 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
     b->BuildAttrValue(task_refresh_interval_ms_,
                       &task_refresh_interval_hint_ms);
 
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, inputs,
-        {std::make_pair(kTaskRefreshIntervalHintMs,
-                        task_refresh_interval_hint_ms),
-         std::make_pair(kDataTransferProtocol, data_transfer_protocol)},
-        output));
+    std::vector<std::pair<StringPiece, AttrValue>> attrs = {
+        std::make_pair(kTaskRefreshIntervalHintMs,
+                       task_refresh_interval_hint_ms),
+        std::make_pair(kDataTransferProtocol, data_transfer_protocol)};
+    if (op_version_ == 2) {
+      AttrValue max_elements_per_request;
+      b->BuildAttrValue(element_batching_.max_elements(),
+                        &max_elements_per_request);
+      attrs.emplace_back(kMaxElementsPerRequest, max_elements_per_request);
+      AttrValue max_bytes_per_request;
+      b->BuildAttrValue(element_batching_.max_bytes(), &max_bytes_per_request);
+      attrs.emplace_back(kMaxBytesPerRequest, max_bytes_per_request);
+      AttrValue transfer_codec;
+      b->BuildAttrValue(transfer_codec_, &transfer_codec);
+      attrs.emplace_back(kTransferCodec, transfer_codec);
+    }
+
+    TF_RETURN_IF_ERROR(b->AddDataset(this, inputs, attrs, output));
     return Status::OK();
   }
 
@@ -278,7 +299,8 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
           [&]() {
             return dispatcher_->GetOrCreateJob(
                 dataset()->dataset_id_, dataset()->processing_mode_, key,
-                dataset()->num_consumers_, job_client_id_);
+                dataset()->num_consumers_, dataset()->element_batching_,
+                job_client_id_);
           },
           /*description=*/
           strings::StrCat("get or create job with dispatcher at ",
@@ -486,7 +508,8 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       std::unique_ptr<DataServiceWorkerClient> worker;
       TF_RETURN_IF_ERROR(CreateDataServiceWorkerClient(
           task_info.transfer_address(), dataset()->protocol_,
-          dataset()->data_transfer_protocol_, worker));
+          dataset()->data_transfer_protocol_, task_info.worker_address(),
+          task_info.element_batching(), worker));
       tasks_.push_back(std::make_shared<Task>(task_info, std::move(worker)));
       worker_thread_cv_.notify_one();
       if (StrictRoundRobin()) {
@@ -937,6 +960,8 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
   const absl::optional<int64> num_consumers_;
   const int64 max_outstanding_requests_;
   const int64 task_refresh_interval_ms_;
+  const tstring transfer_codec_;
+  const ElementBatchingDef element_batching_;
   IterationCounter* const iteration_counter_;  // Owned
   const bool owns_resource_;
   const ResourceHandle iteration_counter_handle_;
@@ -959,6 +984,32 @@ DataServiceDatasetOp::DataServiceDatasetOp(OpKernelConstruction* ctx)
         ctx, ctx->GetAttr(kDataTransferProtocol, &data_transfer_protocol_));
   }
   if (data_transfer_protocol_.empty()) data_transfer_protocol_ = "grpc";
+  int64 max_elements_per_request = 1;
+  if (ctx->HasAttr(kMaxElementsPerRequest)) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kMaxElementsPerRequest, &max_elements_per_request));
+  }
+  OP_REQUIRES(ctx, max_elements_per_request > 0,
+              errors::InvalidArgument(kMaxElementsPerRequest,
+                                      " must be positive, but got ",
+                                      max_elements_per_request));
+  int64 max_bytes_per_request = 16 << 20;
+  if (ctx->HasAttr(kMaxBytesPerRequest)) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kMaxBytesPerRequest, &max_bytes_per_request));
+  }
+  OP_REQUIRES(ctx, max_bytes_per_request > 0,
+              errors::InvalidArgument(kMaxBytesPerRequest,
+                                      " must be positive, but got ",
+                                      max_bytes_per_request));
+  if (ctx->HasAttr(kTransferCodec)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kTransferCodec, &transfer_codec_));
+  }
+  CompressionCodecDef codec;
+  OP_REQUIRES_OK(ctx, ParseCompressionCodec(transfer_codec_, codec));
+  element_batching_.set_max_elements(max_elements_per_request);
+  element_batching_.set_max_bytes(max_bytes_per_request);
+  element_batching_.set_codec(codec);
   auto& op_name = ctx->def().op();
   if (op_name == kDataServiceDatasetV1) {
     op_version_ = 1;
@@ -1056,7 +1107,8 @@ void DataServiceDatasetOp::MakeDataset(OpKernelContext* ctx,
   *output = new Dataset(ctx, op_version_, dataset_id, processing_mode, address,
                         protocol, data_transfer_protocol_, job_name,
                         consumer_index, num_consumers, max_outstanding_requests,
-                        task_refresh_interval_hint_ms_, iteration_counter,
+                        task_refresh_interval_hint_ms_, transfer_codec_,
+                        element_batching_, iteration_counter,
                         owns_resource, iteration_counter_handle, output_types_,
                         output_shapes_);
 }
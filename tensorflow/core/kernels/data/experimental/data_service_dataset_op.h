@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_DATA_SERVICE_DATASET_OP_H_
 
 #include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 
@@ -63,6 +64,11 @@ class DataServiceDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kIterationCounter = "iteration_counter";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kMaxElementsPerRequest =
+      "max_elements_per_request";
+  static constexpr const char* const kMaxBytesPerRequest =
+      "max_bytes_per_request";
+  static constexpr const char* const kTransferCodec = "transfer_codec";
   // Note: If a new constant is declared here, it *must* be defined in
   // data_service_dataset_op.cc, otherwise it will not compile in debug mode.
 
@@ -79,6 +85,8 @@ class DataServiceDatasetOp : public DatasetOpKernel {
   DataTypeVector output_types_;
   std::vector<PartialTensorShape> output_shapes_;
   std::string data_transfer_protocol_;
+  std::string transfer_codec_;
+  ElementBatchingDef element_batching_;
 };
 
 }  // namespace data
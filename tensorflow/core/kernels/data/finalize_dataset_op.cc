@@ -37,10 +37,7 @@ namespace {
 void GetModelDatasetParams(const Options& options,
                            model::AutotuneAlgorithm* algorithm,
                            bool* cpu_budget, bool* ram_budget) {
-  *algorithm = model::AutotuneAlgorithm::HILL_CLIMB;
-  if (options.optimization_options().autotune_buffers()) {
-    *algorithm = model::AutotuneAlgorithm::GRADIENT_DESCENT;
-  }
+  *algorithm = GetAutotuneAlgorithm(options);
   *cpu_budget = options.optimization_options().autotune_cpu_budget();
   *ram_budget = options.optimization_options().autotune_ram_budget();
 }
@@ -0,0 +1,110 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/mapped_record_reader.h"
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr uint64 kHeaderSize = io::RecordReader::kHeaderSize;
+constexpr uint64 kFooterSize = io::RecordReader::kFooterSize;
+
+// Returns true if the masked crc stored after the `n` bytes at `data`
+// matches them.
+bool ChecksumMatches(const char* data, size_t n) {
+  const uint32 masked_crc = core::DecodeFixed32(data + n);
+  return crc32c::Unmask(masked_crc) == crc32c::Value(data, n);
+}
+
+}  // namespace
+
+/* static */
+Status MappedRecordReader::Create(Env* env, const string& filename,
+                                  std::unique_ptr<MappedRecordReader>* out) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(env->NewReadOnlyMemoryRegionFromFile(filename, &region));
+  if (region->length() > 0 && region->data() == nullptr) {
+    return errors::Internal("Failed to map ", filename);
+  }
+  out->reset(new MappedRecordReader(std::move(region)));
+  return Status::OK();
+}
+
+MappedRecordReader::MappedRecordReader(
+    std::unique_ptr<ReadOnlyMemoryRegion> region)
+    : region_(std::move(region)),
+      data_(static_cast<const char*>(region_->data())),
+      length_(region_->length()) {}
+
+Status MappedRecordReader::ReadHeader(uint64* length) {
+  const uint64 remaining = length_ - offset_;
+  if (remaining == 0) {
+    return errors::OutOfRange("eof");
+  }
+  if (remaining < kHeaderSize) {
+    return errors::DataLoss("truncated record at ", offset_);
+  }
+  const char* header = data_ + offset_;
+  if (!ChecksumMatches(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record at ", offset_);
+  }
+  *length = core::DecodeFixed64(header);
+  if (remaining - kHeaderSize < kFooterSize ||
+      remaining - kHeaderSize - kFooterSize < *length) {
+    return errors::DataLoss("truncated record at ", offset_);
+  }
+  return Status::OK();
+}
+
+Status MappedRecordReader::ReadRecord(tstring* record) {
+  uint64 length;
+  TF_RETURN_IF_ERROR(ReadHeader(&length));
+  const char* data = data_ + offset_ + kHeaderSize;
+  if (!ChecksumMatches(data, length)) {
+    return errors::DataLoss("corrupted record at ", offset_);
+  }
+  record->assign(data, length);
+  offset_ += kHeaderSize + length + kFooterSize;
+  return Status::OK();
+}
+
+Status MappedRecordReader::SkipRecords(int num_to_skip, int* num_skipped) {
+  *num_skipped = 0;
+  for (int i = 0; i < num_to_skip; ++i) {
+    uint64 length;
+    TF_RETURN_IF_ERROR(ReadHeader(&length));
+    offset_ += kHeaderSize + length + kFooterSize;
+    ++*num_skipped;
+  }
+  return Status::OK();
+}
+
+Status MappedRecordReader::SeekOffset(uint64 offset) {
+  if (offset > length_) {
+    return errors::InvalidArgument("Offset ", offset,
+                                   " is past the end of the file (",
+                                   length_, " bytes)");
+  }
+  offset_ = offset;
+  return Status::OK();
+}
+
+}  // namespace data
+}  // namespace tensorflow
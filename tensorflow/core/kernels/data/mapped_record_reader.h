@@ -0,0 +1,82 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_MAPPED_RECORD_READER_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_MAPPED_RECORD_READER_H_
+
+#include <memory>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/tstring.h"
+
+namespace tensorflow {
+namespace data {
+
+// Reads an uncompressed TFRecord file through a read-only memory mapping.
+//
+// Records are checksummed in place and copied straight from the mapping into
+// the caller's `tstring`, which saves the `read` syscalls and the intermediate
+// buffer copy of `io::SequentialRecordReader`. Records own their bytes, so
+// they stay valid after the reader is destroyed.
+//
+// NOTE: Records are deliberately not returned as views of the mapping. Copying
+// a view `tstring` (for example when records are batched) yields another view
+// that holds no reference on the mapping, so nothing could keep the mapping
+// alive for as long as such copies are used.
+class MappedRecordReader {
+ public:
+  // Maps `filename`. Returns an error if the file system of `filename` does
+  // not support memory mapping, or if the file is empty.
+  static Status Create(Env* env, const string& filename,
+                       std::unique_ptr<MappedRecordReader>* out);
+
+  // Reads the next record into `*record`. Returns OUT_OF_RANGE at the end of
+  // the file, and DATA_LOSS if the record is truncated or corrupted.
+  Status ReadRecord(tstring* record);
+
+  // Skips up to `num_to_skip` records and stores the number of skipped
+  // records in `*num_skipped`. As with `io::RecordReader`, only the record
+  // headers are checksummed.
+  Status SkipRecords(int num_to_skip, int* num_skipped);
+
+  // Returns the offset of the next record.
+  uint64 TellOffset() const { return offset_; }
+
+  // Moves to the record at `offset`, which must have been returned by
+  // `TellOffset()`.
+  Status SeekOffset(uint64 offset);
+
+  // Returns the size of the mapped file in bytes.
+  uint64 file_size() const { return length_; }
+
+ private:
+  explicit MappedRecordReader(std::unique_ptr<ReadOnlyMemoryRegion> region);
+
+  // Checks the header of the record at `offset_` and stores the length of
+  // its data in `*length`.
+  Status ReadHeader(uint64* length);
+
+  const std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  const char* const data_;
+  const uint64 length_;
+  uint64 offset_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedRecordReader);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_MAPPED_RECORD_READER_H_
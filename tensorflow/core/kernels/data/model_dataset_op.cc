@@ -62,9 +62,12 @@ class ModelDatasetOp::Dataset : public DatasetBase {
         cpu_budget_(cpu_budget),
         ram_budget_(ram_budget),
         traceme_metadata_(
-            {{"algorithm", algorithm == model::AutotuneAlgorithm::HILL_CLIMB
-                               ? "hill climb"
-                               : "gradient descent"},
+            {{"algorithm",
+              algorithm == model::AutotuneAlgorithm::HILL_CLIMB
+                  ? "hill climb"
+                  : algorithm == model::AutotuneAlgorithm::GRADIENT_DESCENT
+                        ? "gradient descent"
+                        : "online cost model"},
              {"cpu_budget",
               strings::Printf("%lld", static_cast<long long>(cpu_budget))},
              {"ram_budget",
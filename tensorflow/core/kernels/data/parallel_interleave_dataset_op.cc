@@ -78,6 +78,8 @@ namespace data {
 /* static */ constexpr const char* const
     ParallelInterleaveDatasetOp::kDeterministic;
 /* static */ constexpr const char* const ParallelInterleaveDatasetOp::kSloppy;
+/* static */ constexpr const char* const
+    ParallelInterleaveDatasetOp::kReorderWindow;
 
 namespace {
 
@@ -88,6 +90,7 @@ constexpr char kBlockIndex[] = "block_index";
 constexpr char kCycleIndex[] = "cycle_index";
 constexpr char kEndOfInput[] = "end_of_input";
 constexpr char kElementIdCounter[] = "element_id_counter";
+constexpr char kNumResultsConsumed[] = "num_results_consumed";
 constexpr char kCurrentElements[] = "current_elements";
 constexpr char kCurrentElementsSize[] = "current_elements.size";
 constexpr char kFutureElements[] = "future_elements";
@@ -99,6 +102,7 @@ constexpr char kIdSuffix[] = ".id";
 constexpr char kSizeSuffix[] = ".size";
 constexpr char kInputsSuffix[] = ".inputs";
 constexpr char kIsReadySuffix[] = ".is_ready";
+constexpr char kSkippedAtSuffix[] = ".skipped_at";
 
 constexpr char kParallelInterleaveDatasetV2[] = "ParallelInterleaveDatasetV2";
 constexpr char kParallelInterleaveDatasetV3[] = "ParallelInterleaveDatasetV3";
@@ -162,7 +166,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           std::unique_ptr<CapturedFunction> captured_func, int64 cycle_length,
           int64 block_length, int64 buffer_output_elements,
           int64 prefetch_input_elements, int64 num_parallel_calls,
-          DeterminismPolicy deterministic, const DataTypeVector& output_types,
+          DeterminismPolicy deterministic, int64 reorder_window,
+          const DataTypeVector& output_types,
           const std::vector<PartialTensorShape>& output_shapes, int op_version)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
@@ -175,6 +180,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
             prefetch_input_elements, cycle_length)),
         num_parallel_calls_(num_parallel_calls),
         deterministic_(deterministic),
+        reorder_window_(reorder_window),
         output_types_(output_types),
         output_shapes_(output_shapes),
         op_version_(op_version),
@@ -186,7 +192,10 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
              {"cycle_length",
               strings::Printf("%lld", static_cast<long long>(cycle_length))},
              {"deterministic",
-              deterministic.IsNondeterministic() ? "false" : "true"}}) {
+              deterministic.IsNondeterministic() ? "false" : "true"},
+             {"reorder_window",
+              strings::Printf("%lld", static_cast<long long>(
+                                          reorder_window_))}}) {
     input_->Ref();
   }
 
@@ -299,6 +308,11 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       b->BuildAttrValue(deterministic_.String(), &deterministic_attr);
       attrs.emplace_back(kDeterministic, deterministic_attr);
     }
+    if (op_version_ >= 4) {
+      AttrValue reorder_window_attr;
+      b->BuildAttrValue(reorder_window_, &reorder_window_attr);
+      attrs.emplace_back(kReorderWindow, reorder_window_attr);
+    }
 
     TF_RETURN_IF_ERROR(b->AddDataset(this, inputs, list_inputs, attrs, output));
     return Status::OK();
@@ -315,6 +329,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
               params.dataset->num_parallel_calls_, mu_,
               num_parallel_calls_cond_var_)),
           deterministic_(deterministic),
+          reorder_window_(params.dataset->reorder_window_),
           current_elements_(params.dataset->cycle_length_) {}
 
     ~ParallelInterleaveIterator() override {
@@ -440,6 +455,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       }
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kElementIdCounter,
                                              element_id_counter_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kNumResultsConsumed,
+                                             num_results_consumed_));
       TF_RETURN_IF_ERROR(WriteCurrentElements(ctx, writer));
       TF_RETURN_IF_ERROR(WriteFutureElements(ctx, writer));
       // Wake workers back up.
@@ -462,6 +479,10 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kElementIdCounter,
                                               &element_id_counter_));
         end_of_input_ = reader->Contains(prefix(), kEndOfInput);
+        if (reader->Contains(prefix(), kNumResultsConsumed)) {
+          TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kNumResultsConsumed,
+                                                &num_results_consumed_));
+        }
       }
       TF_RETURN_IF_ERROR(ReadCurrentElements(ctx, reader));
       TF_RETURN_IF_ERROR(ReadFutureElements(ctx, reader));
@@ -569,6 +590,10 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       // Whether we tried to initialize the element, but the input iterator
       // was exhausted so we could produce no inputs.
       bool no_input TF_GUARDED_BY(&ParallelInterleaveIterator::mu_) = false;
+      // The value of `num_results_consumed_` when the element was first skipped
+      // because it had no result available, or -1 if it has not been skipped
+      // since it last produced a result. Only used with a reorder window.
+      int64 skipped_at TF_GUARDED_BY(&ParallelInterleaveIterator::mu_) = -1;
       // Condition variable for communicating between current worker threads
       // and GetNext.
       condition_variable cond_var;
@@ -659,6 +684,21 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       if (deterministic_) {
         return ConsumeHelper(result);
       }
+      if (reorder_window_ > 0) {
+        // An element that has been skipped for `reorder_window_` results must
+        // produce the next result.
+        for (int64 i = 0; i <= last_valid_current_element_; ++i) {
+          const std::shared_ptr<Element>& element = current_elements_[i];
+          if (element && element->skipped_at >= 0 &&
+              num_results_consumed_ - element->skipped_at >= reorder_window_) {
+            if (cycle_index_ != i) {
+              cycle_index_ = i;
+              block_index_ = 0;
+            }
+            return ConsumeHelper(result);
+          }
+        }
+      }
       // If we are allowed to be nondeterministic (i.e. return results out of
       // order), try to find an element in the cycle that has a result
       // available.
@@ -666,6 +706,11 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
         if (ConsumeHelper(result)) {
           return true;
         }
+        const std::shared_ptr<Element>& element =
+            current_elements_[cycle_index_];
+        if (element->skipped_at < 0) {
+          element->skipped_at = num_results_consumed_;
+        }
         AdvanceToNextInCycle();
       }
       return false;
@@ -697,6 +742,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           // We found a result.
           std::swap(*result, element->results.front());
           element->results.pop_front();
+          element->skipped_at = -1;
+          ++num_results_consumed_;
           if (!element->active) {
             elements_to_process_.push_back(cycle_index_);
             current_workers_cond_var_.notify_one();
@@ -1206,6 +1253,10 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
         TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       const auto& iterator_name =
           absl::StrCat(prefix(), "::", key_prefix, "::", idx);
+      if (element->skipped_at >= 0) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(iterator_name, kSkippedAtSuffix,
+                                               element->skipped_at));
+      }
       if (element->iterator) {
         TF_RETURN_IF_ERROR(SaveInput(ctx, writer, element->iterator));
         TF_RETURN_IF_ERROR(
@@ -1308,6 +1359,10 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           RecordBufferEnqueue(ctx, result->return_values);
           element->results[i] = std::move(result);
         }
+        if (reader->Contains(iterator_name, kSkippedAtSuffix)) {
+          TF_RETURN_IF_ERROR(reader->ReadScalar(iterator_name, kSkippedAtSuffix,
+                                                &element->skipped_at));
+        }
         if (!reader->Contains(iterator_name,
                               absl::StrCat(kInputsSuffix, kSizeSuffix))) {
           element->iterator.reset();
@@ -1528,6 +1583,13 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
     // Determines whether outputs can be produced in deterministic order.
     const bool deterministic_;
 
+    // If positive, bounds how many results may be returned ahead of a result
+    // that is late with respect to the deterministic order.
+    const int64 reorder_window_;
+
+    // Number of results consumed, used to enforce `reorder_window_`.
+    int64 num_results_consumed_ TF_GUARDED_BY(mu_) = 0;
+
     // Controls cancellation of `input_impl_`. Must be ordered before
     // `input_impl_` so that `input_impl_` is destroyed first.
     std::unique_ptr<CancellationManager> cancellation_manager_;
@@ -1589,6 +1651,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
   const int64 prefetch_input_elements_;
   const int64 num_parallel_calls_;
   const DeterminismPolicy deterministic_;
+  const int64 reorder_window_;
   const DataTypeVector output_types_;
   const std::vector<PartialTensorShape> output_shapes_;
   const int op_version_;
@@ -1619,6 +1682,11 @@ ParallelInterleaveDatasetOp::ParallelInterleaveDatasetOp(
     OP_REQUIRES_OK(
         ctx, DeterminismPolicy::FromString(deterministic, &deterministic_));
   }
+  if (ctx->HasAttr(kReorderWindow)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kReorderWindow, &reorder_window_));
+    OP_REQUIRES(ctx, reorder_window_ >= 0,
+                errors::InvalidArgument("`reorder_window` must be >= 0"));
+  }
 }
 
 void ParallelInterleaveDatasetOp::MakeDataset(OpKernelContext* ctx,
@@ -1689,10 +1757,11 @@ void ParallelInterleaveDatasetOp::MakeDataset(OpKernelContext* ctx,
     metrics::RecordTFDataAutotune(kDatasetType);
   }
 
-  *output = new Dataset(
-      ctx, input, std::move(captured_func), cycle_length, block_length,
-      buffer_output_elements, prefetch_input_elements, num_parallel_calls,
-      deterministic_, output_types_, output_shapes_, op_version_);
+  *output = new Dataset(ctx, input, std::move(captured_func), cycle_length,
+                        block_length, buffer_output_elements,
+                        prefetch_input_elements, num_parallel_calls,
+                        deterministic_, reorder_window_, output_types_,
+                        output_shapes_, op_version_);
 }
 
 namespace {
@@ -11,6 +11,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/parallel_interleave_dataset_op.h"
 
+#include <algorithm>
+#include <numeric>
+
 #include "tensorflow/core/data/dataset_test_base.h"
 
 namespace tensorflow {
@@ -31,7 +34,8 @@ class ParallelInterleaveDatasetParams : public DatasetParams {
       std::vector<FunctionDef> func_lib, DataTypeVector type_arguments,
       const DataTypeVector& output_dtypes,
       const std::vector<PartialTensorShape>& output_shapes,
-      const std::string& deterministic, const std::string& node_name)
+      const std::string& deterministic, const std::string& node_name,
+      int64 reorder_window = 0)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
         other_arguments_(std::move(other_arguments)),
@@ -43,7 +47,8 @@ class ParallelInterleaveDatasetParams : public DatasetParams {
         func_(std::move(func)),
         func_lib_(std::move(func_lib)),
         type_arguments_(std::move(type_arguments)),
-        deterministic_(deterministic) {
+        deterministic_(deterministic),
+        reorder_window_(reorder_window) {
     input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
     op_version_ = kOpVersion;
     name_utils::IteratorPrefixParams params;
@@ -88,6 +93,7 @@ class ParallelInterleaveDatasetParams : public DatasetParams {
     *attr_vector = {
         {ParallelInterleaveDatasetOp::kFunc, func_},
         {ParallelInterleaveDatasetOp::kDeterministic, deterministic_},
+        {ParallelInterleaveDatasetOp::kReorderWindow, reorder_window_},
         {ParallelInterleaveDatasetOp::kTarguments, type_arguments_},
         {ParallelInterleaveDatasetOp::kOutputShapes, output_shapes_},
         {ParallelInterleaveDatasetOp::kOutputTypes, output_dtypes_}};
@@ -111,6 +117,7 @@ class ParallelInterleaveDatasetParams : public DatasetParams {
   std::vector<FunctionDef> func_lib_;
   DataTypeVector type_arguments_;
   std::string deterministic_;
+  int64 reorder_window_;
 };
 
 class ParallelInterleaveDatasetOpTest : public DatasetOpsTestBase {};
@@ -124,6 +131,32 @@ FunctionDefHelper::AttrValueWrapper MakeTensorSliceDatasetFunc(
                  {"output_shapes", output_shapes}});
 }
 
+// Returns a function that makes a dataset from the slices of `x`, sleeping
+// for `sleep_microseconds` before producing each slice.
+FunctionDef MakeSleepDataset() {
+  const DataTypeVector output_types = {DT_INT64};
+  const std::vector<PartialTensorShape> output_shapes = {
+      PartialTensorShape({1})};
+  return FunctionDefHelper::Define(
+      // Name
+      "MakeSleepDataset",
+      // Args
+      {"x: int64", "sleep_microseconds: int64"},
+      // Return values
+      {"y: variant"},
+      // Attr def
+      {},
+      // Nodes
+      {{{"slices"},
+        "TensorSliceDataset",
+        {"x"},
+        {{"Toutput_types", output_types}, {"output_shapes", output_shapes}}},
+       {{"y"},
+        "SleepDataset",
+        {"slices", "sleep_microseconds"},
+        {{"output_types", output_types}, {"output_shapes", output_shapes}}}});
+}
+
 ParallelInterleaveDatasetParams ParallelInterleaveDatasetParams1() {
   auto tensor_slice_dataset_params = TensorSliceDatasetParams(
       /*components=*/{CreateTensor<int64>(TensorShape{3, 3, 1},
@@ -774,6 +807,115 @@ TEST_F(ParallelInterleaveDatasetOpTest, InvalidArguments) {
   }
 }
 
+constexpr int64 kStragglerCycleLength = 3;
+constexpr int64 kStragglerInputSize = 10;
+constexpr int64 kStragglerReorderWindow = 2;
+
+// The first of three inputs sleeps for 10ms before each of its results, so a
+// nondeterministic interleave skips it whenever the other inputs are ready.
+// Input `i` produces the values [10 * i, 10 * i + 10).
+ParallelInterleaveDatasetParams StragglerDatasetParams(
+    int64 reorder_window = kStragglerReorderWindow) {
+  std::vector<int64> values(kStragglerCycleLength * kStragglerInputSize);
+  std::iota(values.begin(), values.end(), 0);
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/
+      {CreateTensor<int64>(
+           TensorShape{kStragglerCycleLength, kStragglerInputSize, 1}, values),
+       CreateTensor<int64>(TensorShape{kStragglerCycleLength},
+                           {10 * 1000, 0, 0})},
+      /*node_name=*/"tensor_slice");
+  return ParallelInterleaveDatasetParams(
+      tensor_slice_dataset_params,
+      /*other_arguments=*/{},
+      /*cycle_length=*/kStragglerCycleLength,
+      /*block_length=*/1,
+      /*buffer_output_elements=*/model::kAutotune,
+      /*prefetch_input_elements=*/0,
+      /*num_parallel_calls=*/kStragglerCycleLength,
+      /*func=*/FunctionDefHelper::FunctionRef("MakeSleepDataset"),
+      /*func_lib=*/{MakeSleepDataset()},
+      /*type_arguments=*/{},
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({1})},
+      /*deterministic=*/DeterminismPolicy::kNondeterministic,
+      /*node_name=*/kNodeName,
+      /*reorder_window=*/reorder_window);
+}
+
+// Checks that `outputs` holds every value of `StragglerDatasetParams()` and
+// that the straggler is delayed by at most `reorder_window` results: the
+// deterministic order puts `cycle_length - 1` other results between two
+// results of the straggler, and the window allows `reorder_window` more.
+void ExpectBoundedReordering(const std::vector<Tensor>& outputs) {
+  ASSERT_EQ(outputs.size(), kStragglerCycleLength * kStragglerInputSize);
+  std::vector<int64> values;
+  int64 previous = -1;
+  int64 num_straggler_results = 0;
+  for (int64 i = 0; i < outputs.size(); ++i) {
+    const int64 value = outputs[i].flat<int64>()(0);
+    values.push_back(value);
+    if (value >= kStragglerInputSize) continue;
+    // The results of each input are returned in order.
+    EXPECT_EQ(value, num_straggler_results);
+    const int64 max_position =
+        num_straggler_results == 0
+            ? kStragglerReorderWindow
+            : previous + kStragglerCycleLength + kStragglerReorderWindow;
+    EXPECT_LE(i, max_position) << "straggler result " << value;
+    previous = i;
+    ++num_straggler_results;
+  }
+  std::sort(values.begin(), values.end());
+  for (int64 i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(values[i], i);
+  }
+}
+
+TEST_F(ParallelInterleaveDatasetOpTest, BoundedReorderWindow) {
+  auto dataset_params = StragglerDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> outputs;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &outputs, &end_of_sequence));
+  }
+  ExpectBoundedReordering(outputs);
+}
+
+TEST_F(ParallelInterleaveDatasetOpTest, BoundedReorderWindowSaveAndRestore) {
+  auto dataset_params = StragglerDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  bool end_of_sequence = false;
+  std::vector<Tensor> outputs;
+  while (!end_of_sequence) {
+    // Saving waits for in-flight calls, so only checkpoint every few results
+    // to leave the straggler behind in between.
+    if (outputs.size() % 4 == 1) {
+      VariantTensorDataWriter writer;
+      TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+      std::vector<const VariantTensorData*> data;
+      writer.GetData(&data);
+      VariantTensorDataReader reader(data);
+      TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                                   dataset_params.iterator_prefix(),
+                                   *dataset_, &iterator_));
+    }
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &outputs, &end_of_sequence));
+  }
+  ExpectBoundedReordering(outputs);
+}
+
+TEST_F(ParallelInterleaveDatasetOpTest, InvalidReorderWindow) {
+  auto dataset_params = StragglerDatasetParams(/*reorder_window=*/-1);
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
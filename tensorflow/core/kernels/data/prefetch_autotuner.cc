@@ -20,9 +20,13 @@ limitations under the License.
 namespace tensorflow {
 namespace data {
 
+/* static */ constexpr double PrefetchAutotuner::kStarvationThreshold;
+/* static */ constexpr int64 PrefetchAutotuner::kMinWaits;
+
 PrefetchAutotuner::PrefetchAutotuner(int64 initial_buffer_size,
-                                     int64 buffer_size_min)
-    : buffer_limit_(initial_buffer_size) {
+                                     int64 buffer_size_min,
+                                     int64 max_producers)
+    : buffer_limit_(initial_buffer_size), max_producers_(max_producers) {
   if (initial_buffer_size == model::kAutotune) {
     mode_ = Mode::kUpswing;
     buffer_limit_ = std::max(int64{1}, buffer_size_min);
@@ -44,6 +48,8 @@ void PrefetchAutotuner::RecordConsumption(size_t current_buffer_size) {
       if (static_cast<tensorflow::int64>(current_buffer_size) ==
           buffer_limit_) {
         mode_ = Mode::kDownswing;
+        // The producers kept up, so waits so far do not count against them.
+        ResetWaits();
       }
       return;
     case Mode::kDownswing:
@@ -60,5 +66,31 @@ void PrefetchAutotuner::RecordConsumption(size_t current_buffer_size) {
   }
 }
 
+void PrefetchAutotuner::RecordWait(int64 wait_us, int64 now_us) {
+  if (mode_ == Mode::kDisabled || num_producers_ >= max_producers_) {
+    return;
+  }
+  if (window_start_us_ < 0) {
+    window_start_us_ = now_us - wait_us;
+  }
+  ++window_waits_;
+  window_wait_us_ += wait_us;
+  const int64 window_us = now_us - window_start_us_;
+  if (window_waits_ >= kMinWaits && window_us > 0 &&
+      window_wait_us_ > kStarvationThreshold * window_us) {
+    ++num_producers_;
+    // Each producer needs a slot in the buffer to be useful.
+    buffer_limit_ = std::max(buffer_limit_, num_producers_);
+    mode_ = Mode::kUpswing;
+    ResetWaits();
+  }
+}
+
+void PrefetchAutotuner::ResetWaits() {
+  window_start_us_ = -1;
+  window_waits_ = 0;
+  window_wait_us_ = 0;
+}
+
 }  // namespace data
 }  // namespace tensorflow
@@ -33,19 +33,38 @@ namespace data {
 // if the prefetching thread is able to successfully fill the buffer at its
 // current size.
 //
-// Note: in the current implementation, we never decrease the buffer_limit().
-// This should change in the future!
+// If `max_producers` is greater than 1, PrefetchAutotuner also addresses that
+// failure mode by adjusting the number of threads producing elements. When the
+// buffer has not filled up since the last adjustment and the downstream
+// iterator spent more than `kStarvationThreshold` of that time waiting for
+// elements (as reported by RecordWait()), the producers are too slow and one
+// more producer is added.
+//
+// Note: in the current implementation, we never decrease the buffer_limit()
+// nor the num_producers(). This should change in the future!
 //
 // PrefetchAutotuner is NOT thread safe.
 class PrefetchAutotuner {
  public:
-  explicit PrefetchAutotuner(int64 initial_buffer_size, int64 buffer_size_min);
+  // The fraction of the time the downstream iterator may wait for elements
+  // without the buffer filling up before a producer is added.
+  static constexpr double kStarvationThreshold = 0.1;
+  // The number of waits needed before a producer is added.
+  static constexpr int64 kMinWaits = 8;
+
+  explicit PrefetchAutotuner(int64 initial_buffer_size, int64 buffer_size_min,
+                             int64 max_producers = 1);
 
   int64 buffer_limit() const { return buffer_limit_; }
+  int64 num_producers() const { return num_producers_; }
 
   void RecordConsumption(size_t current_buffer_size);
   void RecordEmpty() { RecordConsumption(0); }
 
+  // Records that the downstream iterator waited `wait_us` microseconds for the
+  // buffer to become non-empty, the wait ending at `now_us`.
+  void RecordWait(int64 wait_us, int64 now_us);
+
  private:
   // PrefetchAutotuner operates as a state machine.
   enum class Mode {
@@ -61,8 +80,20 @@ class PrefetchAutotuner {
     kDownswing,
   };
 
+  // Starts a new window of waits, after the buffer has filled up or a
+  // producer has been added.
+  void ResetWaits();
+
   int64 buffer_limit_;
   Mode mode_ = Mode::kDisabled;
+  const int64 max_producers_;
+  int64 num_producers_ = 1;
+  // The start of the current window of waits, or -1 if there has been no
+  // wait in it yet.
+  int64 window_start_us_ = -1;
+  // The number and total duration of the waits in the current window.
+  int64 window_waits_ = 0;
+  int64 window_wait_us_ = 0;
 };
 
 }  // namespace data
@@ -103,6 +103,70 @@ TEST(PrefetchAutotuner, StartWithMin) {
   }
 }
 
+TEST(PrefetchAutotuner, StarvedConsumerAddsProducers) {
+  PrefetchAutotuner t(model::kAutotune, 0, /*max_producers=*/4);
+  EXPECT_EQ(1, t.num_producers());
+  // The producers are slower than the consumer, which waits 900us for each
+  // element and then processes it for 100us. The buffer never fills up.
+  int64 now_us = 0;
+  for (int i = 0; i < 100; ++i) {
+    t.RecordEmpty();
+    now_us += 900;
+    t.RecordWait(900, now_us);
+    t.RecordConsumption(1);
+    now_us += 100;
+  }
+  // Producers are added up to the maximum, each with a slot in the buffer.
+  EXPECT_EQ(4, t.num_producers());
+  EXPECT_EQ(4, t.buffer_limit());
+}
+
+TEST(PrefetchAutotuner, SlowConsumerKeepsOneProducer) {
+  PrefetchAutotuner t(model::kAutotune, 0, /*max_producers=*/4);
+  // The consumer is slower than the producer, so it finds the buffer full
+  // except for a short wait every 10 elements.
+  int64 now_us = 0;
+  for (int i = 0; i < 100; ++i) {
+    if (i % 10 == 0) {
+      t.RecordEmpty();
+      now_us += 100;
+      t.RecordWait(100, now_us);
+    }
+    t.RecordConsumption(t.buffer_limit());
+    now_us += 1000;
+  }
+  EXPECT_EQ(1, t.num_producers());
+}
+
+TEST(PrefetchAutotuner, ShortWaitsKeepOneProducer) {
+  PrefetchAutotuner t(model::kAutotune, 0, /*max_producers=*/4);
+  // The buffer never fills up, but the consumer only waits for 5% of the
+  // time, below the starvation threshold.
+  int64 now_us = 0;
+  for (int i = 0; i < 100; ++i) {
+    t.RecordEmpty();
+    now_us += 50;
+    t.RecordWait(50, now_us);
+    t.RecordConsumption(1);
+    now_us += 950;
+  }
+  EXPECT_EQ(1, t.num_producers());
+}
+
+TEST(PrefetchAutotuner, ProducersNotTunedWithoutAutotune) {
+  PrefetchAutotuner t(2, 0, /*max_producers=*/4);
+  int64 now_us = 0;
+  for (int i = 0; i < 100; ++i) {
+    t.RecordEmpty();
+    now_us += 900;
+    t.RecordWait(900, now_us);
+    t.RecordConsumption(1);
+    now_us += 100;
+  }
+  EXPECT_EQ(1, t.num_producers());
+  EXPECT_EQ(2, t.buffer_limit());
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
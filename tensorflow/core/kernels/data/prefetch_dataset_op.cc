@@ -47,6 +47,8 @@ namespace data {
 /* static */ constexpr const char* const PrefetchDatasetOp::kSlackPeriod;
 /* static */ constexpr const char* const PrefetchDatasetOp::kLegacyAutotune;
 /* static */ constexpr const char* const PrefetchDatasetOp::kBufferSizeMin;
+/* static */ constexpr const char* const PrefetchDatasetOp::kMaxProducers;
+/* static */ constexpr const char* const PrefetchDatasetOp::kDeterministic;
 
 namespace {
 
@@ -63,13 +65,16 @@ constexpr char kErrorMessageSuffix[] = ".error_message";
 class PrefetchDatasetOp::Dataset : public DatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
-          int64 slack_period, bool legacy_autotune, int64 buffer_size_min)
+          int64 slack_period, bool legacy_autotune, int64 buffer_size_min,
+          int64 max_producers, DeterminismPolicy deterministic)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         slack_period_(slack_period),
         legacy_autotune_(legacy_autotune),
-        buffer_size_min_(buffer_size_min) {
+        buffer_size_min_(buffer_size_min),
+        max_producers_(max_producers),
+        deterministic_(deterministic) {
     input_->Ref();
   }
 
@@ -118,12 +123,18 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     b->BuildAttrValue(legacy_autotune_, &legacy_autotune_attr);
     AttrValue buffer_size_min_attr;
     b->BuildAttrValue(buffer_size_min_, &buffer_size_min_attr);
+    AttrValue max_producers_attr;
+    b->BuildAttrValue(max_producers_, &max_producers_attr);
+    AttrValue deterministic_attr;
+    b->BuildAttrValue(deterministic_.String(), &deterministic_attr);
 
     TF_RETURN_IF_ERROR(
         b->AddDataset(this, {input_graph_node, buffer_size},
                       {std::make_pair(kSlackPeriod, slack_period_attr),
                        std::make_pair(kLegacyAutotune, legacy_autotune_attr),
-                       std::make_pair(kBufferSizeMin, buffer_size_min_attr)},
+                       std::make_pair(kBufferSizeMin, buffer_size_min_attr),
+                       std::make_pair(kMaxProducers, max_producers_attr),
+                       std::make_pair(kDeterministic, deterministic_attr)},
                       output));
     return Status::OK();
   }
@@ -136,7 +147,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           mu_(std::make_shared<mutex>()),
           cond_var_(std::make_shared<condition_variable>()),
           buffer_size_min_(params.dataset->buffer_size_min_),
-          auto_tuner_(params.dataset->buffer_size_, buffer_size_min_),
+          auto_tuner_(params.dataset->buffer_size_, buffer_size_min_,
+                      params.dataset->effective_max_producers()),
           legacy_autotune_(params.dataset->legacy_autotune_),
           // If `legacy_autotune_`, initialize the `buffer_size_` value to be 0
           // to avoid the created node to be collected as tunable nodes in the
@@ -173,12 +185,14 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       const auto& stats_aggregator = ctx->stats_aggregator();
       {
         mutex_lock l(*mu_);
-        TF_RETURN_IF_ERROR(EnsurePrefetchThreadStarted(ctx));
+        TF_RETURN_IF_ERROR(EnsurePrefetchThreadsStarted(ctx));
         // Wait until the next element in the buffer has been
         // produced, or we are shutting down.
+        int64 wait_start_us = -1;
         if (legacy_autotune_) {
           while (!cancelled_ && buffer_.empty() && !prefetch_thread_finished_ &&
                  auto_tuner_.buffer_limit() != 0) {
+            if (wait_start_us < 0) wait_start_us = EnvTime::NowMicros();
             auto_tuner_.RecordEmpty();
             buffer_size_->value = auto_tuner_.buffer_limit();
             RecordStop(ctx);
@@ -188,11 +202,15 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         } else {
           while (!cancelled_ && buffer_.empty() && !prefetch_thread_finished_ &&
                  buffer_size_->value != 0) {
+            if (wait_start_us < 0) wait_start_us = EnvTime::NowMicros();
             RecordStop(ctx);
             cond_var_->wait(l);
             RecordStart(ctx);
           }
         }
+        if (wait_start_us >= 0) {
+          RecordWait(ctx, wait_start_us);
+        }
 
         if (cancelled_) {
           return errors::Cancelled("Iterator was cancelled");
@@ -303,13 +321,14 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     }
 
     data::TraceMeMetadata GetTraceMeMetadata() const override {
-      int64 limit = -1, size = -1;
+      int64 limit = -1, size = -1, num_producers = -1;
       data::TraceMeMetadata result;
       // NOTE: We only set the parallelism value if the lock can be acquired
       // right away to avoid introducing tracing overhead.
       if (mu_->try_lock()) {
         limit = buffer_limit();
         size = buffer_.size();
+        num_producers = prefetch_threads_.size();
         if (!buffer_.empty()) {
           std::vector<std::string> shapes(buffer_.front().value.size());
           for (const auto& component : buffer_.front().value) {
@@ -334,6 +353,14 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           dataset()->buffer_size_ == model::kAutotune ? "true" : "false"));
       result.push_back(std::make_pair(
           "autotune_mode", legacy_autotune_ ? "legacy" : "performance"));
+      if (dataset()->effective_max_producers() > 1) {
+        result.push_back(std::make_pair(
+            "num_producers",
+            num_producers == -1
+                ? kTraceInfoUnavailable
+                : strings::Printf("%lld",
+                                  static_cast<long long>(num_producers))));
+      }
       if (dataset()->slack_period_ > 0) {
         result.push_back(std::make_pair(
             "slack",
@@ -363,6 +390,33 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       return buffer_size_->value;
     }
 
+    // Returns the number of threads that should be producing elements.
+    int64 num_producers() const TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      if (legacy_autotune_) {
+        return auto_tuner_.num_producers();
+      }
+      return 1;
+    }
+
+    // Records that the consumer waited for the buffer to become non-empty
+    // since `wait_start_us`.
+    void RecordWait(IteratorContext* ctx, int64 wait_start_us)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      const int64 now_us = EnvTime::NowMicros();
+      const int64 wait_us = now_us - wait_start_us;
+      metrics::RecordTFDataPrefetchWait(wait_us);
+      const auto& stats_aggregator = ctx->stats_aggregator();
+      if (stats_aggregator) {
+        stats_aggregator->AddToHistogram(
+            stats_utils::ConsumerWaitTimeHistogramName(dataset()->node_name()),
+            {static_cast<double>(wait_us)}, num_elements());
+      }
+      if (legacy_autotune_) {
+        auto_tuner_.RecordWait(wait_us, now_us);
+        buffer_size_->value = auto_tuner_.buffer_limit();
+      }
+    }
+
     void CancelThreads() TF_LOCKS_EXCLUDED(mu_) {
       cancellation_manager_->StartCancel();
       mutex_lock l(*mu_);
@@ -435,18 +489,33 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       return s;
     }
 
-    Status EnsurePrefetchThreadStarted(IteratorContext* ctx)
+    // Starts prefetch threads until there are `num_producers()` of them,
+    // unless the input has been exhausted.
+    Status EnsurePrefetchThreadsStarted(IteratorContext* ctx)
         TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
-      if (!prefetch_thread_) {
+      while (!end_of_input_ && prefetch_threads_.size() < num_producers()) {
         std::shared_ptr<IteratorContext> new_ctx =
             std::make_shared<IteratorContext>(*ctx);
-        prefetch_thread_ = ctx->StartThread(
-            "tf_data_prefetch", [this, new_ctx]() { PrefetchThread(new_ctx); });
+        ++num_running_threads_;
+        prefetch_threads_.push_back(
+            ctx->StartThread("tf_data_prefetch",
+                             [this, new_ctx]() { PrefetchThread(new_ctx); }));
       }
       return Status::OK();
     }
 
+    // Marks the calling prefetch thread as finished. The prefetch threads are
+    // all finished once the last one returns.
+    void FinishPrefetchThread() TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      if (--num_running_threads_ == 0) {
+        prefetch_thread_finished_ = true;
+      }
+      cond_var_->notify_all();
+    }
+
     // Prefetches elements of the input, storing results in an internal buffer.
+    // With several prefetch threads, elements read from the input concurrently
+    // may be buffered in a different order than the input produced them.
     //
     // It owns the iterator context passed to it.
     void PrefetchThread(const std::shared_ptr<IteratorContext>& ctx) {
@@ -455,20 +524,22 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       // Keep track of where we are in an iteration "burst"
       int num_produced = 0;
       while (true) {
-        // 1. Wait for a slot in the buffer.
+        // 1. Wait for a slot in the buffer. The elements being read by other
+        // prefetch threads hold slots too.
         {
           mutex_lock l(*mu_);
-          while (!cancelled_ && buffer_.size() >= buffer_limit()) {
+          while (!cancelled_ && !end_of_input_ &&
+                 buffer_.size() + num_in_flight_ >= buffer_limit()) {
             RecordStop(ctx.get());
             cond_var_->wait(l);
             RecordStart(ctx.get());
           }
 
-          if (cancelled_) {
-            prefetch_thread_finished_ = true;
-            cond_var_->notify_all();
+          if (cancelled_ || end_of_input_) {
+            FinishPrefetchThread();
             return;
           }
+          ++num_in_flight_;
         }
 
         if (dataset()->slack_period_ > 0 &&
@@ -483,8 +554,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         // Acquire the input mutex since we will be reading an element from the
         // input iterator. Note that we do not wish to release this mutex till
         // we have added the fetched element to the `buffer_` else there will be
-        // local state that may be missed by SaveInternal.
-        mutex_lock input_l(input_mu_);
+        // local state that may be missed by SaveInternal. The mutex is shared
+        // by the prefetch threads, which read from the input concurrently.
+        tf_shared_lock input_l(input_mu_);
         bool end_of_sequence;
         BufferElement buffer_element;
         {
@@ -499,14 +571,16 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         }
         if (buffer_element.status.ok() && end_of_sequence) {
           mutex_lock l(*mu_);
-          prefetch_thread_finished_ = true;
-          cond_var_->notify_all();
+          --num_in_flight_;
+          end_of_input_ = true;
+          FinishPrefetchThread();
           return;
         }
 
         // 3. Signal that the element has been produced.
         {
           mutex_lock l(*mu_);
+          --num_in_flight_;
           RecordBufferEnqueue(ctx.get(), buffer_element.value);
           buffer_element.created_us = EnvTime::NowMicros();
           buffer_.push_back(std::move(buffer_element));
@@ -571,9 +645,16 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     const int64 buffer_size_min_;
     PrefetchAutotuner auto_tuner_ TF_GUARDED_BY(*mu_);
     std::deque<BufferElement> buffer_ TF_GUARDED_BY(*mu_);
-    std::unique_ptr<Thread> prefetch_thread_ TF_GUARDED_BY(*mu_);
+    std::vector<std::unique_ptr<Thread>> prefetch_threads_ TF_GUARDED_BY(*mu_);
     bool cancelled_ TF_GUARDED_BY(*mu_) = false;
+    // Set once all the prefetch threads have returned.
     bool prefetch_thread_finished_ TF_GUARDED_BY(*mu_) = false;
+    // Set once a prefetch thread has reached the end of the input.
+    bool end_of_input_ TF_GUARDED_BY(*mu_) = false;
+    // The number of prefetch threads that have not returned.
+    int64 num_running_threads_ TF_GUARDED_BY(*mu_) = 0;
+    // The number of elements being read from the input.
+    int64 num_in_flight_ TF_GUARDED_BY(*mu_) = 0;
     const bool legacy_autotune_;
 
     std::atomic<int64> slack_us_;
@@ -598,6 +679,20 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
   // parameter.
   const int64 buffer_size_min_ = 0;
 
+  // Returns the maximum number of threads among which the autotuner may
+  // divide the reading of the input. Elements read concurrently may be
+  // reordered, so this is 1 unless the dataset may be nondeterministic.
+  int64 effective_max_producers() const {
+    return deterministic_.IsNondeterministic() ? max_producers_ : 1;
+  }
+
+  // If legacy autotune is enabled and determinism is relaxed, determines the
+  // maximum number of threads among which the autotuner may divide the
+  // reading of the input.
+  const int64 max_producers_ = 1;
+
+  const DeterminismPolicy deterministic_;
+
   TraceMeMetadata traceme_metadata_;
 };
 
@@ -612,6 +707,19 @@ PrefetchDatasetOp::PrefetchDatasetOp(OpKernelConstruction* ctx)
   if (ctx->HasAttr(kBufferSizeMin)) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr(kBufferSizeMin, &buffer_size_min_));
   }
+  if (ctx->HasAttr(kMaxProducers)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kMaxProducers, &max_producers_));
+    OP_REQUIRES(ctx, max_producers_ >= 1,
+                errors::InvalidArgument(kMaxProducers,
+                                        " must be >= 1, but got ",
+                                        max_producers_));
+  }
+  if (ctx->HasAttr(kDeterministic)) {
+    std::string deterministic;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kDeterministic, &deterministic));
+    OP_REQUIRES_OK(
+        ctx, DeterminismPolicy::FromString(deterministic, &deterministic_));
+  }
 }
 
 void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
@@ -629,7 +737,8 @@ void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   }
 
   *output = new Dataset(ctx, input, buffer_size, slack_period_,
-                        legacy_autotune_, buffer_size_min_);
+                        legacy_autotune_, buffer_size_min_, max_producers_,
+                        deterministic_);
 }
 
 namespace {
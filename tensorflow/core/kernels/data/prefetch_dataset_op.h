@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_PREFETCH_DATASET_OP_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_PREFETCH_DATASET_OP_H_
 
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/kernels/data/prefetch_autotuner.h"
 
@@ -32,6 +33,8 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kSlackPeriod = "slack_period";
   static constexpr const char* const kLegacyAutotune = "legacy_autotune";
   static constexpr const char* const kBufferSizeMin = "buffer_size_min";
+  static constexpr const char* const kMaxProducers = "max_producers";
+  static constexpr const char* const kDeterministic = "deterministic";
 
   explicit PrefetchDatasetOp(OpKernelConstruction* ctx);
 
@@ -44,6 +47,8 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
   int64 slack_period_ = 0;
   bool legacy_autotune_ = true;
   int64 buffer_size_min_ = 0;
+  int64 max_producers_ = 1;
+  DeterminismPolicy deterministic_;
 };
 
 }  // namespace data
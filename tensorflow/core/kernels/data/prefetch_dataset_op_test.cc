@@ -12,6 +12,8 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/data/prefetch_dataset_op.h"
 
+#include <numeric>
+
 #include "tensorflow/core/data/dataset_test_base.h"
 
 namespace tensorflow {
@@ -29,13 +31,17 @@ class PrefetchDatasetParams : public DatasetParams {
                         DataTypeVector output_dtypes,
                         std::vector<PartialTensorShape> output_shapes,
                         int64 slack_period, bool legacy_autotune,
-                        int64 buffer_size_min, string node_name)
+                        int64 buffer_size_min, string node_name,
+                        int64 max_producers = 1,
+                        string deterministic = DeterminismPolicy::kDefault)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
         buffer_size_(buffer_size),
         slack_period_(slack_period),
         legacy_autotune_(legacy_autotune),
-        buffer_size_min_(buffer_size_min) {
+        buffer_size_min_(buffer_size_min),
+        max_producers_(max_producers),
+        deterministic_(std::move(deterministic)) {
     input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -62,6 +68,10 @@ class PrefetchDatasetParams : public DatasetParams {
                               legacy_autotune_);
     attr_vector->emplace_back(PrefetchDatasetOp::kBufferSizeMin,
                               buffer_size_min_);
+    attr_vector->emplace_back(PrefetchDatasetOp::kMaxProducers,
+                              max_producers_);
+    attr_vector->emplace_back(PrefetchDatasetOp::kDeterministic,
+                              deterministic_);
     return Status::OK();
   }
 
@@ -74,6 +84,8 @@ class PrefetchDatasetParams : public DatasetParams {
   int64 slack_period_;
   bool legacy_autotune_;
   int64 buffer_size_min_;
+  int64 max_producers_;
+  string deterministic_;
 };
 
 // Test case 1: positive buffer size.
@@ -332,6 +344,72 @@ TEST_F(PrefetchDatasetOpTest, InvalidBufferSize) {
   EXPECT_EQ(Initialize(dataset_params).code(), error::INVALID_ARGUMENT);
 }
 
+PrefetchDatasetParams AutotunedPrefetchDatasetParams(
+    int64 num_elements, int64 max_producers, const string& deterministic) {
+  std::vector<int64> values(num_elements);
+  std::iota(values.begin(), values.end(), 0);
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64>(TensorShape{num_elements, 1},
+                                          values)},
+      /*node_name=*/"tensor_slice");
+  return PrefetchDatasetParams(
+      /*input_dataset_params=*/tensor_slice_dataset_params,
+      /*buffer_size=*/model::kAutotune,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({1})},
+      /*slack_period=*/0,
+      /*legacy_autotune=*/true,
+      /*buffer_size_min=*/0,
+      /*node_name=*/kNodeName,
+      /*max_producers=*/max_producers,
+      /*deterministic=*/deterministic);
+}
+
+std::vector<Tensor> RangeOutputs(int64 num_elements) {
+  std::vector<Tensor> outputs;
+  for (int64 i = 0; i < num_elements; ++i) {
+    outputs.push_back(CreateTensor<int64>(TensorShape{1}, {i}));
+  }
+  return outputs;
+}
+
+TEST_F(PrefetchDatasetOpTest, MultipleProducers) {
+  // The elements read concurrently by several producers may be reordered, so
+  // only the set of elements is checked.
+  constexpr int64 kNumElements = 1000;
+  TF_ASSERT_OK(Initialize(AutotunedPrefetchDatasetParams(
+      kNumElements, /*max_producers=*/4,
+      /*deterministic=*/DeterminismPolicy::kNondeterministic)));
+  TF_ASSERT_OK(CheckIteratorGetNext(RangeOutputs(kNumElements),
+                                    /*compare_order=*/false));
+}
+
+// Unless determinism is relaxed, `max_producers` is ignored and the order of
+// the input is preserved.
+TEST_F(PrefetchDatasetOpTest, DefaultDeterminismUsesOneProducer) {
+  constexpr int64 kNumElements = 1000;
+  TF_ASSERT_OK(Initialize(AutotunedPrefetchDatasetParams(
+      kNumElements, /*max_producers=*/4, DeterminismPolicy::kDefault)));
+  TF_ASSERT_OK(CheckIteratorGetNext(RangeOutputs(kNumElements),
+                                    /*compare_order=*/true));
+}
+
+TEST_F(PrefetchDatasetOpTest, DeterministicUsesOneProducer) {
+  constexpr int64 kNumElements = 1000;
+  TF_ASSERT_OK(Initialize(AutotunedPrefetchDatasetParams(
+      kNumElements, /*max_producers=*/4, DeterminismPolicy::kDeterministic)));
+  TF_ASSERT_OK(CheckIteratorGetNext(RangeOutputs(kNumElements),
+                                    /*compare_order=*/true));
+}
+
+TEST_F(PrefetchDatasetOpTest, InvalidMaxProducers) {
+  EXPECT_EQ(Initialize(AutotunedPrefetchDatasetParams(
+                           10, /*max_producers=*/0,
+                           DeterminismPolicy::kNondeterministic))
+                .code(),
+            error::INVALID_ARGUMENT);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
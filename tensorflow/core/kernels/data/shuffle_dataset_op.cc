@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
 #include <deque>
+#include <functional>
 #include <tuple>
 #include <vector>
 
@@ -24,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/random/philox_random.h"
@@ -31,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random_distributions.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/stringprintf.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -46,6 +49,8 @@ namespace data {
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kOutputShapes;
 /* static */ constexpr const char* const
     ShuffleDatasetOpBase::kReshuffleEachIteration;
+/* static */ constexpr const char* const
+    ShuffleDatasetOpBase::kMemoryBudgetBytes;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
 
@@ -74,21 +79,239 @@ constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
 constexpr char kShuffleAndRepeatDatasetV1[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
+constexpr char kExternalShuffle[] = "external_shuffle";
+constexpr char kNumRuns[] = "num_runs";
+constexpr char kRun[] = "run";
+constexpr char kNumComponents[] = "num_components";
+constexpr char kComponent[] = "component";
+
+namespace {
+
+int64 ElementBytes(const std::vector<Tensor>& element) {
+  int64 bytes = 0;
+  for (const Tensor& t : element) {
+    bytes += t.TotalBytes();
+  }
+  return bytes;
+}
+
+// Shuffles the input in groups of up to `buffer_size` consecutive elements, for
+// shuffle buffers that do not fit in memory.
+//
+// A group is read into runs whose elements fit in the memory budget. Each run
+// is shuffled in memory and written to a spill file. The group is then
+// produced by repeatedly choosing a run with probability proportional to its
+// number of remaining elements, and reading the next element of that run. This
+// yields a uniformly random permutation of the group, while only one run is
+// held in memory at a time.
+class ExternalShuffleBuffer {
+ public:
+  using RandomFn = std::function<uint32()>;
+
+  ExternalShuffleBuffer(Env* env, int64 memory_budget_bytes,
+                        string spill_directory)
+      : env_(env),
+        memory_budget_bytes_(memory_budget_bytes),
+        spill_directory_(std::move(spill_directory)) {}
+
+  // Returns the number of elements that have been added and not produced.
+  int64 num_elements() const { return num_elements_; }
+
+  // Returns true if elements have been added to a group that has not been
+  // finished yet.
+  bool filling() const { return filling_; }
+
+  // Adds `element` to the group being filled, and spills the current run if it
+  // has reached the memory budget.
+  // REQUIRES: `FinishGroup()` has not been called since the previous group
+  // was fully produced.
+  Status Add(std::vector<Tensor> element, const RandomFn& random) {
+    filling_ = true;
+    run_bytes_ += ElementBytes(element);
+    run_.push_back(std::move(element));
+    ++num_elements_;
+    if (memory_budget_bytes_ > 0 && run_bytes_ >= memory_budget_bytes_) {
+      TF_RETURN_IF_ERROR(SpillRun(random));
+    }
+    return Status::OK();
+  }
+
+  // Spills the last run of the group being filled, after which the group can
+  // be produced by `GetNext()`.
+  Status FinishGroup(const RandomFn& random) {
+    if (!run_.empty()) TF_RETURN_IF_ERROR(SpillRun(random));
+    filling_ = false;
+    return Status::OK();
+  }
+
+  // Produces a random element of the current group.
+  // REQUIRES: `num_elements() > 0` and `FinishGroup()` has been called.
+  Status GetNext(const RandomFn& random, std::vector<Tensor>* element) {
+    DCHECK(!filling_);
+    int64 index = random() % num_elements_;
+    auto run = runs_.begin();
+    while (index >= run->num_remaining) {
+      index -= run->num_remaining;
+      ++run;
+    }
+    TF_RETURN_IF_ERROR(run->reader->Read(element));
+    --run->num_remaining;
+    if (--num_elements_ == 0) {
+      // Delete the spill files of the group.
+      runs_.clear();
+    }
+    return Status::OK();
+  }
+
+  // Writes the elements that have not been produced yet to the checkpoint,
+  // one at a time. Fails if a group is being filled.
+  Status Save(IteratorStateWriter* writer, const string& key_prefix) const {
+    if (filling_) {
+      return errors::FailedPrecondition(
+          "Cannot save a shuffle buffer while a group is being filled.");
+    }
+    TF_RETURN_IF_ERROR(writer->WriteScalar(key_prefix, kNumRuns, runs_.size()));
+    for (int i = 0; i < runs_.size(); ++i) {
+      const Run& run = runs_[i];
+      const string run_prefix = strings::StrCat(key_prefix, "::", kRun, "_", i);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(run_prefix, kNumElements, run.num_remaining));
+      std::unique_ptr<SpilledElements::Reader> reader;
+      TF_RETURN_IF_ERROR(run.elements->NewReader(&reader));
+      TF_RETURN_IF_ERROR(
+          reader->Skip(run.elements->num_elements() - run.num_remaining));
+      std::vector<Tensor> element;
+      for (int64 j = 0; j < run.num_remaining; ++j) {
+        TF_RETURN_IF_ERROR(reader->Read(&element));
+        const string element_prefix = strings::StrCat(run_prefix, "::", j);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(element_prefix, kNumComponents,
+                                               element.size()));
+        for (int k = 0; k < element.size(); ++k) {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              element_prefix, strings::StrCat(kComponent, "[", k, "]"),
+              element[k]));
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  // Restores the elements written by `Save()` into new spill files.
+  Status Restore(IteratorStateReader* reader, const string& key_prefix) {
+    run_.clear();
+    run_bytes_ = 0;
+    runs_.clear();
+    num_elements_ = 0;
+    filling_ = false;
+    int64 num_runs;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(key_prefix, kNumRuns, &num_runs));
+    std::vector<Tensor> element;
+    for (int64 i = 0; i < num_runs; ++i) {
+      const string run_prefix = strings::StrCat(key_prefix, "::", kRun, "_", i);
+      int64 num_remaining;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(run_prefix, kNumElements, &num_remaining));
+      if (num_remaining == 0) continue;
+      Run run;
+      TF_RETURN_IF_ERROR(
+          SpilledElements::Create(env_, spill_directory_, &run.elements));
+      for (int64 j = 0; j < num_remaining; ++j) {
+        const string element_prefix = strings::StrCat(run_prefix, "::", j);
+        int64 num_components;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(element_prefix, kNumComponents,
+                                              &num_components));
+        element.resize(num_components);
+        for (int k = 0; k < num_components; ++k) {
+          TF_RETURN_IF_ERROR(reader->ReadTensor(
+              element_prefix, strings::StrCat(kComponent, "[", k, "]"),
+              &element[k]));
+        }
+        TF_RETURN_IF_ERROR(run.elements->Append(element));
+      }
+      TF_RETURN_IF_ERROR(run.elements->Finish());
+      TF_RETURN_IF_ERROR(run.elements->NewReader(&run.reader));
+      run.num_remaining = num_remaining;
+      num_elements_ += num_remaining;
+      runs_.push_back(std::move(run));
+    }
+    return Status::OK();
+  }
+
+ private:
+  struct Run {
+    std::unique_ptr<SpilledElements> elements;
+    std::unique_ptr<SpilledElements::Reader> reader;
+    int64 num_remaining = 0;
+  };
+
+  // Shuffles `run_` and moves it to a new spill file.
+  Status SpillRun(const RandomFn& random) {
+    for (int64 i = run_.size() - 1; i > 0; --i) {
+      std::swap(run_[i], run_[random() % (i + 1)]);
+    }
+    Run run;
+    TF_RETURN_IF_ERROR(
+        SpilledElements::Create(env_, spill_directory_, &run.elements));
+    for (const std::vector<Tensor>& element : run_) {
+      TF_RETURN_IF_ERROR(run.elements->Append(element));
+    }
+    TF_RETURN_IF_ERROR(run.elements->Finish());
+    TF_RETURN_IF_ERROR(run.elements->NewReader(&run.reader));
+    run.num_remaining = run_.size();
+    VLOG(2) << "Spilled a shuffle run of " << run_.size() << " elements ("
+            << run_bytes_ << " bytes)";
+    runs_.push_back(std::move(run));
+    run_.clear();
+    run_bytes_ = 0;
+    return Status::OK();
+  }
+
+  Env* const env_;
+  const int64 memory_budget_bytes_;
+  const string spill_directory_;
+  // The run being filled.
+  std::vector<std::vector<Tensor>> run_;
+  int64 run_bytes_ = 0;
+  // The spilled runs of the current group.
+  std::vector<Run> runs_;
+  int64 num_elements_ = 0;
+  bool filling_ = false;
+};
+
+string ShuffleSpillDirectoryFromEnv() {
+  string spill_directory;
+  Status s = ReadStringFromEnvVar("TF_DATA_SHUFFLE_SPILL_DIR", "",
+                                  &spill_directory);
+  if (!s.ok()) {
+    LOG(ERROR) << "ShuffleDataset: " << s.error_message();
+  }
+  return spill_directory;
+}
+
+}  // namespace
 
 ShuffleDatasetOpBase::ShuffleDatasetOpBase(OpKernelConstruction* ctx)
-    : UnaryDatasetOpKernel(ctx) {}
+    : UnaryDatasetOpKernel(ctx) {
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+  }
+}
 
 // Abstract base dataset that implements a shuffling iterator.
 class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
  public:
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
                      int64 buffer_size,
-                     std::shared_ptr<SeedGenerator> seed_generator, int64 count)
+                     std::shared_ptr<SeedGenerator> seed_generator, int64 count,
+                     int64 memory_budget_bytes)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        memory_budget_bytes_(memory_budget_bytes),
+        spill_directory_(ShuffleSpillDirectoryFromEnv()),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -148,8 +371,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           seed_generator_(seed_generator),
           parent_generator_(seed_generator->seed(), seed_generator->seed2()),
           generator_(&parent_generator_) {
-      buffer_ = absl::make_unique<std::vector<std::vector<Tensor>>>(
-          params.dataset->buffer_size_);
+      // With a memory budget, the buffer is allocated once the first element
+      // shows whether it fits in the budget.
+      if (params.dataset->memory_budget_bytes_ <= 0) {
+        buffer_ = absl::make_unique<std::vector<std::vector<Tensor>>>(
+            params.dataset->buffer_size_);
+      }
       slices_.push_back(absl::make_unique<Slice>(0, 0));
     }
 
@@ -170,6 +397,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
             ctx, this, this->prefix(), &input_impl_));
       }
+      if (external_) {
+        return GetNextExternalLocked(ctx, out_tensors, end_of_sequence);
+      }
       while (input_impl_ && num_elements_ < this->dataset()->buffer_size_) {
         if (EnvTime::NowMicros() >
             ((num_log_entries + 1) * kLogIntervalMicros) + start_micros) {
@@ -209,6 +439,14 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             VLOG(1) << "Starting to fill up shuffle buffer of size: "
                     << this->dataset()->buffer_size_;
           }
+          if (!buffer_) {
+            ChooseBufferLocked(ctx, input_element);
+            if (external_) {
+              TF_RETURN_IF_ERROR(external_->Add(std::move(input_element),
+                                                RandomFnLocked()));
+              return GetNextExternalLocked(ctx, out_tensors, end_of_sequence);
+            }
+          }
           this->RecordBufferEnqueue(ctx, input_element);
           buffer_->at(slices_.back()->end % this->dataset()->buffer_size_) =
               std::move(input_element);
@@ -302,7 +540,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kEpoch), epoch_));
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(this->full_name(kNumElements), num_elements_));
-      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(writer, prefix(), *buffer_));
+      if (external_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kExternalShuffle), ""));
+        TF_RETURN_IF_ERROR(
+            external_->Save(writer, this->full_name(kExternalShuffle)));
+      }
+      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+          writer, prefix(),
+          buffer_ ? *buffer_ : std::vector<std::vector<Tensor>>()));
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(this->full_name(kSlicesSize), slices_.size()));
       for (size_t i = 0; i < slices_.size(); ++i) {
@@ -357,10 +603,24 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             reader->ReadScalar(this->full_name(kSlicesSize), &temp));
         slices_size = static_cast<size_t>(temp);
       }
-      buffer_ = absl::make_unique<std::vector<std::vector<Tensor>>>(
-          this->dataset()->buffer_size_);
+      external_.reset();
+      if (reader->Contains(this->full_name(kExternalShuffle))) {
+        external_ = NewExternalShuffleBuffer(ctx);
+        TF_RETURN_IF_ERROR(
+            external_->Restore(reader, this->full_name(kExternalShuffle)));
+      }
+      std::vector<std::vector<Tensor>> elements;
       TF_RETURN_IF_ERROR(
-          ReadElementsFromCheckpoint(reader, prefix(), buffer_.get()));
+          ReadElementsFromCheckpoint(reader, prefix(), &elements));
+      buffer_.reset();
+      if (!external_ && (!elements.empty() ||
+                         this->dataset()->memory_budget_bytes_ <= 0)) {
+        buffer_ = absl::make_unique<std::vector<std::vector<Tensor>>>(
+            this->dataset()->buffer_size_);
+        for (int64 i = 0; i < elements.size() && i < buffer_->size(); ++i) {
+          (*buffer_)[i] = std::move(elements[i]);
+        }
+      }
       slices_.clear();
       for (size_t i = 0; i < slices_size; ++i) {
         int64 start;
@@ -403,10 +663,115 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return out;
     }
 
+    ExternalShuffleBuffer::RandomFn RandomFnLocked()
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) { return Random(); };
+    }
+
+    std::unique_ptr<ExternalShuffleBuffer> NewExternalShuffleBuffer(
+        IteratorContext* ctx) {
+      return absl::make_unique<ExternalShuffleBuffer>(
+          ctx->env(), this->dataset()->memory_budget_bytes_,
+          this->dataset()->spill_directory_);
+    }
+
+    // Estimates the size of the shuffle buffer from the size of its first
+    // element, and either allocates `buffer_` if it fits in the memory budget
+    // or shuffles through spill files from now on.
+    void ChooseBufferLocked(IteratorContext* ctx,
+                            const std::vector<Tensor>& element)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64 buffer_size = this->dataset()->buffer_size_;
+      const int64 budget = this->dataset()->memory_budget_bytes_;
+      const int64 element_bytes = ElementBytes(element);
+      if (element_bytes <= budget / buffer_size) {
+        buffer_ =
+            absl::make_unique<std::vector<std::vector<Tensor>>>(buffer_size);
+        return;
+      }
+      LOG(INFO) << "A shuffle buffer of " << buffer_size
+                << " elements of about " << element_bytes
+                << " bytes exceeds the memory budget of "
+                << budget << " bytes; shuffling groups of " << buffer_size
+                << " elements through spill files instead.";
+      external_ = NewExternalShuffleBuffer(ctx);
+    }
+
+    // Produces the next element in the external shuffle mode, reading the
+    // next group of up to `buffer_size` elements of the same epoch first if
+    // the current group has been produced.
+    Status GetNextExternalLocked(IteratorContext* ctx,
+                                 std::vector<Tensor>* out_tensors,
+                                 bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const auto random = RandomFnLocked();
+      if (external_->num_elements() == 0 || external_->filling()) {
+        Status s = FillExternalGroupLocked(ctx, end_of_sequence);
+        if (!s.ok()) {
+          // Finish the partial group, so that its elements are produced (and
+          // saved) like those of a group cut short by the end of an epoch.
+          external_->FinishGroup(random).IgnoreError();
+          return s;
+        }
+        if (*end_of_sequence) return Status::OK();
+        TF_RETURN_IF_ERROR(external_->FinishGroup(random));
+      }
+      if (external_->num_elements() == 0) {
+        DCHECK(input_impl_ == nullptr);
+        *end_of_sequence = true;
+        return Status::OK();
+      }
+      *end_of_sequence = false;
+      return external_->GetNext(random, out_tensors);
+    }
+
+    // Adds input elements to the group being filled until it holds
+    // `buffer_size` elements or the epoch ends. Sets `*end_of_sequence` if the
+    // input is empty.
+    Status FillExternalGroupLocked(IteratorContext* ctx, bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const auto random = RandomFnLocked();
+      const int64 buffer_size = this->dataset()->buffer_size_;
+      *end_of_sequence = false;
+      while (input_impl_ && external_->num_elements() < buffer_size) {
+        std::vector<Tensor> input_element;
+        bool end_of_input_sequence = false;
+        TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &input_element,
+                                                &end_of_input_sequence));
+        if (!end_of_input_sequence) {
+          data_produced_ = true;
+          TF_RETURN_IF_ERROR(external_->Add(std::move(input_element), random));
+          continue;
+        }
+        if (ctx->split_provider() == nullptr && !data_produced_ &&
+            this->dataset()->count_ == -1) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        epoch_++;
+        if (this->dataset()->count_ != -1 &&
+            epoch_ >= this->dataset()->count_) {
+          input_impl_.reset();
+          break;
+        }
+        if (ctx->split_provider()) {
+          TF_RETURN_IF_ERROR(ctx->split_provider()->Reset());
+        }
+        TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+            ctx, this, this->prefix(), &input_impl_));
+        // Groups do not span epochs.
+        if (external_->num_elements() > 0) break;
+      }
+      return Status::OK();
+    }
+
     mutex mu_;
     SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
     std::unique_ptr<std::vector<std::vector<Tensor>>> buffer_
         TF_GUARDED_BY(mu_);
+    // Used instead of `buffer_` if the shuffle buffer does not fit in the
+    // memory budget.
+    std::unique_ptr<ExternalShuffleBuffer> external_ TF_GUARDED_BY(mu_);
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_) = nullptr;
     int64 epoch_ TF_GUARDED_BY(mu_) = 0;
     int64 num_elements_ TF_GUARDED_BY(mu_) = 0;
@@ -431,6 +796,11 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64 count_;
+  // If positive, a shuffle buffer whose elements are estimated to exceed this
+  // many bytes is shuffled through spill files in `spill_directory_` (see
+  // `ExternalShuffleBuffer`).
+  const int64 memory_budget_bytes_;
+  const string spill_directory_;
   const TraceMeMetadata traceme_metadata_;
 };  // ShuffleDatasetBase
 
@@ -441,9 +811,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 class ShuffleDatasetOp::Dataset : public ShuffleDatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
-          int64 count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-          ResourceHandle&& resource_handle)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+          int64 count, int64 memory_budget_bytes, RandomSeeds&& seeds,
+          SeedGeneratorManager* manager, ResourceHandle&& resource_handle)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes),
         manager_(manager),
         resource_handle_(std::move(resource_handle)),
         resource_mgr_(ctx->resource_manager()),
@@ -476,11 +847,13 @@ class ShuffleDatasetOp::Dataset : public ShuffleDatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(seeds_.input_seed2(), &seed2_node));
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
     TF_RETURN_IF_ERROR(b->AddDataset(
         this,
         {input_graph_node, buffer_size_node, seed_node, seed2_node},  // Inputs
-        {std::make_pair(kReshuffleEachIteration,
-                        reshuffle_each_iteration)},  // Attrs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kMemoryBudgetBytes, memory_budget_bytes)},  // Attrs
         output));
     return Status::OK();
   }
@@ -501,7 +874,8 @@ class ShuffleDatasetOp::DatasetV2 : public ShuffleDatasetBase {
   DatasetV2(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
             int64 count, SeedGeneratorManager* manager,
             ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           /*memory_budget_bytes=*/0),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -553,9 +927,11 @@ class ShuffleDatasetOp::DatasetV2 : public ShuffleDatasetBase {
 class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
  public:
   DatasetV3(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
-            int64 count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            int64 count, int64 memory_budget_bytes, RandomSeeds&& seeds,
+            SeedGeneratorManager* manager, ResourceHandle&& resource_handle,
+            bool owns_resource)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -594,13 +970,15 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this,
-                      {input_graph_node, buffer_size_node, seed_node,
-                       seed2_node, resource_handle_node},  // Inputs
-                      {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
-                      output));
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, buffer_size_node, seed_node, seed2_node,
+         resource_handle_node},  // Inputs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kMemoryBudgetBytes, memory_budget_bytes)},  // Attrs
+        output));
     return Status::OK();
   }
 
@@ -676,9 +1054,9 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     }
 
     // Ownership of manager is transferred onto `DatasetV3`.
-    *output = new ShuffleDatasetOp::DatasetV3(ctx, input, buffer_size, count,
-                                              std::move(seeds), manager,
-                                              std::move(handle), owns_resource);
+    *output = new ShuffleDatasetOp::DatasetV3(
+        ctx, input, buffer_size, count, memory_budget_bytes_, std::move(seeds),
+        manager, std::move(handle), owns_resource);
   } else if (op_version_ == 2) {
     auto handle = HandleFromInput(ctx, 2);
     SeedGeneratorManager* manager = nullptr;
@@ -739,6 +1117,7 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
 
     // Ownership of manager is transferred onto `Dataset`.
     *output = new ShuffleDatasetOp::Dataset(ctx, input, buffer_size, count,
+                                            memory_budget_bytes_,
                                             std::move(seeds), manager,
                                             std::move(handle));
   }
@@ -748,8 +1127,9 @@ class ShuffleAndRepeatDatasetOp::Dataset : public ShuffleDatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
           RandomSeeds&& seeds, SeedGeneratorManager* manager, int64 count,
-          ResourceHandle&& resource_handle)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+          int64 memory_budget_bytes, ResourceHandle&& resource_handle)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes),
         manager_(manager),
         resource_handle_(std::move(resource_handle)),
         resource_mgr_(ctx->resource_manager()),
@@ -784,10 +1164,12 @@ class ShuffleAndRepeatDatasetOp::Dataset : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
     TF_RETURN_IF_ERROR(b->AddDataset(
         this, {input_graph_node, buffer_size, seed, seed2, count},  // Inputs
-        {std::make_pair(kReshuffleEachIteration,
-                        reshuffle_each_iteration)},  // Attrs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kMemoryBudgetBytes, memory_budget_bytes)},  // Attrs
         output));
     return Status::OK();
   }
@@ -802,9 +1184,11 @@ class ShuffleAndRepeatDatasetOp::Dataset : public ShuffleDatasetBase {
 class ShuffleAndRepeatDatasetOp::DatasetV2 : public ShuffleDatasetBase {
  public:
   DatasetV2(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
-            int64 count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            int64 count, int64 memory_budget_bytes, RandomSeeds&& seeds,
+            SeedGeneratorManager* manager, ResourceHandle&& resource_handle,
+            bool owns_resource)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -845,13 +1229,15 @@ class ShuffleAndRepeatDatasetOp::DatasetV2 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this,
-                      {input_graph_node, buffer_size_node, seed_node,
-                       seed2_node, count_node, resource_handle_node},  // Inputs
-                      {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
-                      output));
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, buffer_size_node, seed_node, seed2_node, count_node,
+         resource_handle_node},  // Inputs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kMemoryBudgetBytes, memory_budget_bytes)},  // Attrs
+        output));
     return Status::OK();
   }
 
@@ -936,8 +1322,8 @@ void ShuffleAndRepeatDatasetOp::MakeDataset(OpKernelContext* ctx,
 
     // Ownership of manager is transferred onto `DatasetV2`.
     *output = new ShuffleAndRepeatDatasetOp::DatasetV2(
-        ctx, input, buffer_size, count, std::move(seeds), manager,
-        std::move(handle), owns_resource);
+        ctx, input, buffer_size, count, memory_budget_bytes_, std::move(seeds),
+        manager, std::move(handle), owns_resource);
   } else {
     if (op_version_ != 1) {
       LOG(WARNING) << "Unsupported version of shuffle dataset op: "
@@ -964,7 +1350,7 @@ void ShuffleAndRepeatDatasetOp::MakeDataset(OpKernelContext* ctx,
 
     // Ownership of manager is transferred onto `Dataset`.
     *output = new Dataset(ctx, input, buffer_size, std::move(seeds), manager,
-                          count, std::move(handle));
+                          count, memory_budget_bytes_, std::move(handle));
   }
 }
 
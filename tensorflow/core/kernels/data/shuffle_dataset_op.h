@@ -30,11 +30,15 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
   static constexpr const char* const kOutputShapes = "output_shapes";
   static constexpr const char* const kReshuffleEachIteration =
       "reshuffle_each_iteration";
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
 
   explicit ShuffleDatasetOpBase(OpKernelConstruction* ctx);
 
  protected:
   class ShuffleDatasetBase;
+
+  int64 memory_budget_bytes_ = 0;
 };
 
 class ShuffleDatasetOp : public ShuffleDatasetOpBase {
@@ -11,8 +11,14 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
 namespace data {
@@ -28,14 +34,15 @@ class ShuffleDatasetParams : public DatasetParams {
                        int64 seed2, int64 count, bool reshuffle_each_iteration,
                        DataTypeVector output_dtypes,
                        std::vector<PartialTensorShape> output_shapes,
-                       string node_name)
+                       string node_name, int64 memory_budget_bytes = 0)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
         buffer_size_(buffer_size),
         seed_(seed),
         seed2_(seed2),
         count_(count),
-        reshuffle_each_iteration_(reshuffle_each_iteration) {
+        reshuffle_each_iteration_(reshuffle_each_iteration),
+        memory_budget_bytes_(memory_budget_bytes) {
     input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -74,9 +81,15 @@ class ShuffleDatasetParams : public DatasetParams {
                               output_shapes_);
     attr_vector->emplace_back(ShuffleDatasetOp::kReshuffleEachIteration,
                               reshuffle_each_iteration_);
+    attr_vector->emplace_back(ShuffleDatasetOp::kMemoryBudgetBytes,
+                              memory_budget_bytes_);
     return Status::OK();
   }
 
+  std::vector<FunctionDef> func_lib() const override {
+    return input_dataset_params_[0]->func_lib();
+  }
+
   string dataset_type() const override {
     if (count_ != 1) {
       return ShuffleAndRepeatDatasetOp::kDatasetType;
@@ -92,6 +105,7 @@ class ShuffleDatasetParams : public DatasetParams {
   int64 seed2_;
   int64 count_;
   bool reshuffle_each_iteration_;
+  int64 memory_budget_bytes_;
 };
 
 class ShuffleDatasetOpTest : public DatasetOpsTestBase {};
@@ -549,6 +563,101 @@ INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+TEST_F(ShuffleDatasetOpTest, ShufflesThroughSpillFilesBeyondMemoryBudget) {
+  // 40 elements of 128KB each, with a buffer size of 16 and a memory budget
+  // of 1MB, so that each group of 16 elements is spilled in runs of 8.
+  constexpr int kNumElements = 40;
+  constexpr int kElementSize = 16 * 1024;
+  constexpr int kBufferSize = 16;
+  const string spill_dir = io::JoinPath(testing::TmpDir(), "shuffle_spill");
+  setenv("TF_DATA_SHUFFLE_SPILL_DIR", spill_dir.c_str(), 1);
+  std::vector<int64> values(kNumElements * kElementSize);
+  std::iota(values.begin(), values.end(), 0);
+  auto dataset_params = ShuffleDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64>(
+              TensorShape{kNumElements, kElementSize}, values)},
+          /*node_name=*/"tensor_slice"),
+      /*buffer_size=*/kBufferSize, /*seed=*/1, /*seed2=*/2, /*count=*/1,
+      /*reshuffle_each_iteration=*/false, /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({kElementSize})},
+      /*node_name=*/kShuffleNodeName, /*memory_budget_bytes=*/1 << 20);
+  Status s = Initialize(dataset_params);
+  unsetenv("TF_DATA_SHUFFLE_SPILL_DIR");
+  TF_ASSERT_OK(s);
+
+  // Returns the index of the input element that `element` is.
+  auto index_of = [&](const std::vector<Tensor>& element) {
+    EXPECT_EQ(1, element.size());
+    auto flat = element[0].flat<int64>();
+    EXPECT_EQ(kElementSize, flat.size());
+    const int64 index = flat(0) / kElementSize;
+    for (int i = 0; i < flat.size(); ++i) {
+      EXPECT_EQ(index * kElementSize + i, flat(i));
+    }
+    return index;
+  };
+
+  std::vector<int64> order;
+  bool end_of_sequence = false;
+  while (true) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    if (end_of_sequence) break;
+    order.push_back(index_of(next));
+    if (order.size() == 1) {
+      // The first group is in spill files, one per run.
+      std::vector<string> spill_files;
+      TF_ASSERT_OK(device_->env()->GetMatchingPaths(
+          io::JoinPath(spill_dir, "*"), &spill_files));
+      EXPECT_EQ(2, spill_files.size());
+    }
+  }
+  // The output is a permutation of the input, in which each group of
+  // `kBufferSize` input elements is shuffled separately.
+  ASSERT_EQ(kNumElements, order.size());
+  for (int i = 0; i < kNumElements; ++i) {
+    EXPECT_EQ(i / kBufferSize, order[i] / kBufferSize);
+  }
+  std::vector<int64> sorted = order;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<int64> identity(kNumElements);
+  std::iota(identity.begin(), identity.end(), 0);
+  EXPECT_EQ(identity, sorted);
+  EXPECT_NE(identity, order);
+
+  // Saving and restoring in the middle of a group resumes the same order.
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<int64> restored_order;
+  for (int i = 0; i < 20; ++i) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    restored_order.push_back(index_of(next));
+  }
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  while (true) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    if (end_of_sequence) break;
+    restored_order.push_back(index_of(next));
+  }
+  EXPECT_EQ(order, restored_order);
+}
+
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
@@ -560,6 +669,70 @@ TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   }
 }
 
+// Returns a function that fails on NaN inputs.
+FunctionDef FailOnNaN() {
+  return FunctionDefHelper::Define(
+      // Name
+      "FailOnNaN",
+      // Args
+      {"x: float"},
+      // Return values
+      {"y: float"},
+      // Attr def
+      {},
+      // Nodes
+      {{{"y"}, "CheckNumerics", {"x"}, {{"T", DT_FLOAT}, {"message", "NaN"}}}});
+}
+
+TEST_F(ShuffleDatasetOpTest, SpilledGroupEndsAtInputError) {
+  // The budget is smaller than an element, so the buffer is spilled. The
+  // input fails on its fourth element.
+  auto map_dataset_params = MapDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<float>(
+              TensorShape{8}, {0, 1, 2, std::numeric_limits<float>::quiet_NaN(),
+                               4, 5, 6, 7})},
+          /*node_name=*/"tensor_slice"),
+      /*other_arguments=*/{},
+      /*func=*/FunctionDefHelper::FunctionRef("FailOnNaN", {}),
+      /*func_lib=*/{FailOnNaN()},
+      /*type_arguments=*/{},
+      /*output_dtypes=*/{DT_FLOAT},
+      /*output_shapes=*/{PartialTensorShape({})},
+      /*use_inter_op_parallelism=*/true,
+      /*preserve_cardinality=*/true,
+      /*node_name=*/"map");
+  auto dataset_params = ShuffleDatasetParams(
+      map_dataset_params, /*buffer_size=*/8, /*seed=*/1, /*seed2=*/2,
+      /*count=*/1, /*reshuffle_each_iteration=*/false,
+      /*output_dtypes=*/{DT_FLOAT}, /*output_shapes=*/{PartialTensorShape({})},
+      /*node_name=*/kShuffleNodeName, /*memory_budget_bytes=*/1);
+  TF_ASSERT_OK(Initialize(dataset_params));
+
+  bool end_of_sequence = false;
+  std::vector<Tensor> next;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence)));
+
+  // The elements read before the error form a group of their own, so the
+  // iterator can be saved and produces them before reading further.
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  std::vector<float> values;
+  while (true) {
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    if (end_of_sequence) break;
+    values.push_back(next[0].scalar<float>()());
+  }
+  ASSERT_EQ(7, values.size());
+  std::sort(values.begin(), values.begin() + 3);
+  std::sort(values.begin() + 3, values.end());
+  EXPECT_EQ(std::vector<float>({0, 1, 2, 4, 5, 6, 7}), values);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
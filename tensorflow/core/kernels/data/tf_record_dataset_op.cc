@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/mapped_record_reader.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
@@ -35,6 +36,7 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kFileNames;
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
+/* static */ constexpr const char* const TFRecordDatasetOp::kUseMmap;
 
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kOffset[] = "offset";
@@ -54,12 +56,16 @@ bool is_cloud_tpu_gcs_fs() {
 class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                   const string& compression_type, int64 buffer_size)
+                   const string& compression_type, int64 buffer_size,
+                   bool use_mmap)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
+        requested_mmap_(use_mmap),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
-            compression_type)) {
+            compression_type)),
+        use_mmap_(use_mmap && options_.compression_type ==
+                                  io::RecordReaderOptions::NONE) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
@@ -102,8 +108,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
+    AttrValue use_mmap;
+    b->BuildAttrValue(requested_mmap_, &use_mmap);
     TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+        this, {filenames, compression_type, buffer_size},
+        {std::make_pair(kUseMmap, use_mmap)}, output));
     return Status::OK();
   }
 
@@ -120,11 +129,12 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       mutex_lock l(mu_);
       do {
         // We are currently processing a file, so try to read the next record.
-        if (reader_) {
+        if (reader_ || mapped_reader_) {
           out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
                                     TensorShape({}));
-          Status s =
-              reader_->ReadRecord(&out_tensors->back().scalar<tstring>()());
+          tstring* record = &out_tensors->back().scalar<tstring>()();
+          Status s = mapped_reader_ ? mapped_reader_->ReadRecord(record)
+                                    : reader_->ReadRecord(record);
           if (s.ok()) {
             static monitoring::CounterCell* bytes_counter =
                 metrics::GetTFDataBytesReadCounter(kDatasetType);
@@ -166,10 +176,13 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       do {
         // We are currently processing a file, so try to skip reading
         // the next (num_to_skip - *num_skipped) record.
-        if (reader_) {
+        if (reader_ || mapped_reader_) {
           int last_num_skipped;
-          Status s = reader_->SkipRecords(num_to_skip - *num_skipped,
-                                          &last_num_skipped);
+          Status s = mapped_reader_
+                         ? mapped_reader_->SkipRecords(
+                               num_to_skip - *num_skipped, &last_num_skipped)
+                         : reader_->SkipRecords(num_to_skip - *num_skipped,
+                                                &last_num_skipped);
           *num_skipped += last_num_skipped;
           if (s.ok()) {
             *end_of_sequence = false;
@@ -215,6 +228,9 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       if (reader_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(full_name(kOffset), reader_->TellOffset()));
+      } else if (mapped_reader_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kOffset),
+                                               mapped_reader_->TellOffset()));
       }
       return Status::OK();
     }
@@ -231,7 +247,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
         int64 offset;
         TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        if (mapped_reader_) {
+          TF_RETURN_IF_ERROR(mapped_reader_->SeekOffset(offset));
+        } else {
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        }
       }
       return Status::OK();
     }
@@ -247,6 +267,16 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
       // Actually move on to next file.
       const string& next_filename = dataset()->filenames_[current_file_index_];
+      if (dataset()->use_mmap_) {
+        Status s = MappedRecordReader::Create(env, next_filename,
+                                              &mapped_reader_);
+        if (s.ok()) {
+          return Status::OK();
+        }
+        // Fall back to reading through a stream, e.g. for file systems that
+        // do not support memory mapping or for empty files.
+        VLOG(2) << "Failed to map " << next_filename << ": " << s;
+      }
       TF_RETURN_IF_ERROR(env->NewRandomAccessFile(next_filename, &file_));
       reader_ = absl::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
@@ -257,6 +287,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
       file_.reset();
+      mapped_reader_.reset();
     }
 
     mutex mu_;
@@ -266,15 +297,25 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
+    // Used instead of `reader_` when the dataset reads through memory
+    // mappings.
+    std::unique_ptr<MappedRecordReader> mapped_reader_ TF_GUARDED_BY(mu_);
   };
 
   const std::vector<string> filenames_;
   const tstring compression_type_;
+  // The `use_mmap` attr, which is ignored for compressed files.
+  const bool requested_mmap_;
   io::RecordReaderOptions options_;
+  const bool use_mmap_;
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
-    : DatasetOpKernel(ctx) {}
+    : DatasetOpKernel(ctx) {
+  if (ctx->HasAttr(kUseMmap)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kUseMmap, &use_mmap_));
+  }
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -322,8 +363,8 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
     buffer_size = kS3BlockSize;
   }
 
-  *output =
-      new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+  *output = new Dataset(ctx, std::move(filenames), compression_type,
+                        buffer_size, use_mmap_);
 }
 
 namespace {
@@ -26,6 +26,7 @@ class TFRecordDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kFileNames = "filenames";
   static constexpr const char* const kCompressionType = "compression_type";
   static constexpr const char* const kBufferSize = "buffer_size";
+  static constexpr const char* const kUseMmap = "use_mmap";
 
   explicit TFRecordDatasetOp(OpKernelConstruction* ctx);
 
@@ -34,6 +35,11 @@ class TFRecordDatasetOp : public DatasetOpKernel {
 
  private:
   class Dataset;
+
+  // If true, uncompressed files are read through a memory mapping, and
+  // records are copied straight out of the mapping instead of through a read
+  // buffer.
+  bool use_mmap_ = false;
 };
 
 }  // namespace data
@@ -23,12 +23,13 @@ class TFRecordDatasetParams : public DatasetParams {
  public:
   TFRecordDatasetParams(std::vector<tstring> filenames,
                         CompressionType compression_type, int64 buffer_size,
-                        string node_name)
+                        bool use_mmap, string node_name)
       : DatasetParams({DT_STRING}, {PartialTensorShape({})},
                       std::move(node_name)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
-        buffer_size_(buffer_size) {}
+        buffer_size_(buffer_size),
+        use_mmap_(use_mmap) {}
 
   std::vector<Tensor> GetInputTensors() const override {
     int num_files = filenames_.size();
@@ -49,7 +50,7 @@ class TFRecordDatasetParams : public DatasetParams {
   }
 
   Status GetAttributes(AttributeVector* attr_vector) const override {
-    *attr_vector = {};
+    *attr_vector = {{TFRecordDatasetOp::kUseMmap, use_mmap_}};
     return Status::OK();
   }
 
@@ -61,6 +62,7 @@ class TFRecordDatasetParams : public DatasetParams {
   std::vector<tstring> filenames_;
   CompressionType compression_type_;
   int64 buffer_size_;
+  bool use_mmap_;
 };
 
 class TFRecordDatasetOpTest : public DatasetOpsTestBase {};
@@ -98,6 +100,7 @@ TFRecordDatasetParams TFRecordDatasetParams1() {
   return TFRecordDatasetParams(filenames,
                                /*compression_type=*/compression_type,
                                /*buffer_size=*/10,
+                               /*use_mmap=*/false,
                                /*node_name=*/kNodeName);
 }
 
@@ -116,11 +119,12 @@ TFRecordDatasetParams TFRecordDatasetParams2() {
   return TFRecordDatasetParams(filenames,
                                /*compression_type=*/compression_type,
                                /*buffer_size=*/10,
+                               /*use_mmap=*/false,
                                /*node_name=*/kNodeName);
 }
 
 // Test case 3: multiple text files without compression.
-TFRecordDatasetParams TFRecordDatasetParams3() {
+TFRecordDatasetParams TFRecordDatasetParams3(bool use_mmap = false) {
   std::vector<tstring> filenames = {
       absl::StrCat(testing::TmpDir(), "/tf_record_UNCOMPRESSED_1"),
       absl::StrCat(testing::TmpDir(), "/tf_record_UNCOMPRESSED_2")};
@@ -134,6 +138,7 @@ TFRecordDatasetParams TFRecordDatasetParams3() {
   return TFRecordDatasetParams(filenames,
                                /*compression_type=*/compression_type,
                                /*buffer_size=*/10,
+                               /*use_mmap=*/use_mmap,
                                /*node_name=*/kNodeName);
 }
 
@@ -263,6 +268,62 @@ IteratorSaveAndRestoreTestCases() {
 ITERATOR_SAVE_AND_RESTORE_TEST_P(TFRecordDatasetOpTest, TFRecordDatasetParams,
                                  IteratorSaveAndRestoreTestCases())
 
+TEST_F(TFRecordDatasetOpTest, MemoryMappedReader) {
+  auto dataset_params = TFRecordDatasetParams3(/*use_mmap=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  const std::vector<Tensor> expected_outputs = CreateTensors<tstring>(
+      TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}});
+
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    for (const Tensor& t : next) {
+      // Records own their bytes rather than aliasing the mapped file.
+      EXPECT_NE(tstring::VIEW, t.scalar<tstring>()().type());
+    }
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+  TF_EXPECT_OK(CheckIteratorSaveAndRestore(dataset_params.iterator_prefix(),
+                                           expected_outputs,
+                                           /*breakpoints=*/{0, 2, 4, 7},
+                                           /*compare_order=*/true));
+}
+
+// Batching copies the records, and the batch iterator drops its input
+// iterator (and with it the mappings) before copying the final partial batch.
+TEST_F(TFRecordDatasetOpTest, MemoryMappedReaderPartialBatch) {
+  auto dataset_params = BatchDatasetParams(
+      TFRecordDatasetParams3(/*use_mmap=*/true),
+      /*batch_size=*/4,
+      /*drop_remainder=*/false,
+      /*parallel_copy=*/false,
+      /*output_dtypes=*/{DT_STRING},
+      /*output_shapes=*/{PartialTensorShape({-1})},
+      /*node_name=*/"batch_dataset");
+  TF_ASSERT_OK(Initialize(dataset_params));
+
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  // The batches must stay valid after every reader is gone.
+  iterator_.reset();
+  TF_EXPECT_OK(ExpectEqual(
+      out_tensors,
+      {CreateTensor<tstring>(TensorShape({4}), {"1", "22", "333", "a"}),
+       CreateTensor<tstring>(TensorShape({2}), {"bb", "ccc"})},
+      /*compare_order=*/true));
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -182,6 +182,8 @@ REGISTER_OP("PrefetchDataset")
     .Attr("slack_period: int = 0")
     .Attr("legacy_autotune: bool = true")
     .Attr("buffer_size_min: int = 0")
+    .Attr("max_producers: int = 1")
+    .Attr("deterministic: string = 'default'")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
       shape_inference::ShapeHandle unused;
       // buffer_size should be a scalar.
@@ -253,6 +255,10 @@ REGISTER_OP("ParallelInterleaveDatasetV4")
     .Attr("f: func")
     // "true", "false", or "default".
     .Attr("deterministic: string = 'default'")
+    // If positive and the interleave is nondeterministic, an input element
+    // that is skipped is waited for once this many results have been
+    // returned since it was first skipped.
+    .Attr("reorder_window: int = 0")
     .Attr("Targuments: list(type) >= 0")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
@@ -476,6 +482,10 @@ REGISTER_OP("ShuffleDataset")
     .Input("seed2: int64")
     .Output("handle: variant")
     .Attr("reshuffle_each_iteration: bool = true")
+    // If positive, a shuffle buffer that is estimated to exceed this many
+    // bytes is shuffled in groups of `buffer_size` elements through spill
+    // files instead.
+    .Attr("memory_budget_bytes: int >= 0 = 0")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -510,6 +520,7 @@ REGISTER_OP("ShuffleDatasetV3")
     .Input("seed_generator: resource")
     .Output("handle: variant")
     .Attr("reshuffle_each_iteration: bool = true")
+    .Attr("memory_budget_bytes: int >= 0 = 0")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -532,6 +543,7 @@ REGISTER_OP("ShuffleAndRepeatDataset")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
     .Attr("reshuffle_each_iteration: bool = true")
+    .Attr("memory_budget_bytes: int >= 0 = 0")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
       shape_inference::ShapeHandle unused;
       // buffer_size, seed, seed2, and count should be scalars.
@@ -551,6 +563,7 @@ REGISTER_OP("ShuffleAndRepeatDatasetV2")
     .Input("seed_generator: resource")
     .Output("handle: variant")
     .Attr("reshuffle_each_iteration: bool = true")
+    .Attr("memory_budget_bytes: int >= 0 = 0")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -567,6 +580,8 @@ REGISTER_OP("ShuffleAndRepeatDatasetV2")
 REGISTER_OP("AnonymousMemoryCache")
     .Output("handle: resource")
     .Output("deleter: variant")
+    .Attr("memory_budget_bytes: int >= 0 = 0")
+    .Attr("compression: string = ''")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
       c->set_output(0, c->Scalar());
       c->set_output(1, c->Scalar());
@@ -591,6 +606,8 @@ REGISTER_OP("CacheDataset")
     .Output("handle: variant")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
+    .Attr("memory_budget_bytes: int >= 0 = 0")
+    .Attr("compression: string = ''")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
       shape_inference::ShapeHandle unused;
       // filename should be a scalar.
@@ -605,6 +622,8 @@ REGISTER_OP("CacheDatasetV2")
     .Output("handle: variant")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
+    .Attr("memory_budget_bytes: int >= 0 = 0")
+    .Attr("compression: string = ''")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
       shape_inference::ShapeHandle unused;
       // filename should be a scalar.
@@ -679,6 +698,7 @@ REGISTER_OP("TFRecordDataset")
     .Input("compression_type: string")
     .Input("buffer_size: int64")
     .Output("handle: variant")
+    .Attr("use_mmap: bool = false")
     .SetDoNotOptimize()  // TODO(b/123753214): See comment in dataset_ops.cc.
     .SetShapeFn([](shape_inference::InferenceContext* c) {
       shape_inference::ShapeHandle unused;
@@ -133,6 +133,34 @@ REGISTER_OP("ExperimentalChooseFastestDataset")
     .Attr("output_shapes: list(shape) >= 1")
     .SetShapeFn(shape_inference::ScalarShape);
 
+REGISTER_OP("ColumnarDataset")
+    .Input("filenames: string")
+    .Input("columns: string")
+    .Input("filter_columns: string")
+    .Input("filter_ops: string")
+    .Input("filter_values: double")
+    .Input("filter_int_values: int64")
+    .Input("batch_size: int64")
+    .Input("num_parallel_reads: int64")
+    .Output("handle: variant")
+    .Attr("output_types: list({float,double,int32,int64,string}) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetDoNotOptimize()  // TODO(b/123753214): See comment in dataset_ops.cc.
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // `filenames` must be a scalar or a vector.
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(0), 1, &unused));
+      // `columns`, `filter_columns`, `filter_ops`, `filter_values` and
+      // `filter_int_values` must be vectors.
+      for (int i = 1; i <= 5; ++i) {
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(i), 1, &unused));
+      }
+      // `batch_size` and `num_parallel_reads` must be scalars.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(6), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(7), 0, &unused));
+      return shape_inference::ScalarShape(c);
+    });
+
 REGISTER_OP("CompressElement")
     .Input("components: input_types")
     .Output("compressed: variant")
@@ -1195,6 +1223,9 @@ REGISTER_OP("DataServiceDatasetV2")
     .Attr("output_types: list(type) >= 1")
     .Attr("output_shapes: list(shape) >= 1")
     .Attr("data_transfer_protocol: string = ''")
+    .Attr("max_elements_per_request: int = 1")
+    .Attr("max_bytes_per_request: int = 16777216")
+    .Attr("transfer_codec: string = ''")
     .SetIsStateful()
     .SetShapeFn(shape_inference::ScalarShape);
 
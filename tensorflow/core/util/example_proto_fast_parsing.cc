@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <cstring>
 #include <vector>
 
 #include "absl/base/casts.h"
@@ -113,6 +114,54 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+// Decodes the packed varints in [begin, end) and appends them to `list`.
+//
+// The number of values is the number of bytes without a continuation bit, so
+// `list` is resized once up front. Runs of eight single-byte varints (values
+// in [0, 128), which are common for ids and counts) are detected with a single
+// 64-bit load and mask, and are widened without a branch per byte.
+template <typename Result>
+bool DecodePackedVarint64(const uint8* begin, const uint8* end,
+                          Result* list) {
+  if (begin == end) return true;
+  if (end[-1] & 0x80) return false;  // The last varint is truncated.
+  size_t num_values = 0;
+  for (const uint8* p = begin; p < end; ++p) {
+    num_values += *p < 0x80;
+  }
+  const size_t initial_size = list->size();
+  list->resize(initial_size + num_values);
+  // A LimitedArraySlice may have room for fewer values than were requested.
+  const size_t capacity = list->size() - initial_size;
+  int64* out = list->data() + initial_size;
+
+  constexpr uint64 kContinuationBits = 0x8080808080808080ULL;
+  const uint8* p = begin;
+  size_t index = 0;
+  while (p < end && index < capacity) {
+    if (end - p >= 8 && capacity - index >= 8) {
+      uint64 word;
+      std::memcpy(&word, p, sizeof(word));
+      if ((word & kContinuationBits) == 0) {
+        for (int i = 0; i < 8; ++i) out[index + i] = p[i];
+        p += 8;
+        index += 8;
+        continue;
+      }
+    }
+    // Cannot run past `end`, because the last byte ends a varint.
+    uint64 value = 0;
+    for (int shift = 0;; shift += 7) {
+      if (shift >= 64) return false;  // Longer than 10 bytes.
+      const uint8 byte = *p++;
+      value |= static_cast<uint64>(byte & 0x7f) << shift;
+      if (byte < 0x80) break;
+    }
+    out[index++] = static_cast<int64>(value);
+  }
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -299,15 +348,22 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64>(n));
+        if (packed_length > 0) {
+          // Decode straight from the serialized bytes rather than one varint
+          // at a time through `stream`.
+          const void* packed_data;
+          int available;
+          if (!stream.GetDirectBufferPointer(&packed_data, &available) ||
+              static_cast<uint32>(available) < packed_length) {
+            return false;
+          }
+          const uint8* packed = static_cast<const uint8*>(packed_data);
+          if (!DecodePackedVarint64(packed, packed + packed_length,
+                                    int64_list)) {
+            return false;
+          }
+          if (!stream.Skip(packed_length)) return false;
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
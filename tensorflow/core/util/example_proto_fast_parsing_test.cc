@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <limits>
 #include <utility>
 
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
@@ -170,6 +171,30 @@ TEST(FastParse, Packed) {
       "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d");
 }
 
+TEST(FastParse, PackedVarints) {
+  Example example;
+  auto* int64_list = (*example.mutable_features()->mutable_feature())["ids"]
+                         .mutable_int64_list();
+  // Runs of single-byte varints both longer and shorter than eight, mixed
+  // with multi-byte ones.
+  for (int i = 0; i < 19; ++i) int64_list->add_value(i);
+  for (int64 value : {int64{127}, int64{128}, int64{300}, int64{-1},
+                      std::numeric_limits<int64>::max(),
+                      std::numeric_limits<int64>::min()}) {
+    int64_list->add_value(value);
+  }
+  for (int i = 0; i < 5; ++i) int64_list->add_value(i);
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, TruncatedPackedVarint) {
+  // The packed value 0x8d has its continuation bit set, but is the last byte.
+  Example example;
+  EXPECT_FALSE(TestFastParse(
+      "\x0a\x0e\x0a\x0c\x0a\x03\x61\x67\x65\x12\x05\x1a\x03\x0a\x01\x8d",
+      &example));
+}
+
 TEST(FastParse, EmptyFeatures) {
   Example example;
   example.mutable_features();
@@ -321,6 +346,39 @@ TEST(FastParse, StatsCollection) {
   }
 }
 
+TEST(FastParse, DensePackedVarints) {
+  Example example;
+  auto* int64_list = (*example.mutable_features()->mutable_feature())["ids"]
+                         .mutable_int64_list();
+  std::vector<int64> expected;
+  for (int i = 0; i < 20; ++i) {
+    expected.push_back(i % 3 == 0 ? i * 1000 : i);
+    int64_list->add_value(expected.back());
+  }
+  const std::vector<tstring> serialized(3, Serialize(example));
+
+  FastParseExampleConfig config;
+  AddDenseFeature("ids", DT_INT64, {20}, false, 20, &config);
+  Result result;
+  TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  ASSERT_EQ(1, result.dense_values.size());
+  auto values = result.dense_values[0].matrix<int64>();
+  for (int b = 0; b < serialized.size(); ++b) {
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i], values(b, i));
+    }
+  }
+
+  // A dense shape that does not match the number of values is an error.
+  for (int num_values : {8, 21}) {
+    FastParseExampleConfig wrong_config;
+    AddDenseFeature("ids", DT_INT64, {num_values}, false, num_values,
+                    &wrong_config);
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        FastParseExample(wrong_config, serialized, {}, nullptr, &result)));
+  }
+}
+
 string RandStr(random::SimplePhilox* rng) {
   static const char key_char_lookup[] =
       "0123456789{}~`!@#$%^&*()"
@@ -423,6 +481,56 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+// Parses batches of 128 examples with `num_keys` dense int64 features of
+// `feature_size` values each, where every value is `value`.
+void BenchmarkFastParseExampleDenseInt64(::testing::benchmark::State& state,
+                                         int64 value) {
+  const int num_keys = state.range(0);
+  const int feature_size = state.range(1);
+  constexpr int kBatchSize = 128;
+
+  Example example;
+  FastParseExampleConfig config;
+  std::vector<string> keys;
+  for (int k = 0; k < num_keys; ++k) {
+    keys.push_back(strings::StrCat("feature_", k));
+  }
+  for (const string& key : keys) {
+    auto* int64_list = (*example.mutable_features()->mutable_feature())[key]
+                           .mutable_int64_list();
+    for (int i = 0; i < feature_size; ++i) int64_list->add_value(value);
+    AddDenseFeature(key.c_str(), DT_INT64, {feature_size}, false,
+                    feature_size, &config);
+  }
+  const std::vector<tstring> serialized(kBatchSize, Serialize(example));
+
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  }
+  state.SetItemsProcessed(static_cast<int64>(state.iterations()) *
+                          kBatchSize);
+}
+
+// Single-byte values, e.g. categorical ids.
+void BM_FastParseExampleDenseSmallInt64(::testing::benchmark::State& state) {
+  BenchmarkFastParseExampleDenseInt64(state, 42);
+}
+
+// Two-byte values.
+void BM_FastParseExampleDenseInt64(::testing::benchmark::State& state) {
+  BenchmarkFastParseExampleDenseInt64(state, 1729);
+}
+
+BENCHMARK(BM_FastParseExampleDenseSmallInt64)
+    ->ArgPair(100, 10)
+    ->ArgPair(1000, 1)
+    ->ArgPair(10, 1000);
+BENCHMARK(BM_FastParseExampleDenseInt64)
+    ->ArgPair(100, 10)
+    ->ArgPair(1000, 1)
+    ->ArgPair(10, 1000);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
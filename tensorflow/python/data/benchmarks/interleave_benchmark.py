@@ -17,11 +17,12 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
-
 from tensorflow.python.data.benchmarks import benchmark_base
 from tensorflow.python.data.experimental.ops import interleave_ops
 from tensorflow.python.data.experimental.ops import testing
 from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.ops import math_ops
 
 NON_PARALLEL = "non_parallel"
 EXPERIMENTAL_PARALLEL = "experimental_parallel"
@@ -60,6 +61,27 @@ def _make_fake_dataset_fn(initial_delay_us, remainder_delay_us):
   return fake_dataset_fn
 
 
+def _make_straggler_dataset_fn(delay_us, straggler_delay_us):
+  """Returns a dataset factory in which input 0 is a straggler.
+
+  The factory maps an input index to a dataset with 100 elements which each
+  take `delay_us` to produce, except for index 0, whose elements each take
+  `straggler_delay_us`.
+
+  Args:
+    delay_us: How long to wait before producing each element.
+    straggler_delay_us: How long the straggler waits before producing each
+      element.
+  """
+
+  def straggler_dataset_fn(index):
+    is_straggler = math_ops.cast(math_ops.equal(index, 0), dtypes.int64)
+    sleep_us = delay_us + (straggler_delay_us - delay_us) * is_straggler
+    return dataset_ops.Dataset.range(100).apply(testing.sleep(sleep_us))
+
+  return straggler_dataset_fn
+
+
 class ParallelInterleaveBenchmark(benchmark_base.DatasetBenchmarkBase):
   """Benchmarks for `tf.data.experimental.parallel_interleave()`."""
 
@@ -172,6 +194,34 @@ class ParallelInterleaveBenchmark(benchmark_base.DatasetBenchmarkBase):
         benchmark_id=1,
         benchmark_label="single_parallel_call")
 
+  # Compares the deterministic and nondeterministic modes of core parallel
+  # interleave with a nondeterministic interleave whose reordering is bounded
+  # by `reorder_window`, when one of the inputs is 10x slower than the others.
+  def benchmark_straggler(self):
+    cycle_length = 10
+    modes = [("deterministic", True, None), ("nondeterministic", False, None),
+             ("reorder_window_100", False, 100)]
+    for i, (mode, deterministic, reorder_window) in enumerate(modes):
+      dataset = dataset_ops.ParallelInterleaveDataset(
+          dataset_ops.Dataset.range(cycle_length),
+          _make_straggler_dataset_fn(
+              delay_us=1000, straggler_delay_us=10 * 1000),
+          cycle_length=cycle_length,
+          block_length=1,
+          num_parallel_calls=cycle_length,
+          deterministic=deterministic,
+          reorder_window=reorder_window)
+      self.run_and_report_benchmark(
+          dataset=dataset,
+          num_elements=500,
+          iters=5,
+          warmup=True,
+          extras={
+              "model_name": "interleave.benchmark.straggler.%d" % i,
+              "parameters": "%d.%s" % (cycle_length, mode),
+          },
+          name="straggler_" + mode)
+
   def benchmark_long_cycle(self):
     for i, version in enumerate([EXPERIMENTAL_PARALLEL, CORE_PARALLEL]):
       self._benchmark(
@@ -0,0 +1,160 @@
+#  Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks for `ColumnarDataset` against CSV and TFRecord files."""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+import tempfile
+
+import numpy as np
+
+from tensorflow.core.example import example_pb2
+from tensorflow.core.example import feature_pb2
+from tensorflow.python.data.benchmarks import benchmark_base
+from tensorflow.python.data.experimental.ops import readers
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.data.ops import readers as core_readers
+from tensorflow.python.framework import dtypes
+from tensorflow.python.lib.io import python_io
+from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import parsing_ops
+from tensorflow.python.platform import gfile
+from tensorflow.python.platform import googletest
+
+
+class ColumnarDatasetBenchmark(benchmark_base.DatasetBenchmarkBase):
+  """Benchmarks for `ColumnarDataset` against CSV and TFRecord files.
+
+  The same table, an `id` column and `_NUM_FEATURES` float features, is written
+  in the three formats. Each benchmark reads `_NUM_PROJECTED` features in
+  batches of `_BATCH_SIZE` rows, optionally keeping only the rows whose `id`
+  is below `_FILTER_ID`, so that every pipeline produces the same batches.
+  """
+
+  _NUM_ROWS = 100000
+  _NUM_FEATURES = 64
+  _NUM_PROJECTED = 4
+  _BATCH_SIZE = 1024
+  _ROW_GROUP_SIZE = 8192
+  _FILTER_ID = 10000
+
+  def _set_up(self):
+    gfile.MakeDirs(googletest.GetTempDir())
+    self._temp_dir = tempfile.mkdtemp(dir=googletest.GetTempDir())
+    ids = np.arange(self._NUM_ROWS, dtype=np.int64)
+    features = np.random.rand(self._NUM_ROWS,
+                              self._NUM_FEATURES).astype(np.float32)
+    self._feature_names = ["f%d" % i for i in range(self._NUM_FEATURES)]
+
+    self._columnar_file = os.path.join(self._temp_dir, "table.columnar")
+    readers.write_columnar_file(
+        self._columnar_file, [("id", ids)] +
+        [(name, features[:, i]) for i, name in enumerate(self._feature_names)],
+        row_group_size=self._ROW_GROUP_SIZE)
+
+    self._csv_file = os.path.join(self._temp_dir, "table.csv")
+    with open(self._csv_file, "w") as f:
+      for i in range(self._NUM_ROWS):
+        f.write("%d,%s\n" % (ids[i], ",".join("%f" % v for v in features[i])))
+
+    self._tfrecord_file = os.path.join(self._temp_dir, "table.tfrecord")
+    with python_io.TFRecordWriter(self._tfrecord_file) as writer:
+      for i in range(self._NUM_ROWS):
+        feature = {
+            "id": feature_pb2.Feature(
+                int64_list=feature_pb2.Int64List(value=[ids[i]]))
+        }
+        for j, name in enumerate(self._feature_names):
+          feature[name] = feature_pb2.Feature(
+              float_list=feature_pb2.FloatList(value=[features[i, j]]))
+        example = example_pb2.Example(
+            features=feature_pb2.Features(feature=feature))
+        writer.write(example.SerializeToString())
+
+  def _tear_down(self):
+    gfile.DeleteRecursively(self._temp_dir)
+
+  def _num_batches(self, filtered):
+    num_rows = self._FILTER_ID if filtered else self._NUM_ROWS
+    return -(-num_rows // self._BATCH_SIZE)
+
+  def _columnar_dataset(self, filtered):
+    projected = self._feature_names[:self._NUM_PROJECTED]
+    filters = [("id", "<", self._FILTER_ID)] if filtered else None
+    return readers.ColumnarDataset(
+        self._columnar_file,
+        columns=[(name, dtypes.float32) for name in projected],
+        batch_size=self._BATCH_SIZE,
+        filters=filters,
+        num_parallel_reads=dataset_ops.AUTOTUNE)
+
+  def _csv_dataset(self, filtered):
+    # Column 0 is the id, and the projected features follow it.
+    dataset = readers.CsvDataset(
+        self._csv_file,
+        record_defaults=[[0]] + [[0.0]] * self._NUM_PROJECTED,
+        select_cols=list(range(self._NUM_PROJECTED + 1)))
+    if filtered:
+      dataset = dataset.filter(lambda row_id, *_: row_id < self._FILTER_ID)
+    dataset = dataset.map(lambda _, *features: features)
+    return dataset.batch(self._BATCH_SIZE)
+
+  def _tfrecord_dataset(self, filtered):
+    projected = self._feature_names[:self._NUM_PROJECTED]
+    features = {
+        name: parsing_ops.FixedLenFeature([], dtypes.float32)
+        for name in projected
+    }
+    if filtered:
+      features["id"] = parsing_ops.FixedLenFeature([], dtypes.int64)
+    dataset = core_readers.TFRecordDataset(self._tfrecord_file)
+    dataset = dataset.batch(self._BATCH_SIZE).map(
+        lambda records: parsing_ops.parse_example(records, features))
+    if filtered:
+      # Filter the parsed rows and batch them again.
+      dataset = dataset.unbatch().filter(
+          lambda row: math_ops.less(row["id"], self._FILTER_ID)).batch(
+              self._BATCH_SIZE)
+    return dataset.map(lambda row: tuple(row[name] for name in projected))
+
+  def _run_benchmark(self, dataset, filtered, name):
+    self.run_and_report_benchmark(
+        dataset=dataset.repeat(),
+        num_elements=self._num_batches(filtered),
+        name="%s_%s" % (name, "filtered" if filtered else "projected"),
+        iters=5,
+        extras={
+            "model_name": "columnar.benchmark.%s" % name,
+            "parameters": "%d.%d.%d" % (self._NUM_FEATURES,
+                                        self._NUM_PROJECTED, filtered),
+        },
+        warmup=True)
+
+  def benchmark_formats(self):
+    self._set_up()
+    for filtered in (False, True):
+      self._run_benchmark(self._columnar_dataset(filtered), filtered,
+                          "columnar")
+      self._run_benchmark(self._csv_dataset(filtered), filtered, "csv")
+      self._run_benchmark(self._tfrecord_dataset(filtered), filtered,
+                          "tfrecord")
+    self._tear_down()
+
+
+if __name__ == "__main__":
+  benchmark_base.test.main()
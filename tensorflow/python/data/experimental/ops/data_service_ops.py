@@ -69,7 +69,10 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
                consumer_index=None,
                num_consumers=None,
                max_outstanding_requests=None,
-               task_refresh_interval_hint_ms=None):
+               task_refresh_interval_hint_ms=None,
+               max_elements_per_request=None,
+               max_bytes_per_request=None,
+               transfer_codec=None):
     """Constructs a _DataServiceDatasetV2.
 
     Args:
@@ -106,6 +109,15 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
         `element_size` * `max_outstanding_requests` of memory.
       task_refresh_interval_hint_ms: (Optional.) A hint for how often to query
         the dispatcher for task changes.
+      max_elements_per_request: (Optional.) The maximum number of elements a
+        worker returns per request when reading without `consumer_index`.
+        Values greater than 1 batch elements to amortize the cost of a round
+        trip. Batching is a property of the job, so only the consumer which
+        creates a shared job decides it.
+      max_bytes_per_request: (Optional.) The maximum number of bytes of
+        elements a worker returns per batch.
+      transfer_codec: (Optional.) "none", "snappy", or "zlib". The codec workers
+        compress batches of uncompressed elements with.
     """
     if consumer_index is None != num_consumers is None:
       raise ValueError(
@@ -149,6 +161,12 @@ class _DataServiceDatasetV2(dataset_ops.DatasetSource):
     compat_kwargs = {}
     if data_transfer_protocol is not None:
       compat_kwargs["data_transfer_protocol"] = data_transfer_protocol
+    if max_elements_per_request is not None:
+      compat_kwargs["max_elements_per_request"] = max_elements_per_request
+    if max_bytes_per_request is not None:
+      compat_kwargs["max_bytes_per_request"] = max_bytes_per_request
+    if transfer_codec is not None:
+      compat_kwargs["transfer_codec"] = transfer_codec
     variant_tensor = gen_experimental_dataset_ops.data_service_dataset_v2(
         dataset_id=self._dataset_id,
         processing_mode=self._processing_mode,
@@ -177,7 +195,8 @@ class _DataServiceDatasetV1(dataset_ops.DatasetV1Adapter):
   def __init__(self, dataset_id, processing_mode, address, element_spec,
                protocol, data_transfer_protocol, job_name, consumer_index,
                num_consumers, max_outstanding_requests,
-               task_refresh_interval_hint_ms):
+               task_refresh_interval_hint_ms, max_elements_per_request,
+               max_bytes_per_request, transfer_codec):
 
     self._wrapped = _DataServiceDatasetV2(
         dataset_id=dataset_id,
@@ -190,7 +209,10 @@ class _DataServiceDatasetV1(dataset_ops.DatasetV1Adapter):
         consumer_index=consumer_index,
         num_consumers=num_consumers,
         max_outstanding_requests=max_outstanding_requests,
-        task_refresh_interval_hint_ms=task_refresh_interval_hint_ms)
+        task_refresh_interval_hint_ms=task_refresh_interval_hint_ms,
+        max_elements_per_request=max_elements_per_request,
+        max_bytes_per_request=max_bytes_per_request,
+        transfer_codec=transfer_codec)
     super(_DataServiceDatasetV1, self).__init__(self._wrapped)
 
 
@@ -237,7 +259,10 @@ def _distribute(processing_mode,
                 max_outstanding_requests=None,
                 task_refresh_interval_hint_ms=None,
                 data_transfer_protocol=None,
-                compression="AUTO"):
+                compression="AUTO",
+                max_elements_per_request=None,
+                max_bytes_per_request=None,
+                transfer_codec=None):
   """A transformation that moves dataset processing to the tf.data service.
 
   This transformation is similar to `distribute`, but supports additional
@@ -278,6 +303,14 @@ def _distribute(processing_mode,
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
       tf.data service runtime. `None` indicates not to compress.
+    max_elements_per_request: (Optional.) The maximum number of elements a
+      worker returns per request when reading without `consumer_index`. Values
+      greater than 1 batch elements to amortize the cost of a round trip.
+    max_bytes_per_request: (Optional.) The maximum number of bytes of elements
+      a worker returns per batch.
+    transfer_codec: (Optional.) "none", "snappy", or "zlib". The codec workers
+      compress batches of elements with. Setting a codec replaces the "AUTO"
+      per-element compression.
 
   Returns:
     Dataset: A `Dataset` of the elements produced by the data service.
@@ -290,6 +323,10 @@ def _distribute(processing_mode,
             compression, valid_compressions))
   if compression == COMPRESSION_AUTO and data_transfer_protocol is not None:
     compression = COMPRESSION_NONE
+  # Workers only apply the transfer codec to uncompressed elements.
+  if (compression == COMPRESSION_AUTO and transfer_codec is not None and
+      transfer_codec != "none"):
+    compression = COMPRESSION_NONE
   def _apply_fn(dataset):  # pylint: disable=missing-docstring
     dataset_id = _register_dataset(service, dataset, compression=compression)
     return _from_dataset_id(
@@ -303,7 +340,10 @@ def _distribute(processing_mode,
         max_outstanding_requests=max_outstanding_requests,
         task_refresh_interval_hint_ms=task_refresh_interval_hint_ms,
         data_transfer_protocol=data_transfer_protocol,
-        compression=compression)
+        compression=compression,
+        max_elements_per_request=max_elements_per_request,
+        max_bytes_per_request=max_bytes_per_request,
+        transfer_codec=transfer_codec)
 
   return _apply_fn
 
@@ -641,7 +681,10 @@ def _from_dataset_id(processing_mode,
                      max_outstanding_requests=None,
                      task_refresh_interval_hint_ms=None,
                      data_transfer_protocol=None,
-                     compression="AUTO"):
+                     compression="AUTO",
+                     max_elements_per_request=None,
+                     max_bytes_per_request=None,
+                     transfer_codec=None):
   """Creates a dataset which reads data from the tf.data service.
 
   This transformation is similar to `from_dataset_id`, but supports additional
@@ -687,6 +730,14 @@ def _from_dataset_id(processing_mode,
       data with the tf.data service. By default, data is transferred using gRPC.
     compression: An indication of how the dataset's elements were compressed, so
       that `from_dataset_id` can uncompress them if necessary.
+    max_elements_per_request: (Optional.) The maximum number of elements a
+      worker returns per request when reading without `consumer_index`. Values
+      greater than 1 batch elements to amortize the cost of a round trip.
+    max_bytes_per_request: (Optional.) The maximum number of bytes of elements
+      a worker returns per batch.
+    transfer_codec: (Optional.) "none", "snappy", or "zlib". The codec workers
+      compress batches of elements with. Only elements registered without
+      compression are compressed by the codec.
 
   Returns:
     A `tf.data.Dataset` which reads from the tf.data service.
@@ -727,7 +778,10 @@ def _from_dataset_id(processing_mode,
       consumer_index=consumer_index,
       num_consumers=num_consumers,
       max_outstanding_requests=max_outstanding_requests,
-      task_refresh_interval_hint_ms=task_refresh_interval_hint_ms)
+      task_refresh_interval_hint_ms=task_refresh_interval_hint_ms,
+      max_elements_per_request=max_elements_per_request,
+      max_bytes_per_request=max_bytes_per_request,
+      transfer_codec=transfer_codec)
   if compression == COMPRESSION_AUTO:
     dataset = dataset.map(
         lambda x: compression_ops.uncompress(x, output_spec=element_spec),
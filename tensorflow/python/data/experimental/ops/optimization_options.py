@@ -20,6 +20,7 @@ from __future__ import print_function
 import enum
 
 from tensorflow.core.framework import dataset_options_pb2
+from tensorflow.core.framework import model_pb2
 from tensorflow.python.data.util import options
 from tensorflow.python.util.tf_export import tf_export
 
@@ -27,10 +28,46 @@ from tensorflow.python.util.tf_export import tf_export
 _ENABLE_AUTOTUNE_BUFFERS_BY_DEFAULT = False
 
 
-class _AutotuneAlgorithm(enum.Enum):
-  """Controls what algorithm is used in the autotune implementation."""
+@tf_export("data.experimental.AutotuneAlgorithm")
+class AutotuneAlgorithm(enum.Enum):
+  """Controls what algorithm is used in the autotune implementation.
+
+  HILL_CLIMB: Repeatedly increments the parameter that improves the modeled
+  output latency the most, until the budget is reached.
+
+  GRADIENT_DESCENT: Optimizes all parameters at once with gradient descent on
+  the modeled output latency. Used by default when buffer sizes are autotuned.
+
+  ONLINE_COST_MODEL: Tunes parameters based on the processing times measured
+  while the pipeline runs.
+  """
   HILL_CLIMB = 0
   GRADIENT_DESCENT = 1
+  ONLINE_COST_MODEL = 2
+
+  @classmethod
+  def _to_proto(cls, obj):
+    """Convert enum to proto."""
+    if obj == cls.HILL_CLIMB:
+      return model_pb2.AutotuneAlgorithm.HILL_CLIMB
+    if obj == cls.GRADIENT_DESCENT:
+      return model_pb2.AutotuneAlgorithm.GRADIENT_DESCENT
+    if obj == cls.ONLINE_COST_MODEL:
+      return model_pb2.AutotuneAlgorithm.ONLINE_COST_MODEL
+    raise ValueError("%s._to_proto() is called with undefined enum %s." %
+                     (cls.__name__, obj.name))
+
+  @classmethod
+  def _from_proto(cls, pb):
+    """Convert proto to enum."""
+    if pb == model_pb2.AutotuneAlgorithm.HILL_CLIMB:
+      return cls.HILL_CLIMB
+    if pb == model_pb2.AutotuneAlgorithm.GRADIENT_DESCENT:
+      return cls.GRADIENT_DESCENT
+    if pb == model_pb2.AutotuneAlgorithm.ONLINE_COST_MODEL:
+      return cls.ONLINE_COST_MODEL
+    raise ValueError("%s._from_proto() is called with undefined enum %s." %
+                     (cls.__name__, pb))
 
 
 @tf_export("data.experimental.MapVectorizationOptions")
@@ -140,6 +177,15 @@ class OptimizationOptions(options.OptionsBase):
       "budget to use. Values greater than the available RAM in bytes may "
       "result in OOM. If None, defaults to half of the available RAM in bytes.")
 
+  autotune_algorithm = options.create_option(
+      name="autotune_algorithm",
+      ty=AutotuneAlgorithm,
+      docstring=
+      "When autotuning is enabled (through `autotune`), determines the "
+      "algorithm to use. See `tf.data.experimental.AutotuneAlgorithm` for the "
+      "available algorithms. If None, defaults to `GRADIENT_DESCENT` when "
+      "`autotune_buffers` is enabled, and to `HILL_CLIMB` otherwise.")
+
   filter_fusion = options.create_option(
       name="filter_fusion",
       ty=bool,
@@ -243,14 +289,16 @@ class OptimizationOptions(options.OptionsBase):
     # If autotune_buffers is enabled, we use the GRADIENT_DESCENT algorithm by
     # default, which is more performant for tuning heterogeneous parameters.
     algorithm = (
-        _AutotuneAlgorithm.GRADIENT_DESCENT
-        if self._autotune_buffers() else _AutotuneAlgorithm.HILL_CLIMB)
+        AutotuneAlgorithm.GRADIENT_DESCENT
+        if self._autotune_buffers() else AutotuneAlgorithm.HILL_CLIMB)
     cpu_budget = 0  # Indicates that all CPU cores should be used by default.
     ram_budget = 0  # Indicates that default value of RAM budget should be used.
 
     # Set these options if they are explicitly set by the user.
     if self.autotune is False:  # pylint: disable=g-bool-id-comparison
       autotune = False
+    if self.autotune_algorithm is not None:
+      algorithm = self.autotune_algorithm
     if self.autotune_cpu_budget is not None:
       cpu_budget = self.autotune_cpu_budget
     if self.autotune_ram_budget is not None:
@@ -357,6 +405,9 @@ class OptimizationOptions(options.OptionsBase):
       pb.autotune_cpu_budget = self.autotune_cpu_budget
     if self.autotune_ram_budget is not None:
       pb.autotune_ram_budget = self.autotune_ram_budget
+    if self.autotune_algorithm is not None:
+      pb.autotune_algorithm = AutotuneAlgorithm._to_proto(  # pylint: disable=protected-access
+          self.autotune_algorithm)
     if self.filter_fusion is not None:
       pb.filter_fusion = self.filter_fusion
     if self.filter_with_random_uniform_fusion is not None:
@@ -394,6 +445,9 @@ class OptimizationOptions(options.OptionsBase):
       self.autotune_cpu_budget = pb.autotune_cpu_budget
     if pb.WhichOneof("optional_autotune_ram_budget") is not None:
       self.autotune_ram_budget = pb.autotune_ram_budget
+    if pb.WhichOneof("optional_autotune_algorithm") is not None:
+      self.autotune_algorithm = AutotuneAlgorithm._from_proto(  # pylint: disable=protected-access
+          pb.autotune_algorithm)
     if pb.WhichOneof("optional_filter_fusion") is not None:
       self.filter_fusion = pb.filter_fusion
     if pb.WhichOneof("optional_filter_with_random_uniform_fusion") is not None:
@@ -21,8 +21,11 @@ import collections
 import csv
 import functools
 import gzip
+import struct
+import zlib
 
 import numpy as np
+import six
 
 from tensorflow.python import tf2
 from tensorflow.python.data.experimental.ops import error_ops
@@ -40,6 +43,7 @@ from tensorflow.python.lib.io import file_io
 from tensorflow.python.ops import gen_experimental_dataset_ops
 from tensorflow.python.ops import io_ops
 from tensorflow.python.platform import gfile
+from tensorflow.python.util import compat
 from tensorflow.python.util.tf_export import tf_export
 
 _ACCEPTABLE_CSV_TYPES = (dtypes.float32, dtypes.float64, dtypes.int32,
@@ -1186,6 +1190,196 @@ class SqlDatasetV1(dataset_ops.DatasetV1Adapter):
     super(SqlDatasetV1, self).__init__(wrapped)
 
 
+_COLUMNAR_MAGIC = b"TFCOLUMN"
+_COLUMNAR_FORMAT_VERSION = 1
+_COLUMNAR_FILTER_OPS = ("==", "!=", "<", "<=", ">", ">=")
+
+
+def _columnar_int_value(value):
+  """Returns `value` as an int64 if it is integral, and 0 otherwise."""
+  if isinstance(value, (six.integer_types, np.integer)):
+    return int(value)
+  value = float(value)
+  if value.is_integer() and -2.0**63 <= value < 2.0**63:
+    return int(value)
+  return 0
+
+
+def write_columnar_file(filename, columns, row_group_size):
+  """Writes a table to a file that `ColumnarDataset` can read.
+
+  See `tensorflow/core/kernels/data/experimental/columnar_format.h` for the
+  layout of the file.
+
+  Args:
+    filename: The name of the file to write.
+    columns: A list of `(name, values)` pairs, where `values` is a 1-D numpy
+      array of `float32`, `float64`, `int32`, `int64` or bytes. All arrays must
+      have the same length.
+    row_group_size: The number of rows per row group.
+  """
+  names = [name for name, _ in columns]
+  arrays = [np.asarray(values) for _, values in columns]
+  num_rows = len(arrays[0]) if arrays else 0
+  dtype_enums = []
+  for name, array in zip(names, arrays):
+    if array.ndim != 1 or len(array) != num_rows:
+      raise ValueError("Column %s must be a vector of %d values." %
+                       (name, num_rows))
+    if array.dtype.kind in ("S", "O", "U"):
+      dtype_enums.append(dtypes.string.as_datatype_enum)
+    else:
+      dtype = dtypes.as_dtype(array.dtype)
+      if dtype not in (dtypes.float32, dtypes.float64, dtypes.int32,
+                       dtypes.int64):
+        raise ValueError("Column %s has unsupported type %s." % (name, dtype))
+      dtype_enums.append(dtype.as_datatype_enum)
+
+  int_enums = (dtypes.int32.as_datatype_enum, dtypes.int64.as_datatype_enum)
+  with gfile.GFile(filename, "wb") as f:
+    header = _COLUMNAR_MAGIC + struct.pack("<I", _COLUMNAR_FORMAT_VERSION)
+    f.write(header)
+    offset = len(header)
+    row_groups = []
+    for start in range(0, num_rows, row_group_size):
+      end = min(start + row_group_size, num_rows)
+      chunks = []
+      for array, dtype_enum in zip(arrays, dtype_enums):
+        values = array[start:end]
+        has_statistics = 0
+        if dtype_enum in int_enums:
+          low = high = 0
+          chunk_format = "<QQIIqq"
+        else:
+          low = high = 0.0
+          chunk_format = "<QQIIdd"
+        if dtype_enum == dtypes.string.as_datatype_enum:
+          strings = [compat.as_bytes(v) for v in values]
+          ends = np.cumsum([len(v) for v in strings], dtype="<u8")
+          data = ends.tobytes() + b"".join(strings)
+        else:
+          values = values.astype(values.dtype.newbyteorder("<"))
+          data = values.tobytes()
+          if dtype_enum in int_enums:
+            if len(values):
+              has_statistics = 1
+              low, high = int(values.min()), int(values.max())
+          elif len(values) and not np.isnan(values).any():
+            has_statistics = 1
+            low, high = float(values.min()), float(values.max())
+        f.write(data)
+        checksum = zlib.crc32(data) & 0xffffffff
+        chunks.append(
+            struct.pack(chunk_format, offset, len(data), checksum,
+                        has_statistics, low, high))
+        offset += len(data)
+      row_groups.append((end - start, chunks))
+
+    footer = [struct.pack("<I", len(names))]
+    for name, dtype_enum in zip(names, dtype_enums):
+      name = compat.as_bytes(name)
+      footer.append(struct.pack("<I", len(name)) + name +
+                    struct.pack("<I", dtype_enum))
+    footer.append(struct.pack("<I", len(row_groups)))
+    for group_rows, chunks in row_groups:
+      footer.append(struct.pack("<Q", group_rows))
+      footer.extend(chunks)
+    footer = b"".join(footer)
+    checksum = zlib.crc32(footer) & 0xffffffff
+    f.write(footer + struct.pack("<QI", len(footer), checksum) +
+            _COLUMNAR_MAGIC)
+
+
+class ColumnarDataset(dataset_ops.DatasetSource):
+  """A `Dataset` of batches of rows read from columnar files.
+
+  Unlike `CsvDataset` or `TFRecordDataset`, only the requested columns are read
+  from disk, and rows are filtered before they are materialized. Each element
+  is a tuple with one 1-D tensor of up to `batch_size` rows per column:
+
+  ```python
+  write_columnar_file("/tmp/table", [("id", ids), ("score", scores)],
+                      row_group_size=10000)
+  dataset = ColumnarDataset("/tmp/table", columns=[("score", tf.float32)],
+                            batch_size=1024, filters=[("id", ">=", 100)])
+  ```
+
+  Files are split in row groups, and row groups whose minimum and maximum
+  values show that they cannot satisfy the filters are skipped entirely.
+  """
+
+  def __init__(self,
+               filenames,
+               columns,
+               batch_size,
+               filters=None,
+               num_parallel_reads=None):
+    """Creates a `ColumnarDataset`.
+
+    Args:
+      filenames: A `tf.string` tensor containing one or more filenames.
+      columns: A list of `(name, dtype)` pairs naming the columns to read and
+        their types, which must be `tf.float32`, `tf.float64`, `tf.int32`,
+        `tf.int64` or `tf.string`.
+      batch_size: The maximum number of rows in each element.
+      filters: (Optional.) A list of `(column, op, value)` triples, where `op`
+        is one of "==", "!=", "<", "<=", ">" and ">=". Only rows that satisfy
+        all the filters are returned. Filtered columns must be numeric.
+        Integer columns are compared with integral values exactly, and
+        otherwise values are compared as doubles.
+      num_parallel_reads: (Optional.) The number of row groups to read in
+        parallel. Defaults to 1. If set to `tf.data.experimental.AUTOTUNE`, the
+        size of the inter-op threadpool is used.
+    """
+    filters = filters or []
+    for _, op, _ in filters:
+      if op not in _COLUMNAR_FILTER_OPS:
+        raise ValueError("Unsupported filter operator %r. Expected one of %s." %
+                         (op, ", ".join(_COLUMNAR_FILTER_OPS)))
+    if num_parallel_reads is None:
+      num_parallel_reads = 1
+    self._filenames = ops.convert_to_tensor(
+        filenames, dtype=dtypes.string, name="filenames")
+    self._columns = ops.convert_to_tensor(
+        [name for name, _ in columns], dtype=dtypes.string, name="columns")
+    self._filter_columns = ops.convert_to_tensor(
+        [column for column, _, _ in filters],
+        dtype=dtypes.string,
+        name="filter_columns")
+    self._filter_ops = ops.convert_to_tensor(
+        [op for _, op, _ in filters], dtype=dtypes.string, name="filter_ops")
+    self._filter_values = ops.convert_to_tensor(
+        [value for _, _, value in filters],
+        dtype=dtypes.float64,
+        name="filter_values")
+    self._filter_int_values = ops.convert_to_tensor(
+        [_columnar_int_value(value) for _, _, value in filters],
+        dtype=dtypes.int64,
+        name="filter_int_values")
+    self._batch_size = ops.convert_to_tensor(
+        batch_size, dtype=dtypes.int64, name="batch_size")
+    self._num_parallel_reads = ops.convert_to_tensor(
+        num_parallel_reads, dtype=dtypes.int64, name="num_parallel_reads")
+    self._element_spec = tuple(
+        tensor_spec.TensorSpec([None], dtypes.as_dtype(dtype))
+        for _, dtype in columns)
+    variant_tensor = gen_experimental_dataset_ops.columnar_dataset(
+        filenames=self._filenames,
+        columns=self._columns,
+        filter_columns=self._filter_columns,
+        filter_ops=self._filter_ops,
+        filter_values=self._filter_values,
+        filter_int_values=self._filter_int_values,
+        batch_size=self._batch_size,
+        num_parallel_reads=self._num_parallel_reads,
+        **self._flat_structure)
+    super(ColumnarDataset, self).__init__(variant_tensor)
+
+  @property
+  def element_spec(self):
+    return self._element_spec
+
+
 if tf2.enabled():
   CsvDataset = CsvDatasetV2
   SqlDataset = SqlDatasetV2
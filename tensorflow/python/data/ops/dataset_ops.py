@@ -4174,21 +4174,43 @@ class RangeDataset(DatasetSource):
 class CacheDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that caches elements of its input."""
 
-  def __init__(self, input_dataset, filename):
-    """See `Dataset.cache()` for details."""
+  def __init__(self,
+               input_dataset,
+               filename,
+               memory_budget_bytes=None,
+               compression=None):
+    """See `Dataset.cache()` for details.
+
+    Args:
+      input_dataset: The input dataset.
+      filename: The file to cache to, or an empty string to cache in memory.
+      memory_budget_bytes: (Optional.) If positive, an in-memory cache keeps
+        elements in memory until they exceed this many bytes, and spills the
+        rest to a local file. (Defaults to 0, no budget.)
+      compression: (Optional.) "SNAPPY" to keep the elements of an in-memory
+        cache compressed. (Defaults to "", uncompressed.)
+    """
     self._input_dataset = input_dataset
     self._filename = ops.convert_to_tensor(
         filename, dtype=dtypes.string, name="filename")
+    if memory_budget_bytes is None:
+      memory_budget_bytes = 0
+    if compression is None:
+      compression = ""
     if tf2.enabled() and (context.executing_eagerly() or ops.inside_function()):
       variant_tensor = gen_dataset_ops.cache_dataset_v2(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
           cache=gen_dataset_ops.dummy_memory_cache(),
+          memory_budget_bytes=memory_budget_bytes,
+          compression=compression,
           **self._flat_structure)
     else:
       variant_tensor = gen_dataset_ops.cache_dataset(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
+          memory_budget_bytes=memory_budget_bytes,
+          compression=compression,
           **self._flat_structure)
     super(CacheDataset, self).__init__(input_dataset, variant_tensor)
 
@@ -4200,7 +4222,8 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
                input_dataset,
                buffer_size,
                seed=None,
-               reshuffle_each_iteration=None):
+               reshuffle_each_iteration=None,
+               memory_budget_bytes=None):
     """Randomly shuffles the elements of this dataset.
 
     Args:
@@ -4213,6 +4236,10 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
       reshuffle_each_iteration: (Optional.) A boolean, which if true indicates
         that the dataset should be pseudorandomly reshuffled each time it is
         iterated over. (Defaults to `True`.)
+      memory_budget_bytes: (Optional.) If positive, and `buffer_size` elements
+        of the size of the first input element exceed this many bytes, the
+        input is shuffled in groups of `buffer_size` elements through spill
+        files instead of an in-memory buffer. (Defaults to 0, no budget.)
 
     Returns:
       A `Dataset`.
@@ -4227,6 +4254,8 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
     if reshuffle_each_iteration is None:
       reshuffle_each_iteration = True
     self._reshuffle_each_iteration = reshuffle_each_iteration
+    if memory_budget_bytes is None:
+      memory_budget_bytes = 0
 
     if (tf2.enabled() and
         (context.executing_eagerly() or ops.inside_function())):
@@ -4237,6 +4266,7 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
           seed2=self._seed2,
           seed_generator=gen_dataset_ops.dummy_seed_generator(),
           reshuffle_each_iteration=self._reshuffle_each_iteration,
+          memory_budget_bytes=memory_budget_bytes,
           **self._flat_structure)
     else:
       variant_tensor = gen_dataset_ops.shuffle_dataset(
@@ -4245,6 +4275,7 @@ class ShuffleDataset(UnaryUnchangedStructureDataset):
           seed=self._seed,
           seed2=self._seed2,
           reshuffle_each_iteration=self._reshuffle_each_iteration,
+          memory_budget_bytes=memory_budget_bytes,
           **self._flat_structure)
     super(ShuffleDataset, self).__init__(input_dataset, variant_tensor)
 
@@ -4847,8 +4878,14 @@ class ParallelInterleaveDataset(UnaryDataset):
                num_parallel_calls,
                buffer_output_elements=AUTOTUNE,
                prefetch_input_elements=AUTOTUNE,
-               deterministic=None):
-    """See `Dataset.interleave()` for details."""
+               deterministic=None,
+               reorder_window=None):
+    """See `Dataset.interleave()` for details.
+
+    `reorder_window`, if positive, bounds the reordering of a nondeterministic
+    interleave: an input element that is skipped is waited for once that many
+    results have been returned since it was first skipped.
+    """
     self._input_dataset = input_dataset
     self._map_func = StructuredFunctionWrapper(
         map_func, self._transformation_name(), dataset=input_dataset)
@@ -4889,6 +4926,7 @@ class ParallelInterleaveDataset(UnaryDataset):
         self._num_parallel_calls,
         f=self._map_func.function,
         deterministic=deterministic_string,
+        reorder_window=reorder_window,
         **self._flat_structure)
     super(ParallelInterleaveDataset, self).__init__(input_dataset,
                                                     variant_tensor)
@@ -4939,7 +4977,11 @@ class FilterDataset(UnaryUnchangedStructureDataset):
 class PrefetchDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that asynchronously prefetches its input."""
 
-  def __init__(self, input_dataset, buffer_size, slack_period=None):
+  def __init__(self,
+               input_dataset,
+               buffer_size,
+               slack_period=None,
+               max_producers=None):
     """See `Dataset.prefetch()` for details.
 
     Args:
@@ -4951,6 +4993,11 @@ class PrefetchDataset(UnaryUnchangedStructureDataset):
         user should not have to set this manually; enable this behavior
         automatically via `tf.data.Options.experimental_slack` instead. Defaults
         to None.
+      max_producers: (Optional.) An integer. The maximum number of threads
+        among which an autotuned prefetch may divide the reading of its input.
+        Only takes effect when `tf.data.Options.experimental_deterministic` is
+        False, because elements read concurrently may be reordered. Defaults
+        to 1.
     """
     self._input_dataset = input_dataset
     if buffer_size is None:
@@ -4965,6 +5012,7 @@ class PrefetchDataset(UnaryUnchangedStructureDataset):
           input_dataset._variant_tensor,
           buffer_size=self._buffer_size,
           slack_period=slack_period,
+          max_producers=max_producers,
           **self._flat_structure)
     super(PrefetchDataset, self).__init__(input_dataset, variant_tensor)
 
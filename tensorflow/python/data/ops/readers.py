@@ -247,7 +247,11 @@ class TextLineDatasetV1(dataset_ops.DatasetV1Adapter):
 class _TFRecordDataset(dataset_ops.DatasetSource):
   """A `Dataset` comprising records from one or more TFRecord files."""
 
-  def __init__(self, filenames, compression_type=None, buffer_size=None):
+  def __init__(self,
+               filenames,
+               compression_type=None,
+               buffer_size=None,
+               use_mmap=None):
     """Creates a `TFRecordDataset`.
 
     Args:
@@ -256,6 +260,9 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      use_mmap: (Optional.) If `True`, uncompressed files are read through a
+        memory mapping instead of a read buffer. Ignored for compressed files.
+        (Defaults to `False`.)
     """
     self._filenames = filenames
     self._compression_type = convert.optional_param_to_tensor(
@@ -267,9 +274,13 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         "buffer_size",
         buffer_size,
         argument_default=_DEFAULT_READER_BUFFER_SIZE_BYTES)
-    variant_tensor = gen_dataset_ops.tf_record_dataset(self._filenames,
-                                                       self._compression_type,
-                                                       self._buffer_size)
+    if use_mmap is None:
+      use_mmap = False
+    variant_tensor = gen_dataset_ops.tf_record_dataset(
+        self._filenames,
+        self._compression_type,
+        self._buffer_size,
+        use_mmap=use_mmap)
     super(_TFRecordDataset, self).__init__(variant_tensor)
 
   @property